@@ -0,0 +1,231 @@
+/****************************************************************************************
+* ESP Captive Portal
+* This helper file provides the pieces of a Wi-Fi provisioning portal on the SoftAP:
+* 1. A DNS responder that answers every A query with the AP's IP, so phones & laptops that
+*    join the AP open the portal page by themselves. It answers in place in one fixed
+*    DNS_MAX_PACKET buffer (no heap use of its own), up to DNS_BURST queries per call,
+* 2. A request handler that sends every other host name to http://<AP IP>/wifi, and the
+*    /wifi page: a form for the network name & password.
+*
+* Submitted credentials are only stored here (portalSSID, portalPassword & the
+* portalCredentialsReceived flag) - ESPWiFiHelper.h picks them up from loop(), saves them
+* & connects. ESPWiFiHelper.h also decides when the portal runs (WIFI_MODE_AP_STA: after
+* the STA has been down for PORTAL_DEADLINE_MS).
+*
+* ElegantOTAHelper.h calls setupCaptivePortal(server) in setupOTA().
+****************************************************************************************/
+
+#ifndef ESPCaptivePortal_h
+#define ESPCaptivePortal_h
+
+#ifdef ESP32    // for ESP32 boards
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#endif
+
+#include <ESPAsyncWebServer.h>
+#include "ESPPageTemplate.h"   // flash pages rendered without String
+#include "ESPLog.h"            // buffered, non-blocking log
+
+#define DNS_PORT       53
+#define DNS_MAX_PACKET 512   // largest plain UDP DNS message
+#define DNS_BURST      16    // queries answered per handleCaptivePortal() call
+#define DNS_TTL        60    // s, short so clients ask again once the portal is gone
+
+const char PORTAL_PAGE[] PROGMEM =
+    "<!DOCTYPE html><html><head><meta name=\"viewport\" content=\"width=device-width\">"
+    "<title>%HOST% Wi-Fi setup</title></head><body>"
+    "<h3>%HOST% Wi-Fi setup</h3>"
+    "<form method=\"post\" action=\"/wifi\">"
+    "<p>Network<br><input name=\"ssid\" maxlength=\"32\" value=\"%SSID%\"></p>"
+    "<p>Password<br><input name=\"password\" type=\"password\" maxlength=\"64\"></p>"
+    "<p><button>Save & connect</button></p>"
+    "</form></body></html>";
+const char PORTAL_SAVED_PAGE[] PROGMEM =
+    "<!DOCTYPE html><html><head><meta name=\"viewport\" content=\"width=device-width\"></head><body>"
+    "<h3>Saved</h3><p>Connecting to %SSID%... this access point closes once connected.</p>"
+    "</body></html>";
+
+WiFiUDP dnsUDP;
+uint8_t dnsPacket[DNS_MAX_PACKET];          // query in, answer out
+uint8_t portalIP[4];                         // address every name resolves to
+bool captivePortalActive = false;
+
+char portalSSID[33];                         // last submitted credentials
+char portalPassword[65];
+volatile bool portalCredentialsReceived = false;   // set by the web handler, cleared by the Wi-Fi helper
+
+
+// Turn the DNS query in `packet` into an answer in place: A (or ANY) queries for any name get
+// `ip`, other types get an empty answer. Returns the answer length, 0 to drop the packet.
+size_t buildDnsAnswer(uint8_t* packet, size_t length, size_t maxLength, const uint8_t ip[4]) {
+  if (length < 12 || (packet[2] & 0x80) || (packet[2] & 0x78) ||   // a response, or not a standard query
+      packet[4] != 0 || packet[5] != 1) {                           // exactly one question
+    return 0;
+  }
+
+  // Walk the name, plain labels only (queries do not use compression)
+  size_t pos = 12;
+  while (true) {
+    if (pos >= length) return 0;
+    uint8_t label = packet[pos];
+    if (label == 0) break;
+    if ((label & 0xC0) || pos + label + 1 > 12 + 255) return 0;
+    pos += label + 1;
+  }
+  pos++;
+  if (pos + 4 > length) return 0;
+
+  uint16_t type = packet[pos] << 8 | packet[pos + 1];
+  uint16_t klass = packet[pos + 2] << 8 | packet[pos + 3];
+  pos += 4;   // end of the question, anything after it (EDNS etc.) is dropped
+  bool answer = (type == 1 || type == 255) && (klass == 1 || klass == 255);
+  if (answer && pos + 16 > maxLength) return 0;
+
+  packet[2] = 0x84 | (packet[2] & 0x01);   // response, authoritative, keep recursion desired
+  packet[3] = 0x80;                        // recursion available, no error
+  packet[6] = 0;                           // answer count
+  packet[7] = answer ? 1 : 0;
+  memset(packet + 8, 0, 4);                // no authority or additional records
+
+  if (answer) {
+    const uint8_t record[12] = {
+      0xC0, 0x0C,                          // name: pointer to the question
+      0x00, 0x01, 0x00, 0x01,              // type A, class IN
+      0x00, 0x00, 0x00, DNS_TTL,           // TTL
+      0x00, 0x04                           // 4 byte address
+    };
+    memcpy(packet + pos, record, sizeof(record));
+    memcpy(packet + pos + sizeof(record), ip, 4);
+    pos += sizeof(record) + 4;
+  }
+  return pos;
+}
+
+// Answer the DNS queries waiting, call often while the portal runs
+void handleCaptivePortal() {
+  if (!captivePortalActive) {
+    return;
+  }
+  for (int i = 0; i < DNS_BURST; i++) {
+    int length = dnsUDP.parsePacket();
+    if (length <= 0) {
+      break;
+    }
+    size_t received = dnsUDP.read(dnsPacket, sizeof(dnsPacket));
+    size_t answerLength = length <= DNS_MAX_PACKET ? buildDnsAnswer(dnsPacket, received, sizeof(dnsPacket), portalIP) : 0;
+    if (answerLength > 0) {
+      dnsUDP.beginPacket(dnsUDP.remoteIP(), dnsUDP.remotePort());
+      dnsUDP.write(dnsPacket, answerLength);
+      dnsUDP.endPacket();
+    }
+  }
+}
+
+// Start answering DNS with `ip`, the SoftAP must be up
+void startCaptivePortal(IPAddress ip) {
+  for (int i = 0; i < 4; i++) {
+    portalIP[i] = ip[i];
+  }
+  dnsUDP.begin(DNS_PORT);
+  captivePortalActive = true;
+  LOG_I("Captive portal on http://%u.%u.%u.%u/wifi\n", portalIP[0], portalIP[1], portalIP[2], portalIP[3]);
+}
+
+void stopCaptivePortal() {
+  if (captivePortalActive) {
+    dnsUDP.stop();
+    captivePortalActive = false;
+    LOG_I("Captive portal closed.\n");
+  }
+}
+
+// Fill in the portal page fields
+bool portalPageFields(const char* name, char* out, size_t outSize) {
+  if (strcmp(name, "SSID") == 0) {
+    // HTML escaped, TEMPLATE_MAX_VALUE cuts very long names short
+    size_t n = 0;
+    for (const char* c = portalSSID; *c; c++) {
+      const char* entity = *c == '"' ? "&quot;" : *c == '<' ? "&lt;" : *c == '>' ? "&gt;" : *c == '&' ? "&amp;" : nullptr;
+      size_t entityLength = entity ? strlen(entity) : 1;
+      if (n + entityLength >= outSize) break;
+      if (entity) {
+        memcpy(out + n, entity, entityLength);
+      } else {
+        out[n] = *c;
+      }
+      n += entityLength;
+    }
+    out[n] = '\0';
+  } else if (strcmp(name, "HOST") == 0) {
+#ifdef ESP32
+    snprintf(out, outSize, "%s", WiFi.getHostname());
+#elif defined(ESP8266)
+    snprintf(out, outSize, "%s", wifi_station_get_hostname());
+#endif
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// While the portal runs: the /wifi page & form, and a redirect to it for any other host
+class CaptivePortalHandler : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest *request) override {
+    if (!captivePortalActive || !arrivedOnAP(request)) {
+      return false;   // requests from the STA side are left alone
+    }
+    return !isPortalHost(request) || request->url() == "/wifi";
+  }
+
+  void handleRequest(AsyncWebServerRequest *request) override {
+    if (!isPortalHost(request)) {
+      char location[32];
+      snprintf(location, sizeof(location), "http://%u.%u.%u.%u/wifi", portalIP[0], portalIP[1], portalIP[2], portalIP[3]);
+      request->redirect(location);
+    } else if (request->method() == HTTP_POST) {
+      const AsyncWebParameter* ssid = request->getParam("ssid", true);
+      const AsyncWebParameter* password = request->getParam("password", true);
+      if (!ssid || ssid->value().length() == 0 || ssid->value().length() >= sizeof(portalSSID) ||
+          (password && password->value().length() >= sizeof(portalPassword))) {
+        request->send(400, "text/plain", "Network name 1-32 characters, password up to 64");
+        return;
+      }
+      snprintf(portalSSID, sizeof(portalSSID), "%s", ssid->value().c_str());
+      snprintf(portalPassword, sizeof(portalPassword), "%s", password ? password->value().c_str() : "");
+      portalCredentialsReceived = true;
+      sendTemplate(request, "text/html", PORTAL_SAVED_PAGE, portalPageFields);
+    } else {
+      sendTemplate(request, "text/html", PORTAL_PAGE, portalPageFields);
+    }
+  }
+
+private:
+  // Request came in through the SoftAP
+  static bool arrivedOnAP(AsyncWebServerRequest *request) {
+    IPAddress local = request->client()->localIP();
+    return local[0] == portalIP[0] && local[1] == portalIP[1] && local[2] == portalIP[2] && local[3] == portalIP[3];
+  }
+
+  // Request addressed to the AP IP (not a connectivity check to some other host)
+  static bool isPortalHost(AsyncWebServerRequest *request) {
+    char host[16];
+    snprintf(host, sizeof(host), "%u.%u.%u.%u", portalIP[0], portalIP[1], portalIP[2], portalIP[3]);
+    return request->host() == host;
+  }
+};
+
+CaptivePortalHandler captivePortalHandler;
+
+
+// Register the portal pages, call in setupOTA() (ElegantOTAHelper.h does)
+void setupCaptivePortal(AsyncWebServer& webServer) {
+  webServer.addHandler(&captivePortalHandler);
+}
+
+#endif
@@ -0,0 +1,80 @@
+/****************************************************************************************
+* ESP Helper Features
+* This helper file holds the BUILT-IN FEATURES switches of ESPWiFiHelper.h &
+* ElegantOTAHelper.h in one place, so both see the same defaults whichever is included
+* first. Each switch is 1 unless set with -D in platformio.ini build_flags, and a switch
+* at 0 leaves that feature's code, strings & buffers out of the firmware entirely.
+*
+* `python size_report.py <project dir>` prints flash & RAM per env, to see what each costs.
+****************************************************************************************/
+
+#ifndef ESPHelperFeatures_h
+#define ESPHelperFeatures_h
+
+/****************************************************
+ *************** BUILT-IN FEATURES ******************
+ ** Set to 0 in platformio.ini build_flags (e.g.   **
+ ** -DWIFI_HELPER_SOFTAP=0) to leave a feature's   **
+ ** code & strings out of the firmware entirely    **
+ ****************************************************/
+
+// ESPWiFiHelper.h
+#ifndef WIFI_HELPER_STA
+#define WIFI_HELPER_STA          1   // Station mode
+#endif
+#ifndef WIFI_HELPER_SOFTAP
+#define WIFI_HELPER_SOFTAP       1   // SoftAP mode
+#endif
+#ifndef WIFI_HELPER_STATIC_IP
+#define WIFI_HELPER_STATIC_IP    1   // static IP in STA mode (DHCP only if 0)
+#endif
+#ifndef WIFI_HELPER_FAST_CONNECT
+#define WIFI_HELPER_FAST_CONNECT 1   // RTC cached AP & IP (ESPWiFiFastConnect.h)
+#endif
+#ifndef WIFI_HELPER_REACHABILITY
+#define WIFI_HELPER_REACHABILITY 1   // internet probes (ESPReachability.h), a connection counts as internet if 0
+#endif
+#ifndef WIFI_HELPER_CONFIG_FILE
+#define WIFI_HELPER_CONFIG_FILE  1   // load the saved config from LittleFS (ESPWiFiConfig.h)
+#endif
+#ifndef WIFI_HELPER_METRICS
+#define WIFI_HELPER_METRICS      1   // RSSI, connection & probe metrics on /metrics (ESPMetrics.h)
+#endif
+#ifndef WIFI_HELPER_PORTAL
+#if __has_include(<ESPAsyncWebServer.h>)
+#define WIFI_HELPER_PORTAL       1   // WIFI_MODE_AP_STA: setup AP & captive portal (ESPCaptivePortal.h), needs ESPAsyncWebServer
+#else
+#define WIFI_HELPER_PORTAL       0
+#endif
+#endif
+#ifndef WIFI_HELPER_EVENTS
+#define WIFI_HELPER_EVENTS       WIFI_HELPER_STA   // event bus for subscribers (ESPWiFiEvents.h)
+#endif
+#ifndef WIFI_HELPER_LINK_QUALITY
+#define WIFI_HELPER_LINK_QUALITY WIFI_HELPER_STA   // RSSI history on /link & adaptive TX power (ESPLinkQuality.h)
+#endif
+#ifndef HELPER_STATUS_LED
+#define HELPER_STATUS_LED        WIFI_HELPER_STA   // LED patterns from a timer (ESPStatusLED.h), LED left alone if 0
+#endif
+
+// Both helpers
+#ifndef HELPER_STATUS_PUSH
+#define HELPER_STATUS_PUSH       1   // live status WebSocket on /status (ESPStatusPush.h), setStatus() does nothing if 0
+#endif
+
+// ElegantOTAHelper.h
+#ifndef OTA_HELPER_VERIFY
+#define OTA_HELPER_VERIFY        1   // SHA-256 check & upload metrics (ESPOTAVerify.h), ElegantOTA reboots by itself if 0
+#endif
+#ifndef OTA_HELPER_PATCH
+#define OTA_HELPER_PATCH         1   // compressed & delta images on /ota/patch (ESPOTAPatch.h), ~2.4 KB of RAM for the decoder
+#endif
+
+#if WIFI_HELPER_LINK_QUALITY && !WIFI_HELPER_EVENTS
+#error "WIFI_HELPER_LINK_QUALITY needs WIFI_HELPER_EVENTS: the link goes back to full power on the bus' disconnect event"
+#endif
+#if OTA_HELPER_PATCH && !OTA_HELPER_VERIFY
+#error "OTA_HELPER_PATCH needs OTA_HELPER_VERIFY: a patched image is checked & rebooted into by ESPOTAVerify.h"
+#endif
+
+#endif
@@ -0,0 +1,418 @@
+/****************************************************************************************
+* ESP OTA Patch
+* This helper file takes compressed firmware images & deltas against the running firmware
+* on /ota/patch, made by ota_patch.py, so weak links send far fewer bytes than the ~400 KB
+* firmware.bin that ElegantOTA's /update takes:
+* 1. The .otz stream is a list of operations: literal bytes, copies from the last
+*    OTZ_WINDOW bytes written (LZ compression) & copies from the running firmware (delta),
+* 2. It is decoded as it arrives, straight into the OTA partition through Update - RAM use
+*    is the decoder struct (~2.4 KB), never the image,
+* 3. A delta names the MD5 of the firmware it was made against & is refused by any other,
+* 4. The decoded image goes through the same SHA-256 check & metrics as an ElegantOTA
+*    upload (ESPOTAVerify.h) & handleOTA() reboots into it.
+*
+* To use this helper:
+* - ElegantOTAHelper.h calls setupOTAPatch(server) in setupOTA(),
+* - Build the file on your PC:
+*     python ota_patch.py .pio/build/<env>/firmware.bin -o fw.otz                 (compressed)
+*     python ota_patch.py .pio/build/<env>/firmware.bin --base old.bin -o fw.otz  (delta)
+*   `old.bin` must be the firmware.bin the board is running now.
+* - Upload it: curl -F "file=@fw.otz" http://[esp.ip.address]/ota/patch
+*   (add --digest -u user:password when OTA_USERNAME is set, /ota/patch asks for the same login)
+*
+* The decoder (otz* functions) only touches memory, the board specific parts are the
+* callbacks passed to otzBegin().
+****************************************************************************************/
+
+#ifndef ESPOTAPatch_h
+#define ESPOTAPatch_h
+
+#include <Arduino.h>
+
+#ifdef ESP32    // for ESP32 boards
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <Updater.h>
+#endif
+
+#include <ESPAsyncWebServer.h>
+#include "ESPOTAVerify.h"          // SHA-256 check, metrics & reboot
+
+#define OTZ_WINDOW      2048   // back reference window in bytes (power of 2), ota_patch.py must not use more
+#define OTZ_OUT_BUFFER  256    // decoded bytes per write callback
+#define OTZ_BASE_CHUNK  64     // bytes per base read callback
+#define OTZ_HEADER_SIZE 30     // "OTZ1", target size, base size, window, base MD5
+
+// Operations, in the top 2 bits of the op byte, the low 6 bits hold the length (0 = varint follows)
+#define OTZ_OP_LITERAL 0   // <length> literal bytes follow
+#define OTZ_OP_WINDOW  1   // varint distance back into the bytes already written
+#define OTZ_OP_BASE    2   // zigzag varint offset in the running firmware, relative to the end of the last base copy
+
+// Decoder states
+enum OtzState {
+  OTZ_HEADER,     // reading the header
+  OTZ_OP,         // waiting for an op byte
+  OTZ_LENGTH,     // reading a varint length
+  OTZ_LITERAL,    // copying literal bytes
+  OTZ_DISTANCE,   // reading a window copy distance
+  OTZ_OFFSET,     // reading a base copy offset
+  OTZ_ERROR       // stopped, see `error`
+};
+
+struct OtzDecoder;
+typedef bool (*OtzHeaderCallback)(OtzDecoder& decoder);                         // header read, false refuses the image
+typedef bool (*OtzWriteCallback)(const uint8_t* data, size_t length);           // decoded bytes, in order
+typedef bool (*OtzReadBaseCallback)(uint32_t offset, uint8_t* out, size_t length);  // bytes of the running firmware
+
+struct OtzDecoder {
+  OtzState state;
+  const char* error;               // why decoding stopped
+  uint8_t header[OTZ_HEADER_SIZE];
+  uint8_t headerLength;
+  uint32_t targetSize;             // size of the decoded image
+  uint32_t baseSize;               // size of the firmware a delta was made against, 0 if none
+  uint8_t baseMD5[16];             // MD5 of that firmware
+  uint32_t written;                // decoded bytes so far
+  uint8_t op;                      // current operation
+  uint32_t length;                 // bytes left in the current operation
+  uint32_t varint;                 // varint being read
+  uint8_t varintShift;
+  uint32_t baseNext;               // base offset following the last base copy
+  uint8_t window[OTZ_WINDOW];      // last bytes written
+  uint16_t windowPos;
+  uint8_t out[OTZ_OUT_BUFFER];     // bytes waiting for the write callback
+  uint16_t outLength;
+  OtzHeaderCallback onHeader;
+  OtzWriteCallback write;
+  OtzReadBaseCallback readBase;
+};
+
+
+// Stop decoding with a reason
+bool otzFail(OtzDecoder& d, const char* error) {
+  d.state = OTZ_ERROR;
+  d.error = error;
+  return false;
+}
+
+// Little endian field of the header
+uint32_t otzHeaderField(const OtzDecoder& d, int offset, int size) {
+  uint32_t value = 0;
+  for (int i = size - 1; i >= 0; i--) {
+    value = (value << 8) | d.header[offset + i];
+  }
+  return value;
+}
+
+// Pass the buffered output to the write callback
+bool otzFlush(OtzDecoder& d) {
+  if (d.outLength > 0 && !d.write(d.out, d.outLength)) {
+    return otzFail(d, "write failed");
+  }
+  d.outLength = 0;
+  return true;
+}
+
+// One decoded byte
+bool otzEmit(OtzDecoder& d, uint8_t b) {
+  if (d.written >= d.targetSize) {
+    return otzFail(d, "image larger than its header says");
+  }
+  d.window[d.windowPos] = b;
+  d.windowPos = (d.windowPos + 1) & (OTZ_WINDOW - 1);
+  d.out[d.outLength++] = b;
+  d.written++;
+  return d.outLength < OTZ_OUT_BUFFER || otzFlush(d);
+}
+
+// Collect a varint byte, sets `done` on its last byte
+bool otzVarint(OtzDecoder& d, uint8_t b, bool& done) {
+  if (d.varintShift > 28) {
+    return otzFail(d, "varint too long");
+  }
+  d.varint |= (uint32_t)(b & 0x7F) << d.varintShift;
+  d.varintShift += 7;
+  done = !(b & 0x80);
+  return true;
+}
+
+void otzStartVarint(OtzDecoder& d, OtzState state) {
+  d.varint = 0;
+  d.varintShift = 0;
+  d.state = state;
+}
+
+// Length known: literals follow, or the copy's distance/offset
+bool otzStartOp(OtzDecoder& d) {
+  if (d.length == 0) {
+    return otzFail(d, "zero length operation");
+  }
+  if (d.op == OTZ_OP_LITERAL) {
+    d.state = OTZ_LITERAL;
+  } else if (d.op == OTZ_OP_WINDOW) {
+    otzStartVarint(d, OTZ_DISTANCE);
+  } else if (d.baseSize > 0) {
+    otzStartVarint(d, OTZ_OFFSET);
+  } else {
+    return otzFail(d, "base copy in an image without a base");
+  }
+  return true;
+}
+
+// Copy `length` bytes from `distance` bytes back, may overlap what it writes
+bool otzCopyWindow(OtzDecoder& d, uint32_t distance) {
+  if (distance == 0 || distance > OTZ_WINDOW || distance > d.written) {
+    return otzFail(d, "bad window distance");
+  }
+  while (d.length > 0) {
+    if (!otzEmit(d, d.window[(d.windowPos - distance) & (OTZ_WINDOW - 1)])) {
+      return false;
+    }
+    d.length--;
+  }
+  return true;
+}
+
+// Copy `length` bytes of the running firmware from `offset`
+bool otzCopyBase(OtzDecoder& d, uint32_t offset) {
+  if (offset > d.baseSize || d.length > d.baseSize - offset) {
+    return otzFail(d, "base copy out of range");
+  }
+  d.baseNext = offset + d.length;
+  uint8_t chunk[OTZ_BASE_CHUNK];
+  while (d.length > 0) {
+    size_t n = min((uint32_t)OTZ_BASE_CHUNK, d.length);
+    if (!d.readBase(offset, chunk, n)) {
+      return otzFail(d, "base read failed");
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (!otzEmit(d, chunk[i])) {
+        return false;
+      }
+    }
+    offset += n;
+    d.length -= n;
+  }
+  return true;
+}
+
+// Check & unpack the header, then hand it to the header callback
+bool otzReadHeader(OtzDecoder& d) {
+  if (memcmp(d.header, "OTZ1", 4) != 0) {
+    return otzFail(d, "not an .otz image");
+  }
+  d.targetSize = otzHeaderField(d, 4, 4);
+  d.baseSize = otzHeaderField(d, 8, 4);
+  if (otzHeaderField(d, 12, 2) > OTZ_WINDOW) {
+    return otzFail(d, "window larger than OTZ_WINDOW");
+  }
+  memcpy(d.baseMD5, d.header + 14, sizeof(d.baseMD5));
+  d.state = OTZ_OP;
+  return d.onHeader(d) || otzFail(d, d.error ? d.error : "image refused");
+}
+
+// Reset the decoder for a new image
+void otzBegin(OtzDecoder& d, OtzHeaderCallback onHeader, OtzWriteCallback write, OtzReadBaseCallback readBase) {
+  memset(&d, 0, offsetof(OtzDecoder, window));
+  d.state = OTZ_HEADER;
+  d.onHeader = onHeader;
+  d.write = write;
+  d.readBase = readBase;
+}
+
+// Decode the next piece of the stream, pieces can be cut anywhere
+bool otzFeed(OtzDecoder& d, const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    uint8_t b = data[i];
+    bool done;
+
+    switch (d.state) {
+      case OTZ_HEADER:
+        d.header[d.headerLength++] = b;
+        if (d.headerLength == OTZ_HEADER_SIZE && !otzReadHeader(d)) {
+          return false;
+        }
+        break;
+
+      case OTZ_OP:
+        d.op = b >> 6;
+        d.length = b & 0x3F;
+        if (d.op > OTZ_OP_BASE) {
+          return otzFail(d, "unknown operation");
+        }
+        if (d.length == 0) {
+          otzStartVarint(d, OTZ_LENGTH);
+        } else if (!otzStartOp(d)) {
+          return false;
+        }
+        break;
+
+      case OTZ_LENGTH:
+        if (!otzVarint(d, b, done)) return false;
+        if (done) {
+          d.length = d.varint;
+          if (!otzStartOp(d)) return false;
+        }
+        break;
+
+      case OTZ_LITERAL:
+        if (!otzEmit(d, b)) return false;
+        if (--d.length == 0) {
+          d.state = OTZ_OP;
+        }
+        break;
+
+      case OTZ_DISTANCE:
+        if (!otzVarint(d, b, done)) return false;
+        if (done) {
+          if (!otzCopyWindow(d, d.varint)) return false;
+          d.state = OTZ_OP;
+        }
+        break;
+
+      case OTZ_OFFSET:
+        if (!otzVarint(d, b, done)) return false;
+        if (done) {
+          int32_t delta = (int32_t)(d.varint >> 1) ^ -(int32_t)(d.varint & 1);   // zigzag
+          if (!otzCopyBase(d, d.baseNext + delta)) return false;
+          d.state = OTZ_OP;
+        }
+        break;
+
+      case OTZ_ERROR:
+        return false;
+    }
+  }
+  return true;
+}
+
+// End of the stream: flush & check the whole image was decoded
+bool otzFinish(OtzDecoder& d) {
+  if (d.state == OTZ_ERROR) {
+    return false;
+  }
+  if (d.state != OTZ_OP || d.written != d.targetSize) {
+    return otzFail(d, "image cut short");
+  }
+  return otzFlush(d);
+}
+
+
+/************************** Board side: Update & flash **************************/
+
+OtzDecoder otaPatchDecoder;
+char runningMD5[33];   // MD5 of the running firmware, what a delta must have been made against
+bool otaPatchFailed = false;
+
+
+// Header read: check a delta's base & start the update
+bool otaPatchHeader(OtzDecoder& d) {
+  if (d.baseSize > 0) {
+    char md5[33];
+    for (int i = 0; i < 16; i++) {
+      snprintf(md5 + i * 2, 3, "%02x", d.baseMD5[i]);
+    }
+    if (d.baseSize != ESP.getSketchSize() || strcmp(md5, runningMD5) != 0) {
+      d.error = "delta was made against different firmware";
+      return false;
+    }
+  }
+
+#ifdef ESP8266
+  Update.runAsync(true);   // called from the web server, must not yield
+#endif
+  if (!Update.begin(d.targetSize)) {
+    d.error = "Update.begin failed, image too large?";
+    return false;
+  }
+  return true;
+}
+
+// Decoded bytes go to the OTA partition
+bool otaPatchWrite(const uint8_t* data, size_t length) {
+#ifdef ESP8266
+  ESP.wdtFeed();   // a delta can expand a few bytes into many sectors
+#endif
+  return Update.write((uint8_t*)data, length) == length;
+}
+
+// Read the running firmware, it starts at offset 0 of the running partition (ESP32) or flash (ESP8266)
+bool otaPatchReadBase(uint32_t offset, uint8_t* out, size_t length) {
+#ifdef ESP32
+  return esp_partition_read(esp_ota_get_running_partition(), offset, out, length) == ESP_OK;
+#elif defined(ESP8266)
+  uint32_t aligned[OTZ_BASE_CHUNK / 4 + 2];   // flashRead needs 4 byte alignment
+  uint32_t start = offset & ~3;
+  size_t span = ((offset + length + 3) & ~3) - start;
+  if (!ESP.flashRead(start, aligned, span)) {
+    return false;
+  }
+  memcpy(out, (uint8_t*)aligned + (offset - start), length);
+  return true;
+#endif
+}
+
+// Give up on the update, nothing is booted from it
+void otaPatchAbort() {
+  if (!Update.isRunning()) {
+    return;
+  }
+#ifdef ESP32
+  Update.abort();
+#elif defined(ESP8266)
+  Update.end();        // an unfinished image is dropped, a finished one is committed...
+  discardNewImage();   // ...& not booted
+#endif
+}
+
+// Upload handler for /ota/patch
+void handlePatchUpload(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final) {
+  if (!otaAuthorized(request)) {
+    return;   // the request handler asks for the login
+  }
+  if (index == 0) {
+    otzBegin(otaPatchDecoder, otaPatchHeader, otaPatchWrite, otaPatchReadBase);
+    otaPatchFailed = false;
+    otaStartFilesystem = false;   // a patch is always firmware
+    otaStarted();
+  }
+  if (otaPatchFailed) {
+    return;
+  }
+
+  bool ok = otzFeed(otaPatchDecoder, data, len);
+  otaProgress(index + len, request->contentLength());
+  if (ok && final) {
+    ok = otzFinish(otaPatchDecoder) && (Update.end() || otzFail(otaPatchDecoder, "Update.end failed"));
+  }
+
+  if (!ok) {
+    otaPatchFailed = true;
+    otaPatchAbort();
+    LOG_E("OTA patch failed: %s\n", otaPatchDecoder.error);
+    otaEnded(false, otaPatchDecoder.written);   // failed on /metrics & the status push, OTA priority off
+  } else if (final) {
+    LOG_I("OTA patch: %u bytes decoded from %u\n",
+          (unsigned)otaPatchDecoder.written, (unsigned)(index + len));
+    otaEnded(true, otaPatchDecoder.written);
+  }
+}
+
+// Register /ota/patch, call in setupOTA() (ElegantOTAHelper.h does)
+void setupOTAPatch(AsyncWebServer& webServer) {
+  snprintf(runningMD5, sizeof(runningMD5), "%s", ESP.getSketchMD5().c_str());   // worked out once, at boot
+
+  webServer.on("/ota/patch", HTTP_POST, [](AsyncWebServerRequest *request){
+    if (!otaAuthorized(request)) {
+      return request->requestAuthentication();
+    }
+    bool ok = !otaPatchFailed && otaVerifyState == OTA_VERIFY_PENDING;
+    request->send(ok ? 200 : 400, "text/plain", ok ? "OK, verifying & rebooting"
+                  : otaPatchDecoder.error ? otaPatchDecoder.error : "no image received");
+  }, handlePatchUpload);
+}
+
+#endif
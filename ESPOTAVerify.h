@@ -0,0 +1,452 @@
+/****************************************************************************************
+* ESP OTA Verify
+* This helper file hooks into ElegantOTA's onStart/onProgress/onEnd callbacks to:
+* 1. Track the upload: bytes, chunk sizes, throughput (bytes/s) & stalls (gaps between
+*    chunks longer than OTA_STALL_MS),
+* 2. Check the new image against a SHA-256 digest posted by your deploy tool before the
+*    upload: POST /ota/sha256 with digest=<64 hex digits>,
+* 3. Only reboot into the new image if it matches - otherwise the boot partition (ESP32)
+*    or the pending copy command (ESP8266) is cleared and the old firmware keeps running.
+*
+* Update.end() commits the new image (boot partition / eboot copy command) before it can
+* be read back, so onEnd takes that back & keeps it in RAM, and it is only written again
+* once the digest matches: a reset or power cut before then boots the running firmware.
+* The window left is between Update.end() & onEnd, in the same web server callback.
+* /ota/sha256 asks for the same login as ElegantOTA (setOTAAuth(), setupOTA() sets both).
+*
+* ElegantOTA only reports progress, not the data, so the digest is worked out by reading
+* the written image back from flash in OTA_HASH_BLOCK byte blocks (no copy of the image
+* in RAM) once the upload has finished, from loop() - not from the web server callback.
+*
+* ElegantOTAHelper.h sets this up in setupOTA() & runs it from handleOTA(), so call
+* handleOTA() (or scheduleOTA()) instead of ElegantOTA.loop() - auto reboot is turned off.
+* Without a posted digest the image is still hashed & the digest printed, then rebooted.
+* Filesystem uploads (ElegantOTA's "LittleFS" mode) are not hashed, they reboot as before.
+****************************************************************************************/
+
+#ifndef ESPOTAVerify_h
+#define ESPOTAVerify_h
+
+#include <Arduino.h>
+
+#ifdef ESP32    // for ESP32 boards
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <eboot_command.h>
+#endif
+
+#include <ESPAsyncWebServer.h>
+#include <ElegantOTA.h>
+#include "ESPLog.h"                // flushed before the reboot
+#include "ESPMetrics.h"            // last upload on /metrics
+#include "ESPStatusPush.h"         // upload progress pushed to dashboards
+#include "ESPAdmission.h"          // OTA priority while uploading
+
+#define OTA_HASH_BLOCK 1024   // bytes read from flash per hash step (multiple of 4)
+
+const unsigned long OTA_STALL_MS = 500;   // gap between chunks counted as a stall
+
+// Upload metrics of the last (or running) update
+struct OTAStats {
+  unsigned long startMS;        // onStart time
+  unsigned long lastChunkMS;    // time of the last progress callback
+  unsigned long durationMS;     // start to end
+  size_t bytes;                 // bytes received
+  size_t chunks;                // progress callbacks
+  size_t minChunk;              // smallest chunk
+  size_t maxChunk;              // largest chunk
+  unsigned long maxStallMS;     // longest gap between chunks
+  unsigned long stallMS;        // total time in gaps longer than OTA_STALL_MS
+  size_t imageSize;             // bytes written to flash (more than `bytes` for a compressed upload)
+  bool success;                 // ElegantOTA reported success
+  bool verified;                // digest matched
+  bool filesystem;              // filesystem image (mode=fs), written to the FS partition & not hashed
+};
+
+// Outcome of the digest check
+enum OTAVerifyState {
+  OTA_VERIFY_IDLE,      // nothing to check
+  OTA_VERIFY_PENDING,   // upload done, handleOTAVerify() will check it
+  OTA_VERIFY_PASSED,    // matched (or no digest posted), rebooting
+  OTA_VERIFY_FAILED     // mismatch, new image discarded
+};
+
+OTAStats otaStats;
+volatile OTAVerifyState otaVerifyState = OTA_VERIFY_IDLE;  // set from the web server callbacks
+uint8_t otaExpectedDigest[32];   // posted by the deploy tool
+bool otaHasExpectedDigest = false;
+bool otaStartFilesystem = false; // the last /ota/start asked for a filesystem upload
+const char* otaAuthUser = "";    // ElegantOTA's login, empty = none
+const char* otaAuthPassword = "";
+
+#ifdef ESP32
+const esp_partition_t* otaNewPartition = nullptr;   // Update.end()'s boot partition, held until verified
+#elif defined(ESP8266)
+struct eboot_command otaCopyCommand;                // Update.end()'s copy command, held until verified
+bool otaHasCopyCommand = false;
+#endif
+
+// ElegantOTA's onStart() does not say what is uploaded: this handler looks at /ota/start
+// before ElegantOTA's own does & notes the mode, otaStarted() picks it up
+class OTAModeSniffer : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest *request) override {
+    if (request->url() == "/ota/start") {
+      const AsyncWebParameter* mode = request->getParam("mode");
+      otaStartFilesystem = mode && mode->value() == "fs";
+    }
+    return false;   // ElegantOTA handles it
+  }
+};
+
+OTAModeSniffer otaModeSniffer;
+
+
+/************** SHA-256 (FIPS 180-4), streaming, 108 bytes of state **************/
+
+struct Sha256 {
+  uint32_t state[8];
+  uint64_t length;       // bytes hashed
+  uint8_t block[64];     // partial block
+  uint8_t blockLength;
+};
+
+const uint32_t SHA256_K[64] PROGMEM = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+uint32_t sha256Rotr(uint32_t x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+void sha256Transform(Sha256& ctx, const uint8_t* data) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (uint32_t)data[i * 4] << 24 | (uint32_t)data[i * 4 + 1] << 16 | (uint32_t)data[i * 4 + 2] << 8 | data[i * 4 + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = sha256Rotr(w[i - 15], 7) ^ sha256Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = sha256Rotr(w[i - 2], 17) ^ sha256Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  uint32_t a = ctx.state[0], b = ctx.state[1], c = ctx.state[2], d = ctx.state[3];
+  uint32_t e = ctx.state[4], f = ctx.state[5], g = ctx.state[6], h = ctx.state[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (sha256Rotr(e, 6) ^ sha256Rotr(e, 11) ^ sha256Rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                  pgm_read_dword(&SHA256_K[i]) + w[i];
+    uint32_t t2 = (sha256Rotr(a, 2) ^ sha256Rotr(a, 13) ^ sha256Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+  }
+  ctx.state[0] += a; ctx.state[1] += b; ctx.state[2] += c; ctx.state[3] += d;
+  ctx.state[4] += e; ctx.state[5] += f; ctx.state[6] += g; ctx.state[7] += h;
+}
+
+void sha256Begin(Sha256& ctx) {
+  const uint32_t init[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                             0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+  memcpy(ctx.state, init, sizeof(init));
+  ctx.length = 0;
+  ctx.blockLength = 0;
+}
+
+void sha256Update(Sha256& ctx, const uint8_t* data, size_t length) {
+  ctx.length += length;
+  while (length--) {
+    ctx.block[ctx.blockLength++] = *data++;
+    if (ctx.blockLength == 64) {
+      sha256Transform(ctx, ctx.block);
+      ctx.blockLength = 0;
+    }
+  }
+}
+
+void sha256End(Sha256& ctx, uint8_t digest[32]) {
+  uint64_t bits = ctx.length * 8;
+  uint8_t pad = 0x80;
+  sha256Update(ctx, &pad, 1);
+  pad = 0;
+  while (ctx.blockLength != 56) {
+    sha256Update(ctx, &pad, 1);
+  }
+  for (int i = 7; i >= 0; i--) {
+    uint8_t b = bits >> (i * 8);
+    sha256Update(ctx, &b, 1);
+  }
+  for (int i = 0; i < 32; i++) {
+    digest[i] = ctx.state[i / 4] >> (24 - (i % 4) * 8);
+  }
+}
+
+/*********************************************************************************/
+
+
+// Parse 64 hex digits into 32 bytes
+bool parseDigest(const char* hex, uint8_t digest[32]) {
+  if (strlen(hex) != 64) {
+    return false;
+  }
+  for (int i = 0; i < 32; i++) {
+    char byteHex[3] = { hex[i * 2], hex[i * 2 + 1], '\0' };
+    char* end;
+    digest[i] = strtoul(byteHex, &end, 16);
+    if (*end != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Log a digest as hex
+void printDigest(const char* label, const uint8_t digest[32]) {
+  char hex[65];
+  for (int i = 0; i < 32; i++) {
+    snprintf(hex + i * 2, 3, "%02x", digest[i]);
+  }
+  LOG_I("%s%s\n", label, hex);
+}
+
+// Set the login /ota/sha256 (& /ota/patch) ask for, the same as ElegantOTA.begin()'s
+void setOTAAuth(const char* username, const char* password) {
+  otaAuthUser = username;
+  otaAuthPassword = password;
+}
+
+// True if no login is set or the request carries it
+bool otaAuthorized(AsyncWebServerRequest* request) {
+  return !otaAuthUser[0] || request->authenticate(otaAuthUser, otaAuthPassword);
+}
+
+// Take back the boot switch Update.end() just made & keep it in RAM, so a reset before
+// handleOTAVerify() has checked the image boots the running firmware
+void holdNewImage() {
+#ifdef ESP32
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  otaNewPartition = esp_ota_get_boot_partition();
+  if (otaNewPartition == running) {
+    otaNewPartition = nullptr;
+  } else {
+    esp_ota_set_boot_partition(running);
+  }
+#elif defined(ESP8266)
+  otaHasCopyCommand = eboot_command_read(&otaCopyCommand) == 0 && otaCopyCommand.action == ACTION_COPY_RAW;
+  eboot_command_clear();
+#endif
+}
+
+// Boot the held image on the next restart
+void commitNewImage() {
+#ifdef ESP32
+  esp_ota_set_boot_partition(otaNewPartition);
+#elif defined(ESP8266)
+  eboot_command_write(&otaCopyCommand);
+#endif
+}
+
+// Hash the image holdNewImage() held back, reading it from flash.
+// Returns false if the image location could not be found.
+bool hashNewImage(uint8_t digest[32]) {
+  static uint32_t buffer[OTA_HASH_BLOCK / 4];   // 4 byte aligned for the flash reads
+  Sha256 ctx;
+  sha256Begin(ctx);
+
+#ifdef ESP32
+  const esp_partition_t* partition = otaNewPartition;
+  if (!partition) {
+    return false;
+  }
+  size_t size = otaStats.imageSize;
+  for (size_t offset = 0; offset < size; offset += OTA_HASH_BLOCK) {
+    size_t length = min((size_t)OTA_HASH_BLOCK, size - offset);
+    esp_partition_read(partition, offset, buffer, length);
+    sha256Update(ctx, (const uint8_t*)buffer, length);
+    yield();
+  }
+#elif defined(ESP8266)
+  if (!otaHasCopyCommand) {
+    return false;
+  }
+  uint32_t address = otaCopyCommand.args[0];   // where Update wrote the new image
+  size_t size = otaCopyCommand.args[2];
+  for (size_t offset = 0; offset < size; offset += OTA_HASH_BLOCK) {
+    size_t length = min((size_t)OTA_HASH_BLOCK, size - offset);
+    ESP.flashRead(address + offset, buffer, (length + 3) & ~3);
+    sha256Update(ctx, (const uint8_t*)buffer, length);
+    yield();
+  }
+#endif
+
+  sha256End(ctx, digest);
+  return true;
+}
+
+// Stop the new image from being booted, the running firmware stays
+void discardNewImage() {
+#ifdef ESP32
+  esp_ota_set_boot_partition(esp_ota_get_running_partition());
+  otaNewPartition = nullptr;
+#elif defined(ESP8266)
+  eboot_command_clear();
+  otaHasCopyCommand = false;
+#endif
+}
+
+// Upload started: reset the metrics
+void otaStarted() {
+  memset(&otaStats, 0, sizeof(otaStats));
+  otaStats.startMS = millis();
+  otaStats.lastChunkMS = otaStats.startMS;
+  otaStats.minChunk = (size_t)-1;
+  otaStats.filesystem = otaStartFilesystem;
+  otaStartFilesystem = false;
+  otaVerifyState = OTA_VERIFY_IDLE;
+  setStatus(STATUS_OTA_STATE, OTA_STATE_UPLOADING);
+  setStatus(STATUS_OTA_BYTES, 0);
+  setOTAPriority(true);   // other routes are turned away until it ends
+}
+
+// `current` bytes of `final` received
+void otaProgress(size_t current, size_t final) {
+  unsigned long currentMS = millis();
+  size_t chunk = current - otaStats.bytes;
+  unsigned long gapMS = currentMS - otaStats.lastChunkMS;
+
+  otaStats.bytes = current;
+  otaStats.chunks++;
+  otaStats.minChunk = min(otaStats.minChunk, chunk);
+  otaStats.maxChunk = max(otaStats.maxChunk, chunk);
+  otaStats.maxStallMS = max(otaStats.maxStallMS, gapMS);
+  if (gapMS >= OTA_STALL_MS) {
+    otaStats.stallMS += gapMS;
+  }
+  otaStats.lastChunkMS = currentMS;
+  setStatus(STATUS_OTA_BYTES, current);   // coalesced, at most one message per PUSH_PERIOD_MS
+  setOTAPriority(true);
+}
+
+// Upload finished & Update.end() called, `imageSize` bytes were written to flash
+void otaEnded(bool success, size_t imageSize) {
+  otaStats.durationMS = millis() - otaStats.startMS;
+  otaStats.success = success;
+  otaStats.imageSize = imageSize;
+  if (success && !otaStats.filesystem) {
+    holdNewImage();   // booted only once handleOTAVerify() has checked it
+  }
+  otaVerifyState = success ? OTA_VERIFY_PENDING : OTA_VERIFY_IDLE;
+  setStatus(STATUS_OTA_STATE, success ? OTA_STATE_VERIFYING : OTA_STATE_FAILED);
+  setOTAPriority(false);
+}
+
+int32_t readOTAMetric(int arg) {
+  switch (arg) {
+    case 0: return otaStats.bytes;
+    case 1: return otaStats.durationMS;
+    case 2: return otaStats.maxStallMS;
+    default: return otaStats.success;
+  }
+}
+
+// Register the ElegantOTA callbacks & the digest endpoint, call before ElegantOTA.begin()
+// so the upload mode is seen before ElegantOTA handles /ota/start
+void setupOTAVerify(AsyncWebServer& webServer) {
+  webServer.addHandler(&otaModeSniffer);
+
+  registerGauge("ota_last_bytes", "Bytes received by the last update", nullptr, readOTAMetric, 0);
+  registerGauge("ota_last_duration_ms", "Duration of the last update", nullptr, readOTAMetric, 1);
+  registerGauge("ota_last_max_stall_ms", "Longest gap between chunks of the last update", nullptr, readOTAMetric, 2);
+  registerGauge("ota_last_success", "Last update reported success", nullptr, readOTAMetric, 3);
+
+  ElegantOTA.setAutoReboot(false);   // handleOTAVerify() reboots once the image is checked
+
+  // Deploy tool posts the expected digest before uploading
+  webServer.on("/ota/sha256", HTTP_POST, [](AsyncWebServerRequest *request){
+    if (!otaAuthorized(request)) {
+      return request->requestAuthentication();
+    }
+    const AsyncWebParameter* param = request->hasParam("digest", true) ? request->getParam("digest", true)
+                                                                       : request->getParam("digest");
+    if (param && parseDigest(param->value().c_str(), otaExpectedDigest)) {
+      otaHasExpectedDigest = true;
+      request->send(200, "text/plain", "OK");
+    } else {
+      request->send(400, "text/plain", "digest must be 64 hex digits");
+    }
+  });
+
+  ElegantOTA.onStart(otaStarted);
+  ElegantOTA.onProgress(otaProgress);
+  ElegantOTA.onEnd([](bool success) {
+    otaEnded(success, otaStats.bytes);   // ElegantOTA writes what it receives
+  });
+}
+
+// Log the metrics of the last update
+void printOTAStats() {
+  unsigned long rate = otaStats.durationMS ? otaStats.bytes * 1000UL / otaStats.durationMS : 0;
+  LOG_I("OTA: %u bytes in %lu ms (%lu bytes/s), %u chunks of %u-%u bytes, "
+        "stalled %lu ms (longest %lu ms)\n",
+        (unsigned)otaStats.bytes, otaStats.durationMS, rate, (unsigned)otaStats.chunks,
+        (unsigned)(otaStats.chunks ? otaStats.minChunk : 0), (unsigned)otaStats.maxChunk,
+        otaStats.stallMS, otaStats.maxStallMS);
+}
+
+// Check a finished upload & reboot into it if it is good, call from loop() (handleOTA() does)
+void handleOTAVerify() {
+  if (otaVerifyState != OTA_VERIFY_PENDING) {
+    return;
+  }
+
+  printOTAStats();
+
+  if (otaStats.filesystem) {   // no copy command to find, the new file system is mounted after the reboot
+    otaVerifyState = OTA_VERIFY_PASSED;
+    setStatus(STATUS_OTA_STATE, OTA_STATE_PASSED);
+    LOG_I("OTA: filesystem image written, rebooting...\n");
+    flushLog();
+    delay(100);
+    ESP.restart();
+    return;
+  }
+
+  uint8_t digest[32];
+  if (!hashNewImage(digest)) {
+    LOG_E("OTA: could not find the new image to verify it, discarding it.\n");
+    discardNewImage();
+    otaVerifyState = OTA_VERIFY_FAILED;
+    setStatus(STATUS_OTA_STATE, OTA_STATE_FAILED);
+    return;
+  }
+  printDigest("OTA: image SHA-256 ", digest);
+
+  if (otaHasExpectedDigest && memcmp(digest, otaExpectedDigest, sizeof(digest)) != 0) {
+    printDigest("OTA: expected SHA-256 ", otaExpectedDigest);
+    LOG_E("OTA: digest mismatch! Discarding the new image, keeping the running firmware.\n");
+    discardNewImage();
+    otaHasExpectedDigest = false;
+    otaVerifyState = OTA_VERIFY_FAILED;
+    setStatus(STATUS_OTA_STATE, OTA_STATE_FAILED);
+    return;
+  }
+
+  otaStats.verified = otaHasExpectedDigest;
+  otaHasExpectedDigest = false;
+  commitNewImage();
+  otaVerifyState = OTA_VERIFY_PASSED;
+  setStatus(STATUS_OTA_STATE, OTA_STATE_PASSED);
+  LOG_I("OTA: image accepted, rebooting...\n");
+  flushLog();   // queued Wi-Fi helper messages, then the UART
+  delay(100);
+  ESP.restart();
+}
+
+#endif
@@ -0,0 +1,216 @@
+/****************************************************************************************
+* ESP Profiler
+* This helper file is an opt-in instrumentation layer for finding what blocks loop():
+* 1. PROFILE_SCOPE("name") at the top of a function times it with the CPU cycle counter
+*    (two register reads & a few adds, well under a us) & keeps calls, total & longest
+*    time per call site in a fixed table (PROFILE_MAX_SITES),
+* 2. profileLoop() at the top of loop() times each loop() pass, without the time
+*    Scheduler::run() spends waiting, into a log scale histogram (4 buckets per power of
+*    2) for the p50/p95/p99 & longest pass,
+* 3. Any probe or loop() pass at or above PROFILE_STALL_US is a stall: the last
+*    PROFILE_MAX_STALLS are kept with the responsible site & logged with LOG_W(). For a
+*    loop() pass, the site named is the longest probe that ran in it. A pass this long
+*    also goes without feeding the watchdog, unless the code in it calls yield()/delay().
+*
+* The helpers' entry points (setupWiFi(), handleWiFi(), setupOTA()...) are instrumented.
+* With HELPER_PROFILE 0 (the default) PROFILE_SCOPE() compiles to nothing & profileLoop()
+* returns straight away, so the probes can stay in the code.
+*
+* To use this helper:
+* - Add -DHELPER_PROFILE=1 to build_flags,
+* - In main loop() > call profileLoop() first,
+* - Add PROFILE_SCOPE("name") to your own functions if needed (loop() context only, not ISRs),
+* - Call printProfile() (e.g. every minute) to print the table, the loop percentiles & stalls.
+*
+* The cycle counter wraps every 2^32 cycles (27 s at 160 MHz), longer probes are misread.
+****************************************************************************************/
+
+#ifndef ESPProfiler_h
+#define ESPProfiler_h
+
+#include <Arduino.h>
+#include "ESPScheduler.h"   // idle time excluded from loop() passes
+#include "ESPLog.h"         // stall messages
+
+#ifndef HELPER_PROFILE
+#define HELPER_PROFILE 0    // probes on = 1, set with -D in build_flags
+#endif
+
+#define PROFILE_MAX_SITES    16   // instrumented call sites
+#define PROFILE_MAX_STALLS   8    // last stalls kept
+#define PROFILE_LOOP_BUCKETS 96   // 4 per power of 2, loop() passes up to ~33 s
+
+const unsigned long PROFILE_STALL_US = 20000;   // probe or loop() pass at least this long is a stall
+
+#if HELPER_PROFILE
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_SCOPE(name) static int PROFILE_JOIN(profileSiteId, __LINE__) = profileSite(name); \
+                            ProfileScope PROFILE_JOIN(profileScope, __LINE__)(PROFILE_JOIN(profileSiteId, __LINE__))
+#else
+#define PROFILE_SCOPE(name) do {} while (0)
+#endif
+
+// Totals of one call site
+struct ProfileSite {
+  const char* name;
+  uint32_t calls;
+  uint64_t totalCycles;
+  uint32_t maxCycles;
+};
+
+// One stall
+struct ProfileStall {
+  const char* site;       // probe that stalled, or the longest probe in a slow loop() pass
+  uint32_t us;            // duration
+  uint32_t atMS;          // millis() when it ended
+  bool loopPass;          // a whole loop() pass = true | one probe = false
+};
+
+ProfileSite profileSites[PROFILE_MAX_SITES];
+int profileSiteCount = 0;
+uint32_t profileCpuMHz = 80;             // cycles per us, read on the first profileSite()
+uint32_t profileStallCycles = 0xFFFFFFFF;
+
+ProfileStall profileStalls[PROFILE_MAX_STALLS];   // ring, newest at profileStallCount - 1
+uint32_t profileStallCount = 0;                   // stalls since boot
+
+uint32_t profileLoopBuckets[PROFILE_LOOP_BUCKETS];
+uint32_t profileLoopPasses = 0;
+uint32_t profileLoopMaxUS = 0;
+uint32_t profileLoopStartUS = 0;              // start of the current loop() pass
+unsigned long long profileLoopIdleUS = 0;     // Scheduler::idleUS at that start
+bool profileLoopStarted = false;
+int profileLoopWorstSite = -1;                // longest probe in the current pass
+uint32_t profileLoopWorstCycles = 0;
+
+
+// Register a call site, returns its id (-1 if the table is full). PROFILE_SCOPE() calls this once per site.
+int profileSite(const char* name) {
+  if (profileSiteCount == 0) {
+    profileCpuMHz = ESP.getCpuFreqMHz();
+    profileStallCycles = PROFILE_STALL_US * profileCpuMHz;
+  }
+  if (profileSiteCount >= PROFILE_MAX_SITES) {
+    LOG_E("Profiler full! Could not add %s, raise PROFILE_MAX_SITES.\n", name);
+    return -1;
+  }
+  profileSites[profileSiteCount] = { name, 0, 0, 0 };
+  return profileSiteCount++;
+}
+
+void recordStall(const char* site, uint32_t us, bool loopPass) {
+  profileStalls[profileStallCount % PROFILE_MAX_STALLS] = { site, us, (uint32_t)millis(), loopPass };
+  profileStallCount++;
+  LOG_W("Stall: %s%s took %lu us\n", loopPass ? "loop() pass, longest in it " : "", site, (unsigned long)us);
+}
+
+// Add one timed run of `site`
+void profileRecord(int site, uint32_t cycles) {
+  if (site < 0) {
+    return;
+  }
+  ProfileSite& s = profileSites[site];
+  s.calls++;
+  s.totalCycles += cycles;
+  if (cycles > s.maxCycles) {
+    s.maxCycles = cycles;
+  }
+  if (cycles > profileLoopWorstCycles) {
+    profileLoopWorstCycles = cycles;
+    profileLoopWorstSite = site;
+  }
+  if (cycles >= profileStallCycles) {
+    recordStall(s.name, cycles / profileCpuMHz, false);
+  }
+}
+
+// Times the enclosing block, made by PROFILE_SCOPE()
+struct ProfileScope {
+  int site;
+  uint32_t startCycles;
+  ProfileScope(int id) : site(id), startCycles(ESP.getCycleCount()) {}
+  ~ProfileScope() { profileRecord(site, ESP.getCycleCount() - startCycles); }
+};
+
+// Histogram bucket of a loop() pass: exact below 4 us, then 4 buckets per power of 2
+int profileBucket(uint32_t us) {
+  if (us < 4) {
+    return us;
+  }
+  int bits = 32 - __builtin_clz(us);
+  int bucket = (bits - 2) * 4 + ((us >> (bits - 3)) & 3);
+  return bucket < PROFILE_LOOP_BUCKETS ? bucket : PROFILE_LOOP_BUCKETS - 1;
+}
+
+// Longest time that falls in `bucket`
+uint32_t profileBucketLimit(int bucket) {
+  if (bucket < 4) {
+    return bucket;
+  }
+  int next = bucket + 1;
+  return ((uint32_t)(4 + next % 4) << (next / 4 - 1)) - 1;
+}
+
+// Call first thing in loop(): ends the previous pass & starts a new one
+void profileLoop() {
+  if (!HELPER_PROFILE) {
+    return;
+  }
+  uint32_t nowUS = micros();
+  unsigned long long idleUS = Scheduler::idleUS;
+  if (profileLoopStarted) {
+    uint32_t busyUS = (nowUS - profileLoopStartUS) - (uint32_t)(idleUS - profileLoopIdleUS);
+    profileLoopBuckets[profileBucket(busyUS)]++;
+    profileLoopPasses++;
+    if (busyUS > profileLoopMaxUS) {
+      profileLoopMaxUS = busyUS;
+    }
+    if (busyUS >= PROFILE_STALL_US) {
+      recordStall(profileLoopWorstSite >= 0 ? profileSites[profileLoopWorstSite].name : "(no probe)", busyUS, true);
+    }
+  }
+  profileLoopStartUS = nowUS;
+  profileLoopIdleUS = idleUS;
+  profileLoopStarted = true;
+  profileLoopWorstSite = -1;
+  profileLoopWorstCycles = 0;
+}
+
+// loop() pass time at `percent` (upper end of its bucket, within 25%)
+uint32_t profileLoopPercentile(int percent) {
+  uint32_t rank = ((uint64_t)profileLoopPasses * percent + 99) / 100;
+  uint32_t seen = 0;
+  for (int i = 0; i < PROFILE_LOOP_BUCKETS; i++) {
+    seen += profileLoopBuckets[i];
+    if (seen >= rank && seen > 0) {
+      uint32_t limit = profileBucketLimit(i);
+      return limit < profileLoopMaxUS ? limit : profileLoopMaxUS;
+    }
+  }
+  return profileLoopMaxUS;
+}
+
+// Print the call sites, loop() percentiles & the last stalls
+void printProfile() {
+  for (int i = 0; i < profileSiteCount; i++) {
+    const ProfileSite& s = profileSites[i];
+    Serial.printf("%-20s %8lu calls, avg %8lu us, max %8lu us\n", s.name, (unsigned long)s.calls,
+                  s.calls ? (unsigned long)(s.totalCycles / s.calls / profileCpuMHz) : 0UL,
+                  (unsigned long)(s.maxCycles / profileCpuMHz));
+  }
+  Serial.printf("loop() %lu passes: p50 %lu us, p95 %lu us, p99 %lu us, max %lu us\n",
+                (unsigned long)profileLoopPasses, (unsigned long)profileLoopPercentile(50),
+                (unsigned long)profileLoopPercentile(95), (unsigned long)profileLoopPercentile(99),
+                (unsigned long)profileLoopMaxUS);
+
+  uint32_t kept = profileStallCount < PROFILE_MAX_STALLS ? profileStallCount : PROFILE_MAX_STALLS;
+  Serial.printf("%lu stalls of %lu us or more since boot\n", (unsigned long)profileStallCount, PROFILE_STALL_US);
+  for (uint32_t i = 1; i <= kept; i++) {
+    const ProfileStall& stall = profileStalls[(profileStallCount - i) % PROFILE_MAX_STALLS];
+    Serial.printf("  at %lu ms: %s%s, %lu us\n", (unsigned long)stall.atMS, stall.loopPass ? "loop() pass in " : "",
+                  stall.site, (unsigned long)stall.us);
+  }
+}
+
+#endif
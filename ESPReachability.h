@@ -0,0 +1,277 @@
+/****************************************************************************************
+* ESP Reachability Monitor
+* This helper file replaces the one-shot blocking ping with a background monitor:
+* 1. Probes the gateway, the DNS server & an internet host:port with a TCP connect,
+* 2. Probes are asynchronous (AsyncTCP/ESPAsyncTCP), one at a time, a round every
+*    PROBE_INTERVAL_MS - handleReachability() only checks flags & never waits,
+* 3. Keeps the last REACH_WINDOW results per target (RTT & loss),
+* 4. internetReachable() reports if the internet host loss is below REACH_LOSS_LIMIT,
+* 5. registerReachabilityMetrics() adds the RTT & loss per target to /metrics (ESPMetrics.h).
+*
+* This file is used by ESPWiFiSTAHelper.h & ESPWiFiHelper.h to keep `hasInternet` up to
+* date, include it in the project next to the Wi-Fi helper. The STA helpers call
+* startReachability() when connected, stopReachability() when the link drops and
+* handleReachability() from handleWiFi().
+*
+* Change `probeHost` & `probeHostPort` to a server your devices are allowed to reach.
+****************************************************************************************/
+
+#ifndef ESPReachability_h
+#define ESPReachability_h
+
+#ifdef ESP32    // for ESP32 boards
+#include <WiFi.h>
+#include <AsyncTCP.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+#endif
+
+#include "ESPMetrics.h"   // RTT & loss gauges
+#include "ESPLog.h"       // printReachability()
+#include "ESPStatusPush.h"   // gateway RTT & internet loss pushed to dashboards
+
+// Probe configuration
+const char* probeHost = "www.google.com";   // internet probe host (name or IP), resolved asynchronously
+uint16_t probeHostPort = 80;                // internet probe port
+uint16_t gatewayProbePort = 80;             // gateway probe port (router web UI)
+uint16_t dnsProbePort = 53;                 // DNS server probe port (DNS over TCP)
+
+const unsigned long PROBE_INTERVAL_MS = 30000;  // ms between probe rounds
+const unsigned long PROBE_TIMEOUT_MS = 3000;    // ms before an unanswered probe counts as lost
+const int REACH_LOSS_LIMIT = 50;                // internet host loss (%) at or above which there is no internet
+
+#define REACH_WINDOW 8   // results kept per target (max 8, one bit each)
+
+// Probe targets, probed in this order each round
+enum ProbeTarget {
+  PROBE_GATEWAY,
+  PROBE_DNS,
+  PROBE_HOST,
+  PROBE_TARGET_COUNT
+};
+
+// Rolling results for one target
+struct ProbeStats {
+  uint8_t results;               // one bit per probe, 1 = answered, newest in bit 0
+  uint8_t count;                 // probes in the window (up to REACH_WINDOW)
+  uint8_t next;                  // next slot in rttMS
+  uint16_t rttMS[REACH_WINDOW];  // connect time of each probe, 0 if lost
+};
+
+// Progress of the probe in flight
+enum ProbeState {
+  PROBE_IDLE,       // no probe in flight
+  PROBE_PENDING,    // connect started, waiting for a callback
+  PROBE_ANSWERED,   // connected (set from the TCP callback)
+  PROBE_LOST        // error (set from the TCP callback) or connect could not start
+};
+
+ProbeStats probeStats[PROBE_TARGET_COUNT];  // results per target
+
+AsyncClient probeClient;                      // reused for every probe
+volatile ProbeState probeState = PROBE_IDLE;  // written from the TCP callbacks
+volatile unsigned long probeAnsweredMS = 0;   // time the TCP callback saw the connect
+ProbeTarget probeTarget = PROBE_GATEWAY;      // target of the probe in flight
+unsigned long probeStartMS = 0;               // time the probe in flight was started
+unsigned long lastRoundMS = 0;                // time the last round started
+bool reachabilityActive = false;              // probing enabled (Wi-Fi connected)
+bool roundRunning = false;                    // a round is part way through its targets
+
+
+// Add one probe result to a target's window
+void recordProbe(ProbeTarget target, bool answered, unsigned long rttMS) {
+  ProbeStats& stats = probeStats[target];
+  stats.results = (stats.results << 1) | (answered ? 1 : 0);
+  stats.rttMS[stats.next] = answered ? constrain(rttMS, 1UL, 0xFFFFUL) : 0;  // 0 is kept for lost probes
+  stats.next = (stats.next + 1) % REACH_WINDOW;
+  if (stats.count < REACH_WINDOW) {
+    stats.count++;
+  }
+}
+
+// Loss over the window in %, 100 if nothing was probed yet
+int reachabilityLoss(ProbeTarget target) {
+  const ProbeStats& stats = probeStats[target];
+  if (stats.count == 0) {
+    return 100;
+  }
+
+  int answered = 0;
+  for (int i = 0; i < stats.count; i++) {
+    answered += (stats.results >> i) & 1;
+  }
+  return 100 - answered * 100 / stats.count;
+}
+
+// Average RTT of the answered probes in the window, 0 if none
+unsigned long reachabilityRTT(ProbeTarget target) {
+  const ProbeStats& stats = probeStats[target];
+  unsigned long total = 0;
+  int answered = 0;
+
+  for (int i = 0; i < stats.count; i++) {
+    if (stats.rttMS[i] > 0) {
+      total += stats.rttMS[i];
+      answered++;
+    }
+  }
+  return answered ? total / answered : 0;
+}
+
+// True once the internet host has answered enough of the recent probes
+bool internetReachable() {
+  return probeStats[PROBE_HOST].count > 0 && reachabilityLoss(PROBE_HOST) < REACH_LOSS_LIMIT;
+}
+
+// True while a round is under way, handleReachability() needs calling often then
+bool reachabilityBusy() {
+  return roundRunning || probeState != PROBE_IDLE;
+}
+
+// Start a TCP connect to the current target, returns at once
+void startProbe() {
+  bool started;
+
+  probeState = PROBE_PENDING;
+  probeStartMS = millis();
+
+  switch (probeTarget) {
+    case PROBE_GATEWAY:
+      started = probeClient.connect(WiFi.gatewayIP(), gatewayProbePort);
+      break;
+    case PROBE_DNS:
+      started = probeClient.connect(WiFi.dnsIP(), dnsProbePort);
+      break;
+    default:
+      started = probeClient.connect(probeHost, probeHostPort);  // DNS lookup is asynchronous too
+      break;
+  }
+
+  if (!started) {
+    probeState = PROBE_LOST;
+  }
+}
+
+// Close the probe connection & move on to the next target (or end the round)
+void finishProbe(bool answered, unsigned long rttMS) {
+  probeState = PROBE_IDLE;  // before close(), so its callbacks are ignored
+  probeClient.close(true);
+  recordProbe(probeTarget, answered, rttMS);
+  if (probeTarget == PROBE_GATEWAY) {
+    setStatus(STATUS_GATEWAY_RTT, reachabilityRTT(PROBE_GATEWAY), 5);
+  } else if (probeTarget == PROBE_HOST) {
+    setStatus(STATUS_INTERNET_LOSS, reachabilityLoss(PROBE_HOST));
+  }
+
+  if (probeTarget + 1 < PROBE_TARGET_COUNT) {
+    probeTarget = (ProbeTarget)(probeTarget + 1);
+  } else {
+    probeTarget = PROBE_GATEWAY;
+    roundRunning = false;
+  }
+}
+
+// Register the TCP callbacks, runs once on the first startReachability()
+void setupReachability() {
+  probeClient.onConnect([](void* arg, AsyncClient* client) {
+    if (probeState == PROBE_PENDING) {
+      probeAnsweredMS = millis();
+      probeState = PROBE_ANSWERED;
+    }
+  });
+  probeClient.onError([](void* arg, AsyncClient* client, int8_t error) {
+    if (probeState == PROBE_PENDING) {
+      probeState = PROBE_LOST;
+    }
+  });
+}
+
+// Start probing with an empty window, a round starts on the next handleReachability()
+void startReachability() {
+  static bool callbacksSet = false;
+  if (!callbacksSet) {
+    setupReachability();
+    callbacksSet = true;
+  }
+
+  memset(probeStats, 0, sizeof(probeStats));
+  probeTarget = PROBE_GATEWAY;
+  roundRunning = true;
+  lastRoundMS = millis();
+  reachabilityActive = true;
+}
+
+// Stop probing & drop any probe in flight
+void stopReachability() {
+  reachabilityActive = false;
+  roundRunning = false;
+  if (probeState != PROBE_IDLE) {
+    probeState = PROBE_IDLE;
+    probeClient.close(true);
+  }
+}
+
+// Advance the probes, call from loop() (done by handleWiFi() in the STA helpers)
+void handleReachability() {
+  if (!reachabilityActive) {
+    return;
+  }
+
+  unsigned long currentMS = millis();
+
+  switch (probeState) {
+    case PROBE_IDLE:
+      if (!roundRunning && currentMS - lastRoundMS >= PROBE_INTERVAL_MS) {
+        roundRunning = true;
+        lastRoundMS = currentMS;
+      }
+      if (roundRunning) {
+        startProbe();
+      }
+      break;
+
+    case PROBE_PENDING:
+      if (currentMS - probeStartMS >= PROBE_TIMEOUT_MS) {
+        finishProbe(false, 0);
+      }
+      break;
+
+    case PROBE_ANSWERED:
+      finishProbe(true, probeAnsweredMS - probeStartMS);
+      break;
+
+    case PROBE_LOST:
+      finishProbe(false, 0);
+      break;
+  }
+}
+
+int32_t readProbeRTT(int target) {
+  return reachabilityRTT((ProbeTarget)target);
+}
+
+int32_t readProbeLoss(int target) {
+  return reachabilityLoss((ProbeTarget)target);
+}
+
+// Add the RTT & loss of each target to /metrics, called by the Wi-Fi helpers' setupWiFi()
+void registerReachabilityMetrics() {
+  const char* labels[PROBE_TARGET_COUNT] = { "target=\"gateway\"", "target=\"dns\"", "target=\"internet\"" };
+  for (int i = 0; i < PROBE_TARGET_COUNT; i++) {
+    registerGauge("wifi_probe_rtt_ms", "Average connect time of the answered probes", labels[i], readProbeRTT, i);
+    registerGauge("wifi_probe_loss_percent", "Probes lost in the window", labels[i], readProbeLoss, i);
+  }
+}
+
+// Log the window of each target
+void printReachability() {
+  const char* names[PROBE_TARGET_COUNT] = { "Gateway", "DNS", "Internet" };
+  for (int i = 0; i < PROBE_TARGET_COUNT; i++) {
+    LOG_I("%s: %d%% loss, %lu ms avg RTT (%d probes)\n", names[i],
+          reachabilityLoss((ProbeTarget)i), reachabilityRTT((ProbeTarget)i), probeStats[i].count);
+  }
+}
+
+#endif
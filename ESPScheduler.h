@@ -0,0 +1,181 @@
+/****************************************************************************************
+* ESP Scheduler
+* This helper file is a small cooperative scheduler for the periodic work of the helpers:
+* 1. Fixed number of task slots (SCHEDULER_MAX_TASKS), no heap allocation,
+* 2. Each task has a period & a next-run deadline, millis() rollover safe,
+* 3. Overruns (a task missing a whole period, or running longer than its period) are
+*    counted & the task is re-synced instead of running a burst of catch-up calls,
+* 4. Scheduler::run() runs the due tasks then waits until the next deadline instead of
+*    spinning (set Scheduler::sleepWhenIdle to false to only yield). With modem/light sleep
+*    set up (ESPPowerSave.h) the chip powers down during that wait,
+* 5. Scheduler::activePercent() reports the share of time spent running tasks, and
+*    Scheduler::passObserver (if set) gets the busy time of every run() that ran a task.
+*
+* To use this helper:
+* - Include this file in your project (the Wi-Fi & OTA helpers include it already),
+* - In main setup() > register tasks with Scheduler::add(), or call the helpers'
+*   scheduleWiFi() / scheduleOTA() functions,
+* - In main loop() > call Scheduler::run() only.
+****************************************************************************************/
+
+#ifndef ESPScheduler_h
+#define ESPScheduler_h
+
+#include <Arduino.h>
+#include "ESPLog.h"   // full table & printStats()
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8   // task slots, raise (here or with -D in build_flags) if more tasks are needed
+#endif
+
+namespace Scheduler {
+
+typedef void (*TaskCallback)();
+typedef void (*PassObserver)(unsigned long busyUS);
+
+// One task slot
+struct Task {
+  const char* name;          // name for printStats()
+  TaskCallback callback;     // function to run
+  unsigned long periodMS;    // ms between runs
+  unsigned long nextRunMS;   // deadline of the next run
+  unsigned long runs;        // times run
+  unsigned long overruns;    // times a whole period was missed
+  unsigned long maxRunUS;    // longest run in us
+};
+
+const unsigned long MAX_IDLE_MS = 1000;   // longest wait in run(), keeps loop() responsive to other code
+
+Task tasks[SCHEDULER_MAX_TASKS];  // task slots
+int taskCount = 0;                // used slots
+bool sleepWhenIdle = true;        // run() waits for the next deadline = true | only yields = false
+
+unsigned long long busyUS = 0;    // total time spent in task callbacks
+unsigned long long idleUS = 0;    // total time spent waiting in run()
+PassObserver passObserver = nullptr;   // called after each run() that ran a task, e.g. ESPMetrics.h loop histogram
+
+
+// True if `deadline` has been reached at `now`, works across the millis() rollover
+bool reached(unsigned long now, unsigned long deadline) {
+  return (long)(now - deadline) >= 0;
+}
+
+// Register a task, first run is straight away. Returns the task id, or -1 if all slots are used.
+// Adding the same callback again only updates its period.
+int add(const char* name, TaskCallback callback, unsigned long periodMS) {
+  for (int i = 0; i < taskCount; i++) {
+    if (tasks[i].callback == callback) {
+      tasks[i].periodMS = periodMS;
+      return i;
+    }
+  }
+
+  if (taskCount >= SCHEDULER_MAX_TASKS) {
+    LOG_E("Scheduler full! Could not add task %s, raise SCHEDULER_MAX_TASKS.\n", name);
+    return -1;
+  }
+
+  Task& task = tasks[taskCount];
+  memset(&task, 0, sizeof(task));
+  task.name = name;
+  task.callback = callback;
+  task.periodMS = periodMS;
+  task.nextRunMS = millis();
+  return taskCount++;
+}
+
+// Change a task's period, takes effect from its next run
+void setPeriod(int id, unsigned long periodMS) {
+  if (id >= 0 && id < taskCount) {
+    tasks[id].periodMS = periodMS;
+  }
+}
+
+// Make a task due on the next run()
+void runSoon(int id) {
+  if (id >= 0 && id < taskCount) {
+    tasks[id].nextRunMS = millis();
+  }
+}
+
+// ms until the earliest deadline (0 if a task is due), MAX_IDLE_MS at most
+unsigned long msUntilNext(unsigned long now) {
+  unsigned long waitMS = MAX_IDLE_MS;
+  for (int i = 0; i < taskCount; i++) {
+    if (reached(now, tasks[i].nextRunMS)) {
+      return 0;
+    }
+    if (tasks[i].nextRunMS - now < waitMS) {
+      waitMS = tasks[i].nextRunMS - now;
+    }
+  }
+  return waitMS;
+}
+
+// Run every due task, then wait for the next deadline. Call from loop().
+// Returns the ms that were left until the next deadline.
+unsigned long run() {
+  unsigned long now = millis();
+  unsigned long passUS = 0;   // time in task callbacks this pass
+  bool ranTask = false;
+
+  for (int i = 0; i < taskCount; i++) {
+    Task& task = tasks[i];
+    if (!reached(now, task.nextRunMS)) {
+      continue;
+    }
+
+    unsigned long startUS = micros();
+    task.callback();
+    unsigned long runUS = micros() - startUS;
+
+    busyUS += runUS;
+    passUS += runUS;
+    ranTask = true;
+    task.runs++;
+    if (runUS > task.maxRunUS) {
+      task.maxRunUS = runUS;
+    }
+
+    // Keep the task on its phase, unless it fell a whole period behind
+    now = millis();
+    task.nextRunMS += task.periodMS;
+    if (reached(now, task.nextRunMS)) {
+      task.overruns++;
+      task.nextRunMS = now + task.periodMS;
+    }
+  }
+
+  if (ranTask && passObserver) {
+    passObserver(passUS);
+  }
+
+  unsigned long waitMS = msUntilNext(now);
+  unsigned long idleStartUS = micros();
+  if (sleepWhenIdle && waitMS > 0) {
+    delay(waitMS);    // lets the Wi-Fi stack & async server run, CPU idles (or sleeps, see ESPPowerSave.h)
+  } else {
+    yield();
+  }
+  idleUS += micros() - idleStartUS;
+  return waitMS;
+}
+
+// Share of the time spent running tasks since boot, in %
+float activePercent() {
+  unsigned long long totalUS = busyUS + idleUS;
+  return totalUS ? busyUS * 100.0f / totalUS : 0.0f;
+}
+
+// Log run count, overruns & longest run of each task
+void printStats() {
+  for (int i = 0; i < taskCount; i++) {
+    LOG_I("Task %-10s every %5lu ms: %lu runs, %lu overruns, longest %lu us\n",
+          tasks[i].name, tasks[i].periodMS, tasks[i].runs, tasks[i].overruns, tasks[i].maxRunUS);
+  }
+  LOG_I("Active %.2f%% of the time\n", activePercent());
+}
+
+}  // namespace Scheduler
+
+#endif
@@ -0,0 +1,217 @@
+/****************************************************************************************
+* ESP Sleep Cycle
+* This helper file runs a battery node as a wake -> connect -> work -> deep sleep cycle:
+* 1. Connects with the STA helper (set USE_FAST_CONNECT, or wifiConfig.useFastConnect with
+*    ESPWiFiHelper.h, to true to skip scan & DHCP),
+* 2. Runs your callback once connected (read sensors, publish...),
+* 3. Flushes the log (ESPLog.h) & Serial, gives the TCP stack a moment to send, then deep sleeps,
+* 4. Keeps a state struct in RTC memory across sleeps: boot count, last failure reason &
+*    consecutive failures - each failure doubles the sleep time up to CYCLE_MAX_SLEEP_MS,
+* 5. Records when each phase finished (radio on, associated, IP acquired, callback done)
+*    so you can see where the wake budget goes - printed every cycle & kept in RTC memory.
+*
+* To use this helper:
+* - Include ESPWiFiSTAHelper.h (or ESPWiFiHelper.h in STA mode), then this file,
+* - Write a `bool myCallback()` that does the work & returns true on success,
+* - In main setup() > call runSleepCycle(myCallback), it does not return,
+* - main loop() stays empty.
+*
+* ESP8266: connect GPIO16 (D0) to RST, or the board can not wake itself up.
+****************************************************************************************/
+
+#ifndef ESPSleepCycle_h
+#define ESPSleepCycle_h
+
+#ifdef ESP32    // for ESP32 boards
+#include <WiFi.h>
+#include <esp_sleep.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <ESP8266WiFi.h>
+#endif
+
+#include "ESPWiFiFastConnect.h"   // RTC memory layout & CRC
+#include "ESPLog.h"              // flushed before sleeping
+
+// Cycle settings
+const unsigned long CYCLE_SLEEP_MS = 60000;        // ms to sleep after a good cycle
+const unsigned long CYCLE_MAX_SLEEP_MS = 3600000;  // sleep limit while failures are backing off
+const unsigned long CYCLE_WIFI_TIMEOUT_MS = 10000; // ms to wait for Wi-Fi before giving up on this cycle
+const unsigned long CYCLE_FLUSH_MS = 50;           // ms for the TCP stack to send before sleeping
+
+// ESP8266 RTC user memory offset (in 4 byte blocks), right after the fast connect cache
+const uint32_t SLEEP_CYCLE_RTC_OFFSET = FAST_CONNECT_RTC_OFFSET + sizeof(FastConnectCache) / 4;
+const uint32_t SLEEP_CYCLE_MAGIC = 0x534C4331;     // "SLC1", bump if the layout changes
+
+// Why the last cycle failed
+enum CycleFailure {
+  CYCLE_OK,               // no failure
+  CYCLE_WIFI_TIMEOUT,     // not connected within CYCLE_WIFI_TIMEOUT_MS
+  CYCLE_CALLBACK_FAILED   // the callback returned false
+};
+
+// Cycle phases, timestamps are ms since boot
+enum CyclePhase {
+  PHASE_RADIO_ON,         // setupWiFi() returned, the radio is on & the first attempt started
+  PHASE_ASSOCIATED,       // associated with the AP
+  PHASE_GOT_IP,           // IP acquired
+  PHASE_CALLBACK_DONE,    // callback returned
+  PHASE_COUNT
+};
+
+// State kept in RTC memory across deep sleeps (a multiple of 4 bytes)
+struct SleepCycleState {
+  uint32_t magic;                     // SLEEP_CYCLE_MAGIC when valid
+  uint32_t bootCount;                 // wakes since power-up
+  uint16_t consecutiveFailures;       // failed cycles in a row
+  uint8_t lastFailure;                // CycleFailure of the last failed cycle
+  uint8_t reserved;                   // padding
+  uint16_t lastPhaseMS[PHASE_COUNT];  // phase timestamps of the previous cycle
+  uint32_t crc;                       // CRC32 over all fields above
+};
+
+typedef bool (*CycleCallback)();      // returns true if the work succeeded
+
+SleepCycleState sleepCycleState;          // state of this cycle, readable from the callback
+unsigned long cyclePhaseMS[PHASE_COUNT];  // phase timestamps of this cycle, 0 = not reached
+
+#ifdef ESP32
+RTC_DATA_ATTR SleepCycleState rtcSleepCycleState;   // lives in RTC slow memory
+#elif defined(ESP8266)
+WiFiEventHandler cycleConnectedHandler;   // kept alive for the event callbacks
+WiFiEventHandler cycleGotIPHandler;
+#endif
+
+
+// Read the state from RTC memory, starts from zero after a power-up or a bad CRC
+void loadSleepCycleState() {
+#ifdef ESP32
+  memcpy(&sleepCycleState, &rtcSleepCycleState, sizeof(sleepCycleState));
+#elif defined(ESP8266)
+  ESP.rtcUserMemoryRead(SLEEP_CYCLE_RTC_OFFSET, (uint32_t*)&sleepCycleState, sizeof(sleepCycleState));
+#endif
+
+  if (sleepCycleState.magic != SLEEP_CYCLE_MAGIC ||
+      sleepCycleState.crc != fastConnectCRC((const uint8_t*)&sleepCycleState, offsetof(SleepCycleState, crc))) {
+    memset(&sleepCycleState, 0, sizeof(sleepCycleState));
+    sleepCycleState.magic = SLEEP_CYCLE_MAGIC;
+  }
+}
+
+// Write the state to RTC memory
+void saveSleepCycleState() {
+  sleepCycleState.crc = fastConnectCRC((const uint8_t*)&sleepCycleState, offsetof(SleepCycleState, crc));
+
+#ifdef ESP32
+  memcpy(&rtcSleepCycleState, &sleepCycleState, sizeof(sleepCycleState));
+#elif defined(ESP8266)
+  ESP.rtcUserMemoryWrite(SLEEP_CYCLE_RTC_OFFSET, (uint32_t*)&sleepCycleState, sizeof(sleepCycleState));
+#endif
+}
+
+// Note the time a phase finished, only the first time it is reached
+void markCyclePhase(CyclePhase phase) {
+  if (cyclePhaseMS[phase] == 0) {
+    cyclePhaseMS[phase] = millis();
+  }
+}
+
+#ifdef ESP32
+// Wi-Fi event callback for the associated & got IP phases
+void onCycleWiFiEvent(arduino_event_id_t event) {
+  markCyclePhase(event == ARDUINO_EVENT_WIFI_STA_CONNECTED ? PHASE_ASSOCIATED : PHASE_GOT_IP);
+}
+#endif
+
+// Sleep time for the next cycle: doubles per consecutive failure up to CYCLE_MAX_SLEEP_MS
+unsigned long nextSleepMS() {
+  unsigned long sleepMS = CYCLE_SLEEP_MS;
+  for (int i = 0; i < sleepCycleState.consecutiveFailures && sleepMS < CYCLE_MAX_SLEEP_MS; i++) {
+    sleepMS *= 2;
+  }
+  return sleepMS > CYCLE_MAX_SLEEP_MS ? CYCLE_MAX_SLEEP_MS : sleepMS;
+}
+
+// Print this cycle's phase timestamps
+void printCyclePhases() {
+  const char* names[PHASE_COUNT] = { "Radio on", "Associated", "Got IP", "Callback done" };
+  LOG_I("Cycle %lu phases (ms since boot):", (unsigned long)sleepCycleState.bootCount);
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    LOG_I(" %s %lu%s", names[i], cyclePhaseMS[i], i < PHASE_COUNT - 1 ? " |" : "\n");
+  }
+}
+
+// Save the outcome of this cycle & deep sleep, does not return
+void endSleepCycle(CycleFailure failure) {
+  if (failure == CYCLE_OK) {
+    sleepCycleState.consecutiveFailures = 0;
+  } else {
+    sleepCycleState.lastFailure = failure;
+    if (sleepCycleState.consecutiveFailures < 0xFFFF) {
+      sleepCycleState.consecutiveFailures++;
+    }
+  }
+
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    sleepCycleState.lastPhaseMS[i] = cyclePhaseMS[i] > 0xFFFF ? 0xFFFF : cyclePhaseMS[i];
+  }
+  saveSleepCycleState();
+
+  unsigned long sleepMS = nextSleepMS();
+  printCyclePhases();
+  LOG_I("Cycle %s, sleeping for %lu ms\n", failure == CYCLE_OK ? "done" : "failed", sleepMS);
+
+  delay(CYCLE_FLUSH_MS);   // let the TCP stack send what the callback queued
+  flushLog();
+
+#ifdef ESP32
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepMS * 1000);
+  esp_deep_sleep_start();
+#elif defined(ESP8266)
+  ESP.deepSleep((uint64_t)sleepMS * 1000);
+#endif
+}
+
+// Run one wake cycle: connect, run the callback, deep sleep. Call from setup(), does not return.
+void runSleepCycle(CycleCallback callback) {
+  loadSleepCycleState();
+  sleepCycleState.bootCount++;
+  memset(cyclePhaseMS, 0, sizeof(cyclePhaseMS));
+
+  LOG_I("\nWake %lu, %u failed cycles in a row\n",
+        (unsigned long)sleepCycleState.bootCount, sleepCycleState.consecutiveFailures);
+
+#ifdef ESP32
+  WiFi.onEvent(onCycleWiFiEvent, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+  WiFi.onEvent(onCycleWiFiEvent, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+#elif defined(ESP8266)
+  cycleConnectedHandler = WiFi.onStationModeConnected([](const WiFiEventStationModeConnected& event) {
+    markCyclePhase(PHASE_ASSOCIATED);
+  });
+  cycleGotIPHandler = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP& event) {
+    markCyclePhase(PHASE_GOT_IP);
+  });
+#endif
+
+  setupWiFi();
+  markCyclePhase(PHASE_RADIO_ON);   // after setupWiFi(): its mode switch & settle delay are part of bringing the radio up
+
+  // Nothing else runs in this cycle, so wait here for the connection
+  unsigned long startMS = millis();
+  while (!isConnected) {
+    if (millis() - startMS >= CYCLE_WIFI_TIMEOUT_MS) {
+      LOG_W("\nNo Wi-Fi this cycle.\n");
+      endSleepCycle(CYCLE_WIFI_TIMEOUT);
+    }
+    handleWiFi();
+    handleLog();
+    delay(10);
+  }
+
+  bool ok = callback();
+  markCyclePhase(PHASE_CALLBACK_DONE);
+
+  endSleepCycle(ok ? CYCLE_OK : CYCLE_CALLBACK_FAILED);
+}
+
+#endif
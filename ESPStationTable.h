@@ -0,0 +1,424 @@
+/****************************************************************************************
+* ESP Station Table
+* This helper file keeps a table of the stations connected to the SoftAP, kept up to date
+* by the Wi-Fi join/leave events instead of polling the station list:
+* 1. Fixed array of STATION_TABLE_SIZE slots keyed by MAC (open addressing), no heap use,
+* 2. Each entry has the association id, IP, RSSI, connect time & last seen time,
+* 3. Lookups by MAC are O(1) on average, the table is never more than 10/16 full.
+*
+* Where the events do not carry everything:
+* - IP:   ESP32 fills it in from the "IP assigned" event, ESP8266 has no such event so
+*         updateStationTable() looks it up once per new station (the SDK list it reads is
+*         allocated, but only while a station is still waiting for its IP),
+* - RSSI: ESP32 reads it from the driver's station list in updateStationTable(),
+*         ESP8266 takes it from the probe requests connected stations send.
+*
+* Query API: stationCount(), getStation(mac, info), listStations(infos, max) - they copy
+* the entries out, as the ESP32 events update the table from another task.
+*
+* Report API: formatStations() writes the table as text lines, a JSON array or packed
+* binary records straight from the slots into a caller's buffer, whole records at a time
+* & resumable, so it also fills chunked HTTP responses. MACs, IPs & numbers go through
+* small hand-rolled encoders, no printf & no copy of the entries. reportStations() sends
+* it to any Print (Serial, a client...), printStationTable() to the log.
+*
+* This file is used by ESPWiFiSoftAPHelper.h: setupWiFi() calls setupStationTable() & the
+* "stations" task calls updateStationTable().
+****************************************************************************************/
+
+#ifndef ESPStationTable_h
+#define ESPStationTable_h
+
+#ifdef ESP32    // for ESP32 boards
+#include <WiFi.h>
+#include <esp_wifi.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <ESP8266WiFi.h>
+#endif
+
+#include "ESPLog.h"   // printStationTable() output
+#include "ESPStatusPush.h"   // station count pushed to dashboards
+
+#ifndef STATION_TABLE_SIZE
+#define STATION_TABLE_SIZE 16   // slots, a power of 2 & at least the AP's station limit (ESP8266 8, ESP32 10), can be set with -D
+#endif
+#define STATION_RECORD_MAX 112  // longest record of one station in any StationFormat
+#define STATION_BINARY_SIZE 19  // bytes per binary record
+
+// One connected station
+struct StationInfo {
+  uint8_t mac[6];
+  uint8_t aid;                // association id from the AP, 0 = free slot
+  int8_t rssi;                // dBm, 0 = not known yet
+  uint32_t ip;                // 0 until DHCP hands one out
+  unsigned long connectedMS;  // when it joined
+  unsigned long lastSeenMS;   // last event or station list entry for it
+};
+
+// formatStations() output
+enum StationFormat {
+  STATION_TEXT,     // one line per station: MAC IP RSSI, connected & last seen seconds
+  STATION_JSON,     // [{"mac":"..","ip":"..","rssi":-61,"connected":12,"seen":0},...]
+  STATION_BINARY    // STATION_BINARY_SIZE, then per station: MAC, IP (network order),
+                    // RSSI (int8), connected & seen seconds (uint32 little endian)
+};
+
+// Write position in the formatStations() output
+struct StationCursor {
+  int step;         // 0 = header, 1..STATION_TABLE_SIZE = slot + 1, then the footer
+  int records;      // stations written so far
+};
+
+StationInfo stationTable[STATION_TABLE_SIZE];
+int stationTableCount = 0;
+volatile uint32_t stationTableVersion = 0;   // bumped on every join & leave
+
+#ifdef ESP32
+portMUX_TYPE stationTableMux = portMUX_INITIALIZER_UNLOCKED;   // events arrive on the Wi-Fi event task
+#define STATION_TABLE_LOCK()   portENTER_CRITICAL(&stationTableMux)
+#define STATION_TABLE_UNLOCK() portEXIT_CRITICAL(&stationTableMux)
+#elif defined(ESP8266)
+WiFiEventHandler stationJoinHandler;    // kept alive for the event callbacks
+WiFiEventHandler stationLeaveHandler;
+WiFiEventHandler stationProbeHandler;
+#define STATION_TABLE_LOCK()            // events run between loop() calls
+#define STATION_TABLE_UNLOCK()
+#endif
+
+
+// Home slot of a MAC, the last 3 bytes are the device specific part
+int stationHomeSlot(const uint8_t mac[6]) {
+  return (mac[3] * 7 + mac[4] * 3 + mac[5]) & (STATION_TABLE_SIZE - 1);
+}
+
+// Slot holding `mac`, or the free slot where it would go (-1 if the table is full). Call locked.
+int findStationSlot(const uint8_t mac[6]) {
+  int slot = stationHomeSlot(mac);
+  for (int probe = 0; probe < STATION_TABLE_SIZE; probe++) {
+    StationInfo& entry = stationTable[slot];
+    if (entry.aid == 0 || memcmp(entry.mac, mac, 6) == 0) {
+      return slot;
+    }
+    slot = (slot + 1) & (STATION_TABLE_SIZE - 1);
+  }
+  return -1;
+}
+
+// A station joined (or joined again without leaving)
+void addStation(const uint8_t mac[6], uint8_t aid) {
+  unsigned long currentMS = millis();
+  STATION_TABLE_LOCK();
+  int slot = findStationSlot(mac);
+  if (slot >= 0) {
+    StationInfo& entry = stationTable[slot];
+    if (entry.aid == 0) {
+      stationTableCount++;
+    }
+    memcpy(entry.mac, mac, 6);
+    entry.aid = aid ? aid : 0xFF;   // never 0, that marks a free slot
+    entry.rssi = 0;
+    entry.ip = 0;
+    entry.connectedMS = currentMS;
+    entry.lastSeenMS = currentMS;
+    stationTableVersion++;
+  }
+  STATION_TABLE_UNLOCK();
+  setStatus(STATUS_STATIONS, stationTableCount);
+}
+
+// A station left: free its slot & move later entries of the same probe run back
+void removeStation(const uint8_t mac[6]) {
+  STATION_TABLE_LOCK();
+  int slot = findStationSlot(mac);
+  if (slot >= 0 && stationTable[slot].aid != 0) {
+    int hole = slot;
+    int next = (hole + 1) & (STATION_TABLE_SIZE - 1);
+    while (next != slot && stationTable[next].aid != 0) {   // stops after one lap when the table is full
+      int home = stationHomeSlot(stationTable[next].mac);
+      // Move the entry into the hole unless its home lies between the hole & where it sits
+      if (((next - home) & (STATION_TABLE_SIZE - 1)) >= ((next - hole) & (STATION_TABLE_SIZE - 1))) {
+        stationTable[hole] = stationTable[next];
+        hole = next;
+      }
+      next = (next + 1) & (STATION_TABLE_SIZE - 1);
+    }
+    stationTable[hole].aid = 0;
+    stationTableCount--;
+    stationTableVersion++;
+  }
+  STATION_TABLE_UNLOCK();
+  setStatus(STATUS_STATIONS, stationTableCount);
+}
+
+// Update a known station, unknown MACs are ignored
+void touchStation(const uint8_t mac[6], int8_t rssi, uint32_t ip) {
+  STATION_TABLE_LOCK();
+  int slot = findStationSlot(mac);
+  if (slot >= 0 && stationTable[slot].aid != 0) {
+    StationInfo& entry = stationTable[slot];
+    if (rssi != 0) entry.rssi = rssi;
+    if (ip != 0) entry.ip = ip;
+    entry.lastSeenMS = millis();
+  }
+  STATION_TABLE_UNLOCK();
+}
+
+
+/**************************** Query API ****************************/
+
+// Number of connected stations
+int stationCount() {
+  return stationTableCount;
+}
+
+// Copy the entry of `mac` into `info`, false if it is not connected
+bool getStation(const uint8_t mac[6], StationInfo& info) {
+  STATION_TABLE_LOCK();
+  int slot = findStationSlot(mac);
+  bool found = slot >= 0 && stationTable[slot].aid != 0;
+  if (found) {
+    info = stationTable[slot];
+  }
+  STATION_TABLE_UNLOCK();
+  return found;
+}
+
+// Copy up to `maxInfos` entries into `infos`, returns how many
+int listStations(StationInfo* infos, int maxInfos) {
+  int n = 0;
+  STATION_TABLE_LOCK();
+  for (int i = 0; i < STATION_TABLE_SIZE && n < maxInfos; i++) {
+    if (stationTable[i].aid != 0) {
+      infos[n++] = stationTable[i];
+    }
+  }
+  STATION_TABLE_UNLOCK();
+  return n;
+}
+
+/*******************************************************************/
+
+
+/**************************** Report API ****************************/
+
+const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// Write `mac` as AA:BB:CC:DD:EE:FF, returns the end
+char* formatMAC(char* out, const uint8_t mac[6]) {
+  for (int i = 0; i < 6; i++) {
+    *out++ = HEX_DIGITS[mac[i] >> 4];
+    *out++ = HEX_DIGITS[mac[i] & 0x0F];
+    if (i < 5) {
+      *out++ = ':';
+    }
+  }
+  return out;
+}
+
+// Write `value` in decimal, returns the end
+char* formatNumber(char* out, uint32_t value) {
+  char digits[10];
+  int n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+  while (n) {
+    *out++ = digits[--n];
+  }
+  return out;
+}
+
+// Write an lwIP address (first octet in the low byte) as a.b.c.d, returns the end
+char* formatIP(char* out, uint32_t ip) {
+  for (int i = 0; i < 4; i++) {
+    out = formatNumber(out, (ip >> (8 * i)) & 0xFF);
+    if (i < 3) {
+      *out++ = '.';
+    }
+  }
+  return out;
+}
+
+// Copy `text` without its terminator, returns the end
+char* appendText(char* out, const char* text) {
+  while (*text) {
+    *out++ = *text++;
+  }
+  return out;
+}
+
+// Write `value` as 4 bytes, low byte first, returns the end
+char* appendUint32LE(char* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    *out++ = value >> (8 * i);
+  }
+  return out;
+}
+
+// Write one station record (at most STATION_RECORD_MAX bytes), returns the end
+char* formatStation(char* out, const StationInfo& info, StationFormat format, bool first, unsigned long currentMS) {
+  uint32_t connectedS = (currentMS - info.connectedMS) / 1000;
+  uint32_t seenS = (currentMS - info.lastSeenMS) / 1000;
+  const char* rssiSign = info.rssi < 0 ? "-" : "";
+  if (format == STATION_BINARY) {
+    memcpy(out, info.mac, 6);
+    out = appendUint32LE(out + 6, info.ip);
+    *out++ = info.rssi;
+    out = appendUint32LE(out, connectedS);
+    return appendUint32LE(out, seenS);
+  }
+  if (format == STATION_JSON) {
+    out = appendText(out, first ? "{\"mac\":\"" : ",{\"mac\":\"");
+    out = appendText(formatMAC(out, info.mac), "\",\"ip\":\"");
+    out = appendText(formatIP(out, info.ip), "\",\"rssi\":");
+    out = appendText(formatNumber(appendText(out, rssiSign), abs(info.rssi)), ",\"connected\":");
+    out = appendText(formatNumber(out, connectedS), ",\"seen\":");
+    return appendText(formatNumber(out, seenS), "}");
+  }
+  out = appendText(formatMAC(appendText(out, "MAC: "), info.mac), ", IP: ");
+  out = appendText(formatIP(out, info.ip), ", RSSI: ");
+  out = appendText(formatNumber(appendText(out, rssiSign), abs(info.rssi)), " dBm, connected ");
+  out = appendText(formatNumber(out, connectedS), " s, seen ");
+  return appendText(formatNumber(out, seenS), " s ago\n");
+}
+
+// Write the next whole records of the table that fit into `out`, continuing from the cursor
+// (start with {}). Returns the bytes written, 0 when done. `size` must be at least STATION_RECORD_MAX.
+size_t formatStations(char* out, size_t size, StationFormat format, StationCursor& cursor) {
+  unsigned long currentMS = millis();
+  char* end = out;
+  if (cursor.step == 0) {
+    if (format == STATION_JSON) {
+      *end++ = '[';
+    } else if (format == STATION_BINARY) {
+      *end++ = STATION_BINARY_SIZE;
+    }
+    cursor.step = 1;
+  }
+
+  STATION_TABLE_LOCK();   // held for at most one buffer of records, no calls that wait
+  while (cursor.step <= STATION_TABLE_SIZE && (size_t)(end - out) + STATION_RECORD_MAX <= size) {
+    const StationInfo& info = stationTable[cursor.step - 1];
+    if (info.aid != 0) {
+      end = formatStation(end, info, format, cursor.records == 0, currentMS);
+      cursor.records++;
+    }
+    cursor.step++;
+  }
+  STATION_TABLE_UNLOCK();
+
+  if (cursor.step == STATION_TABLE_SIZE + 1 && (size_t)(end - out) + 2 <= size) {
+    if (format == STATION_JSON) {
+      end = appendText(end, "]\n");
+    }
+    cursor.step++;
+  }
+  return end - out;
+}
+
+// Send the table to `sink` (Serial, a WiFiClient...) in `format`, in a small stack buffer
+void reportStations(Print& sink, StationFormat format) {
+  char buffer[2 * STATION_RECORD_MAX];
+  StationCursor cursor = {};
+  size_t n;
+  while ((n = formatStations(buffer, sizeof(buffer), format, cursor)) > 0) {
+    sink.write((const uint8_t*)buffer, n);
+  }
+}
+
+/********************************************************************/
+
+
+#ifdef ESP32
+// Join, leave & IP assigned events
+void onStationEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  if (event == ARDUINO_EVENT_WIFI_AP_STACONNECTED) {
+    addStation(info.wifi_ap_staconnected.mac, info.wifi_ap_staconnected.aid);
+  } else if (event == ARDUINO_EVENT_WIFI_AP_STADISCONNECTED) {
+    removeStation(info.wifi_ap_stadisconnected.mac);
+  } else if (event == ARDUINO_EVENT_WIFI_AP_STAIPASSIGNED) {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    touchStation(info.wifi_ap_staipassigned.mac, 0, info.wifi_ap_staipassigned.ip.addr);
+#else
+    // No MAC in this event before IDF 5: give the IP to the newest station still without one
+    uint32_t ip = info.wifi_ap_staipassigned.ip.addr;
+    STATION_TABLE_LOCK();
+    StationInfo* newest = nullptr;
+    for (int i = 0; i < STATION_TABLE_SIZE; i++) {
+      StationInfo& entry = stationTable[i];
+      if (entry.aid != 0 && entry.ip == 0 && (!newest || (long)(entry.connectedMS - newest->connectedMS) > 0)) {
+        newest = &entry;
+      }
+    }
+    if (newest) {
+      newest->ip = ip;
+    }
+    STATION_TABLE_UNLOCK();
+#endif
+  }
+}
+#endif
+
+// Register the join/leave events, call in setupWiFi() before the SoftAP starts
+void setupStationTable() {
+#ifdef ESP32
+  WiFi.onEvent(onStationEvent, ARDUINO_EVENT_WIFI_AP_STACONNECTED);
+  WiFi.onEvent(onStationEvent, ARDUINO_EVENT_WIFI_AP_STADISCONNECTED);
+  WiFi.onEvent(onStationEvent, ARDUINO_EVENT_WIFI_AP_STAIPASSIGNED);
+#elif defined(ESP8266)
+  stationJoinHandler = WiFi.onSoftAPModeStationConnected([](const WiFiEventSoftAPModeStationConnected& event) {
+    addStation(event.mac, event.aid);
+  });
+  stationLeaveHandler = WiFi.onSoftAPModeStationDisconnected([](const WiFiEventSoftAPModeStationDisconnected& event) {
+    removeStation(event.mac);
+  });
+  stationProbeHandler = WiFi.onSoftAPModeProbeRequestReceived([](const WiFiEventSoftAPModeProbeRequestReceived& event) {
+    touchStation(event.mac, event.rssi, 0);
+  });
+#endif
+}
+
+// Fill in what the events do not carry, call periodically (the "stations" task does)
+void updateStationTable() {
+#ifdef ESP32
+  // RSSI & last seen from the driver's list, a stack struct - no allocation
+  wifi_sta_list_t stationList;
+  if (esp_wifi_ap_get_sta_list(&stationList) == ESP_OK) {
+    for (int i = 0; i < stationList.num; i++) {
+      touchStation(stationList.sta[i].mac, stationList.sta[i].rssi, 0);
+    }
+  }
+#elif defined(ESP8266)
+  // IPs of new stations, only walks the (allocated) SDK list while one is missing
+  bool missingIP = false;
+  for (int i = 0; i < STATION_TABLE_SIZE; i++) {
+    missingIP |= stationTable[i].aid != 0 && stationTable[i].ip == 0;
+  }
+  if (missingIP) {
+    struct station_info* station = wifi_softap_get_station_info();
+    while (station) {
+      touchStation(station->bssid, 0, station->ip.addr);
+      station = STAILQ_NEXT(station, next);
+    }
+    wifi_softap_free_station_info();
+  }
+#endif
+}
+
+// Print the table to the log, a few whole lines per message
+void printStationTable() {
+  if (HELPER_LOG_LEVEL < HELPER_LOG_INFO || logLevel < HELPER_LOG_INFO) {
+    return;
+  }
+  LOG_I("Number of connected devices = %d\n", stationCount());
+  char buffer[2 * STATION_RECORD_MAX];
+  StationCursor cursor = {};
+  size_t n;
+  while ((n = formatStations(buffer, sizeof(buffer), STATION_TEXT, cursor)) > 0) {
+    logWrite(buffer, n);
+  }
+}
+
+#endif
@@ -0,0 +1,254 @@
+/****************************************************************************************
+* ESP Wi-Fi Config
+* This helper file keeps all the Wi-Fi settings of ESPWiFiHelper.h in one WiFiConfig
+* struct, and stores it in LittleFS so settings can change without a reflash:
+* 1. The defaults are the `wifiConfig` initializer in ESPWiFiHelper.h (edit them there),
+* 2. setupWiFi() calls loadWiFiConfig(), a saved config replaces the defaults,
+* 3. saveWiFiConfig() writes the current one, call setupWiFi() again or restart to use it.
+*
+* The file (WIFI_CONFIG_PATH) is a compact binary record: magic, version, length, the
+* fields (strings length-prefixed), then a CRC32. A missing, cut short or corrupted file,
+* or one from a newer firmware, is ignored & the defaults stay. Fields added in a later
+* version go at the end: an older, shorter record ends where its fields end, & the
+* fields after that keep their defaults. Only a record cut inside a field is refused.
+****************************************************************************************/
+
+#ifndef ESPWiFiConfig_h
+#define ESPWiFiConfig_h
+
+#ifdef ESP32    // for ESP32 boards
+#include <WiFi.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <ESP8266WiFi.h>
+#endif
+
+#include <LittleFS.h>
+#include "ESPWiFiFastConnect.h"   // CRC32
+#include "ESPLog.h"               // mount failures, invalid config & load time
+
+// Wi-Fi Modes
+#define WIFI_MODE_SOFTAP   0
+#define WIFI_MODE_STA      1
+#define WIFI_MODE_AP_STA   2   // STA, with the SoftAP & captive portal as a fallback
+
+#define WIFI_CONFIG_MAGIC    0x47464357   // "WCFG"
+#define WIFI_CONFIG_VERSION  1            // bump when fields are added (at the end)
+#define WIFI_CONFIG_MAX_SIZE 320          // largest serialized config
+
+const char* WIFI_CONFIG_PATH = "/wifi.cfg";
+
+// All Wi-Fi settings
+struct WiFiConfig {
+  int mode;                 // WIFI_MODE_SOFTAP, WIFI_MODE_STA or WIFI_MODE_AP_STA
+
+  // SoftAP
+  char apSSID[33];          // SoftAP network name
+  char apPassword[65];      // SoftAP password (minimum 8 characters)
+  IPAddress apIP;           // AP IP address
+  IPAddress apSubnet;       // subnet mask for SoftAP
+
+  // STA
+  char staSSID[33];         // Wi-Fi network name
+  char staPassword[65];     // Wi-Fi network password
+  char hostName[33];        // hostname
+  bool useStaticIP;         // static IP = true | DHCP = false
+  bool useFastConnect;      // reuse the last AP & IP lease after a reset/deep sleep (ESPWiFiFastConnect.h)
+  IPAddress staticIP;       // static IP
+  IPAddress gateway;        // router gateway
+  IPAddress subnet;         // subnet mask
+  IPAddress dns;            // DNS server
+};
+
+// Flag bits of the serialized config
+#define WIFI_CONFIG_STATIC_IP    0x01
+#define WIFI_CONFIG_FAST_CONNECT 0x02
+
+
+// Bounds-checked cursor over a serialized config, `ok` turns false on overflow
+struct ConfigCursor {
+  uint8_t* data;
+  size_t size;
+  size_t pos;
+  bool ok;
+};
+
+void putConfigBytes(ConfigCursor& c, const void* bytes, size_t length) {
+  if (!c.ok || length > c.size - c.pos) {
+    c.ok = false;
+    return;
+  }
+  memcpy(c.data + c.pos, bytes, length);
+  c.pos += length;
+}
+
+void putConfigU32(ConfigCursor& c, uint32_t value) {
+  uint8_t bytes[4] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+  putConfigBytes(c, bytes, 4);
+}
+
+void putConfigString(ConfigCursor& c, const char* s, size_t fieldSize) {
+  uint8_t length = strnlen(s, fieldSize - 1);
+  putConfigBytes(c, &length, 1);
+  putConfigBytes(c, s, length);
+}
+
+void getConfigBytes(ConfigCursor& c, void* bytes, size_t length) {
+  if (!c.ok || length > c.size - c.pos) {
+    c.ok = false;
+    return;
+  }
+  memcpy(bytes, c.data + c.pos, length);
+  c.pos += length;
+}
+
+// A field starting at the end of the record is missing from an older version: keeps `missing`
+uint32_t getConfigU32(ConfigCursor& c, uint32_t missing) {
+  if (c.ok && c.pos == c.size) {
+    return missing;
+  }
+  uint8_t bytes[4] = { 0 };
+  getConfigBytes(c, bytes, 4);
+  return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+// Missing from an older version (at the end of the record): `s` keeps its value
+void getConfigString(ConfigCursor& c, char* s, size_t fieldSize) {
+  if (c.ok && c.pos == c.size) {
+    return;
+  }
+  uint8_t length = 0;
+  getConfigBytes(c, &length, 1);
+  if (length >= fieldSize) {
+    c.ok = false;
+    return;
+  }
+  getConfigBytes(c, s, length);
+  s[c.ok ? length : 0] = '\0';
+}
+
+// Serialize `config` into `out`, returns its length (0 if it does not fit)
+size_t serializeWiFiConfig(const WiFiConfig& config, uint8_t* out, size_t size) {
+  ConfigCursor c = { out, size, 0, true };
+  putConfigU32(c, WIFI_CONFIG_MAGIC);
+  uint8_t version = WIFI_CONFIG_VERSION;
+  putConfigBytes(c, &version, 1);
+  c.pos += 2;   // length, filled in below
+
+  uint8_t mode = config.mode;
+  uint8_t flags = (config.useStaticIP ? WIFI_CONFIG_STATIC_IP : 0) | (config.useFastConnect ? WIFI_CONFIG_FAST_CONNECT : 0);
+  putConfigBytes(c, &mode, 1);
+  putConfigBytes(c, &flags, 1);
+  putConfigString(c, config.apSSID, sizeof(config.apSSID));
+  putConfigString(c, config.apPassword, sizeof(config.apPassword));
+  putConfigU32(c, (uint32_t)config.apIP);
+  putConfigU32(c, (uint32_t)config.apSubnet);
+  putConfigString(c, config.staSSID, sizeof(config.staSSID));
+  putConfigString(c, config.staPassword, sizeof(config.staPassword));
+  putConfigString(c, config.hostName, sizeof(config.hostName));
+  putConfigU32(c, (uint32_t)config.staticIP);
+  putConfigU32(c, (uint32_t)config.gateway);
+  putConfigU32(c, (uint32_t)config.subnet);
+  putConfigU32(c, (uint32_t)config.dns);
+
+  if (!c.ok || c.size - c.pos < 4) {
+    return 0;
+  }
+  size_t length = c.pos + 4;
+  out[5] = length;
+  out[6] = length >> 8;
+  putConfigU32(c, fastConnectCRC(out, c.pos));
+  return length;
+}
+
+// Read a serialized config into `config`, which is left untouched unless it is valid
+bool deserializeWiFiConfig(const uint8_t* data, size_t length, WiFiConfig& config) {
+  if (length < 11 || length > WIFI_CONFIG_MAX_SIZE) {
+    return false;
+  }
+  ConfigCursor c = { (uint8_t*)data, length - 4, 0, true };   // the CRC is checked separately
+  uint8_t version = 0;
+  uint8_t lengthBytes[2];
+  uint32_t magic = getConfigU32(c, 0);
+  getConfigBytes(c, &version, 1);
+  getConfigBytes(c, lengthBytes, 2);
+
+  uint32_t crc = (uint32_t)data[length - 4] | (uint32_t)data[length - 3] << 8 |
+                 (uint32_t)data[length - 2] << 16 | (uint32_t)data[length - 1] << 24;
+  if (magic != WIFI_CONFIG_MAGIC || version == 0 || version > WIFI_CONFIG_VERSION ||
+      (size_t)(lengthBytes[0] | lengthBytes[1] << 8) != length || crc != fastConnectCRC(data, length - 4)) {
+    return false;
+  }
+
+  WiFiConfig loaded = config;   // fields missing from an older version keep their current values
+  uint8_t mode = 0, flags = 0;
+  getConfigBytes(c, &mode, 1);    // mode & flags are in every version
+  getConfigBytes(c, &flags, 1);
+  getConfigString(c, loaded.apSSID, sizeof(loaded.apSSID));
+  getConfigString(c, loaded.apPassword, sizeof(loaded.apPassword));
+  loaded.apIP = getConfigU32(c, (uint32_t)loaded.apIP);
+  loaded.apSubnet = getConfigU32(c, (uint32_t)loaded.apSubnet);
+  getConfigString(c, loaded.staSSID, sizeof(loaded.staSSID));
+  getConfigString(c, loaded.staPassword, sizeof(loaded.staPassword));
+  getConfigString(c, loaded.hostName, sizeof(loaded.hostName));
+  loaded.staticIP = getConfigU32(c, (uint32_t)loaded.staticIP);
+  loaded.gateway = getConfigU32(c, (uint32_t)loaded.gateway);
+  loaded.subnet = getConfigU32(c, (uint32_t)loaded.subnet);
+  loaded.dns = getConfigU32(c, (uint32_t)loaded.dns);
+  loaded.mode = mode;
+  loaded.useStaticIP = flags & WIFI_CONFIG_STATIC_IP;
+  loaded.useFastConnect = flags & WIFI_CONFIG_FAST_CONNECT;
+
+  if (!c.ok || mode > WIFI_MODE_AP_STA) {
+    return false;
+  }
+  config = loaded;
+  return true;
+}
+
+// Replace `config` with the saved one if there is a valid file, returns true if it did
+bool loadWiFiConfig(WiFiConfig& config) {
+  if (!mountLittleFS()) {
+    LOG_E("LittleFS mount failed! Using the default Wi-Fi config.\n");
+    return false;
+  }
+  unsigned long startUS = micros();
+
+  File file = LittleFS.open(WIFI_CONFIG_PATH, "r");
+  if (!file) {
+    return false;
+  }
+  uint8_t data[WIFI_CONFIG_MAX_SIZE];
+  size_t length = file.read(data, sizeof(data));
+  file.close();
+
+  if (!deserializeWiFiConfig(data, length, config)) {
+    LOG_W("Saved Wi-Fi config is invalid, using the defaults.\n");
+    return false;
+  }
+  LOG_I("Wi-Fi config loaded in %lu us\n", micros() - startUS);
+  return true;
+}
+
+// Save `config`, written to a temporary file first so a reset mid-write keeps the old one
+bool saveWiFiConfig(const WiFiConfig& config) {
+  uint8_t data[WIFI_CONFIG_MAX_SIZE];
+  size_t length = serializeWiFiConfig(config, data, sizeof(data));
+  if (length == 0) {
+    return false;
+  }
+  if (!mountLittleFS()) {
+    LOG_E("LittleFS mount failed! Wi-Fi config not saved.\n");
+    return false;
+  }
+
+  File file = LittleFS.open("/wifi.cfg.tmp", "w");
+  if (!file) {
+    return false;
+  }
+  bool written = file.write(data, length) == length;
+  file.close();
+  return written && LittleFS.rename("/wifi.cfg.tmp", WIFI_CONFIG_PATH);
+}
+
+#endif
@@ -0,0 +1,109 @@
+/****************************************************************************************
+* ESP Wi-Fi Fast Connect
+* This helper file keeps the last good connection details in RTC memory so the next
+* boot (reset or deep sleep wake) can skip the scan & DHCP:
+* 1. AP BSSID & channel - passed to WiFi.begin() as hints, no channel scan needed,
+* 2. IP, gateway, subnet & DNS - applied with WiFi.config(), no DHCP round trip.
+*
+* The cache is stored in RTC user memory on ESP8266 and in an RTC_DATA_ATTR variable on
+* ESP32, and is protected by a CRC32. RTC memory survives resets & deep sleep but not a
+* power cycle, so the first boot after power-up always takes the normal path.
+* A cached DHCP lease is applied as a static config for that session, so keep the router's
+* lease time longer than the device's sleep interval.
+*
+* This file is used by ESPWiFiSTAHelper.h & ESPWiFiHelper.h, set USE_FAST_CONNECT (STA helper)
+* or wifiConfig.useFastConnect (ESPWiFiHelper.h) to true to enable it. Include it in the project next to the Wi-Fi helper.
+****************************************************************************************/
+
+#ifndef ESPWiFiFastConnect_h
+#define ESPWiFiFastConnect_h
+
+#ifdef ESP32    // for ESP32 boards
+#include <WiFi.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <ESP8266WiFi.h>
+#endif
+
+const uint32_t FAST_CONNECT_MAGIC = 0x46434331;   // "FCC1", bump if the layout changes
+const uint32_t FAST_CONNECT_RTC_OFFSET = 32;      // ESP8266 RTC user memory offset (in 4 byte blocks), the first 128 bytes hold the OTA (eboot) command
+
+// Cached connection details, 32 bytes (a multiple of 4 as ESP8266 RTC memory needs)
+struct FastConnectCache {
+  uint32_t magic;       // FAST_CONNECT_MAGIC when the entry is valid
+  uint8_t bssid[6];     // BSSID of the AP we were associated with
+  uint8_t channel;      // channel of that AP
+  uint8_t network;      // index of the network in the STA helper's list (0 with one network)
+  uint32_t ip;          // IP address (DHCP lease or static)
+  uint32_t gateway;     // gateway address
+  uint32_t subnet;      // subnet mask
+  uint32_t dns;         // DNS server
+  uint32_t crc;         // CRC32 over all fields above
+};
+
+FastConnectCache fastConnectCache;  // working copy, filled by loadFastConnectCache()
+
+#ifdef ESP32
+RTC_DATA_ATTR FastConnectCache rtcFastConnectCache;  // lives in RTC slow memory
+#endif
+
+
+// CRC32 (reflected, polynomial 0xEDB88320), bitwise to avoid a 1 KB lookup table
+uint32_t fastConnectCRC(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xFFFFFFFF;
+  while (length--) {
+    crc ^= *data++;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+// Read the cache from RTC memory, returns true if it holds a valid entry
+bool loadFastConnectCache() {
+#ifdef ESP32
+  memcpy(&fastConnectCache, &rtcFastConnectCache, sizeof(fastConnectCache));
+#elif defined(ESP8266)
+  if (!ESP.rtcUserMemoryRead(FAST_CONNECT_RTC_OFFSET, (uint32_t*)&fastConnectCache, sizeof(fastConnectCache))) {
+    return false;
+  }
+#endif
+
+  return fastConnectCache.magic == FAST_CONNECT_MAGIC &&
+         fastConnectCache.crc == fastConnectCRC((const uint8_t*)&fastConnectCache, offsetof(FastConnectCache, crc));
+}
+
+// Write the working copy to RTC memory
+void writeFastConnectCache() {
+  fastConnectCache.crc = fastConnectCRC((const uint8_t*)&fastConnectCache, offsetof(FastConnectCache, crc));
+
+#ifdef ESP32
+  memcpy(&rtcFastConnectCache, &fastConnectCache, sizeof(fastConnectCache));
+#elif defined(ESP8266)
+  ESP.rtcUserMemoryWrite(FAST_CONNECT_RTC_OFFSET, (uint32_t*)&fastConnectCache, sizeof(fastConnectCache));
+#endif
+}
+
+// Store the details of the current connection, call once connected
+void saveFastConnectCache(uint8_t network = 0) {
+  memset(&fastConnectCache, 0, sizeof(fastConnectCache));
+  fastConnectCache.magic = FAST_CONNECT_MAGIC;
+  memcpy(fastConnectCache.bssid, WiFi.BSSID(), sizeof(fastConnectCache.bssid));
+  fastConnectCache.channel = WiFi.channel();
+  fastConnectCache.network = network;
+  fastConnectCache.ip = (uint32_t)WiFi.localIP();
+  fastConnectCache.gateway = (uint32_t)WiFi.gatewayIP();
+  fastConnectCache.subnet = (uint32_t)WiFi.subnetMask();
+  fastConnectCache.dns = (uint32_t)WiFi.dnsIP();
+
+  writeFastConnectCache();
+}
+
+// Invalidate the cache, e.g. when the hints did not work
+void clearFastConnectCache() {
+  memset(&fastConnectCache, 0, sizeof(fastConnectCache));
+  writeFastConnectCache();
+}
+
+#endif
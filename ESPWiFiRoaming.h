@@ -0,0 +1,203 @@
+/****************************************************************************************
+* ESP Wi-Fi Roaming
+* This helper file lets the STA helper use several networks & access points:
+* 1. A list of SSID/password pairs (like WiFiMulti), tried in order of signal strength,
+* 2. A ranked candidate table (BSSID, channel, RSSI) filled from asynchronous scans,
+*    WiFi.scanNetworks(true), so the scan never blocks loop(),
+* 3. Roaming: while connected, a background scan starts when the averaged RSSI drops below
+*    ROAM_RSSI_THRESHOLD, and the STA moves to a candidate at least ROAM_HYSTERESIS_DB
+*    stronger. After joining an AP it stays for at least ROAM_HOLD_MS, so two APs of
+*    similar strength do not make it bounce between them.
+*
+* The decisions (addRoamCandidate(), updateRoamRSSI(), roamScanDue(), pickRoamCandidate())
+* only work on the table & the times passed in, the scan itself is in startRoamScan() &
+* pollRoamScan().
+*
+* This file is used by ESPWiFiSTAHelper.h: the network list is `wifiNetworks` there and
+* USE_ROAMING turns the background scans & roaming on.
+****************************************************************************************/
+
+#ifndef ESPWiFiRoaming_h
+#define ESPWiFiRoaming_h
+
+#ifdef ESP32    // for ESP32 boards
+#include <WiFi.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <ESP8266WiFi.h>
+#endif
+
+#include "ESPLog.h"   // buffered, non-blocking log
+
+#define ROAM_MAX_CANDIDATES 8   // strongest APs kept from a scan
+
+const int ROAM_RSSI_THRESHOLD = -72;                     // dBm, look for a better AP below this (averaged)
+const int ROAM_HYSTERESIS_DB = 8;                        // dB a candidate must beat the current AP by
+const unsigned long ROAM_HOLD_MS = 60000;                // ms on an AP before roaming away from it again
+const unsigned long ROAM_SCAN_INTERVAL_MS = 30000;       // ms between background scans while the signal is weak
+const unsigned long ROAM_CANDIDATE_MAX_AGE_MS = 60000;   // ms a scan result stays usable
+
+// One network to join
+struct WiFiNetwork {
+  const char* ssid;       // Wi-Fi network name
+  const char* password;   // Wi-Fi network password
+};
+
+// One AP seen in the last scan that belongs to a configured network
+struct RoamCandidate {
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t network;        // index into the network list
+  int8_t rssi;            // dBm when scanned
+};
+
+const WiFiNetwork* roamNetworks = nullptr;     // network list, set by setupRoaming()
+int roamNetworkCount = 0;
+
+RoamCandidate roamCandidates[ROAM_MAX_CANDIDATES];   // strongest first
+int roamCandidateCount = 0;
+int roamNextCandidate = 0;            // next candidate to try when connecting
+unsigned long roamScanMS = 0;         // when the candidate table was filled
+unsigned long roamLastScanMS = 0;     // when the last scan started
+bool roamScanning = false;            // async scan in progress
+bool roamScanned = false;             // the table holds results of at least one scan
+
+int roamRSSI = 0;                     // averaged RSSI of the current AP (dBm), 0 = no sample yet
+unsigned long roamAssociatedMS = 0;   // when the current AP was joined
+
+
+// Index of `ssid` in the network list, -1 if it is not one of ours
+int roamNetworkIndex(const char* ssid) {
+  for (int i = 0; i < roamNetworkCount; i++) {
+    if (strcmp(roamNetworks[i].ssid, ssid) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Empty the candidate table before a new scan is read in
+void clearRoamCandidates() {
+  roamCandidateCount = 0;
+  roamNextCandidate = 0;
+}
+
+// Add a scanned AP, kept in RSSI order (the earlier network wins a tie) & only the strongest ROAM_MAX_CANDIDATES
+void addRoamCandidate(const char* ssid, const uint8_t bssid[6], int rssi, int channel) {
+  int network = roamNetworkIndex(ssid);
+  if (network < 0) {
+    return;
+  }
+
+  int pos = roamCandidateCount;
+  while (pos > 0 && (roamCandidates[pos - 1].rssi < rssi ||
+                     (roamCandidates[pos - 1].rssi == rssi && roamCandidates[pos - 1].network > network))) {
+    pos--;
+  }
+  if (pos >= ROAM_MAX_CANDIDATES) {
+    return;   // weaker than everything kept
+  }
+  int last = roamCandidateCount < ROAM_MAX_CANDIDATES ? roamCandidateCount : ROAM_MAX_CANDIDATES - 1;
+  memmove(&roamCandidates[pos + 1], &roamCandidates[pos], (last - pos) * sizeof(RoamCandidate));
+  if (roamCandidateCount < ROAM_MAX_CANDIDATES) {
+    roamCandidateCount++;
+  }
+
+  RoamCandidate& candidate = roamCandidates[pos];
+  memcpy(candidate.bssid, bssid, 6);
+  candidate.channel = channel;
+  candidate.network = network;
+  candidate.rssi = rssi < -128 ? -128 : rssi;
+}
+
+// True if there is a recent candidate that has not been tried yet
+bool roamCandidatesLeft(unsigned long currentMS) {
+  return roamScanned && roamNextCandidate < roamCandidateCount && currentMS - roamScanMS < ROAM_CANDIDATE_MAX_AGE_MS;
+}
+
+// The STA joined an AP: start its hold time & a new RSSI average
+void roamAssociated(unsigned long currentMS) {
+  roamAssociatedMS = currentMS;
+  roamRSSI = 0;
+}
+
+// Add an RSSI sample of the current AP to the average (1/4 weight, so a single dip does not count)
+void updateRoamRSSI(int rssi) {
+  if (rssi >= 0) {
+    return;   // not associated
+  }
+  roamRSSI = roamRSSI == 0 ? rssi : roamRSSI + (rssi - roamRSSI) / 4;
+}
+
+// True if a background scan should start now
+bool roamScanDue(unsigned long currentMS) {
+  return !roamScanning && roamRSSI != 0 && roamRSSI < ROAM_RSSI_THRESHOLD &&
+         currentMS - roamAssociatedMS >= ROAM_HOLD_MS &&
+         (!roamScanned || currentMS - roamLastScanMS >= ROAM_SCAN_INTERVAL_MS);
+}
+
+// Candidate to roam to from the AP `currentBSSID` at `currentRSSI`, -1 to stay
+int pickRoamCandidate(const uint8_t currentBSSID[6], int currentRSSI, unsigned long currentMS) {
+  if (currentRSSI >= ROAM_RSSI_THRESHOLD || currentMS - roamAssociatedMS < ROAM_HOLD_MS ||
+      !roamScanned || currentMS - roamScanMS >= ROAM_CANDIDATE_MAX_AGE_MS) {
+    return -1;
+  }
+  for (int i = 0; i < roamCandidateCount; i++) {
+    if (memcmp(roamCandidates[i].bssid, currentBSSID, 6) != 0) {
+      // Strongest other AP, the rest are weaker still
+      return roamCandidates[i].rssi >= currentRSSI + ROAM_HYSTERESIS_DB ? i : -1;
+    }
+  }
+  return -1;
+}
+
+
+// Use `networks` for connecting & roaming, call in setupWiFi()
+void setupRoaming(const WiFiNetwork* networks, int count) {
+  roamNetworks = networks;
+  roamNetworkCount = count;
+}
+
+// Start an asynchronous scan, pollRoamScan() picks up the results
+void startRoamScan(unsigned long currentMS) {
+  if (roamScanning) {
+    return;
+  }
+  WiFi.scanDelete();            // free the results of a previous scan
+  WiFi.scanNetworks(true);      // async, returns straight away
+  roamScanning = true;
+  roamLastScanMS = currentMS;
+}
+
+// Read the scan results into the candidate table once the scan is done, true when it finished
+bool pollRoamScan(unsigned long currentMS) {
+  if (!roamScanning) {
+    return false;
+  }
+  int found = WiFi.scanComplete();
+  if (found == WIFI_SCAN_RUNNING) {
+    return false;
+  }
+
+  roamScanning = false;
+  if (found < 0) {
+    LOG_W("Wi-Fi scan failed.\n");
+    return true;   // the old table stays, until it ages out
+  }
+  clearRoamCandidates();
+  for (int i = 0; i < found; i++) {
+    addRoamCandidate(WiFi.SSID(i).c_str(), WiFi.BSSID(i), WiFi.RSSI(i), WiFi.channel(i));
+  }
+  WiFi.scanDelete();
+  roamScanMS = currentMS;
+  roamScanned = true;
+  if (roamCandidateCount > 0) {
+    LOG_I("Wi-Fi scan: %d of %d APs are ours, best %s at %d dBm on channel %u\n", roamCandidateCount, found,
+          roamNetworks[roamCandidates[0].network].ssid, roamCandidates[0].rssi, roamCandidates[0].channel);
+  } else {
+    LOG_I("Wi-Fi scan: none of the %d APs are ours\n", found);
+  }
+  return true;
+}
+
+#endif
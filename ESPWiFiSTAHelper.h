@@ -2,14 +2,27 @@
 * This helper file consolidates the following functions:
 * 1. Connect to Wi-Fi network,
 * 2. Configure static IP address (optional),
-* 3. Check internet connectivity using ping,
-* 4. Handle LED blinking states based on connectivity.
+* 3. Monitor internet connectivity in the background (ESPReachability.h),
+* 4. Show the connection state on the LED from a timer (ESPStatusLED.h): fast blink while
+*    connecting, slow blink without internet, solid when online, 2 pulses after giving up,
+* 5. Retry the connection in the background (timeout + exponential backoff) without blocking,
+* 6. Optionally reconnect fast after a reset/deep sleep using the cached AP & IP (ESPWiFiFastConnect.h),
+* 7. Join the strongest of several networks, and roam to a clearly stronger AP when the
+*    signal gets weak (ESPWiFiRoaming.h).
+*
+* With the scheduler (ESPScheduler.h): in main setup() > call scheduleWiFi() after setupWiFi(),
+* and in main loop() > call Scheduler::run() instead of handleWiFi() & handleLog().
+* Set `idleMode` in ESPPowerSave.h to modem or light sleep the radio while the scheduler idles.
 *
 * To use this helper:
 * - Include this file in your project,
-* - Modify the SSID info, choose to use a Static IP or DHCP - if static, configure as needed,
-* - In main setup() > call the setupWiFi() function,
-* - In main loop() > call the handleLED() function.
+* - Modify the network list (one or more SSID/password pairs), choose to use a Static IP or DHCP - if static, configure as needed,
+* - In main setup() > call the setupWiFi() function (returns immediately, no waiting for the AP),
+* - In main loop() > call the handleWiFi() & handleLog() functions (& handleWiFiEvents() if you
+*   subscribe to ESPWiFiEvents.h).
+*
+* Messages go through ESPLog.h (LOG_I() etc.), so they never stall the connection handling.
+* RSSI, reconnects, roams & probe RTT/loss are registered with ESPMetrics.h for /metrics.
 ****************************************************************************************/
 
 #ifndef ESPWiFiSTAHelper_h
@@ -17,19 +30,36 @@
 
 #ifdef ESP32    // for ESP32 boards
 #include <WiFi.h>
-#include <ESP32Ping.h>
 
 #elif defined(ESP8266)    // for ESP8266 boards
 #include <ESP8266WiFi.h>
-#include <ESP8266Ping.h>
 #endif
 
+#include "ESPLog.h"              // buffered, non-blocking log
+#include "ESPWiFiFastConnect.h"   // BSSID/channel/IP cache in RTC memory
+#include "ESPReachability.h"      // background gateway/DNS/internet probes
+#include "ESPScheduler.h"         // cooperative task scheduler
+#include "ESPPowerSave.h"         // modem/light sleep while the scheduler idles
+#include "ESPWiFiRoaming.h"       // network list, scan candidates & roaming
+#include "ESPMetrics.h"           // Prometheus counters & gauges
+#include "ESPProfiler.h"          // opt-in entry point timing (HELPER_PROFILE)
+#include "ESPStatusPush.h"        // live status for dashboards
+#include "ESPStatusLED.h"         // LED patterns played from a timer
+#include "ESPWiFiEvents.h"        // event bus for application subscribers
+#include "ESPLinkQuality.h"       // RSSI history & adaptive TX power
+
 // Configuration for Wi-Fi and static IP (if applicable)
-const char* ssid = "YOUR_SSID_NAME";      // Wi-Fi network name
-const char* password = "YOUR_SSID_PW";    // Wi-Fi network password
+// Networks to join, like WiFiMulti: with more than one, a scan finds which are in range & they
+// are tried strongest first. APs sharing an SSID need only one entry.
+const WiFiNetwork wifiNetworks[] = {
+  { "YOUR_SSID_NAME", "YOUR_SSID_PW" },   // Wi-Fi network name & password
+};
+const int WIFI_NETWORK_COUNT = sizeof(wifiNetworks) / sizeof(wifiNetworks[0]);
 const char* hostName = "ESP8266";         // change the hostname if needed
 
-bool USE_STATIC_IP = false;   // static IP = true | DHCP = false
+bool USE_STATIC_IP = false;     // static IP = true | DHCP = false
+bool USE_FAST_CONNECT = false;  // reuse the last AP & IP lease after a reset/deep sleep = true | always scan & DHCP = false
+bool USE_ROAMING = true;        // scan when the signal is weak & move to a stronger AP = true | stay until the link drops = false
 
 IPAddress staticIP(192, 168, 3, 10);    // static IP
 IPAddress gateway(192, 168, 3, 1);      // router gateway
@@ -38,13 +68,139 @@ IPAddress dns(192, 168, 3, 1);          // DNS server
 
 bool isConnected = false;   // Wi-Fi connection status
 bool hasInternet = false;   // internet connection status
+uint32_t wifiReconnects = 0; // connections lost since boot
+uint32_t wifiRoams = 0;      // moves to a stronger AP since boot
+
+// Connection retry settings
+const unsigned long CONNECT_TIMEOUT_MS = 15000;  // ms to wait for an attempt before giving up on it
+const unsigned long BACKOFF_BASE_MS = 1000;      // ms to wait after the first failed attempt (doubles each failure)
+const unsigned long BACKOFF_MAX_MS = 60000;      // upper limit for the wait between attempts
+const int MAX_CONNECT_ATTEMPTS = 0;              // attempts before giving up for good (0 = keep trying)
+const unsigned long FAST_CONNECT_TIMEOUT_MS = 3000;  // ms to wait for a cached AP before falling back to a full scan
+
+// Task periods
+const unsigned long WIFI_TASK_PERIOD_MS = 50;    // ms between handleWiFi() runs when scheduled & busy
+const unsigned long WIFI_IDLE_PERIOD_MS = 1000;  // ms between handleWiFi() runs when connected with no probe in flight
+
+// Connection states, advanced by handleWiFi()
+enum ConnState {
+  CONN_IDLE,        // setupWiFi() not called yet
+  CONN_SCANNING,    // finding which of the networks are in range before an attempt
+  CONN_CONNECTING,  // waiting for WiFi.begin() to associate
+  CONN_CONNECTED,   // associated & IP assigned
+  CONN_BACKOFF,     // attempt failed, waiting before the next one
+  CONN_FAILED       // MAX_CONNECT_ATTEMPTS reached, no more attempts
+};
+
+ConnState connState = CONN_IDLE;  // current connection state
+unsigned long connStateMS = 0;    // time the current state was entered
+unsigned long backoffMS = 0;      // wait before the next attempt while in CONN_BACKOFF
+int connectAttempts = 0;          // failed attempts since the last successful connection
+bool fastConnecting = false;      // current attempt uses the cached BSSID/channel/IP
+unsigned long connectStartMS = 0; // time setupWiFi() started the first attempt
+int wifiTaskId = -1;              // scheduler task id of handleWiFi(), -1 if not scheduled
+uint8_t connectNetwork = 0;       // index in wifiNetworks of the current attempt / connection
+
+
+// Start a connection attempt
+void beginWiFiAttempt() {
+  if (fastConnecting) {
+    connectNetwork = fastConnectCache.network < WIFI_NETWORK_COUNT ? fastConnectCache.network : 0;
+    beginWiFiSTA(wifiNetworks[connectNetwork].ssid, wifiNetworks[connectNetwork].password,
+                 fastConnectCache.channel, fastConnectCache.bssid);  // skip the channel scan
+  } else if (roamCandidatesLeft(millis())) {
+    const RoamCandidate& candidate = roamCandidates[roamNextCandidate++];   // strongest AP not tried yet
+    connectNetwork = candidate.network;
+    beginWiFiSTA(wifiNetworks[connectNetwork].ssid, wifiNetworks[connectNetwork].password, candidate.channel, candidate.bssid);
+  } else {
+    connectNetwork = 0;
+    beginWiFiSTA(wifiNetworks[0].ssid, wifiNetworks[0].password);  // connect to Wi-Fi network, keeps the listen interval
+  }
+  connectAttempts++;
+  connState = CONN_CONNECTING;
+  connStateMS = millis();
+
+  LOG_I("Attempting to connect to %s (attempt %d)", wifiNetworks[connectNetwork].ssid, connectAttempts);
+}
+
+// Start the next attempt, with several networks scan first unless a recent scan has APs left to try
+void nextWiFiAttempt() {
+  if (WIFI_NETWORK_COUNT > 1 && !fastConnecting && !roamCandidatesLeft(millis())) {
+    startRoamScan(millis());
+    connState = CONN_SCANNING;
+    connStateMS = millis();
+    LOG_I("Scanning for Wi-Fi networks...\n");
+    return;
+  }
+  beginWiFiAttempt();
+}
+
+// Work out the wait before the next attempt: doubles per failure up to BACKOFF_MAX_MS,
+// plus up to 25% random jitter so a room full of nodes does not retry in lock-step
+unsigned long nextBackoffMS() {
+  unsigned long waitMS = BACKOFF_BASE_MS;
+  for (int i = 1; i < connectAttempts && waitMS < BACKOFF_MAX_MS; i++) {
+    waitMS *= 2;
+  }
+  if (waitMS > BACKOFF_MAX_MS) {
+    waitMS = BACKOFF_MAX_MS;
+  }
+  return waitMS + random(waitMS / 4 + 1);
+}
+
+// Runs once when the connection comes up
+void onWiFiConnected() {
+  LOG_I("\nWi-Fi connected!\n");
+  IPAddress ip = WiFi.localIP();
+  LOG_I("IP Address: %u.%u.%u.%u\n", ip[0], ip[1], ip[2], ip[3]);
+
+  isConnected = true;     // set Wi-Fi is connected flag
+  setStatus(STATUS_CONNECTED, 1);
+  connectAttempts = 0;    // reset the backoff
+  LOG_I("Connected in %lu ms%s\n", millis() - connectStartMS, fastConnecting ? " (fast connect)" : "");
+
+  if (USE_FAST_CONNECT) {
+    saveFastConnectCache(connectNetwork);   // remember this AP & lease for the next boot
+  }
+  roamAssociated(millis());   // hold time before roaming away again
+
+  // Check internet connectivity in the background, handleWiFi() updates hasInternet
+  LOG_I("Monitoring internet access...\n");
+  startReachability();
+}
+
+
+int32_t readWiFiMetric(int arg) {
+  switch (arg) {
+    case 0: return isConnected ? WiFi.RSSI() : 0;
+    case 1: return isConnected;
+    default: return hasInternet;
+  }
+}
+
+// Register the Wi-Fi metrics (ESPMetrics.h), once
+void registerWiFiMetrics() {
+  static bool registered = false;
+  if (registered) {
+    return;
+  }
+  registered = true;
+  setupMetrics();
+  registerGauge("wifi_rssi_dbm", "STA signal strength, 0 when not connected", nullptr, readWiFiMetric, 0);
+  registerGauge("wifi_connected", "STA connected", nullptr, readWiFiMetric, 1);
+  registerGauge("wifi_internet", "Internet host reachable", nullptr, readWiFiMetric, 2);
+  registerCounter("wifi_reconnects_total", "STA connections lost since boot", nullptr, &wifiReconnects);
+  registerCounter("wifi_roams_total", "Moves to a stronger AP since boot", nullptr, &wifiRoams);
+  registerReachabilityMetrics();
+}
 
 
 // Single function to handle Wi-Fi setup and LED states
 void setupWiFi() {
-  // Initialize the Built-In LED
-  pinMode(LED_BUILTIN, OUTPUT);     // set the LED pin mode
-  digitalWrite(LED_BUILTIN, HIGH);  // initialize the LED as off (active low)
+  PROFILE_SCOPE("setupWiFi");
+  setupStatusLED();   // LED off, handleWiFi() posts the patterns
+  setupWiFiEvents();  // platform events into the bus for subscribers
+  setupLinkQuality(); // full TX power again after a disconnect
 
   // Start Wi-Fi connection
   WiFi.mode(WIFI_STA);            // set Wi-Fi to Station mode
@@ -57,53 +213,182 @@ void setupWiFi() {
   // Configure static IP if USE_STATIC_IP is true
   if (USE_STATIC_IP) {
     if (!WiFi.config(staticIP, gateway, subnet, dns)) {
-      Serial.println("Failed to configure static IP! Check the ESPWiFiHelper.h configuration.");
+      LOG_E("Failed to configure static IP! Check the ESPWiFiHelper.h configuration.\n");
     } else {
-      Serial.println("Static IP configuration successful.");
+      LOG_I("Static IP configuration successful.\n");
     }
   }
 
-  WiFi.begin(ssid, password);  // connect to Wi-Fi network
-
-  Serial.print("Attempting to connect to Wi-Fi");
-  while (WiFi.status() != WL_CONNECTED) {
-    Serial.print(".");
-    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));   // toggle LED for fast blinking
-    delay(250);
+  // Use the cached AP & IP if there is a valid entry from before the reset
+  if (USE_FAST_CONNECT && loadFastConnectCache()) {
+    LOG_I("Using cached AP & IP for a fast connect.\n");
+    fastConnecting = true;
+    if (!USE_STATIC_IP) {
+      WiFi.config(IPAddress(fastConnectCache.ip), IPAddress(fastConnectCache.gateway),
+                  IPAddress(fastConnectCache.subnet), IPAddress(fastConnectCache.dns));
+    }
   }
 
-  Serial.println("\nWi-Fi connected!");
-  Serial.print("IP Address: ");
-  Serial.println(WiFi.localIP());
-  
-  isConnected = true;  // set Wi-Fi is connected flag
+  applyPowerSave();  // modem/light sleep setting, needs to be set before associating
 
-  // Check internet connectivity using ping
-  Serial.println("\nPinging Google to test internet & DNS...");
-  hasInternet = Ping.ping("www.google.com");
+  setupRoaming(wifiNetworks, WIFI_NETWORK_COUNT);
+  registerWiFiMetrics();
+  connectStartMS = millis();
+  nextWiFiAttempt();  // start connecting, handleWiFi() takes it from here
+}
 
+// Connection gone (or left for another AP): stop the probes
+void dropWiFiConnection() {
+  stopReachability();
+  isConnected = false;
   if (hasInternet) {
-    Serial.println("Ping successful! Internet is available.");
-    digitalWrite(LED_BUILTIN, LOW);  // solid LED (active low)
-  } else {
-    Serial.println("Ping failed! Either Wi-Fi is connected with no internet, or DNS is not working.");
+    postWiFiEvent(WIFI_EVENT_BUS_INTERNET, 0);
   }
+  hasInternet = false;
+  setStatus(STATUS_CONNECTED, 0);
+  setStatus(STATUS_INTERNET, 0);
 }
 
-// Function to handle LED blinking for no internet access
-void handleBuiltInLED() {
-  const long BLINK_PERIOD = 1000;  // ms for slow blink
-  long lastBlinkMS = 0;            // last time the LED blinked
-  bool ledState = false;           // current state of the LED
-  long currentMS = millis();       // get the current time
-
-  if (isConnected && !hasInternet) {
-    if (currentMS - lastBlinkMS >= BLINK_PERIOD) {
-      digitalWrite(LED_BUILTIN, ledState);  // toggle the LED
-      ledState = !ledState;                 // update LED state
-      lastBlinkMS = currentMS;              // update the last blink time
+// While connected: scan in the background when the signal is weak, and move to a clearly stronger AP
+void handleRoaming(unsigned long currentMS) {
+  PROFILE_SCOPE("handleRoaming");
+  static unsigned long lastSampleMS = 0;
+  if (currentMS - lastSampleMS >= WIFI_IDLE_PERIOD_MS) {
+    updateRoamRSSI(WiFi.RSSI());   // one sample per idle period, however often handleWiFi() runs
+    lastSampleMS = currentMS;
+  }
+
+  if (pollRoamScan(currentMS)) {
+    int best = pickRoamCandidate(WiFi.BSSID(), roamRSSI, currentMS);
+    if (best >= 0) {
+      const RoamCandidate& candidate = roamCandidates[best];
+      LOG_I("\nRoaming from %d dBm to %02X:%02X:%02X:%02X:%02X:%02X (%s) at %d dBm\n", roamRSSI,
+            candidate.bssid[0], candidate.bssid[1], candidate.bssid[2], candidate.bssid[3],
+            candidate.bssid[4], candidate.bssid[5], wifiNetworks[candidate.network].ssid, candidate.rssi);
+      dropWiFiConnection();
+      WiFi.disconnect();
+      wifiRoams++;
+      roamNextCandidate = best;
+      connectAttempts = 0;
+      beginWiFiAttempt();
     }
+  } else if (roamScanDue(currentMS) && !reachabilityBusy()) {
+    startRoamScan(currentMS);   // between probes, the radio leaves the channel for a moment
+  }
+}
+
+// LED pattern of the connection state
+LEDPattern wifiLEDPattern() {
+  switch (connState) {
+    case CONN_SCANNING:
+    case CONN_CONNECTING: return LED_FAST_BLINK;
+    case CONN_CONNECTED:  return hasInternet ? LED_ON : LED_SLOW_BLINK;
+    case CONN_FAILED:     return ledErrorCode(LED_ERROR_CONNECT);
+    default:              return LED_OFF;   // idle, or waiting out the backoff
   }
 }
 
+// Advance the connection state machine, call from loop()
+void handleWiFi() {
+  PROFILE_SCOPE("handleWiFi");
+  const unsigned long DOT_PERIOD_MS = 250;      // ms between progress dots while connecting
+  static unsigned long lastDotMS = 0;           // last time a dot was logged
+  unsigned long currentMS = millis();           // get the current time
+
+  switch (connState) {
+    case CONN_SCANNING:
+      if (pollRoamScan(currentMS) || currentMS - connStateMS >= CONNECT_TIMEOUT_MS) {
+        roamScanning = false;
+        beginWiFiAttempt();   // strongest AP found, or the first network if none were (it may be hidden)
+      }
+      break;
+
+    case CONN_CONNECTING:
+      if (WiFi.status() == WL_CONNECTED) {
+        connState = CONN_CONNECTED;
+        connStateMS = currentMS;
+        onWiFiConnected();
+        fastConnecting = false;
+      } else if (fastConnecting && (currentMS - connStateMS >= FAST_CONNECT_TIMEOUT_MS ||
+                                    WiFi.status() == WL_NO_SSID_AVAIL || WiFi.status() == WL_CONNECT_FAILED)) {
+        // Cached AP is gone or the lease is no longer valid, fall back to the normal path straight away
+        LOG_W("\nFast connect failed, falling back to a full scan.\n");
+        fastConnecting = false;
+        clearFastConnectCache();
+        WiFi.disconnect();
+        if (!USE_STATIC_IP) {
+          WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));  // back to DHCP
+        }
+        connectAttempts = 0;
+        nextWiFiAttempt();
+      } else if (currentMS - connStateMS >= CONNECT_TIMEOUT_MS) {
+        WiFi.disconnect();                // drop the attempt
+        connStateMS = currentMS;
+
+        if (MAX_CONNECT_ATTEMPTS > 0 && connectAttempts >= MAX_CONNECT_ATTEMPTS) {
+          connState = CONN_FAILED;
+          LOG_E("\nWi-Fi connection failed! Giving up, check the SSID & password.\n");
+        } else {
+          connState = CONN_BACKOFF;
+          backoffMS = nextBackoffMS();
+          LOG_W("\nWi-Fi connection timed out, retrying in %lu ms\n", backoffMS);
+        }
+      } else if (currentMS - lastDotMS >= DOT_PERIOD_MS) {
+        LOG_I(".");
+        lastDotMS = currentMS;
+      }
+      break;
+
+    case CONN_BACKOFF:
+      if (currentMS - connStateMS >= backoffMS) {
+        nextWiFiAttempt();
+      }
+      break;
+
+    case CONN_CONNECTED:
+      if (WiFi.status() != WL_CONNECTED) {
+        LOG_W("\nWi-Fi connection lost!\n");
+        wifiReconnects++;
+        dropWiFiConnection();
+        nextWiFiAttempt();
+      } else {
+        handleReachability();
+        handleLinkQuality(currentMS);
+        setStatus(STATUS_RSSI, WiFi.RSSI(), 3);
+        if (internetReachable() != hasInternet) {
+          hasInternet = !hasInternet;
+          setStatus(STATUS_INTERNET, hasInternet);
+          postWiFiEvent(WIFI_EVENT_BUS_INTERNET, hasInternet);
+          if (hasInternet) {
+            LOG_I("Internet is available.\n");
+          } else {
+            LOG_W("Internet lost! Either the uplink is down, or DNS is not working.\n");
+          }
+        }
+        if (USE_ROAMING) {
+          handleRoaming(currentMS);
+        }
+      }
+      break;
+
+    default:  // CONN_IDLE & CONN_FAILED: nothing to do
+      break;
+  }
+
+  // Only poll quickly while connecting, scanning or probing, so the scheduler can sleep longer otherwise
+  bool busy = connState == CONN_CONNECTING || roamScanning || (connState == CONN_CONNECTED && reachabilityBusy());
+  Scheduler::setPeriod(wifiTaskId, busy ? WIFI_TASK_PERIOD_MS : WIFI_IDLE_PERIOD_MS);
+  setLEDPattern(wifiLEDPattern());   // only restarts the LED timer when the state changed
+}
+
+// The LED runs from a timer now (ESPStatusLED.h), kept so loop()s calling it still build
+void handleBuiltInLED() {}
+
+// Register handleWiFi() with the scheduler, call in setup() after setupWiFi()
+void scheduleWiFi() {
+  wifiTaskId = Scheduler::add("wifi", handleWiFi, WIFI_TASK_PERIOD_MS);
+  scheduleWiFiEvents();   // dispatch to the event subscribers
+  scheduleLog();   // drain the log into Serial
+}
+
 #endif
@@ -3,13 +3,18 @@
 * This helper file consolidates the following functions:
 * 1. Set up Wi-Fi Soft Access Point (AP) with custom settings,
 * 2. Configure AP IP address and subnet mask,
-* 3. Print number of connected devices every 10 seconds.
+* 3. Track connected devices from the join/leave events (ESPStationTable.h) & print them
+*    when they change.
 *
 * To use this helper:
 * - Include this file in your project,
 * - Modify the SSID info, password, and AP IP configuration as needed,
 * - In main setup() > call setupSoftAP() function,
-* - In main loop() > call whosConnected() function.
+* - In main loop() > call the whosConnected() & handleLog() functions (& handleWiFiEvents() if you
+*   subscribe to ESPWiFiEvents.h).
+*
+* With the scheduler (ESPScheduler.h): in main setup() > call scheduleWiFi() after setupWiFi(),
+* and in main loop() > call Scheduler::run() instead of whosConnected() & handleLog().
 ****************************************************************************************/
 
 #ifndef ESPWiFiSoftAPHelper_h
@@ -22,6 +27,13 @@
 #include <ESP8266WiFi.h>
 #endif
 
+#include "ESPScheduler.h"   // cooperative task scheduler
+#include "ESPLog.h"         // buffered, non-blocking log
+#include "ESPStationTable.h"  // connected stations, updated by events
+#include "ESPProfiler.h"     // opt-in entry point timing (HELPER_PROFILE)
+#include "ESPStatusLED.h"    // LED patterns played from a timer
+#include "ESPWiFiEvents.h"   // event bus for application subscribers
+
 
 // Configuration for SoftAP
 const char* ssid = "ESP8266";       // Wi-Fi AP network name
@@ -33,73 +45,68 @@ IPAddress subnet(255, 255, 255, 0); // Subnet mask
 long lastCheckMS = 0;   // variable to track the last check connected devices time
 bool isActive = false;  // Wi-Fi AP status
 
+const unsigned long CHECK_PERIOD_MS = 1000;   // ms between station table checks (print changes, look up IPs)
+
 
 void setupWiFi() {
+  PROFILE_SCOPE("setupWiFi");
   // Start configuring the SoftAP
-  Serial.println("Configuring Wi-Fi SoftAP...");
+  LOG_I("Configuring Wi-Fi SoftAP...\n");
+  setupStatusLED();      // LED off until the AP is up
+  setupWiFiEvents();     // station joins & leaves into the bus for subscribers
+  setupStationTable();   // track joins & leaves from here on
 
   if (!WiFi.softAPConfig(IP, IP, subnet)) {   // device IP | gateway IP | subnet mask
-    Serial.println("Failed to configure network! Check your IP configuration.");
+    LOG_E("Failed to configure network! Check your IP configuration.\n");
     return;
   }
 
   // Start the SoftAP with the provided credentials
   if (WiFi.softAP(ssid, password)) {
-    Serial.println("SoftAP configured successfully!");
-    Serial.print("\nNetwork Name: ");
-    Serial.println(ssid);
-    Serial.print("Password: ");
-    Serial.println(password);
-    Serial.print("AP IP Address: ");
-    Serial.println(WiFi.softAPIP());
-
-    digitalWrite(LED_BUILTIN, LOW);     // turn on the LED (active LOW)
+    LOG_I("SoftAP configured successfully!\n");
+    IPAddress apIP = WiFi.softAPIP();
+    LOG_I("\nNetwork Name: %s\n", ssid);
+    LOG_I("Password: %s\n", password);
+    LOG_I("AP IP Address: %u.%u.%u.%u\n", apIP[0], apIP[1], apIP[2], apIP[3]);
+
+    setLEDPattern(LED_ON);              // solid LED
     isActive = true;                    // update the AP status
   } else {
-    Serial.println("Failed to start SoftAP! Check your setup.");
+    LOG_E("Failed to start SoftAP! Check your setup.\n");
   }
 }
 
 
-// Function to handle connected devices printing
-void whosConnected() {
-  const long CHECK_PERIOD = 10000;  // ms for checking connected devices period
-  static long lastCheckMS = 0;      // static to retain value between calls
-  long currentMS = millis();        // get the current time
+// Print the connected devices when one joined or left, checked every CHECK_PERIOD_MS
+void printConnected() {
+  PROFILE_SCOPE("printConnected");
+  static uint32_t printedVersion = 0;  // table version last printed
 
   if (isActive) {
-    if (currentMS - lastCheckMS >= CHECK_PERIOD) {
-      int numStations = WiFi.softAPgetStationNum();  // get the number of connected stations
-      Serial.printf("Number of connected devices = %d\n", numStations);
-
-#ifdef ESP32    // for ESP32 boards
-      wifi_sta_list_t stationList;
-      esp_wifi_ap_get_sta_list(&stationList);  // get the list of connected stations
-      for (int i = 0; i < stationList.num; i++) {
-        wifi_sta_info_t station = stationList.sta[i];
-        Serial.printf("Connected device MAC: %02X:%02X:%02X:%02X:%02X:%02X\n",
-                      station.mac[0], station.mac[1], station.mac[2],
-                      station.mac[3], station.mac[4], station.mac[5]);
-        Serial.println();
-      }
-#endif
+    updateStationTable();   // fill in IPs & RSSI the events do not carry
+    if (stationTableVersion != printedVersion) {
+      printedVersion = stationTableVersion;
+      printStationTable();
+    }
+  }
+}
 
-#ifdef ESP8266  // for ESP8266 boards
-      struct station_info* station = wifi_softap_get_station_info();  // get station info
-      while (station) {
-        Serial.printf("Connected device MAC: %02X:%02X:%02X:%02X:%02X:%02X\n",
-                      station->bssid[0], station->bssid[1], station->bssid[2],
-                      station->bssid[3], station->bssid[4], station->bssid[5]);
-
-        station = STAILQ_NEXT(station, next);  // move to the next connected station
-        Serial.println();
-      }
-      wifi_softap_free_station_info();  // free the station info memory
-#endif
+// Function to handle connected devices printing
+void whosConnected() {
+  static unsigned long lastCheckMS = 0;  // static to retain value between calls
+  unsigned long currentMS = millis();    // get the current time
 
-      lastCheckMS = currentMS;  // update the last checked time
-    }
+  if (currentMS - lastCheckMS >= CHECK_PERIOD_MS) {
+    printConnected();
+    lastCheckMS = currentMS;  // update the last checked time
   }
 }
 
+// Register the connected devices check with the scheduler, call in setup() after setupWiFi()
+void scheduleWiFi() {
+  Scheduler::add("stations", printConnected, CHECK_PERIOD_MS);
+  scheduleWiFiEvents();   // dispatch to the event subscribers
+  scheduleLog();   // drain the log into Serial
+}
+
 #endif
@@ -0,0 +1,94 @@
+"""
+bench.py
+Builds the helper benchmarks (the bench_* envs of the root platformio.ini) & runs each one
+through every network scenario, so time to connect, loop() latency & heap allocations per
+helper show up as numbers - on the PC, with the mock HAL in test/hal.
+
+    python bench.py                           all helpers, all scenarios
+    python bench.py -e bench_sta -s drops     only these (both repeatable)
+    python bench.py --save bench.json         keep the numbers
+    python bench.py --baseline bench.json     print the change since then
+
+Connect & reconnect times are simulated ms (the HAL's scripted Wi-Fi timings), pass times
+are host ns - compare them between runs on the same PC, not with the device.
+"""
+
+import argparse
+import configparser
+import json
+import os
+import subprocess
+import sys
+
+SCENARIOS = ["good", "fast", "flaky", "weak_roam", "drops", "no_internet"]
+COLUMNS = [("connect_ms", "connect"), ("reconnect_ms", "reconn"), ("begins", "begins"),
+           ("pass_p50_ns", "p50 ns"), ("pass_p99_ns", "p99 ns"), ("pass_max_ns", "max ns"),
+           ("setup_allocs", "setup al"), ("allocs_per_min", "al/min"), ("peak_bytes", "peak B")]
+HOST_TIMES = ("pass_p50_ns", "pass_p99_ns", "pass_max_ns")
+ROOT = os.path.dirname(os.path.abspath(__file__))
+
+
+def bench_envs():
+    config = configparser.ConfigParser(interpolation=None, strict=False)
+    config.read(os.path.join(ROOT, "platformio.ini"))
+    return [section[4:] for section in config.sections() if section.startswith("env:bench_")]
+
+
+def build(env):
+    result = subprocess.run(["pio", "run", "-d", ROOT, "-e", env],
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    if result.returncode != 0:
+        sys.stdout.write(result.stdout)
+        sys.exit("Build of %s failed" % env)
+    return os.path.join(ROOT, ".pio", "build", env, "program")
+
+
+def run(program, scenario):
+    """Run one scenario, returns {"connect_ms": ..., ...}."""
+    result = subprocess.run([program, scenario], stdout=subprocess.PIPE, universal_newlines=True)
+    if result.returncode != 0:
+        sys.exit("%s %s failed" % (program, scenario))
+    fields = dict(line.split("=", 1) for line in result.stdout.splitlines() if "=" in line)
+    return {name: int(fields[name]) for name, _ in COLUMNS}
+
+
+def change(value, reference, name):
+    if reference is None or name in HOST_TIMES:
+        return ""
+    return "(%+d)" % (value - reference) if value != reference else ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Host benchmarks of the helpers per network scenario")
+    parser.add_argument("-e", "--env", action="append", help="only these bench envs (default: all)")
+    parser.add_argument("-s", "--scenario", action="append", help="only these scenarios (default: all)")
+    parser.add_argument("--save", help="write the results to this JSON file")
+    parser.add_argument("--baseline", help="JSON file from --save to compare with")
+    args = parser.parse_args()
+
+    envs = args.env or bench_envs()
+    scenarios = args.scenario or SCENARIOS
+    baseline = json.load(open(args.baseline)) if args.baseline else {}
+
+    results = {}
+    for env in envs:
+        print("Building %s..." % env)
+        program = build(env)
+        results[env] = {scenario: run(program, scenario) for scenario in scenarios}
+
+    for env in envs:
+        print("\n%s" % env)
+        print("%-12s" % "scenario" + "".join("%10s" % title for _, title in COLUMNS))
+        for scenario in scenarios:
+            r = results[env][scenario]
+            before = baseline.get(env, {}).get(scenario, {})
+            print("%-12s" % scenario + "".join("%10s" % ("%d %s" % (r[name], change(r[name], before.get(name), name))).strip()
+                                             for name, _ in COLUMNS))
+
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,215 @@
+/****************************************************************************************
+* Helper Benchmark
+* Runs one helper on the native HAL (test/hal) through a scripted network scenario & prints
+* what it cost, one `name=value` per field for bench.py:
+* - connect_ms: simulated ms from setup() to the first IP (or the SoftAP being up),
+* - reconnect_ms: simulated ms from a dropped link to the IP again, averaged (drops only),
+* - pass_p50_ns / pass_p99_ns / pass_max_ns: host time of one loop() pass, the helper's
+*   own code plus the HAL events it waited on,
+* - begins: WiFi.begin() calls (first connect, retries, reconnects & roams),
+* - setup_allocs: heap allocations during setup(),
+* - allocs_per_min: allocations per simulated minute once connected (steady state),
+* - peak_bytes: most heap the sketch held at once.
+*
+* Scenarios (the first argument, `good` if none):
+* - good:        one AP at -60 dBm, answers straight away,
+* - fast:        a boot connects & saves the fast-connect cache, the measured boot reuses it,
+* - flaky:       the first 2 connection attempts fail,
+* - weak_roam:   the AP fades to -84 dBm after 1 minute, a second one at -55 dBm is around,
+* - drops:       the link drops every 90 s,
+* - no_internet: the LAN works, nothing past the gateway answers.
+*
+* Each bench_<helper>.cpp includes its helper, then this file, & defines the bench* hooks.
+* Time is simulated, so a run takes a few host seconds for BENCH_MINUTES of device time.
+****************************************************************************************/
+
+#ifndef bench_h
+#define bench_h
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+#include <chrono>
+
+const unsigned long BENCH_MINUTES = 10;          // simulated minutes each scenario runs
+const unsigned long BENCH_CONNECT_LIMIT_MS = 120000;   // connect_ms is -1 past this
+const char* BENCH_SSID = "YOUR_SSID_NAME";       // the examples' default credentials
+const char* BENCH_PASSWORD = "YOUR_SSID_PW";
+
+// Defined by each bench_<helper>.cpp
+void benchSetup();            // what the example's setup() does
+void benchLoop();             // what the example's loop() does
+bool benchConnected();        // the helper reached its connected state
+void benchFastConnect();      // turn the fast-connect option on
+void benchTraffic();          // requests a browser would send, called every 5 simulated s
+
+namespace bench {
+
+struct Result {
+  long connectMS = -1;
+  long reconnectMS = -1;
+  uint64_t passP50NS = 0;
+  uint64_t passP99NS = 0;
+  uint64_t passMaxNS = 0;
+  uint32_t setupAllocations = 0;
+  uint32_t allocationsPerMinute = 0;
+  int64_t peakBytes = 0;
+  uint32_t passes = 0;
+  uint32_t begins = 0;
+};
+
+// Set up the network for a scenario, returns false if the name is unknown
+inline bool applyScenario(const std::string& scenario) {
+  hal::addAccessPoint(BENCH_SSID, BENCH_PASSWORD, 1, 6, -60);
+  if (scenario == "good" || scenario == "fast") {
+    return true;
+  }
+  if (scenario == "flaky") {
+    hal::wifiTiming.failAttempts = 2;
+    return true;
+  }
+  if (scenario == "weak_roam") {
+    hal::addAccessPoint(BENCH_SSID, BENCH_PASSWORD, 2, 11, -55);
+    hal::accessPoints[1].up = false;   // out of range at first
+    hal::after(60000, []() {
+      hal::accessPoints[0].rssi = -84;
+      hal::accessPoints[1].up = true;
+    });
+    return true;
+  }
+  if (scenario == "drops") {
+    return true;   // run() drops the link
+  }
+  if (scenario == "no_internet") {
+    hal::internetUp = false;
+    return true;
+  }
+  return false;
+}
+
+// One boot that connects & leaves the fast-connect cache in RTC memory for the next
+inline void warmBoot() {
+  hal::runBoot([]() {
+    benchFastConnect();
+    benchSetup();
+    while (!benchConnected() && millis() < BENCH_CONNECT_LIMIT_MS) {
+      benchLoop();
+    }
+    for (unsigned long end = millis() + 5000; millis() < end;) {
+      benchLoop();
+    }
+  });
+}
+
+inline uint64_t percentile(std::vector<uint64_t>& values, int percent) {
+  if (values.empty()) {
+    return 0;
+  }
+  size_t index = (values.size() - 1) * percent / 100;
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+inline void traffic() {
+  benchTraffic();
+  hal::after(5000, traffic);
+}
+
+inline Result run(const std::string& scenario) {
+  Result result;
+  std::vector<uint64_t> passes;
+  {
+    hal::Quiet quiet;
+    passes.reserve(1 << 20);
+  }
+
+  hal::resetHeapStats();
+  uint32_t setupAllocations = hal::heap.allocations;
+  benchSetup();
+  result.setupAllocations = hal::heap.allocations - setupAllocations;
+  hal::after(5000, traffic);
+
+  bool drops = scenario == "drops";
+  unsigned long nextDropMS = 90000;
+  unsigned long droppedAtMS = 0;
+  bool dropped = false;
+  uint64_t reconnectTotalMS = 0;
+  uint32_t reconnects = 0;
+  unsigned long steadyFromMS = 0;
+  uint32_t steadyFromAllocations = 0;
+  unsigned long endMS = BENCH_MINUTES * 60000;
+
+  while (millis() < endMS) {
+    if (drops && millis() >= nextDropMS && WiFi.status() == WL_CONNECTED) {
+      nextDropMS += 90000;
+      hal::dropLink();
+      droppedAtMS = millis();
+      dropped = true;
+    }
+
+    uint64_t before = hal::nowUS;
+    auto start = std::chrono::steady_clock::now();
+    benchLoop();
+    auto took = std::chrono::steady_clock::now() - start;
+    if (hal::nowUS == before) {
+      hal::advance(hal::YIELD_US);   // a pass with nothing to wait for, as loop() spins on the device
+    }
+    {
+      hal::Quiet quiet;
+      passes.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(took).count());
+    }
+
+    if (result.connectMS < 0 && benchConnected()) {
+      result.connectMS = millis();
+      steadyFromMS = millis();
+      steadyFromAllocations = hal::heap.allocations;
+    }
+    if (dropped && benchConnected() && WiFi.status() == WL_CONNECTED) {
+      dropped = false;
+      reconnectTotalMS += millis() - droppedAtMS;
+      reconnects++;
+    }
+    if (result.connectMS < 0 && millis() > BENCH_CONNECT_LIMIT_MS) {
+      break;
+    }
+  }
+
+  result.passes = passes.size();
+  result.passP50NS = percentile(passes, 50);
+  result.passP99NS = percentile(passes, 99);
+  result.passMaxNS = passes.empty() ? 0 : *std::max_element(passes.begin(), passes.end());
+  if (result.connectMS >= 0 && millis() > steadyFromMS) {
+    result.allocationsPerMinute = (uint64_t)(hal::heap.allocations - steadyFromAllocations) * 60000 / (millis() - steadyFromMS);
+  }
+  result.reconnectMS = reconnects ? (long)(reconnectTotalMS / reconnects) : -1;
+  result.peakBytes = hal::heap.peakBytes;
+  result.begins = hal::wifiBegins;
+  return result;
+}
+
+inline int main(int argc, char** argv, const char* helper) {
+  std::string scenario = argc > 1 ? argv[1] : "good";
+  hal::serialEcho = false;
+  if (!applyScenario(scenario)) {
+    fprintf(stderr, "unknown scenario: %s\n", scenario.c_str());
+    return 2;
+  }
+  if (scenario == "fast") {
+    warmBoot();
+    benchFastConnect();
+  }
+
+  Result result = run(scenario);
+  printf("helper=%s\nscenario=%s\n", helper, scenario.c_str());
+  printf("connect_ms=%ld\nreconnect_ms=%ld\n", result.connectMS, result.reconnectMS);
+  printf("pass_p50_ns=%llu\npass_p99_ns=%llu\npass_max_ns=%llu\npasses=%u\n",
+         (unsigned long long)result.passP50NS, (unsigned long long)result.passP99NS,
+         (unsigned long long)result.passMaxNS, result.passes);
+  printf("setup_allocs=%u\nallocs_per_min=%u\npeak_bytes=%lld\nbegins=%u\n",
+         result.setupAllocations, result.allocationsPerMinute, (long long)result.peakBytes, result.begins);
+  return 0;
+}
+
+}  // namespace bench
+
+#endif
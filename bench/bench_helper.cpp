@@ -0,0 +1,40 @@
+/****************************************************************************************
+* Benchmark of ESPWiFiHelper.h (STA + SoftAP) with ElegantOTAHelper.h, set up like
+* examples/ElegantOTA_AysncWeb_Helper. A browser polls / & /metrics while it runs.
+* `pio run -e bench_helper`, then `.pio/build/bench_helper/program <scenario>` (or bench.py).
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ElegantOTAHelper.h"
+#include "ESPWiFiHelper.h"
+#include "bench.h"
+
+void benchSetup() {
+  Serial.begin(115200);
+  setupWiFi();
+  setupOTA();
+  scheduleWiFi();
+  scheduleOTA();
+}
+
+void benchLoop() {
+  Scheduler::run();
+}
+
+bool benchConnected() {
+  return WiFi.status() == WL_CONNECTED;
+}
+
+void benchFastConnect() {
+  wifiConfig.useFastConnect = true;
+}
+
+void benchTraffic() {
+  static bool metrics = false;
+  metrics = !metrics;
+  hal::get(server, metrics ? "/metrics" : "/");
+}
+
+int main(int argc, char** argv) {
+  return bench::main(argc, argv, "ESPWiFiHelper.h + ElegantOTAHelper.h");
+}
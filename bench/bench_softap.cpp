@@ -0,0 +1,41 @@
+/****************************************************************************************
+* Benchmark of ESPWiFiSoftAPHelper.h, set up like examples/WiFi_SoftAP_Mode_Helper.
+* Stations join & leave the AP while it runs (up to 4 at once). The STA scenarios only
+* change the network around it, connect_ms is the time to the AP being up.
+* `pio run -e bench_softap`, then `.pio/build/bench_softap/program <scenario>` (or bench.py).
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPWiFiSoftAPHelper.h"
+#include "bench.h"
+
+void benchSetup() {
+  Serial.begin(115200);
+  setupWiFi();
+  scheduleWiFi();
+}
+
+void benchLoop() {
+  Scheduler::run();
+}
+
+bool benchConnected() {
+  return isActive;
+}
+
+void benchFastConnect() {}   // the AP has nothing to reconnect to
+
+void benchTraffic() {
+  static uint8_t next = 0;
+  uint8_t mac[6] = { 0x0A, 0x00, 0x00, 0x00, 0x00, next };
+  if (hal::stations.size() >= 4) {
+    hal::leaveStation(hal::stations.front().mac);
+  }
+  hal::joinStation(mac, next % 8 + 1, IPAddress(192, 168, 10, 100 + next % 50));
+  hal::probeRequest(mac, -40 - next % 40);
+  next++;
+}
+
+int main(int argc, char** argv) {
+  return bench::main(argc, argv, "ESPWiFiSoftAPHelper.h");
+}
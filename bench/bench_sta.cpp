@@ -0,0 +1,32 @@
+/****************************************************************************************
+* Benchmark of ESPWiFiSTAHelper.h, set up like examples/WiFi_STA_Mode_Helper.
+* `pio run -e bench_sta`, then `.pio/build/bench_sta/program <scenario>` (or bench.py).
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPWiFiSTAHelper.h"
+#include "bench.h"
+
+void benchSetup() {
+  Serial.begin(115200);
+  setupWiFi();
+  scheduleWiFi();
+}
+
+void benchLoop() {
+  Scheduler::run();
+}
+
+bool benchConnected() {
+  return WiFi.status() == WL_CONNECTED;
+}
+
+void benchFastConnect() {
+  USE_FAST_CONNECT = true;
+}
+
+void benchTraffic() {}   // no server in this helper
+
+int main(int argc, char** argv) {
+  return bench::main(argc, argv, "ESPWiFiSTAHelper.h");
+}
@@ -0,0 +1,74 @@
+# PlatformIO pre-script for ESPStaticAssets.h
+#
+# When the filesystem image is built (buildfs / uploadfs), copies data/ to a staging folder:
+# - text files are stored gzipped (path.gz) when that makes them smaller,
+# - every file gets a strong ETag (first 16 hex digits of the SHA-256 of its content),
+# - the list of files goes in /assets.manifest: "<path> <etag> <g|p|gp>" per line,
+#   g = path.gz in the image, p = plain path in the image.
+# The image is then built from the staging folder instead of data/.
+#
+# platformio.ini:
+#   extra_scripts = pre:gzip_assets.py
+#   board_build.filesystem = littlefs
+
+Import("env")
+
+import gzip
+import hashlib
+import os
+import shutil
+
+SOURCE_DIR = os.path.join(env.subst("$PROJECT_DIR"), "data")
+STAGING_DIR = os.path.join(env.subst("$BUILD_DIR"), "data_assets")
+MANIFEST_NAME = "assets.manifest"
+GZIP_EXTENSIONS = (".html", ".htm", ".css", ".js", ".json", ".svg", ".txt", ".xml", ".ico")
+# Also store the plain copy of gzipped files. Off: a file with only the .gz copy is sent
+# gzipped (Content-Encoding: gzip) to every client, which all browsers take. On: clients
+# that do not send Accept-Encoding: gzip get the plain copy, which takes its own flash.
+KEEP_PLAIN = False
+
+
+def stage_assets():
+    if not os.path.isdir(SOURCE_DIR):
+        print("gzip_assets: no data/ folder, nothing to do")
+        return
+
+    shutil.rmtree(STAGING_DIR, ignore_errors=True)
+    lines = []
+
+    for root, dirs, files in os.walk(SOURCE_DIR):
+        dirs.sort()
+        for name in sorted(files):
+            source = os.path.join(root, name)
+            path = os.path.relpath(source, SOURCE_DIR).replace(os.sep, "/")
+            target = os.path.join(STAGING_DIR, path)
+            os.makedirs(os.path.dirname(target), exist_ok=True)
+
+            with open(source, "rb") as f:
+                data = f.read()
+            etag = hashlib.sha256(data).hexdigest()[:16]
+            flags = ""
+
+            if name.lower().endswith(GZIP_EXTENSIONS):
+                packed = gzip.compress(data, compresslevel=9, mtime=0)
+                if len(packed) < len(data):
+                    with open(target + ".gz", "wb") as f:
+                        f.write(packed)
+                    flags += "g"
+                    print("gzip_assets: /%s %d -> %d bytes" % (path, len(data), len(packed)))
+
+            if not flags or KEEP_PLAIN:
+                shutil.copyfile(source, target)
+                flags += "p"
+
+            lines.append("/%s %s %s\n" % (path, etag, flags))
+
+    with open(os.path.join(STAGING_DIR, MANIFEST_NAME), "w", newline="\n") as f:
+        f.writelines(lines)
+
+    env.Replace(PROJECT_DATA_DIR=STAGING_DIR)
+    print("gzip_assets: %d files staged in %s" % (len(lines), STAGING_DIR))
+
+
+if {"buildfs", "uploadfs", "uploadfsota"} & set(COMMAND_LINE_TARGETS):
+    stage_assets()
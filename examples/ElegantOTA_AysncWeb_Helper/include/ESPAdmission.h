@@ -0,0 +1,231 @@
+/****************************************************************************************
+* ESP Admission
+* This helper file guards the AsyncWebServer against more clients than the heap can hold.
+* A handler checked before all the others turns requests away with a short answer from
+* flash when:
+* 1. Free heap is below ADMIT_MIN_FREE_HEAP (503), checked first & for every route,
+* 2. An upload is running (OTA priority): everything but the OTA routes (/update, /ota/...)
+*    gets a 503 until it ends, or until no data came for ADMIT_OTA_IDLE_MS,
+* 3. ADMIT_MAX_REQUESTS requests are already in flight (503),
+* 4. The client IP used up its token bucket: ADMIT_BURST requests, then one per
+*    ADMIT_REFILL_MS (429). The buckets are a fixed table of ADMIT_RATE_TABLE IPs, the one
+*    idle longest makes room for a new IP.
+*
+* OTA routes skip 3 & 4, so a deploy gets through a busy server. The status WebSocket is
+* not counted as in flight either, ESPStatusPush.h limits its own clients.
+* A request is in flight from admission until its connection closes. A slot not released
+* after ADMIT_STALE_MS is taken over, so a lost disconnect cannot lock the server.
+*
+* The decisions (admitReason(), admitRequest(), releaseRequest()) only use the values
+* passed in, AdmissionGuard connects them to the server. The reason a request was turned
+* away is kept from canHandle() to the answer (ADMIT_PENDING requests at a time), so a
+* POST whose body arrives after things changed still gets the status of that reason.
+* Rejections are counted on /metrics (http_rejected_total).
+*
+* ElegantOTAHelper.h calls setupAdmission(server) first thing in setupOTA(), the OTA
+* helpers call setOTAPriority() when an upload starts, progresses & ends.
+****************************************************************************************/
+
+#ifndef ESPAdmission_h
+#define ESPAdmission_h
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "ESPMetrics.h"      // rejection counters
+#include "ESPStatusPush.h"   // STATUS_PUSH_PATH, not counted as in flight
+
+#define ADMIT_MAX_REQUESTS 3    // requests in flight at once (OTA routes not counted)
+#define ADMIT_RATE_TABLE   8    // client IPs with a token bucket
+#define ADMIT_BURST        8    // requests an IP can make at once
+#define ADMIT_PENDING      4    // turned away requests waiting for their answer (a body still arriving)
+
+#ifdef ESP32
+const uint32_t ADMIT_MIN_FREE_HEAP = 40000;   // bytes, new requests are turned away below this
+#elif defined(ESP8266)
+const uint32_t ADMIT_MIN_FREE_HEAP = 12000;
+#endif
+const unsigned long ADMIT_REFILL_MS = 500;     // ms per token, 2 requests/s per IP after the burst
+const unsigned long ADMIT_STALE_MS = 15000;    // ms before an unreleased slot is reused
+const unsigned long ADMIT_OTA_IDLE_MS = 10000; // ms without upload data before OTA priority ends
+
+// Outcome of the checks, in the order they are made
+enum AdmitResult {
+  ADMIT_OK,
+  ADMIT_LOW_HEAP,        // 503
+  ADMIT_OTA_BUSY,        // 503, an upload is running
+  ADMIT_BUSY,            // 503, ADMIT_MAX_REQUESTS in flight
+  ADMIT_RATE_LIMITED,    // 429
+  ADMIT_RESULT_COUNT
+};
+
+// A turned away request & why, from canHandle() to handleRequest()
+struct PendingRejection {
+  AsyncWebServerRequest* request;   // nullptr = free
+  AdmitResult reason;
+};
+
+// Token bucket of one client IP
+struct RateBucket {
+  uint32_t ip;              // 0 = free
+  uint8_t tokens;
+  unsigned long refillMS;   // time the last token was added (or the bucket was full)
+};
+
+const char ADMIT_BUSY_TEXT[] PROGMEM = "503 - Busy, try again shortly";
+const char ADMIT_RATE_TEXT[] PROGMEM = "429 - Too many requests";
+
+unsigned long admitSlotMS[ADMIT_MAX_REQUESTS];   // start of each in-flight request
+bool admitSlotUsed[ADMIT_MAX_REQUESTS];
+uint32_t admitSlotTicket[ADMIT_MAX_REQUESTS];    // bumped each time the slot is taken
+RateBucket rateBuckets[ADMIT_RATE_TABLE];
+bool otaPriority = false;                        // upload running
+unsigned long otaPriorityMS = 0;                 // last upload start or data
+uint32_t admitCounts[ADMIT_RESULT_COUNT];        // requests per outcome
+
+
+// Upload started / got data (true) or ended (false)
+void setOTAPriority(bool active) {
+  otaPriority = active;
+  otaPriorityMS = millis();
+}
+
+bool isOTARoute(const char* url) {
+  return strncmp(url, "/ota/", 5) == 0 || strcmp(url, "/update") == 0;
+}
+
+// Bucket of `ip` with its tokens refilled to `currentMS`, or the bucket idle longest, reset for `ip`
+RateBucket& rateBucket(uint32_t ip, unsigned long currentMS) {
+  RateBucket* bucket = &rateBuckets[0];
+  for (int i = 0; i < ADMIT_RATE_TABLE; i++) {
+    if (rateBuckets[i].ip == ip) {
+      bucket = &rateBuckets[i];
+      break;
+    }
+    if (rateBuckets[i].ip == 0 || currentMS - rateBuckets[i].refillMS > currentMS - bucket->refillMS) {
+      bucket = &rateBuckets[i];   // free, or idle longer
+    }
+  }
+  if (bucket->ip != ip) {
+    *bucket = { ip, ADMIT_BURST, currentMS };
+  }
+
+  unsigned long refills = (currentMS - bucket->refillMS) / ADMIT_REFILL_MS;
+  if (bucket->tokens + refills >= ADMIT_BURST) {
+    bucket->tokens = ADMIT_BURST;
+    bucket->refillMS = currentMS;
+  } else {
+    bucket->tokens += refills;
+    bucket->refillMS += refills * ADMIT_REFILL_MS;
+  }
+  return *bucket;
+}
+
+// Free in-flight slot, -1 if none. A slot older than ADMIT_STALE_MS counts as free.
+int freeAdmitSlot(unsigned long currentMS) {
+  for (int i = 0; i < ADMIT_MAX_REQUESTS; i++) {
+    if (!admitSlotUsed[i] || currentMS - admitSlotMS[i] >= ADMIT_STALE_MS) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Would a request for `url` from `ip` be admitted? No side effects.
+AdmitResult admitReason(const char* url, uint32_t ip, unsigned long currentMS, uint32_t freeHeap) {
+  if (freeHeap < ADMIT_MIN_FREE_HEAP) {
+    return ADMIT_LOW_HEAP;
+  }
+  if (isOTARoute(url) || strcmp(url, STATUS_PUSH_PATH) == 0) {
+    return ADMIT_OK;
+  }
+  if (otaPriority && currentMS - otaPriorityMS < ADMIT_OTA_IDLE_MS) {
+    return ADMIT_OTA_BUSY;
+  }
+  if (freeAdmitSlot(currentMS) < 0) {
+    return ADMIT_BUSY;
+  }
+  for (int i = 0; i < ADMIT_RATE_TABLE; i++) {
+    if (rateBuckets[i].ip == ip) {
+      bool refilled = currentMS - rateBuckets[i].refillMS >= ADMIT_REFILL_MS;
+      return rateBuckets[i].tokens > 0 || refilled ? ADMIT_OK : ADMIT_RATE_LIMITED;
+    }
+  }
+  return ADMIT_OK;   // new IP, full bucket
+}
+
+// Admit or reject a request: takes a token & an in-flight slot if admitted. `slot` & `ticket` are set
+// for releaseRequest() when the request ends, `slot` is -1 if it has none (OTA & status routes).
+AdmitResult admitRequest(const char* url, uint32_t ip, unsigned long currentMS, uint32_t freeHeap, int& slot, uint32_t& ticket) {
+  slot = -1;
+  AdmitResult result = admitReason(url, ip, currentMS, freeHeap);
+  if (result == ADMIT_OK && !isOTARoute(url) && strcmp(url, STATUS_PUSH_PATH) != 0) {
+    RateBucket& bucket = rateBucket(ip, currentMS);
+    bucket.tokens--;   // admitReason() made sure there is one
+    slot = freeAdmitSlot(currentMS);
+    admitSlotUsed[slot] = true;
+    admitSlotMS[slot] = currentMS;
+    ticket = ++admitSlotTicket[slot];
+  }
+  admitCounts[result]++;
+  return result;
+}
+
+// The request holding `slot` ended, ignored if the slot went stale & was taken over since
+void releaseRequest(int slot, uint32_t ticket) {
+  if (slot >= 0 && slot < ADMIT_MAX_REQUESTS && admitSlotTicket[slot] == ticket) {
+    admitSlotUsed[slot] = false;
+  }
+}
+
+
+// First handler of the server: claims the requests to turn away & answers them
+class AdmissionGuard : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest *request) override {
+    int slot;
+    uint32_t ticket;
+    AdmitResult result = admitRequest(request->url().c_str(), request->client()->remoteIP(), millis(), ESP.getFreeHeap(), slot, ticket);
+    if (result != ADMIT_OK) {
+      _pending[_nextPending] = { request, result };   // the oldest is overwritten in a flood
+      _nextPending = (_nextPending + 1) % ADMIT_PENDING;
+      return true;
+    }
+    if (slot >= 0) {
+      request->onDisconnect([slot, ticket]() { releaseRequest(slot, ticket); });
+    }
+    return false;   // admitted, the next handlers serve it
+  }
+
+  void handleRequest(AsyncWebServerRequest *request) override {
+    AdmitResult reason = ADMIT_BUSY;   // overwritten in a flood: 503, the client retries later either way
+    for (PendingRejection& pending : _pending) {
+      if (pending.request == request) {
+        reason = pending.reason;
+        pending.request = nullptr;
+        break;
+      }
+    }
+    if (reason == ADMIT_RATE_LIMITED) {
+      request->send_P(429, "text/plain", ADMIT_RATE_TEXT);
+    } else {
+      request->send_P(503, "text/plain", ADMIT_BUSY_TEXT);   // low heap, upload running or busy
+    }
+  }
+
+private:
+  PendingRejection _pending[ADMIT_PENDING] = {};
+  uint8_t _nextPending = 0;
+};
+
+AdmissionGuard admissionGuard;
+
+// Add the guard, call before any other handler is added (ElegantOTAHelper.h does)
+void setupAdmission(AsyncWebServer& webServer) {
+  webServer.addHandler(&admissionGuard);
+  registerCounter("http_rejected_total", "Requests turned away", "reason=\"heap\"", &admitCounts[ADMIT_LOW_HEAP]);
+  registerCounter("http_rejected_total", "Requests turned away", "reason=\"ota\"", &admitCounts[ADMIT_OTA_BUSY]);
+  registerCounter("http_rejected_total", "Requests turned away", "reason=\"busy\"", &admitCounts[ADMIT_BUSY]);
+  registerCounter("http_rejected_total", "Requests turned away", "reason=\"rate\"", &admitCounts[ADMIT_RATE_LIMITED]);
+}
+
+#endif
@@ -0,0 +1,268 @@
+/****************************************************************************************
+* ESP Log
+* This helper file replaces blocking Serial.print calls in the helpers with a buffered log:
+* 1. LOG_E() / LOG_W() / LOG_I() / LOG_D() take printf arguments, format into a small stack
+*    buffer & copy the text into a fixed ring buffer (LOG_BUFFER_SIZE) - the caller never
+*    waits for the UART,
+* 2. Levels: calls above HELPER_LOG_LEVEL are compiled out (format strings included), and
+*    `logLevel` lowers the level further at runtime,
+* 3. handleLog() drains the ring into Serial, only as much as the UART FIFO takes without
+*    blocking, and hands the same bytes to the extra sinks (addLogSink(): a telnet client,
+*    the web push channel, logFileSink() for LittleFS...). Sinks must not block either,
+* 4. A full ring drops whole messages & counts them (logDropped). The drain reports the
+*    count in sequence: after the text that was queued before the first drop, before the
+*    text queued after it.
+*
+* Writers: loop() code, the Wi-Fi event callbacks (ESP32 event task) & ISRs. The copy into
+* the ring is a short critical section, the drain reads without locking (one consumer).
+* ISRs must use logFromISR() with a fixed text, formatting is not ISR safe.
+*
+* To use this helper:
+* - The helpers include it & scheduleWiFi() registers the drain (scheduleLog()),
+* - Without the scheduler, call handleLog() in main loop(),
+* - Call flushLog() before a restart or deep sleep so nothing queued is lost.
+****************************************************************************************/
+
+#ifndef ESPLog_h
+#define ESPLog_h
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <LittleFS.h>
+
+namespace Scheduler {   // ESPScheduler.h, included at the end as it logs with LOG_W() itself
+typedef void (*TaskCallback)();
+int add(const char* name, TaskCallback callback, unsigned long periodMS);
+}
+
+// Levels
+#define HELPER_LOG_NONE  0
+#define HELPER_LOG_ERROR 1
+#define HELPER_LOG_WARN  2
+#define HELPER_LOG_INFO  3
+#define HELPER_LOG_DEBUG 4
+
+#ifndef HELPER_LOG_LEVEL
+#define HELPER_LOG_LEVEL HELPER_LOG_INFO   // highest level compiled in, set with -D in build_flags
+#endif
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE  2048   // bytes, a power of 2
+#endif
+#define LOG_LINE_MAX     160    // longest message, longer ones are cut short
+#define LOG_MAX_SINKS    3      // extra sinks next to Serial
+
+#define LOG_PRINTF(level, ...) do { if (HELPER_LOG_LEVEL >= (level) && logLevel >= (level)) logPrintf(__VA_ARGS__); } while (0)
+#define LOG_E(...) LOG_PRINTF(HELPER_LOG_ERROR, __VA_ARGS__)
+#define LOG_W(...) LOG_PRINTF(HELPER_LOG_WARN, __VA_ARGS__)
+#define LOG_I(...) LOG_PRINTF(HELPER_LOG_INFO, __VA_ARGS__)
+#define LOG_D(...) LOG_PRINTF(HELPER_LOG_DEBUG, __VA_ARGS__)
+
+const unsigned long LOG_TASK_PERIOD_MS = 20;   // ms between drains when scheduled (a 115200 baud FIFO empties in ~11 ms)
+const char* LOG_FILE_PATH = "/log.txt";        // logFileSink() file, moved to /log.old when full
+const size_t LOG_FILE_MAX_SIZE = 16384;
+
+typedef void (*LogSink)(const char* data, size_t length);
+
+uint8_t logLevel = HELPER_LOG_LEVEL;   // runtime level, up to HELPER_LOG_LEVEL
+bool logToSerial = true;               // drain into Serial
+
+char logBuffer[LOG_BUFFER_SIZE];
+volatile uint32_t logHead = 0;         // free-running write index, only moved by writers
+volatile uint32_t logTail = 0;         // free-running read index, only moved by handleLog()
+volatile uint32_t logDropped = 0;      // messages dropped because the ring was full
+uint32_t logDroppedReported = 0;       // logDropped at the last drop report
+volatile bool logDropPending = false;  // drops not reported yet
+uint32_t logDropHead = 0;              // logHead at the first of them, the report goes there
+uint32_t logHighWater = 0;             // most bytes queued at once
+
+LogSink logSinks[LOG_MAX_SINKS];
+int logSinkCount = 0;
+
+#ifdef ESP32
+portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+#define LOG_LOCK()   portENTER_CRITICAL_SAFE(&logMux)    // task & ISR safe
+#define LOG_UNLOCK() portEXIT_CRITICAL_SAFE(&logMux)
+#elif defined(ESP8266)
+#define LOG_LOCK()   uint32_t logSavedPS = xt_rsil(15)    // interrupts off for the copy
+#define LOG_UNLOCK() xt_wsr_ps(logSavedPS)
+#endif
+
+
+// Append `length` bytes as one message, or drop it whole if it does not fit. Returns false if dropped.
+bool IRAM_ATTR logWrite(const char* text, size_t length) {
+  bool written = false;
+  LOG_LOCK();
+  uint32_t used = logHead - __atomic_load_n(&logTail, __ATOMIC_ACQUIRE);   // drained bytes are free again
+  if (length <= LOG_BUFFER_SIZE - used) {
+    uint32_t offset = logHead & (LOG_BUFFER_SIZE - 1);
+    size_t first = length < LOG_BUFFER_SIZE - offset ? length : LOG_BUFFER_SIZE - offset;
+    memcpy(logBuffer + offset, text, first);
+    memcpy(logBuffer, text + first, length - first);
+    __atomic_store_n(&logHead, logHead + length, __ATOMIC_RELEASE);   // text before the index
+    used += length;
+    if (used > logHighWater) {
+      logHighWater = used;
+    }
+    written = true;
+  } else {
+    if (!logDropPending) {
+      logDropHead = logHead;   // the text before it was queued before the drop
+      __atomic_store_n(&logDropPending, true, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&logDropped, logDropped + 1, __ATOMIC_RELAXED);
+  }
+  LOG_UNLOCK();
+  return written;
+}
+
+// Log a fixed text from an ISR (no formatting)
+void IRAM_ATTR logFromISR(const char* text) {
+  logWrite(text, strlen(text));
+}
+
+// Format & queue a message, use the LOG_* macros so the level check happens first
+void logPrintf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+void logPrintf(const char* format, ...) {
+  char line[LOG_LINE_MAX];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (length > 0) {
+    logWrite(line, (size_t)length < sizeof(line) ? length : sizeof(line) - 1);
+  }
+}
+
+// Add a sink that gets every drained chunk (not split on line ends), returns false if all slots are used
+bool addLogSink(LogSink sink) {
+  for (int i = 0; i < logSinkCount; i++) {
+    if (logSinks[i] == sink) {
+      return true;
+    }
+  }
+  if (logSinkCount >= LOG_MAX_SINKS) {
+    return false;
+  }
+  logSinks[logSinkCount++] = sink;
+  return true;
+}
+
+void removeLogSink(LogSink sink) {
+  for (int i = 0; i < logSinkCount; i++) {
+    if (logSinks[i] == sink) {
+      logSinks[i] = logSinks[--logSinkCount];
+      return;
+    }
+  }
+}
+
+// Hand a chunk to Serial & the sinks
+void writeLogChunk(const char* data, size_t length) {
+  if (logToSerial) {
+    Serial.write((const uint8_t*)data, length);
+  }
+  for (int i = 0; i < logSinkCount; i++) {
+    logSinks[i](data, length);
+  }
+}
+
+// Write the drop report once the UART has room for the line. Returns false if it has not.
+bool reportLogDrops() {
+  if (logToSerial && Serial.availableForWrite() < 48) {
+    return false;
+  }
+  uint32_t dropped;
+  {
+    LOG_LOCK();
+    dropped = logDropped;      // drops from now on start a new report
+    logDropPending = false;
+    LOG_UNLOCK();
+  }
+  char line[48];
+  int length = snprintf(line, sizeof(line), "[log] %lu messages dropped\n", (unsigned long)(dropped - logDroppedReported));
+  writeLogChunk(line, length);
+  logDroppedReported = dropped;
+  return true;
+}
+
+// Move queued text to Serial & the sinks without blocking, call often (scheduleLog() does)
+void handleLog() {
+  uint32_t tail = logTail;
+  while (true) {
+    bool dropPending = __atomic_load_n(&logDropPending, __ATOMIC_ACQUIRE);
+    uint32_t head = dropPending ? logDropHead : __atomic_load_n(&logHead, __ATOMIC_ACQUIRE);   // up to the drop first
+    if (tail == head) {
+      if (dropPending && reportLogDrops()) {
+        continue;   // then the text queued after it
+      }
+      break;
+    }
+    size_t room = logToSerial ? Serial.availableForWrite() : LOG_BUFFER_SIZE;
+    if (room == 0) {
+      break;   // FIFO full, the rest goes next time
+    }
+    uint32_t offset = tail & (LOG_BUFFER_SIZE - 1);
+    size_t length = head - tail;
+    if (length > LOG_BUFFER_SIZE - offset) length = LOG_BUFFER_SIZE - offset;   // up to the end of the ring
+    if (length > room) length = room;
+
+    writeLogChunk(logBuffer + offset, length);
+    tail += length;
+    __atomic_store_n(&logTail, tail, __ATOMIC_RELEASE);   // the writers may reuse the space now
+  }
+}
+
+// Drain everything, waiting for the UART, call before a restart or deep sleep
+void flushLog() {
+  while (logTail != logHead || logDropped != logDroppedReported) {
+    handleLog();
+    yield();
+  }
+  Serial.flush();
+}
+
+// Register handleLog() with the scheduler, the Wi-Fi helpers' scheduleWiFi() calls this
+void scheduleLog() {
+  Scheduler::add("log", handleLog, LOG_TASK_PERIOD_MS);
+}
+
+
+// Mount LittleFS without the format the cores do when a mount fails (the ESP8266 default):
+// a damaged file system is left for a filesystem upload to replace, its files are not wiped.
+// Returns false if it could not be mounted, the helpers then fall back to their defaults.
+bool mountLittleFS() {
+#ifdef ESP32
+  return LittleFS.begin(false);   // formatOnFail
+#elif defined(ESP8266)
+  LittleFSConfig config;
+  config.setAutoFormat(false);
+  LittleFS.setConfig(config);
+  return LittleFS.begin();
+#endif
+}
+
+// Sink that appends the log to LOG_FILE_PATH in LittleFS, moved to /log.old at LOG_FILE_MAX_SIZE.
+// Flash writes can take a few ms, but only the drain waits for them. Mount LittleFS with
+// mountLittleFS() first, then add with addLogSink(logFileSink).
+void logFileSink(const char* data, size_t length) {
+  File file = LittleFS.open(LOG_FILE_PATH, "a");
+  if (!file) {
+    return;
+  }
+  size_t size = file.size();
+  if (size + length > LOG_FILE_MAX_SIZE) {
+    file.close();
+    LittleFS.remove("/log.old");
+    LittleFS.rename(LOG_FILE_PATH, "/log.old");
+    file = LittleFS.open(LOG_FILE_PATH, "a");
+    if (!file) {
+      return;
+    }
+  }
+  file.write((const uint8_t*)data, length);
+  file.close();
+}
+
+#include "ESPScheduler.h"   // Scheduler::add() for scheduleLog()
+
+#endif
@@ -0,0 +1,97 @@
+/****************************************************************************************
+* ESP Page Template
+* This helper file renders small pages kept in flash (PROGMEM) with %NAME% fields filled
+* in, without building a String:
+* 1. The template is read straight from flash, byte by byte,
+* 2. Each field value is written by your callback into a small fixed buffer on the stack,
+* 3. Output goes straight into the buffer AsyncWebServer hands to a chunked response
+*    filler, so a page of any size is served without a heap copy,
+* 4. A TemplateCursor in the filler keeps where the last piece stopped, so each piece goes
+*    on from there instead of rendering the page again from the start.
+*
+* To use this helper:
+* - Put the page in flash: const char MY_PAGE[] PROGMEM = "Up %UPTIME% s";
+* - Write a field callback that fills `out` for the names it knows & returns true,
+* - Serve it with sendTemplate(request, "text/html", MY_PAGE, myFields).
+*
+* Unknown %NAME%s & a lone % are sent as they are. Each field is read once, when the page
+* gets to it, & a value cut off at the end of a piece is finished from the cursor's copy:
+* a value that changes while the response is sent cannot shift or mangle the page.
+****************************************************************************************/
+
+#ifndef ESPPageTemplate_h
+#define ESPPageTemplate_h
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#define TEMPLATE_MAX_NAME  16   // longest %NAME%
+#define TEMPLATE_MAX_VALUE 32   // longest field value, including the terminator
+
+typedef bool (*TemplateFields)(const char* name, char* out, size_t outSize);
+
+// Where a render stopped, the next piece goes on from here
+struct TemplateCursor {
+  size_t page = 0;                  // next template byte
+  char value[TEMPLATE_MAX_VALUE];   // field being sent, as it was when the render got to it
+  uint8_t valueLength = 0;
+  uint8_t valueSent = 0;            // bytes of `value` already written
+};
+
+
+// Render `page` (in flash) with its fields filled in, on from where `cursor` stopped.
+// Writes at most `maxLen` bytes to `out`. Returns bytes written, 0 once it is all sent.
+size_t renderTemplate(PGM_P page, TemplateFields fields, TemplateCursor& cursor, uint8_t* out, size_t maxLen) {
+  char name[TEMPLATE_MAX_NAME + 1];   // field name being looked up
+  size_t written = 0;                 // bytes written to `out`
+
+  while (written < maxLen) {
+    // The rest of a field value the last piece ended in
+    if (cursor.valueSent < cursor.valueLength) {
+      size_t n = min(maxLen - written, (size_t)(cursor.valueLength - cursor.valueSent));
+      memcpy(out + written, cursor.value + cursor.valueSent, n);
+      written += n;
+      cursor.valueSent += n;
+      continue;
+    }
+
+    char c = pgm_read_byte(page + cursor.page);
+    if (c == '\0') {
+      break;
+    }
+    cursor.page++;
+
+    if (c == '%') {
+      size_t n = 0;
+      char next = pgm_read_byte(page + cursor.page);
+      while (n < TEMPLATE_MAX_NAME && next != '\0' && next != '%') {
+        name[n++] = next;
+        next = pgm_read_byte(page + cursor.page + n);
+      }
+      name[n] = '\0';
+
+      cursor.value[0] = '\0';
+      if (next == '%' && n > 0 && fields(name, cursor.value, sizeof(cursor.value))) {
+        cursor.value[sizeof(cursor.value) - 1] = '\0';
+        cursor.valueLength = strlen(cursor.value);
+        cursor.valueSent = 0;
+        cursor.page += n + 1;   // skip "NAME%"
+        continue;
+      }
+    }
+    out[written++] = c;   // a literal character
+  }
+  return written;
+}
+
+// Send a flash template as a chunked response, rendered straight into the response buffer.
+// The cursor lives in the filler, on the heap with the response, `index` is where it stopped.
+void sendTemplate(AsyncWebServerRequest* request, const char* contentType, PGM_P page, TemplateFields fields) {
+  AsyncWebServerResponse* response = request->beginChunkedResponse(contentType,
+    [page, fields, cursor = TemplateCursor()](uint8_t* buffer, size_t maxLen, size_t index) mutable -> size_t {
+      return renderTemplate(page, fields, cursor, buffer, maxLen);
+    });
+  request->send(response);
+}
+
+#endif
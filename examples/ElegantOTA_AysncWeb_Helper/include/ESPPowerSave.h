@@ -0,0 +1,125 @@
+/****************************************************************************************
+* ESP Power Save
+* This helper file configures what the chip does while Scheduler::run() waits for the
+* next task deadline (see ESPScheduler.h):
+* 1. IDLE_DELAY       - plain delay(), CPU idles, radio settings left as they are,
+* 2. IDLE_MODEM_SLEEP - radio off between DTIM beacons, CPU idles in delay(),
+* 3. IDLE_LIGHT_SLEEP - radio off & CPU paused between DTIM beacons during delay()
+*                       (ESP8266 auto light sleep, ESP32 needs power management enabled
+*                       in its SDK config, otherwise it uses modem sleep).
+*
+* The AP buffers frames for us while asleep, so incoming TCP (AsyncWebServer, OTA) still
+* wakes the node - with up to `listenInterval` beacons (~100 ms each) of extra latency.
+* Sleep only applies in STA mode, a SoftAP must stay awake for its clients: with the
+* SoftAP up (WIFI_AP_STA) applyPowerSave() logs a warning & leaves the radio awake. In
+* ESPWiFiHelper.h's WIFI_MODE_AP_STA that is only while the setup AP runs, the STA is
+* connected in WIFI_STA first & stopProvisioningAP() applies the setting again.
+*
+* The ESP32 keeps the listen interval in the STA config, which WiFi.begin() writes afresh
+* (listen_interval 0 = the IDF default of 3) with no parameter for it. beginWiFiSTA() calls
+* WiFi.begin() without connecting, puts the interval back & then associates, so use it in
+* place of WiFi.begin().
+*
+* This file is used by ESPWiFiSTAHelper.h & ESPWiFiHelper.h: set `idleMode` &
+* `listenInterval` below, setupWiFi() applies them before connecting.
+****************************************************************************************/
+
+#ifndef ESPPowerSave_h
+#define ESPPowerSave_h
+
+#ifdef ESP32    // for ESP32 boards
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_pm.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <ESP8266WiFi.h>
+#endif
+
+#include "ESPLog.h"   // skipped & applied messages
+
+// Idle modes
+enum IdleMode {
+  IDLE_DELAY,
+  IDLE_MODEM_SLEEP,
+  IDLE_LIGHT_SLEEP
+};
+
+IdleMode idleMode = IDLE_DELAY;       // IDLE_DELAY, IDLE_MODEM_SLEEP or IDLE_LIGHT_SLEEP
+uint8_t listenInterval = 3;           // DTIM beacons slept through between wake-ups (1-10)
+
+
+// Sleep is on & the radio is in STA mode only
+bool powerSaveActive() {
+  return idleMode != IDLE_DELAY && WiFi.getMode() == WIFI_STA;
+}
+
+// Put `listenInterval` into the Wi-Fi stack, it takes effect on the next association
+void applyListenInterval() {
+#ifdef ESP32    // for ESP32 boards
+  wifi_config_t config;
+  esp_wifi_get_config(WIFI_IF_STA, &config);
+  config.sta.listen_interval = listenInterval;
+  esp_wifi_set_config(WIFI_IF_STA, &config);
+
+#elif defined(ESP8266)    // for ESP8266 boards
+  WiFi.setSleepMode(idleMode == IDLE_LIGHT_SLEEP ? WIFI_LIGHT_SLEEP : WIFI_MODEM_SLEEP, listenInterval);
+#endif
+}
+
+// WiFi.begin() with the listen interval still set when it associates, use in place of WiFi.begin()
+void beginWiFiSTA(const char* ssid, const char* password, int32_t channel = 0, const uint8_t* bssid = nullptr) {
+  if (!powerSaveActive()) {
+    WiFi.begin(ssid, password, channel, bssid);
+    return;
+  }
+  WiFi.begin(ssid, password, channel, bssid, false);   // writes the STA config, does not connect
+  applyListenInterval();
+#ifdef ESP32
+  esp_wifi_connect();
+#elif defined(ESP8266)
+  wifi_station_connect();
+#endif
+}
+
+// Apply the idle mode to the Wi-Fi stack, call before connecting (setupWiFi() does this)
+void applyPowerSave() {
+  if (idleMode == IDLE_DELAY) {
+    return;
+  }
+
+  if (WiFi.getMode() != WIFI_STA) {
+    LOG_W("Power save skipped, only available in STA mode.\n");
+    return;
+  }
+
+#ifdef ESP32    // for ESP32 boards
+  // The listen interval is set again by beginWiFiSTA(), WiFi.begin() rewrites the STA config
+  applyListenInterval();
+  WiFi.setSleep(WIFI_PS_MAX_MODEM);
+
+#if CONFIG_PM_ENABLE
+  if (idleMode == IDLE_LIGHT_SLEEP) {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t pmConfig;
+#else
+    esp_pm_config_esp32_t pmConfig;
+#endif
+    pmConfig.max_freq_mhz = getCpuFrequencyMhz();
+    pmConfig.min_freq_mhz = 40;
+    pmConfig.light_sleep_enable = true;
+    esp_pm_configure(&pmConfig);
+  }
+#endif
+#endif
+
+#ifdef ESP8266  // for ESP8266 boards
+  // Light sleep kicks in automatically during delay() once associated
+  applyListenInterval();
+#endif
+
+  LOG_I("Power save: %s, listen interval %d\n",
+        idleMode == IDLE_LIGHT_SLEEP ? "light sleep" : "modem sleep", listenInterval);
+}
+
+#endif
@@ -0,0 +1,231 @@
+/****************************************************************************************
+* ESP Static Assets
+* This helper file serves the files of the LittleFS image on the AsyncWebServer:
+* 1. Prefers the pre-compressed .gz copy (sent with Content-Encoding: gzip) when the
+*    browser accepts gzip, falls back to the plain file if the image has one. A file with
+*    only the .gz copy (gzip_assets.py's default, KEEP_PLAIN = False) is sent gzipped to
+*    every client - all browsers take it - so no plain copy takes flash. Set KEEP_PLAIN
+*    for clients without gzip (some scripts & IoT clients),
+* 2. Sends a strong ETag worked out at build time (SHA-256 of the file, see gzip_assets.py)
+*    & a Cache-Control header,
+* 3. Answers If-None-Match with 304 from a RAM table, without opening the file.
+*
+* The manifest (/assets.manifest) is read once in setupStaticAssets() into a fixed table
+* of STATIC_ASSET_MAX entries (16 bytes each) & the paths into a STATIC_ASSET_PATH_BYTES
+* pool. A lookup compares the path's hash, then the stored path only on a hash match.
+*
+* To use this helper:
+* - Put your files in the project's data/ folder,
+* - Add gzip_assets.py to the project & `extra_scripts = pre:gzip_assets.py` and
+*   `board_build.filesystem = littlefs` to platformio.ini,
+* - Build & upload the filesystem image ("Upload Filesystem Image" task),
+* - ElegantOTAHelper.h calls setupStaticAssets(server) in setupOTA().
+****************************************************************************************/
+
+#ifndef ESPStaticAssets_h
+#define ESPStaticAssets_h
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <LittleFS.h>
+#include "ESPLog.h"   // mount & manifest messages
+
+#define STATIC_ASSET_MAX 32          // files the table can hold
+#define STATIC_ASSET_PATH_BYTES 512  // paths of all the files, '\0' included
+
+const char* ASSET_MANIFEST_PATH = "/assets.manifest";  // written by gzip_assets.py
+const char* ASSET_CACHE_CONTROL = "no-cache";          // revalidate every time, answered with 304 while the ETag matches
+
+// Representations a file has in the image
+#define ASSET_GZIP  0x01   // path.gz
+#define ASSET_PLAIN 0x02   // path
+
+// One file of the image
+struct StaticAsset {
+  uint32_t pathHash;     // FNV-1a hash of the URL path
+  uint32_t etagHi;       // first 8 bytes of the SHA-256 of the file
+  uint32_t etagLo;
+  uint16_t pathOffset;   // the URL path in staticAssetPaths
+  uint8_t flags;         // ASSET_GZIP and/or ASSET_PLAIN
+};
+
+StaticAsset staticAssets[STATIC_ASSET_MAX];  // loaded from the manifest
+int staticAssetCount = 0;
+char staticAssetPaths[STATIC_ASSET_PATH_BYTES];
+size_t staticAssetPathsUsed = 0;
+
+
+// FNV-1a hash of a path
+uint32_t assetPathHash(const char* path) {
+  uint32_t hash = 2166136261UL;
+  while (*path) {
+    hash = (hash ^ (uint8_t)*path++) * 16777619UL;
+  }
+  return hash;
+}
+
+// Find the table entry for a URL path, nullptr if it is not in the image
+const StaticAsset* findStaticAsset(const char* path) {
+  uint32_t hash = assetPathHash(path);
+  for (int i = 0; i < staticAssetCount; i++) {
+    if (staticAssets[i].pathHash == hash && strcmp(staticAssetPaths + staticAssets[i].pathOffset, path) == 0) {
+      return &staticAssets[i];   // the path too: two paths can share a hash
+    }
+  }
+  return nullptr;
+}
+
+// Content type from the file extension
+const char* assetContentType(const char* path) {
+  const char* ext = strrchr(path, '.');
+  if (!ext) return "application/octet-stream";
+  if (strcmp(ext, ".html") == 0 || strcmp(ext, ".htm") == 0) return "text/html";
+  if (strcmp(ext, ".css") == 0) return "text/css";
+  if (strcmp(ext, ".js") == 0) return "application/javascript";
+  if (strcmp(ext, ".json") == 0) return "application/json";
+  if (strcmp(ext, ".svg") == 0) return "image/svg+xml";
+  if (strcmp(ext, ".png") == 0) return "image/png";
+  if (strcmp(ext, ".jpg") == 0) return "image/jpeg";
+  if (strcmp(ext, ".ico") == 0) return "image/x-icon";
+  if (strcmp(ext, ".txt") == 0) return "text/plain";
+  return "application/octet-stream";
+}
+
+// Parse one manifest line: "<path> <16 hex digit etag> <flags: g and/or p>"
+bool parseAssetLine(char* line, StaticAsset& asset) {
+  char* path = strtok(line, " ");
+  char* etag = strtok(nullptr, " ");
+  char* flags = strtok(nullptr, " \r");
+  if (!path || !etag || !flags || strlen(etag) != 16) {
+    return false;
+  }
+
+  char half[9];
+  memcpy(half, etag, 8);
+  half[8] = '\0';
+  asset.etagHi = strtoul(half, nullptr, 16);
+  asset.etagLo = strtoul(etag + 8, nullptr, 16);
+  asset.pathHash = assetPathHash(path);
+  asset.flags = (strchr(flags, 'g') ? ASSET_GZIP : 0) | (strchr(flags, 'p') ? ASSET_PLAIN : 0);
+  if (asset.flags == 0) {
+    return false;
+  }
+
+  size_t pathSize = strlen(path) + 1;
+  if (staticAssetPathsUsed + pathSize > sizeof(staticAssetPaths)) {
+    LOG_W("%s left out, the asset paths are over STATIC_ASSET_PATH_BYTES\n", path);
+    return false;
+  }
+  memcpy(staticAssetPaths + staticAssetPathsUsed, path, pathSize);
+  asset.pathOffset = staticAssetPathsUsed;
+  staticAssetPathsUsed += pathSize;
+  return true;
+}
+
+// Read the manifest into the table, returns the number of files found
+int loadStaticAssets() {
+  staticAssetCount = 0;
+  staticAssetPathsUsed = 0;
+
+  File manifest = LittleFS.open(ASSET_MANIFEST_PATH, "r");
+  if (!manifest) {
+    return 0;
+  }
+
+  char line[96];
+  size_t length = 0;
+  while (staticAssetCount < STATIC_ASSET_MAX) {
+    int c = manifest.available() ? manifest.read() : -1;
+    if (c >= 0 && c != '\n') {
+      if (length < sizeof(line) - 1) {
+        line[length++] = c;
+      }
+      continue;
+    }
+
+    // End of a line (or of the file, the last line may have no newline)
+    line[length] = '\0';
+    if (length > 0 && parseAssetLine(line, staticAssets[staticAssetCount])) {
+      staticAssetCount++;
+    }
+    length = 0;
+    if (c < 0) {
+      break;
+    }
+  }
+  manifest.close();
+  return staticAssetCount;
+}
+
+// Request handler for the files in the table
+class StaticAssetHandler : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest *request) override {
+    if (request->method() != HTTP_GET || findStaticAsset(request->url().c_str()) == nullptr) {
+      return false;
+    }
+    request->addInterestingHeader("If-None-Match");     // the server keeps only the headers a handler asks for
+    request->addInterestingHeader("Accept-Encoding");
+    return true;
+  }
+
+  void handleRequest(AsyncWebServerRequest *request) override {
+    const char* path = request->url().c_str();
+    const StaticAsset* asset = findStaticAsset(path);
+
+    // Pick the representation the client can take
+    bool acceptsGzip = false;
+    if (request->hasHeader("Accept-Encoding")) {
+      acceptsGzip = strstr(request->getHeader("Accept-Encoding")->value().c_str(), "gzip") != nullptr;
+    }
+    bool gzip = (asset->flags & ASSET_GZIP) && (acceptsGzip || !(asset->flags & ASSET_PLAIN));   // gzip only: gzipped to all
+
+    // Strong ETag per representation
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%08lx%08lx%s\"",
+             (unsigned long)asset->etagHi, (unsigned long)asset->etagLo, gzip ? "-gz" : "");
+
+    // Unchanged: answer from the table, the file is not touched
+    if (request->hasHeader("If-None-Match") &&
+        strstr(request->getHeader("If-None-Match")->value().c_str(), etag) != nullptr) {
+      AsyncWebServerResponse *response = request->beginResponse(304);
+      response->addHeader("ETag", etag);
+      response->addHeader("Cache-Control", ASSET_CACHE_CONTROL);
+      request->send(response);
+      return;
+    }
+
+    char fsPath[64];
+    snprintf(fsPath, sizeof(fsPath), gzip ? "%s.gz" : "%s", path);
+
+    AsyncWebServerResponse *response = request->beginResponse(LittleFS, fsPath, assetContentType(path));
+    if (gzip) {
+      response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", ASSET_CACHE_CONTROL);
+    response->addHeader("Vary", "Accept-Encoding");
+    request->send(response);
+  }
+};
+
+StaticAssetHandler staticAssetHandler;
+
+
+// Mount LittleFS, load the manifest & register the handler
+void setupStaticAssets(AsyncWebServer& webServer) {
+  if (!mountLittleFS()) {
+    LOG_E("LittleFS mount failed! Static files are not served.\n");
+    return;
+  }
+
+  if (loadStaticAssets() == 0) {
+    LOG_W("No asset manifest found, upload the filesystem image built with gzip_assets.py.\n");
+    return;
+  }
+
+  webServer.addHandler(&staticAssetHandler);
+  LOG_I("Serving %d static files from LittleFS\n", staticAssetCount);
+}
+
+#endif
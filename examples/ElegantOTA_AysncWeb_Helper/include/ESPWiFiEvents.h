@@ -0,0 +1,250 @@
+/****************************************************************************************
+* ESP Wi-Fi Events
+* This helper file is an event bus for application code that wants to react to Wi-Fi
+* changes instead of reading the isConnected / hasInternet flags:
+* 1. The platform Wi-Fi callbacks (STA got IP, lost IP, disconnected with the reason code,
+*    SoftAP station joined / left) & the STA helpers (internet up / down) post typed
+*    events into a fixed ring (WIFI_EVENTS_QUEUE), safe from the Wi-Fi event task. A full
+*    ring drops the new event & counts it,
+* 2. handleWiFiEvents() takes everything queued in one go & hands the batch to the
+*    subscribers, in the order it happened, from loop() context,
+* 3. Subscribers live in a fixed table (WIFI_EVENTS_MAX_SUBSCRIBERS), each with a mask of
+*    the event types it wants. A coalescing subscriber gets only the last event of each
+*    channel per batch - the STA link, internet, & each SoftAP station (by MAC) - with
+*    `count` telling how many were folded into it, so a flapping link is one call, not 20.
+*
+* ESP8266 has no "lost IP" event, the DHCP timeout is posted as WIFI_EVENT_BUS_LOST_IP.
+*
+* To use this helper:
+* - The Wi-Fi helpers call setupWiFiEvents() in setupWiFi() & schedule handleWiFiEvents()
+*   in scheduleWiFi() (without the scheduler, call handleWiFiEvents() in main loop()),
+* - subscribeWiFiEvents(onWiFiEvent, WIFI_EVENT_BUS_MASK(WIFI_EVENT_BUS_GOT_IP), true) in setup(),
+*   with void onWiFiEvent(const WiFiBusEvent& event) { ... } running in loop() context.
+****************************************************************************************/
+
+#ifndef ESPWiFiEvents_h
+#define ESPWiFiEvents_h
+
+#ifdef ESP32    // for ESP32 boards
+#include <WiFi.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <ESP8266WiFi.h>
+#endif
+
+#include "ESPScheduler.h"   // handleWiFiEvents() task
+
+#define WIFI_EVENTS_QUEUE           16   // events between two dispatches, a power of 2
+#define WIFI_EVENTS_MAX_SUBSCRIBERS 6    // subscriber slots
+
+const unsigned long WIFI_EVENTS_PERIOD_MS = 100;   // ms between dispatches when scheduled, the coalescing window
+
+// Event types (WIFI_EVENT_* names are taken by the ESP32 SDK)
+enum WiFiBusEventType {
+  WIFI_EVENT_BUS_GOT_IP,          // STA has an IP: `ip`
+  WIFI_EVENT_BUS_LOST_IP,         // STA lost its IP (ESP8266: DHCP timeout)
+  WIFI_EVENT_BUS_DISCONNECTED,    // STA left its AP: `value` = reason code, `mac` = AP BSSID
+  WIFI_EVENT_BUS_INTERNET,        // internet reachability changed: `value` = 1 up | 0 down
+  WIFI_EVENT_BUS_STATION_JOINED,  // station joined the SoftAP: `mac`, `value` = association id
+  WIFI_EVENT_BUS_STATION_LEFT,    // station left the SoftAP: `mac`, `value` = association id
+  WIFI_EVENT_BUS_TYPE_COUNT
+};
+
+#define WIFI_EVENT_BUS_MASK(type) (1U << (type))
+const uint32_t WIFI_EVENT_BUS_ALL = (1U << WIFI_EVENT_BUS_TYPE_COUNT) - 1;
+
+// One event
+struct WiFiBusEvent {
+  uint8_t type;          // WiFiBusEventType
+  uint8_t value;         // reason code | internet up | association id
+  uint16_t count;        // events folded into this one by coalescing, 1 if none
+  uint8_t mac[6];        // station MAC | AP BSSID, zeros if none
+  uint32_t ip;           // lwIP address, first octet in the low byte
+  unsigned long atMS;    // when it happened (the last one, if coalesced)
+};
+
+typedef void (*WiFiEventCallback)(const WiFiBusEvent& event);
+
+// One subscriber slot
+struct WiFiEventSubscriber {
+  WiFiEventCallback callback;   // nullptr = free slot
+  uint32_t mask;                // WIFI_EVENT_BUS_MASK() of the types it gets
+  bool coalesce;                // last event per channel & batch only
+};
+
+WiFiBusEvent wifiEventQueue[WIFI_EVENTS_QUEUE];
+uint32_t wifiEventHead = 0;     // free-running write index
+uint32_t wifiEventTail = 0;     // free-running read index, only moved by handleWiFiEvents()
+uint32_t wifiEventsPosted = 0;
+uint32_t wifiEventsDropped = 0; // ring full
+WiFiEventSubscriber wifiEventSubscribers[WIFI_EVENTS_MAX_SUBSCRIBERS];
+
+#ifdef ESP32
+portMUX_TYPE wifiEventMux = portMUX_INITIALIZER_UNLOCKED;   // events arrive on the Wi-Fi event task
+#define WIFI_EVENT_LOCK()   portENTER_CRITICAL(&wifiEventMux)
+#define WIFI_EVENT_UNLOCK() portEXIT_CRITICAL(&wifiEventMux)
+#elif defined(ESP8266)
+WiFiEventHandler busGotIPHandler;        // kept alive for the event callbacks
+WiFiEventHandler busDHCPTimeoutHandler;
+WiFiEventHandler busDisconnectedHandler;
+WiFiEventHandler busJoinHandler;
+WiFiEventHandler busLeaveHandler;
+#define WIFI_EVENT_LOCK()                // events run between loop() calls
+#define WIFI_EVENT_UNLOCK()
+#endif
+
+
+// Queue an event, false if the ring is full (it is dropped & counted)
+bool postWiFiEvent(WiFiBusEventType type, uint8_t value = 0, const uint8_t* mac = nullptr, uint32_t ip = 0) {
+  WiFiBusEvent event = { (uint8_t)type, value, 1, {}, ip, millis() };
+  if (mac) {
+    memcpy(event.mac, mac, 6);
+  }
+  bool queued = false;
+  WIFI_EVENT_LOCK();
+  if (wifiEventHead - wifiEventTail < WIFI_EVENTS_QUEUE) {
+    wifiEventQueue[wifiEventHead & (WIFI_EVENTS_QUEUE - 1)] = event;
+    wifiEventHead++;
+    wifiEventsPosted++;
+    queued = true;
+  } else {
+    wifiEventsDropped++;
+  }
+  WIFI_EVENT_UNLOCK();
+  return queued;
+}
+
+// Add a subscriber for the types in `mask`, returns its id (-1 if all slots are used)
+int subscribeWiFiEvents(WiFiEventCallback callback, uint32_t mask = WIFI_EVENT_BUS_ALL, bool coalesce = false) {
+  for (int i = 0; i < WIFI_EVENTS_MAX_SUBSCRIBERS; i++) {
+    if (!wifiEventSubscribers[i].callback) {
+      wifiEventSubscribers[i] = { callback, mask, coalesce };
+      return i;
+    }
+  }
+  return -1;
+}
+
+void unsubscribeWiFiEvents(int id) {
+  if (id >= 0 && id < WIFI_EVENTS_MAX_SUBSCRIBERS) {
+    wifiEventSubscribers[id].callback = nullptr;
+  }
+}
+
+// Events on one channel replace each other when coalescing: the STA link, internet, each station
+bool sameWiFiEventChannel(const WiFiBusEvent& a, const WiFiBusEvent& b) {
+  bool aStation = a.type >= WIFI_EVENT_BUS_STATION_JOINED;
+  bool bStation = b.type >= WIFI_EVENT_BUS_STATION_JOINED;
+  if (aStation || bStation) {
+    return aStation && bStation && memcmp(a.mac, b.mac, 6) == 0;
+  }
+  return (a.type == WIFI_EVENT_BUS_INTERNET) == (b.type == WIFI_EVENT_BUS_INTERNET);
+}
+
+// Hand `batch` to one subscriber
+void deliverWiFiEvents(const WiFiEventSubscriber& subscriber, const WiFiBusEvent* batch, int n) {
+  for (int i = 0; i < n; i++) {
+    if (!(subscriber.mask & WIFI_EVENT_BUS_MASK(batch[i].type))) {
+      continue;
+    }
+    if (!subscriber.coalesce) {
+      subscriber.callback(batch[i]);
+      continue;
+    }
+    // Coalescing: deliver an event only if it is the last of its channel, counting the ones before it
+    uint16_t count = 1;
+    bool last = true;
+    for (int j = 0; j < n && last; j++) {
+      if (j != i && (subscriber.mask & WIFI_EVENT_BUS_MASK(batch[j].type)) && sameWiFiEventChannel(batch[i], batch[j])) {
+        if (j > i) {
+          last = false;
+        } else {
+          count++;
+        }
+      }
+    }
+    if (last) {
+      WiFiBusEvent event = batch[i];
+      event.count = count;
+      subscriber.callback(event);
+    }
+  }
+}
+
+// Dispatch everything queued to the subscribers, call often (scheduleWiFiEvents() does)
+void handleWiFiEvents() {
+  WiFiBusEvent batch[WIFI_EVENTS_QUEUE];
+  int n = 0;
+  WIFI_EVENT_LOCK();
+  while (wifiEventTail != wifiEventHead) {
+    batch[n++] = wifiEventQueue[wifiEventTail & (WIFI_EVENTS_QUEUE - 1)];
+    wifiEventTail++;
+  }
+  WIFI_EVENT_UNLOCK();
+
+  for (int i = 0; i < WIFI_EVENTS_MAX_SUBSCRIBERS && n > 0; i++) {
+    if (wifiEventSubscribers[i].callback) {
+      deliverWiFiEvents(wifiEventSubscribers[i], batch, n);
+    }
+  }
+}
+
+
+#ifdef ESP32
+void onBusWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      postWiFiEvent(WIFI_EVENT_BUS_GOT_IP, 0, nullptr, info.got_ip.ip_info.ip.addr);
+      break;
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      postWiFiEvent(WIFI_EVENT_BUS_LOST_IP);
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      postWiFiEvent(WIFI_EVENT_BUS_DISCONNECTED, info.wifi_sta_disconnected.reason, info.wifi_sta_disconnected.bssid);
+      break;
+    case ARDUINO_EVENT_WIFI_AP_STACONNECTED:
+      postWiFiEvent(WIFI_EVENT_BUS_STATION_JOINED, info.wifi_ap_staconnected.aid, info.wifi_ap_staconnected.mac);
+      break;
+    case ARDUINO_EVENT_WIFI_AP_STADISCONNECTED:
+      postWiFiEvent(WIFI_EVENT_BUS_STATION_LEFT, info.wifi_ap_stadisconnected.aid, info.wifi_ap_stadisconnected.mac);
+      break;
+    default:
+      break;
+  }
+}
+#endif
+
+// Register the platform callbacks, call in setupWiFi() (the Wi-Fi helpers do), safe to call twice
+void setupWiFiEvents() {
+  static bool done = false;
+  if (done) {
+    return;
+  }
+  done = true;
+#ifdef ESP32
+  WiFi.onEvent(onBusWiFiEvent);
+#elif defined(ESP8266)
+  busGotIPHandler = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP& event) {
+    postWiFiEvent(WIFI_EVENT_BUS_GOT_IP, 0, nullptr, (uint32_t)event.ip);
+  });
+  busDHCPTimeoutHandler = WiFi.onStationModeDHCPTimeout([]() {
+    postWiFiEvent(WIFI_EVENT_BUS_LOST_IP);
+  });
+  busDisconnectedHandler = WiFi.onStationModeDisconnected([](const WiFiEventStationModeDisconnected& event) {
+    postWiFiEvent(WIFI_EVENT_BUS_DISCONNECTED, event.reason, event.bssid);
+  });
+  busJoinHandler = WiFi.onSoftAPModeStationConnected([](const WiFiEventSoftAPModeStationConnected& event) {
+    postWiFiEvent(WIFI_EVENT_BUS_STATION_JOINED, event.aid, event.mac);
+  });
+  busLeaveHandler = WiFi.onSoftAPModeStationDisconnected([](const WiFiEventSoftAPModeStationDisconnected& event) {
+    postWiFiEvent(WIFI_EVENT_BUS_STATION_LEFT, event.aid, event.mac);
+  });
+#endif
+}
+
+// Register the dispatch with the scheduler, call in scheduleWiFi() (the Wi-Fi helpers do)
+void scheduleWiFiEvents() {
+  Scheduler::add("events", handleWiFiEvents, WIFI_EVENTS_PERIOD_MS);
+}
+
+#endif
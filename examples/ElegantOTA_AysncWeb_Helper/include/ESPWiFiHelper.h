@@ -4,17 +4,26 @@
  * This header file provides a simple way to configure and use either SoftAP (Access Point)
  * mode or Station (Client) mode for ESP8266/ESP32 boards. 
  * It supports both static IP configuration and DHCP for Station mode.
- * It also checks internet connectivity with a LED status:
- * - Solid: Wi-Fi connected and internet available
+ * It also monitors internet connectivity in the background (ESPReachability.h) with a LED status,
+ * played from a timer (ESPStatusLED.h) so a busy loop() does not disturb it:
+ * - Solid: Wi-Fi connected and internet available (or the SoftAP is up)
  * - Slow Blink: Wi-Fi connected but no internet
+ * - Fast Blink: connecting
+ * - Breathing: setup portal open (WIFI_MODE_AP_STA)
+ * - 2 pulses & a pause: gave up connecting (MAX_CONNECT_ATTEMPTS)
  * 
  * Usage:
  *
  * Include this header file in your project and configure the Wi-Fi modes & settings as needed.
+ * All settings are fields of the `wifiConfig` struct below (see ESPWiFiConfig.h), they are the
+ * defaults: a config saved with saveWiFiConfig(wifiConfig) replaces them at boot, no reflash needed.
  * 
  * 1. Select Wi-Fi Mode:
- *    - In the `wifiMode` variable, set either `WIFI_MODE_SOFTAP` (for SoftAP mode) or 
- *      `WIFI_MODE_STA` (for Station mode).
+ *    - In the `mode` field, set either `WIFI_MODE_SOFTAP` (for SoftAP mode), 
+ *      `WIFI_MODE_STA` (for Station mode) or `WIFI_MODE_AP_STA` (Station mode that falls back to
+ *      the SoftAP settings with a captive portal at http://apIP/wifi when the STA connection has
+ *      been down for PORTAL_DEADLINE_MS - new credentials are saved & used without a reboot.
+ *      Needs ElegantOTAHelper.h for the web server).
  * 
  * 2. Configure SoftAP (Access Point) Settings if using SoftAP mode:
  *    - Modify the `apSSID` (network name), `apPassword` (password), `apIP` (IP address), 
@@ -22,14 +31,32 @@
  * 
  * 3. Configure Station (Client) Settings if using STA mode:
  *    - Set `staSSID` (Wi-Fi network name) and `staPassword` (Wi-Fi network password).
- *    - If using Static IP, set `USE_STATIC_IP` to `true` and configure the `staticIP`, `gateway`, 
- *      `subnet`, and `dns` variables as needed.
+ *    - If using Static IP, set `useStaticIP` to `true` and configure the `staticIP`, `gateway`, 
+ *      `subnet`, and `dns` fields as needed.
+ *    - Set `useFastConnect` to `true` to reconnect after a reset/deep sleep using the AP & IP
+ *      cached in RTC memory (skips the scan & DHCP, needs ESPWiFiFastConnect.h).
  * 
  * 4. In the main.cpp file:
  *   - #include "ESPWiFiHelper.h"
  *   - In the `setup()` function, call the `setupWiFi()` function to initialize Wi-Fi based on the selected mode.
- *   - In the `loop()` function, call the `handleBuiltInLED()` function to handle LED status for no internet access.
- *     if STA mode is selected.
+ *     In STA mode it only starts the connection and returns, so the rest of setup() runs straight away.
+ *   - In the `loop()` function, call the `handleWiFi()` function to drive the STA connection (timeout,
+ *     retries with exponential backoff & reconnects, it also posts the LED pattern). Also call
+ *     `handleLog()`, the helper's messages are queued in ESPLog.h & only reach Serial from there.
+ *   - To react to Wi-Fi changes, subscribe with subscribeWiFiEvents() (ESPWiFiEvents.h) & also call
+ *     `handleWiFiEvents()` in the `loop()` function. The bus & the status LED are built with STA
+ *     mode, set -DWIFI_HELPER_EVENTS=1 / -DHELPER_STATUS_LED=1 to keep them with WIFI_HELPER_STA=0.
+ *   - Or with the scheduler (ESPScheduler.h): call `scheduleWiFi()` after `setupWiFi()`, and only
+ *     `Scheduler::run()` in the `loop()` function. Set `idleMode` in ESPPowerSave.h to modem or
+ *     light sleep the radio while the scheduler idles. In WIFI_MODE_AP_STA it sleeps too, except
+ *     while the setup AP is up (its clients need the radio awake).
+ * 
+ * 5. Leave out what you do not use (see BUILT-IN FEATURES in ESPHelperFeatures.h): e.g. build_flags =
+ *    -DWIFI_HELPER_SOFTAP=0 -DWIFI_HELPER_REACHABILITY=0 drops the SoftAP code & the internet
+ *    probes from the firmware. `python size_report.py <project dir>` prints flash & RAM per env.
+ *    -DHELPER_LOG_LEVEL=1 keeps only the error messages (ESPLog.h).
+ *    With -DWIFI_HELPER_METRICS=1 (default) the RSSI, reconnects & probe RTT/loss are added to
+ *    the /metrics page served by ElegantOTAHelper.h (ESPMetrics.h).
  * 
 ****************************************************************************************/
 
@@ -38,138 +65,470 @@
 
 #ifdef ESP32    // for ESP32 boards
 #include <WiFi.h>
-#include <ESP32Ping.h>
 
 #elif defined(ESP8266)    // for ESP8266 boards
 #include <ESP8266WiFi.h>
-#include <ESP8266Ping.h>
 #endif
 
+#include "ESPHelperFeatures.h"    // BUILT-IN FEATURES switches, shared with ElegantOTAHelper.h
+#include "ESPLog.h"              // buffered, non-blocking log
+#include "ESPWiFiConfig.h"        // settings struct, saved in LittleFS
+#include "ESPWiFiFastConnect.h"   // BSSID/channel/IP cache in RTC memory
+
+#if WIFI_HELPER_PORTAL
+#include "ESPCaptivePortal.h"     // DNS responder & /wifi setup page
+#endif
+
+#if WIFI_HELPER_REACHABILITY
+#include "ESPReachability.h"      // background gateway/DNS/internet probes
+#else
+// No probes: a working connection counts as internet access
+void startReachability() {}
+void stopReachability() {}
+void handleReachability() {}
+bool internetReachable() { return true; }
+bool reachabilityBusy() { return false; }
+void registerReachabilityMetrics() {}
+#endif
+#if WIFI_HELPER_METRICS
+#include "ESPMetrics.h"           // Prometheus counters & gauges
+#endif
+#include "ESPScheduler.h"         // cooperative task scheduler
+#include "ESPPowerSave.h"         // modem/light sleep while the scheduler idles
+#include "ESPProfiler.h"          // opt-in entry point timing (HELPER_PROFILE)
+#include "ESPStatusPush.h"        // live status for dashboards
+#include "ESPStatusLED.h"         // LED patterns played from a timer (HELPER_STATUS_LED)
+#if WIFI_HELPER_EVENTS
+#include "ESPWiFiEvents.h"        // event bus for application subscribers
+#endif
+#if WIFI_HELPER_LINK_QUALITY
+#include "ESPLinkQuality.h"       // RSSI history & adaptive TX power
+#endif
 
-// Wi-Fi Modes
-#define WIFI_MODE_SOFTAP   0
-#define WIFI_MODE_STA      1
 
 /****************************************************
- ****************** MODE SELECTION ******************
- ** Replace with WIFI_MODE_SOFTAP or WIFI_MODE_STA **
+ ****************** CONFIGURATION *******************
+ ** Defaults, a config saved with saveWiFiConfig() **
+ ** (ESPWiFiConfig.h) replaces them at boot        **
  ****************************************************/
 
-int wifiMode = WIFI_MODE_STA;   // WIFI_MODE_SOFTAP or WIFI_MODE_STA
-
-// SoftAP Configuration
-const char* apSSID = "ESP8266";       // SoftAP network name
-const char* apPassword = "12345678";  // SoftAP password
-IPAddress apIP(192, 168, 10, 1);      // AP IP address
-IPAddress apSubnet(255, 255, 255, 0); // subnet mask for SoftAP
+WiFiConfig wifiConfig = {
+  WIFI_MODE_STA,                  // mode: WIFI_MODE_SOFTAP, WIFI_MODE_STA or WIFI_MODE_AP_STA
 
-// STA Configuration
-const char* staSSID = "YOUR_SSID_NAME";      // Wi-Fi network name
-const char* staPassword = "YOUR_SSID_PW";    // Wi-Fi network password
-const char* hostName = "ESP8266";            // change the hostname if needed
+  // SoftAP Configuration
+  "ESP8266",                      // apSSID: SoftAP network name
+  "12345678",                     // apPassword: SoftAP password
+  IPAddress(192, 168, 10, 1),     // apIP: AP IP address
+  IPAddress(255, 255, 255, 0),    // apSubnet: subnet mask for SoftAP
 
-bool USE_STATIC_IP = false;             // static IP = true | DHCP = false
-IPAddress staticIP(192, 168, 3, 10);    // static IP
-IPAddress gateway(192, 168, 3, 1);      // router gateway
-IPAddress subnet(255, 255, 255, 0);     // subnet mask
-IPAddress dns(192, 168, 3, 1);          // DNS server
+  // STA Configuration
+  "YOUR_SSID_NAME",               // staSSID: Wi-Fi network name
+  "YOUR_SSID_PW",                 // staPassword: Wi-Fi network password
+  "ESP8266",                      // hostName: change the hostname if needed
+  false,                          // useStaticIP: static IP = true | DHCP = false
+  false,                          // useFastConnect: reuse the last AP & IP lease after a reset/deep sleep = true | always scan & DHCP = false
+  IPAddress(192, 168, 3, 10),     // staticIP: static IP
+  IPAddress(192, 168, 3, 1),      // gateway: router gateway
+  IPAddress(255, 255, 255, 0),    // subnet: subnet mask
+  IPAddress(192, 168, 3, 1)       // dns: DNS server
+};
 
 bool isConnected = false;   // Wi-Fi connection status
 bool hasInternet = false;   // Internet connection status
+uint32_t wifiReconnects = 0; // STA connections lost since boot
+
+// STA connection retry settings
+const unsigned long CONNECT_TIMEOUT_MS = 15000;  // ms to wait for an attempt before giving up on it
+const unsigned long BACKOFF_BASE_MS = 1000;      // ms to wait after the first failed attempt (doubles each failure)
+const unsigned long BACKOFF_MAX_MS = 60000;      // upper limit for the wait between attempts
+const int MAX_CONNECT_ATTEMPTS = 0;              // attempts before giving up for good (0 = keep trying)
+const unsigned long FAST_CONNECT_TIMEOUT_MS = 3000;  // ms to wait for a cached AP before falling back to a full scan
+
+// WIFI_MODE_AP_STA settings
+const unsigned long PORTAL_DEADLINE_MS = 30000;  // ms without a STA connection before the setup AP & portal start
+const unsigned long PORTAL_LINGER_MS = 10000;    // ms the portal stays up once connected, so the phone sees it worked
+
+// Task periods
+const unsigned long WIFI_TASK_PERIOD_MS = 50;    // ms between handleWiFi() runs when scheduled & busy
+const unsigned long WIFI_IDLE_PERIOD_MS = 1000;  // ms between handleWiFi() runs when connected with no probe in flight
+
+// STA connection states, advanced by handleWiFi()
+enum ConnState {
+  CONN_IDLE,        // setupWiFi() not called yet (or SoftAP mode)
+  CONN_CONNECTING,  // waiting for WiFi.begin() to associate
+  CONN_CONNECTED,   // associated & IP assigned
+  CONN_BACKOFF,     // attempt failed, waiting before the next one
+  CONN_FAILED       // MAX_CONNECT_ATTEMPTS reached, no more attempts
+};
+
+ConnState connState = CONN_IDLE;  // current connection state
+unsigned long connStateMS = 0;    // time the current state was entered
+unsigned long backoffMS = 0;      // wait before the next attempt while in CONN_BACKOFF
+int connectAttempts = 0;          // failed attempts since the last successful connection
+bool fastConnecting = false;      // current attempt uses the cached BSSID/channel/IP
+unsigned long connectStartMS = 0; // time setupWiFi() started the first attempt
+int wifiTaskId = -1;              // scheduler task id of handleWiFi(), -1 if not scheduled
+unsigned long staDownMS = 0;      // time the STA connection was started or last lost
+
+
+// True if the selected mode runs the STA connection (STA, or AP+STA)
+bool staEnabled() {
+  return WIFI_HELPER_STA && (wifiConfig.mode == WIFI_MODE_STA || (WIFI_HELPER_PORTAL && wifiConfig.mode == WIFI_MODE_AP_STA));
+}
+
+
+// Start a STA connection attempt
+void beginWiFiAttempt() {
+  if (WIFI_HELPER_FAST_CONNECT && fastConnecting) {
+    beginWiFiSTA(wifiConfig.staSSID, wifiConfig.staPassword, fastConnectCache.channel, fastConnectCache.bssid);  // skip the channel scan
+  } else {
+    beginWiFiSTA(wifiConfig.staSSID, wifiConfig.staPassword);  // connect to Wi-Fi network, keeps the listen interval
+  }
+  connectAttempts++;
+  connState = CONN_CONNECTING;
+  connStateMS = millis();
+
+  LOG_I("Attempting to connect to Wi-Fi (attempt %d)", connectAttempts);
+}
+
+// Work out the wait before the next attempt: doubles per failure up to BACKOFF_MAX_MS,
+// plus up to 25% random jitter so a room full of nodes does not retry in lock-step
+unsigned long nextBackoffMS() {
+  unsigned long waitMS = BACKOFF_BASE_MS;
+  for (int i = 1; i < connectAttempts && waitMS < BACKOFF_MAX_MS; i++) {
+    waitMS *= 2;
+  }
+  if (waitMS > BACKOFF_MAX_MS) {
+    waitMS = BACKOFF_MAX_MS;
+  }
+  return waitMS + random(waitMS / 4 + 1);
+}
+
+// Runs once when the STA connection comes up
+void onWiFiConnected() {
+  LOG_I("\nWi-Fi connected!\n");
+  IPAddress ip = WiFi.localIP();
+  LOG_I("IP Address: %u.%u.%u.%u\n", ip[0], ip[1], ip[2], ip[3]);
+  isConnected = true;     // Set Wi-Fi connected flag
+  setStatus(STATUS_CONNECTED, 1);
+  connectAttempts = 0;    // reset the backoff
+  LOG_I("Connected in %lu ms%s\n", millis() - connectStartMS, fastConnecting ? " (fast connect)" : "");
+
+  if (WIFI_HELPER_FAST_CONNECT && wifiConfig.useFastConnect) {
+    saveFastConnectCache();   // remember this AP & lease for the next boot
+  }
+
+  // Check internet connectivity in the background, handleWiFi() updates hasInternet
+  LOG_I("Monitoring internet access...\n");
+  startReachability();
+}
+
+
+#if WIFI_HELPER_METRICS
+int32_t readWiFiMetric(int arg) {
+  switch (arg) {
+    case 0: return isConnected ? WiFi.RSSI() : 0;
+    case 1: return isConnected;
+    default: return hasInternet;
+  }
+}
+#endif
+
+// Register the Wi-Fi metrics (ESPMetrics.h), once
+void registerWiFiMetrics() {
+#if WIFI_HELPER_METRICS
+  static bool registered = false;
+  if (registered) {
+    return;
+  }
+  registered = true;
+  setupMetrics();
+  registerGauge("wifi_rssi_dbm", "STA signal strength, 0 when not connected", nullptr, readWiFiMetric, 0);
+  registerGauge("wifi_connected", "STA connected", nullptr, readWiFiMetric, 1);
+  registerGauge("wifi_internet", "Internet host reachable", nullptr, readWiFiMetric, 2);
+  registerCounter("wifi_reconnects_total", "STA connections lost since boot", nullptr, &wifiReconnects);
+  registerReachabilityMetrics();
+#endif
+}
 
 
 // Setup Wi-Fi modes depending on the selected mode
 void setupWiFi() {
-  // Initialize the Built-In LED
-  pinMode(LED_BUILTIN, OUTPUT);     // set the LED pin mode
-  digitalWrite(LED_BUILTIN, HIGH);  // initialize off (active low)
+  PROFILE_SCOPE("setupWiFi");
+  setupStatusLED();   // LED off until a mode is up, nothing with HELPER_STATUS_LED 0
+#if WIFI_HELPER_EVENTS
+  setupWiFiEvents();  // platform events into the bus for subscribers
+#endif
+#if WIFI_HELPER_LINK_QUALITY
+  setupLinkQuality(); // full TX power again after a disconnect
+#endif
+
+  if (WIFI_HELPER_CONFIG_FILE) {
+    loadWiFiConfig(wifiConfig);     // saved settings replace the defaults
+  }
+  if ((wifiConfig.mode == WIFI_MODE_SOFTAP && !WIFI_HELPER_SOFTAP) || (wifiConfig.mode != WIFI_MODE_SOFTAP && !staEnabled())) {
+    LOG_E("Selected Wi-Fi mode is not built in! Check the WIFI_HELPER_* build flags.\n");
+  }
 
 /******************************************
  ************* SoftAP Mode ****************
  ******************************************/
-  if (wifiMode == WIFI_MODE_SOFTAP) {
+  if (WIFI_HELPER_SOFTAP && wifiConfig.mode == WIFI_MODE_SOFTAP) {
 
-    Serial.println("Setting up SoftAP...");
-    if (!WiFi.softAPConfig(apIP, apIP, apSubnet)) {
-      Serial.println("Failed to configure SoftAP network! Check your IP configuration.");
+    LOG_I("Setting up SoftAP...\n");
+    if (!WiFi.softAPConfig(wifiConfig.apIP, wifiConfig.apIP, wifiConfig.apSubnet)) {
+      LOG_E("Failed to configure SoftAP network! Check your IP configuration.\n");
       return;
     }
-    if (WiFi.softAP(apSSID, apPassword)) {
-      Serial.println("SoftAP configured successfully!");
-      Serial.print("Network Name: ");
-      Serial.println(apSSID);
-      Serial.print("AP IP Address: ");
-      Serial.println(WiFi.softAPIP());
-      digitalWrite(LED_BUILTIN, LOW);  // Turn on LED (active low)
+    if (WiFi.softAP(wifiConfig.apSSID, wifiConfig.apPassword)) {
+      LOG_I("SoftAP configured successfully!\n");
+      IPAddress apIP = WiFi.softAPIP();
+      LOG_I("Network Name: %s\n", wifiConfig.apSSID);
+      LOG_I("AP IP Address: %u.%u.%u.%u\n", apIP[0], apIP[1], apIP[2], apIP[3]);
+      setLEDPattern(LED_ON);
     } else {
-      Serial.println("Failed to start SoftAP! Check your setup.");
+      LOG_E("Failed to start SoftAP! Check your setup.\n");
     }
   }
 
 /******************************************
  ******* Station Mode (Wi-Fi Client) ******
  ******************************************/
-  if (wifiMode == WIFI_MODE_STA) {
+  if (staEnabled()) {
     
-    Serial.println("Connecting to Wi-Fi...");
+    LOG_I("Connecting to Wi-Fi...\n");
+    registerWiFiMetrics();
     WiFi.mode(WIFI_STA);
     WiFi.disconnect();
     WiFi.persistent(false);
     WiFi.setAutoReconnect(true);
-    WiFi.hostname(hostName);
+    WiFi.hostname(wifiConfig.hostName);
     delay(100);
 
-    if (USE_STATIC_IP) {
-      if (!WiFi.config(staticIP, gateway, subnet, dns)) {
-        Serial.println("Failed to configure static IP! Check the ESPWiFiHelper.h configuration.");
+    if (WIFI_HELPER_STATIC_IP && wifiConfig.useStaticIP) {
+      if (!WiFi.config(wifiConfig.staticIP, wifiConfig.gateway, wifiConfig.subnet, wifiConfig.dns)) {
+        LOG_E("Failed to configure static IP! Check the ESPWiFiHelper.h configuration.\n");
       } else {
-        Serial.println("Static IP configuration successful.");
+        LOG_I("Static IP configuration successful.\n");
       }
     }
 
-    WiFi.begin(staSSID, staPassword);
-    Serial.print("Attempting to connect to Wi-Fi");
-
-    while (WiFi.status() != WL_CONNECTED) {
-      Serial.print(".");
-      digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));  // Toggle LED for fast blinking
-      delay(250);
+    // Use the cached AP & IP if there is a valid entry from before the reset
+    if (WIFI_HELPER_FAST_CONNECT && wifiConfig.useFastConnect && loadFastConnectCache()) {
+      LOG_I("Using cached AP & IP for a fast connect.\n");
+      fastConnecting = true;
+      if (!(WIFI_HELPER_STATIC_IP && wifiConfig.useStaticIP)) {
+        WiFi.config(IPAddress(fastConnectCache.ip), IPAddress(fastConnectCache.gateway),
+                    IPAddress(fastConnectCache.subnet), IPAddress(fastConnectCache.dns));
+      }
     }
 
-    Serial.println("\nWi-Fi connected!");
-    Serial.print("IP Address: ");
-    Serial.println(WiFi.localIP());
-    isConnected = true;  // Set Wi-Fi connected flag
+    applyPowerSave();  // modem/light sleep setting, needs to be set before associating
+
+    connectStartMS = millis();
+    staDownMS = connectStartMS;
+    beginWiFiAttempt();  // start connecting, handleWiFi() takes it from here
+  }
+}
 
-    // Check internet connectivity using ping
-    Serial.println("\nPinging Google to test internet & DNS...");
-    hasInternet = Ping.ping("www.google.com");
 
-    if (hasInternet) {
-      Serial.println("Ping successful! Internet is available.");
-      digitalWrite(LED_BUILTIN, LOW);  // solid on LED (active low)
-    } else {
-      Serial.println("Ping failed! No internet or DNS issue.");
+#if WIFI_HELPER_PORTAL
+// Bring up the SoftAP next to the STA & start the captive portal
+void startProvisioningAP() {
+  LOG_I("\nNo Wi-Fi connection, starting the setup access point...\n");
+  WiFi.mode(WIFI_AP_STA);
+#ifdef ESP32
+  WiFi.setSleep(false);                 // the AP's clients need the radio awake
+#elif defined(ESP8266)
+  WiFi.setSleepMode(WIFI_NONE_SLEEP);
+#endif
+
+  if (!WiFi.softAPConfig(wifiConfig.apIP, wifiConfig.apIP, wifiConfig.apSubnet) ||
+      !WiFi.softAP(wifiConfig.apSSID, wifiConfig.apPassword)) {
+    LOG_E("Failed to start the setup access point! Check the SoftAP settings.\n");
+    staDownMS = millis();               // try again after another PORTAL_DEADLINE_MS
+    return;
+  }
+  snprintf(portalSSID, sizeof(portalSSID), "%s", wifiConfig.staSSID);   // prefill the form
+  startCaptivePortal(WiFi.softAPIP());
+  LOG_I("Join \"%s\" to set up Wi-Fi\n", wifiConfig.apSSID);
+}
+
+// Back to STA only, power save was skipped while the AP was up & applies again now
+void stopProvisioningAP() {
+  stopCaptivePortal();
+  WiFi.softAPdisconnect(true);
+  WiFi.mode(WIFI_STA);
+  applyPowerSave();
+}
+
+// Run the portal while the STA is down, and connect with the credentials it receives
+void handleProvisioning(unsigned long currentMS) {
+  PROFILE_SCOPE("handleProvisioning");
+  if (portalCredentialsReceived) {
+    portalCredentialsReceived = false;
+    snprintf(wifiConfig.staSSID, sizeof(wifiConfig.staSSID), "%s", portalSSID);
+    snprintf(wifiConfig.staPassword, sizeof(wifiConfig.staPassword), "%s", portalPassword);
+    if (WIFI_HELPER_CONFIG_FILE && !saveWiFiConfig(wifiConfig)) {
+      LOG_E("Failed to save the Wi-Fi config! Using it until the next reboot.\n");
     }
+
+    LOG_I("\nNew Wi-Fi credentials for \"%s\", connecting...\n", wifiConfig.staSSID);
+    WiFi.disconnect();
+    fastConnecting = false;
+    connectAttempts = 0;
+    beginWiFiAttempt();
+  }
+
+  if (!captivePortalActive && !isConnected && currentMS - staDownMS >= PORTAL_DEADLINE_MS) {
+    startProvisioningAP();
+  } else if (captivePortalActive && isConnected && currentMS - connStateMS >= PORTAL_LINGER_MS) {
+    stopProvisioningAP();
+  }
+  handleCaptivePortal();
+}
+#endif
+
+
+// LED pattern of the STA connection state
+LEDPattern wifiLEDPattern() {
+#if WIFI_HELPER_PORTAL
+  if (captivePortalActive) {
+    return LED_BREATHE;
+  }
+#endif
+  switch (connState) {
+    case CONN_CONNECTING: return LED_FAST_BLINK;
+    case CONN_CONNECTED:  return hasInternet ? LED_ON : LED_SLOW_BLINK;
+    case CONN_FAILED:     return ledErrorCode(LED_ERROR_CONNECT);
+    default:              return LED_OFF;   // idle, or waiting out the backoff
   }
 }
 
+// Advance the STA connection state machine, call from loop()
+void handleWiFi() {
+  PROFILE_SCOPE("handleWiFi");
+  if (!staEnabled()) {
+    return;
+  }
+
+  const unsigned long DOT_PERIOD_MS = 250;      // ms between progress dots while connecting
+  static unsigned long lastDotMS = 0;           // last time a dot was logged
+  unsigned long currentMS = millis();           // get the current time
 
-// Function to handle LED blinking for no internet access in STA mode
-void handleBuiltInLED() {
-  if (wifiMode == WIFI_MODE_STA) {
-    const long BLINK_PERIOD = 1000;  // ms for slow blink
-    static long lastBlinkMS = 0;     // last time the LED blinked
-    static bool ledState = false;    // current state of the LED
-    long currentMS = millis();       // get the current time
+  switch (connState) {
+    case CONN_CONNECTING:
+      if (WiFi.status() == WL_CONNECTED) {
+        connState = CONN_CONNECTED;
+        connStateMS = currentMS;
+        onWiFiConnected();
+        fastConnecting = false;
+      } else if (WIFI_HELPER_FAST_CONNECT && fastConnecting && (currentMS - connStateMS >= FAST_CONNECT_TIMEOUT_MS ||
+                                    WiFi.status() == WL_NO_SSID_AVAIL || WiFi.status() == WL_CONNECT_FAILED)) {
+        // Cached AP is gone or the lease is no longer valid, fall back to the normal path straight away
+        LOG_W("\nFast connect failed, falling back to a full scan.\n");
+        fastConnecting = false;
+        clearFastConnectCache();
+        WiFi.disconnect();
+        if (!(WIFI_HELPER_STATIC_IP && wifiConfig.useStaticIP)) {
+          WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));  // back to DHCP
+        }
+        connectAttempts = 0;
+        beginWiFiAttempt();
+      } else if (currentMS - connStateMS >= CONNECT_TIMEOUT_MS) {
+        WiFi.disconnect();                // drop the attempt
+        connStateMS = currentMS;
 
-    if (isConnected && !hasInternet) {
-      if (currentMS - lastBlinkMS >= BLINK_PERIOD) {
-        digitalWrite(LED_BUILTIN, ledState);  // toggle the LED
-        ledState = !ledState;                 // update LED state
-        lastBlinkMS = currentMS;              // update the last blink time
+        if (MAX_CONNECT_ATTEMPTS > 0 && connectAttempts >= MAX_CONNECT_ATTEMPTS) {
+          connState = CONN_FAILED;
+          LOG_E("\nWi-Fi connection failed! Giving up, check staSSID & staPassword.\n");
+        } else {
+          connState = CONN_BACKOFF;
+          backoffMS = nextBackoffMS();
+          LOG_W("\nWi-Fi connection timed out, retrying in %lu ms\n", backoffMS);
+        }
+      } else if (currentMS - lastDotMS >= DOT_PERIOD_MS) {
+        LOG_I(".");
+        lastDotMS = currentMS;
       }
-    }
+      break;
+
+    case CONN_BACKOFF:
+      if (currentMS - connStateMS >= backoffMS) {
+        beginWiFiAttempt();
+      }
+      break;
+
+    case CONN_CONNECTED:
+      if (WiFi.status() != WL_CONNECTED) {
+        LOG_W("\nWi-Fi connection lost!\n");
+        staDownMS = currentMS;
+        wifiReconnects++;
+        stopReachability();
+        isConnected = false;
+#if WIFI_HELPER_EVENTS
+        if (hasInternet) {
+          postWiFiEvent(WIFI_EVENT_BUS_INTERNET, 0);
+        }
+#endif
+        hasInternet = false;
+        setStatus(STATUS_CONNECTED, 0);
+        setStatus(STATUS_INTERNET, 0);
+        beginWiFiAttempt();
+      } else {
+        handleReachability();
+#if WIFI_HELPER_LINK_QUALITY
+        if (wifiConfig.mode == WIFI_MODE_STA) {
+          handleLinkQuality(currentMS);   // not with the SoftAP up, its stations need the full power
+        }
+#endif
+        setStatus(STATUS_RSSI, WiFi.RSSI(), 3);
+        if (internetReachable() != hasInternet) {
+          hasInternet = !hasInternet;
+          setStatus(STATUS_INTERNET, hasInternet);
+#if WIFI_HELPER_EVENTS
+          postWiFiEvent(WIFI_EVENT_BUS_INTERNET, hasInternet);
+#endif
+          if (hasInternet) {
+            LOG_I("Internet is available.\n");
+          } else {
+            LOG_W("Internet lost! Either the uplink is down, or DNS is not working.\n");
+          }
+        }
+      }
+      break;
+
+    default:  // CONN_IDLE & CONN_FAILED: nothing to do
+      break;
+  }
+
+#if WIFI_HELPER_PORTAL
+  if (wifiConfig.mode == WIFI_MODE_AP_STA) {
+    handleProvisioning(currentMS);
+  }
+#endif
+
+  // Only poll quickly while connecting, probing or serving the portal, so the scheduler can sleep longer otherwise
+  bool busy = connState == CONN_CONNECTING || (connState == CONN_CONNECTED && reachabilityBusy());
+#if WIFI_HELPER_PORTAL
+  busy |= captivePortalActive;
+#endif
+  Scheduler::setPeriod(wifiTaskId, busy ? WIFI_TASK_PERIOD_MS : WIFI_IDLE_PERIOD_MS);
+  setLEDPattern(wifiLEDPattern());   // only restarts the LED timer when the state changed
+}
+
+
+// The LED runs from a timer now (ESPStatusLED.h), kept so loop()s calling it still build
+void handleBuiltInLED() {}
+
+// Register handleWiFi() with the scheduler, call in setup() after setupWiFi()
+void scheduleWiFi() {
+#if WIFI_HELPER_EVENTS
+  scheduleWiFiEvents();   // dispatch to the event subscribers, SoftAP joins & leaves too
+#endif
+  scheduleLog();          // drain the log into Serial, in every mode
+  if (staEnabled()) {
+    wifiTaskId = Scheduler::add("wifi", handleWiFi, WIFI_TASK_PERIOD_MS);
   }
 }
 
@@ -5,7 +5,24 @@
 * - Include this file in your project.
 * - Include ESPWiFiHelper.h in your project or setup Wi-Fi connection yourself in main.
 * - In main setup() > call the setupOTA() function.
-* - In main loop() > call the ElegantOTA.loop() function to allow for reboots after updates.
+* - In main loop() > call the handleOTA() function to verify updates & reboot into them,
+*   and handleStatusPush() for the /status WebSocket,
+*   or call scheduleOTA() in setup() and Scheduler::run() in loop() (ESPScheduler.h).
+* - Leave out what you do not use with the OTA_HELPER_* & HELPER_STATUS_PUSH switches in
+*   build_flags (see BUILT-IN FEATURES in ESPHelperFeatures.h).
+* - Optionally post the SHA-256 of the new firmware to /ota/sha256 before uploading it,
+*   a mismatching image is discarded (see ESPOTAVerify.h).
+* - Set OTA_USERNAME & OTA_PASSWORD to ask for a login on /update & the /ota/ routes.
+* - Over a weak link, upload a compressed image or delta from ota_patch.py to /ota/patch
+*   instead of /update (see ESPOTAPatch.h).
+* - With ESPWiFiHelper.h in WIFI_MODE_AP_STA, the same server shows the Wi-Fi setup page
+*   while the captive portal runs (see ESPCaptivePortal.h).
+* - Requests are turned away with a 503/429 from flash when the heap is low, too many are in
+*   flight, an IP sends too fast, or an upload is running (see ESPAdmission.h).
+* - Dashboards can open a WebSocket on /status for live status pushed as it changes,
+*   instead of polling a page (see ESPStatusPush.h).
+* - Point Prometheus at http://[esp.ip]/metrics for heap, loop latency, Wi-Fi & update
+*   metrics (see ESPMetrics.h).
 *
 * >>IMPORTANT<<
 * If using an ESP8266 board, set #define ELEGANTOTA_USE_ASYNC_WEBSERVER 0 to 1 in the ElegantOTA.h file.
@@ -15,41 +32,141 @@
 #define ELEGANTOTAHELPER_H
 
 #ifdef ESP32                // for ESP32 boards
+#include <WiFi.h>
 #include <AsyncTCP.h>
 
 #elif defined(ESP8266)      // for ESP8266 boards
+#include <ESP8266WiFi.h>
 #include <ESPAsyncTCP.h>
 #endif
 
 #include <ESPAsyncWebServer.h>      // include the AsyncWebServer library
 #include <ElegantOTA.h>             // set #define ELEGANTOTA_USE_ASYNC_WEBSERVER 0 to 1 in the ElegantOTA.h file
 #include <LittleFS.h>
+#include "ESPHelperFeatures.h"      // BUILT-IN FEATURES switches, shared with ESPWiFiHelper.h
+#include "ESPScheduler.h"           // cooperative task scheduler
+#include "ESPPageTemplate.h"        // flash page templates rendered without String
+#include "ESPStaticAssets.h"        // gzipped LittleFS files with ETags
+#if OTA_HELPER_VERIFY
+#include "ESPOTAVerify.h"           // SHA-256 check & upload metrics
+#endif
+#if OTA_HELPER_PATCH
+#include "ESPOTAPatch.h"            // compressed & delta images on /ota/patch
+#endif
+#if WIFI_HELPER_PORTAL
+#include "ESPCaptivePortal.h"       // Wi-Fi setup page for ESPWiFiHelper.h WIFI_MODE_AP_STA
+#endif
+#include "ESPMetrics.h"             // Prometheus /metrics
+#include "ESPProfiler.h"            // opt-in entry point timing (HELPER_PROFILE)
+#include "ESPStatusPush.h"          // live status WebSocket on /status
+#include "ESPAdmission.h"           // request limits & heap floor
+#if WIFI_HELPER_LINK_QUALITY
+#include "ESPLinkQuality.h"         // RSSI history on /link
+#endif
 
 // Asyncronous web server, on port 80
 AsyncWebServer server(80);
 
+const unsigned long OTA_TASK_PERIOD_MS = 1000;  // ms between handleOTA() runs when scheduled (delay before an update is verified)
+const char* OTA_USERNAME = "";   // login for /update, /ota/sha256 & /ota/patch, empty = none
+const char* OTA_PASSWORD = "";
+
+// Pages served from flash, no String is built per request
+const char NOT_FOUND_PAGE[] PROGMEM = "404 - Page Not Found, oops!";
+const char INDEX_PAGE[] PROGMEM =
+    "Hi! I am %HOST%, and look! No wires!!.\n"
+    "Up for %UPTIME% s.\n\n"
+    "Browse to http://%IP%/update to update my firmware.";
+
+
+// Fill in the landing page fields
+bool indexPageFields(const char* name, char* out, size_t outSize) {
+    if (strcmp(name, "IP") == 0) {
+        IPAddress ip = (WiFi.getMode() == WIFI_AP) ? WiFi.softAPIP() : WiFi.localIP();
+        snprintf(out, outSize, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    } else if (strcmp(name, "HOST") == 0) {
+#ifdef ESP32
+        snprintf(out, outSize, "%s", WiFi.getHostname());
+#elif defined(ESP8266)
+        snprintf(out, outSize, "%s", wifi_station_get_hostname());
+#endif
+    } else if (strcmp(name, "UPTIME") == 0) {
+        snprintf(out, outSize, "%lu", millis() / 1000);
+    } else {
+        return false;
+    }
+    return true;
+}
+
 
 // Function to initialize Serial monitor, Wi-Fi, Built-In LED, server, and OTA
 void setupOTA() {
+    PROFILE_SCOPE("setupOTA");
+
+    // Turn requests away before they run the heap out: heap floor, OTA priority, in-flight & per-IP limits (see ESPAdmission.h)
+    setupAdmission(server);
+
     // Handle unknown requests
     server.onNotFound([](AsyncWebServerRequest *request){
-        request->send(404, "text/plain", "404 - Page Not Found, oops!");
+        request->send_P(404, "text/plain", NOT_FOUND_PAGE);
     });
 
     // Default landing page
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-        String message = "Hi! I am ESP8266, and look! No wires!!.\n\n";
-        message += "Browse to http://[assigned.esp.ip.address]/update to update my firmware.";
+    server.on("/", HTTP_GET, timedRoute("/", [](AsyncWebServerRequest *request){
+        sendTemplate(request, "text/plain", INDEX_PAGE, indexPageFields);
+    }));
 
-        request->send(200, "text/plain", message);
-    });
+    // Heap, loop latency, Wi-Fi & upload metrics for Prometheus (see ESPMetrics.h)
+    setupMetricsEndpoint(server);
+
+#if HELPER_STATUS_PUSH
+    // Connectivity, stations & OTA progress pushed as they change, instead of polling (see ESPStatusPush.h)
+    setupStatusPush(server);
+#endif
+
+#if WIFI_HELPER_LINK_QUALITY
+    // RSSI, channel, PHY mode & TX power history of the STA link (see ESPLinkQuality.h)
+    setupLinkEndpoint(server);
+#endif
+
+#if WIFI_HELPER_PORTAL
+    // Wi-Fi setup page & redirects while the captive portal runs (ESPWiFiHelper.h WIFI_MODE_AP_STA)
+    setupCaptivePortal(server);
+#endif
+
+    // Files from the LittleFS image (see gzip_assets.py)
+    setupStaticAssets(server);
 
     // Setup the server
-    ElegantOTA.begin(&server);
+#if OTA_HELPER_VERIFY
+    setOTAAuth(OTA_USERNAME, OTA_PASSWORD);
+    setupOTAVerify(server);   // before ElegantOTA.begin(), it looks at /ota/start first
+#endif
+    ElegantOTA.begin(&server, OTA_USERNAME, OTA_PASSWORD);
+#if OTA_HELPER_PATCH
+    setupOTAPatch(server);
+#endif
     server.begin();
     delay(500);
-    Serial.println("\nHTTP server started");
-    Serial.println("Open: http://[assigned.esp.ip.address]/update in a browser to update firmware");
+    LOG_I("\nHTTP server started\n");
+    LOG_I("Open: http://[assigned.esp.ip.address]/update in a browser to update firmware\n");
+}
+
+// Verify a finished update & reboot into it
+void handleOTA() {
+    PROFILE_SCOPE("handleOTA");
+    ElegantOTA.loop();
+#if OTA_HELPER_VERIFY
+    handleOTAVerify();
+#endif
+}
+
+// Register the update check & the status push with the scheduler, call in setup() after setupOTA()
+void scheduleOTA() {
+    Scheduler::add("ota", handleOTA, OTA_TASK_PERIOD_MS);
+#if HELPER_STATUS_PUSH
+    Scheduler::add("push", handleStatusPush, PUSH_PERIOD_MS);   // its own period, not handleOTA()'s
+#endif
 }
 
 #endif
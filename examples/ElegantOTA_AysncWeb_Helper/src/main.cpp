@@ -8,10 +8,12 @@ To incorpurate this in any other sketch:
 
  - In Setup():
   > call setupWiFi() to setup Wi-Fi in either SoftAP or STA mode,
-  > call setupOTA() to setup ElegantOTA & AsyncWebServer.
+  > call setupOTA() to setup ElegantOTA & AsyncWebServer,
+  > call scheduleWiFi() & scheduleOTA() to register the helpers' periodic work with the scheduler:
+    the STA connection (connects, retries & reconnects, posts the LED pattern played from a timer)
+    & the ElegantOTA reboot check after updates.
  - In Loop():
-  > call the handleBuiltInLED() function if WiFi is configured for STA mode (indicates internet access),
-  > call the ElegantOTA.loop() function in the loop() function to allow for reboots after updates.
+  > call Scheduler::run() to run the registered work when it is due (waits in between instead of spinning).
 
 To upload a new sketch (firmware) via WiFi:
  - build the sketch and find the firmware.bin file in the .pio/build/nodemcuv2 or /esp32dev folder,
@@ -40,11 +42,17 @@ void setup() {
   setupWiFi();    // set up Wi-Fi
   setupOTA();     // setup ElegantOTA & AsyncWebServer
 
+  scheduleWiFi(); // run the Wi-Fi connection work from the scheduler
+  scheduleOTA();  // run the ElegantOTA reboot check from the scheduler
+  if (HELPER_PROFILE) {
+    Scheduler::add("profile", printProfile, 60000);   // print the helpers' timings & stalls every minute (ESPProfiler.h)
+  }
+
   Serial.println("\nSetup completed.\n");
 }
 
 
 void loop() {
-  handleBuiltInLED();   // handles LED blinking in STA mode if connected with no internet
-  ElegantOTA.loop();    // handles rebooting after OTA update
+  profileLoop();        // times each pass when built with -DHELPER_PROFILE=1 (env nodemcuv2_profile)
+  Scheduler::run();     // runs the helpers' due tasks, then idles until the next one
 }
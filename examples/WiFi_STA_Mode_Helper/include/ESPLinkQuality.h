@@ -0,0 +1,407 @@
+/****************************************************************************************
+* ESP Link Quality
+* This helper file keeps a history of the STA link & turns the transmit power down to what
+* the link needs:
+* 1. While connected, handleLinkQuality() reads the RSSI every LINK_READING_MS & averages
+*    the readings of LINK_SAMPLE_MS into one sample. Samples go into a fixed byte ring
+*    (LINK_HISTORY_BYTES), delta encoded:
+*    - 0ddddddd                  1 byte, RSSI moved by d (-64..63 dB), nothing else changed,
+*    - 0x80 rssi channel phy|tx  4 bytes, a full sample: the first, when the channel, PHY
+*                                mode or TX power changed, & every LINK_KEY_INTERVAL samples,
+*    - 0x81 reason               2 bytes, the STA was disconnected (ESPWiFiEvents.h reason).
+*    ~200 samples (half an hour at 10 s) fit in 256 bytes. The oldest records make room,
+*    the reader starts at the first full sample it finds,
+* 2. adaptLink() decides the TX power from the history: with the AP assumed to transmit at
+*    full power, our signal reaches it about as strong as its reaches us, less the dB we
+*    turned down. Below LINK_MIN_MARGIN over LINK_RSSI_FLOOR it steps straight back up,
+*    after LINK_HOLD_SAMPLES steady samples with LINK_TARGET_MARGIN to spare one step down.
+*    A disconnect goes back to full power,
+* 3. The PHY mode (linkAdaptPhy, off by default) only changes at a disconnect, so it never
+*    forces a reassociation: a weak link drops a step (11n > 11g > 11b, slower but more
+*    robust), a strong one goes back up a step.
+*
+* Less TX power saves current on every packet & interferes less with the neighbours on the
+* same channel in dense deployments.
+*
+* API: readLinkSamples(samples, max) copies out the newest samples, linkPolicy holds the
+* current TX step & PHY mode. With ESPAsyncWebServer, GET /link returns the history as JSON
+* (ElegantOTAHelper.h registers it).
+*
+* This file is used by the STA helpers: setupWiFi() calls setupLinkQuality(), handleWiFi()
+* calls handleLinkQuality() while connected.
+****************************************************************************************/
+
+#ifndef ESPLinkQuality_h
+#define ESPLinkQuality_h
+
+#ifdef ESP32    // for ESP32 boards
+#include <WiFi.h>
+#include <esp_wifi.h>
+
+#elif defined(ESP8266)    // for ESP8266 boards
+#include <ESP8266WiFi.h>
+#endif
+
+#include "ESPLog.h"          // TX power & PHY changes
+#include "ESPWiFiEvents.h"   // disconnect reasons
+
+#if __has_include(<ESPAsyncWebServer.h>)
+#include <ESPAsyncWebServer.h>
+#define LINK_HTTP 1          // GET /link
+#else
+#define LINK_HTTP 0
+#endif
+
+#define LINK_HISTORY_BYTES 256   // history ring, a power of 2
+#define LINK_KEY_INTERVAL  32    // samples between full samples
+#define LINK_TX_STEPS      6     // TX power steps in LINK_TX_DBM10
+
+// Link settings
+bool linkAdaptTxPower = true;   // lowest TX power that keeps the link = true | full power = false
+bool linkAdaptPhy = false;      // step the PHY mode down/up at disconnects = true | keep 11n = false
+
+const unsigned long LINK_SAMPLE_MS = 10000;   // ms per sample, the RSSI readings in it are averaged
+const unsigned long LINK_READING_MS = 1000;   // ms between RSSI readings, however often handleWiFi() runs
+const int8_t LINK_RSSI_FLOOR = -75;           // dBm our signal should reach the AP with, at least
+const int8_t LINK_MIN_MARGIN = 4;             // dB over the floor below which the power goes up at once
+const int8_t LINK_TARGET_MARGIN = 10;         // dB over the floor kept after stepping the power down
+const uint8_t LINK_HOLD_SAMPLES = 6;          // steady samples before the next step down (1 min)
+const int8_t LINK_PHY_UP_MARGIN = 15;         // dB over the floor at a disconnect to step the PHY mode up
+
+// TX power per step in 0.1 dBm, step 0 = full power
+const int16_t LINK_TX_DBM10[LINK_TX_STEPS] = { 195, 170, 150, 130, 110, 85 };
+#ifdef ESP32
+const wifi_power_t LINK_TX_POWER[LINK_TX_STEPS] = {
+  WIFI_POWER_19_5dBm, WIFI_POWER_17dBm, WIFI_POWER_15dBm, WIFI_POWER_13dBm, WIFI_POWER_11dBm, WIFI_POWER_8_5dBm
+};
+#endif
+
+// PHY modes, the ESP8266 WIFI_PHY_MODE_* values
+#define LINK_PHY_B 1
+#define LINK_PHY_G 2
+#define LINK_PHY_N 3
+
+// Record tags in the history
+#define LINK_RECORD_KEY        0x80
+#define LINK_RECORD_DISCONNECT 0x81
+
+// One decoded sample
+struct LinkSample {
+  int8_t rssi;      // dBm, average over the sample
+  uint8_t channel;
+  uint8_t phy;      // LINK_PHY_*
+  uint8_t txStep;   // index into LINK_TX_DBM10
+  uint8_t reason;   // reason code of a disconnect since the sample before, 0 if none
+};
+
+// TX power & PHY mode decisions
+struct LinkPolicy {
+  uint8_t txStep;          // index into LINK_TX_DBM10, 0 = full power
+  uint8_t phy;             // LINK_PHY_*
+  uint8_t steadySamples;   // samples since the last change or disconnect
+};
+
+// Read position in a copy of the history
+struct LinkCursor {
+  uint32_t pos;            // next record, free-running like linkHistoryHead
+  uint32_t end;
+  bool keyed;              // a full sample was read, deltas can be decoded
+  LinkSample sample;       // last decoded sample
+};
+
+uint8_t linkHistory[LINK_HISTORY_BYTES];
+uint32_t linkHistoryHead = 0;     // free-running write index
+uint32_t linkHistoryTail = 0;     // first byte of the oldest record
+LinkPolicy linkPolicy = { 0, LINK_PHY_N, 0 };
+LinkSample linkLastSample = {};   // last sample written
+uint8_t linkSinceKey = LINK_KEY_INTERVAL;   // samples since the last full one
+
+long linkRSSISum = 0;             // readings of the current sample
+int linkRSSICount = 0;
+unsigned long linkSampleStartMS = 0;
+unsigned long linkReadingMS = 0;
+
+#ifdef ESP32
+portMUX_TYPE linkMux = portMUX_INITIALIZER_UNLOCKED;   // GET /link copies the ring on the async_tcp task
+#define LINK_LOCK()   portENTER_CRITICAL(&linkMux)
+#define LINK_UNLOCK() portEXIT_CRITICAL(&linkMux)
+#elif defined(ESP8266)
+#define LINK_LOCK()                // web requests run between loop() calls
+#define LINK_UNLOCK()
+#endif
+
+
+/**************************** History ****************************/
+
+// Bytes of the record starting with `tag`
+int linkRecordLength(uint8_t tag) {
+  return tag == LINK_RECORD_KEY ? 4 : tag == LINK_RECORD_DISCONNECT ? 2 : 1;
+}
+
+// Append one record, dropping the oldest ones to make room
+void appendLinkRecord(const uint8_t* record, int length) {
+  LINK_LOCK();
+  while (linkHistoryHead - linkHistoryTail + length > LINK_HISTORY_BYTES) {
+    linkHistoryTail += linkRecordLength(linkHistory[linkHistoryTail & (LINK_HISTORY_BYTES - 1)]);
+  }
+  for (int i = 0; i < length; i++) {
+    linkHistory[(linkHistoryHead + i) & (LINK_HISTORY_BYTES - 1)] = record[i];
+  }
+  linkHistoryHead += length;
+  LINK_UNLOCK();
+}
+
+// Encode a sample as a 1 byte delta when it can be, as a full sample otherwise
+void recordLinkSample(const LinkSample& sample) {
+  int delta = sample.rssi - linkLastSample.rssi;
+  if (linkSinceKey < LINK_KEY_INTERVAL && delta >= -64 && delta <= 63 && sample.channel == linkLastSample.channel &&
+      sample.phy == linkLastSample.phy && sample.txStep == linkLastSample.txStep) {
+    uint8_t record = delta & 0x7F;
+    appendLinkRecord(&record, 1);
+    linkSinceKey++;
+  } else {
+    uint8_t record[4] = { LINK_RECORD_KEY, (uint8_t)sample.rssi, sample.channel, (uint8_t)(sample.phy << 4 | sample.txStep) };
+    appendLinkRecord(record, 4);
+    linkSinceKey = 1;
+  }
+  linkLastSample = sample;
+}
+
+void recordLinkDisconnect(uint8_t reason) {
+  uint8_t record[2] = { LINK_RECORD_DISCONNECT, reason };
+  appendLinkRecord(record, 2);
+}
+
+// Decode the next sample of `ring` (a copy of linkHistory) into cursor.sample, false at the end
+bool nextLinkSample(const uint8_t* ring, LinkCursor& cursor) {
+  uint8_t reason = 0;
+  while (cursor.pos != cursor.end) {
+    uint8_t tag = ring[cursor.pos & (LINK_HISTORY_BYTES - 1)];
+    const uint8_t* at = ring;
+    uint32_t pos = cursor.pos;
+    cursor.pos += linkRecordLength(tag);
+    if (tag == LINK_RECORD_DISCONNECT) {
+      reason = at[(pos + 1) & (LINK_HISTORY_BYTES - 1)];
+    } else if (tag == LINK_RECORD_KEY) {
+      uint8_t phyTx = at[(pos + 3) & (LINK_HISTORY_BYTES - 1)];
+      cursor.sample = { (int8_t)at[(pos + 1) & (LINK_HISTORY_BYTES - 1)], at[(pos + 2) & (LINK_HISTORY_BYTES - 1)],
+                        (uint8_t)(phyTx >> 4), (uint8_t)(phyTx & 0x0F), reason };
+      cursor.keyed = true;
+      return true;
+    } else if (cursor.keyed) {
+      int8_t delta = (int8_t)(tag << 1) >> 1;   // 7 bit two's complement
+      cursor.sample.rssi += delta;
+      cursor.sample.reason = reason;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Copy the history ring & its indices, for reading while the sampler goes on
+void copyLinkHistory(uint8_t* ring, LinkCursor& cursor) {
+  LINK_LOCK();
+  memcpy(ring, linkHistory, LINK_HISTORY_BYTES);
+  cursor = { linkHistoryTail, linkHistoryHead, false, {} };
+  LINK_UNLOCK();
+}
+
+// Copy the newest samples (up to `maxSamples`) into `samples`, oldest first. Returns how many.
+int readLinkSamples(LinkSample* samples, int maxSamples) {
+  uint8_t ring[LINK_HISTORY_BYTES];
+  LinkCursor cursor;
+  copyLinkHistory(ring, cursor);
+  LinkCursor counter = cursor;
+  int total = 0;
+  while (nextLinkSample(ring, counter)) {
+    total++;
+  }
+  int n = 0;
+  for (int i = 0; nextLinkSample(ring, cursor); i++) {
+    if (i >= total - maxSamples) {
+      samples[n++] = cursor.sample;
+    }
+  }
+  return n;
+}
+
+/*****************************************************************/
+
+
+// Decide the TX power (& at a disconnect the PHY mode) from the latest average RSSI. True if either changed.
+bool adaptLink(LinkPolicy& policy, int8_t rssi, bool disconnected) {
+  LinkPolicy before = policy;
+  if (disconnected) {
+    policy.txStep = 0;   // reconnect at full power
+    policy.steadySamples = 0;
+    if (linkAdaptPhy && rssi < LINK_RSSI_FLOOR && policy.phy > LINK_PHY_B) {
+      policy.phy--;
+    } else if (linkAdaptPhy && rssi >= LINK_RSSI_FLOOR + LINK_PHY_UP_MARGIN && policy.phy < LINK_PHY_N) {
+      policy.phy++;
+    }
+    return policy.txStep != before.txStep || policy.phy != before.phy;
+  }
+  if (!linkAdaptTxPower) {
+    policy.txStep = 0;
+    return policy.txStep != before.txStep;
+  }
+
+  // Estimated margin of our signal at the AP over the floor, at `step`
+  auto margin = [rssi](int step) { return rssi - LINK_RSSI_FLOOR - (LINK_TX_DBM10[0] - LINK_TX_DBM10[step]) / 10; };
+  if (margin(policy.txStep) < LINK_MIN_MARGIN) {
+    while (policy.txStep > 0 && margin(policy.txStep) < LINK_TARGET_MARGIN) {
+      policy.txStep--;   // straight back up, as far as needed
+    }
+  } else if (policy.steadySamples >= LINK_HOLD_SAMPLES && policy.txStep + 1 < LINK_TX_STEPS &&
+             margin(policy.txStep + 1) >= LINK_TARGET_MARGIN) {
+    policy.txStep++;     // one step down at a time
+  }
+
+  if (policy.txStep != before.txStep) {
+    policy.steadySamples = 0;
+  } else if (policy.steadySamples < 255) {
+    policy.steadySamples++;
+  }
+  return policy.txStep != before.txStep;
+}
+
+// Set the radio to the policy
+void applyLinkPolicy(const LinkPolicy& policy, bool phyChanged) {
+#ifdef ESP32
+  WiFi.setTxPower(LINK_TX_POWER[policy.txStep]);
+  if (phyChanged) {
+    uint8_t protocols[] = { 0, WIFI_PROTOCOL_11B, WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G,
+                            WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N };
+    esp_wifi_set_protocol(WIFI_IF_STA, protocols[policy.phy]);
+  }
+#elif defined(ESP8266)
+  WiFi.setOutputPower(LINK_TX_DBM10[policy.txStep] / 10.0f);
+  if (phyChanged) {
+    WiFi.setPhyMode((WiFiPhyMode_t)policy.phy);
+  }
+#endif
+  LOG_I("Link: TX power %d.%d dBm, PHY 11%c\n", LINK_TX_DBM10[policy.txStep] / 10, LINK_TX_DBM10[policy.txStep] % 10,
+        " bgn"[policy.phy]);
+}
+
+// Event bus subscriber: note the disconnect & go back to full power for the reconnect
+void onLinkDisconnected(const WiFiBusEvent& event) {
+  recordLinkDisconnect(event.value);
+  uint8_t phy = linkPolicy.phy;
+  int8_t rssi = linkRSSICount ? linkRSSISum / linkRSSICount : linkLastSample.rssi;
+  if (adaptLink(linkPolicy, rssi, true)) {
+    applyLinkPolicy(linkPolicy, linkPolicy.phy != phy);
+  }
+  linkRSSISum = 0;
+  linkRSSICount = 0;
+}
+
+// Subscribe to the disconnects, call in setupWiFi() after setupWiFiEvents() (the STA helpers do)
+void setupLinkQuality() {
+  static bool done = false;
+  if (done) {
+    return;
+  }
+  done = true;
+#ifdef ESP8266
+  linkPolicy.phy = WiFi.getPhyMode();
+#endif
+  subscribeWiFiEvents(onLinkDisconnected, WIFI_EVENT_BUS_MASK(WIFI_EVENT_BUS_DISCONNECTED));
+}
+
+// Take an RSSI reading & close the sample every LINK_SAMPLE_MS, call while connected (handleWiFi() does)
+void handleLinkQuality(unsigned long currentMS) {
+  if (linkRSSICount > 0 && currentMS - linkReadingMS < LINK_READING_MS) {
+    return;
+  }
+  linkReadingMS = currentMS;
+  if (linkRSSICount == 0) {
+    linkSampleStartMS = currentMS;
+  }
+  linkRSSISum += WiFi.RSSI();
+  linkRSSICount++;
+  if (currentMS - linkSampleStartMS < LINK_SAMPLE_MS) {
+    return;
+  }
+
+  LinkSample sample = { (int8_t)(linkRSSISum / linkRSSICount), (uint8_t)WiFi.channel(), linkPolicy.phy,
+                        linkPolicy.txStep, 0 };
+  linkRSSISum = 0;
+  linkRSSICount = 0;
+  recordLinkSample(sample);
+  if (adaptLink(linkPolicy, sample.rssi, false)) {
+    applyLinkPolicy(linkPolicy, false);
+  }
+}
+
+
+#if LINK_HTTP
+// Write position in the GET /link output, with its own copy of the history
+struct LinkPageCursor {
+  uint8_t ring[LINK_HISTORY_BYTES];
+  LinkCursor cursor;
+  int step;                 // 0 = header, 1 = samples, 2 = done
+  size_t lineLength;
+  size_t lineSent;
+  char line[48];
+};
+
+// Render the next line of the page, false once everything is written
+bool nextLinkLine(LinkPageCursor& page) {
+  int n = -1;
+  if (page.step == 0) {
+    n = snprintf(page.line, sizeof(page.line), "{\"sampleS\":%lu,\"samples\":[", LINK_SAMPLE_MS / 1000);
+    page.step = 1;
+  } else if (page.step == 1) {
+    bool first = !page.cursor.keyed;
+    if (nextLinkSample(page.ring, page.cursor)) {
+      const LinkSample& s = page.cursor.sample;
+      n = snprintf(page.line, sizeof(page.line), "%s\n[%d,%u,\"%c\",%d.%d,%u]", first ? "" : ",", s.rssi, s.channel,
+                   " bgn"[s.phy & 3], LINK_TX_DBM10[s.txStep % LINK_TX_STEPS] / 10, LINK_TX_DBM10[s.txStep % LINK_TX_STEPS] % 10,
+                   s.reason);
+    } else {
+      n = snprintf(page.line, sizeof(page.line), "]}\n");
+      page.step = 2;
+    }
+  }
+  if (n < 0) {
+    return false;
+  }
+  page.lineLength = (size_t)n < sizeof(page.line) ? n : sizeof(page.line) - 1;
+  page.lineSent = 0;
+  return true;
+}
+
+// Write up to `maxLen` bytes of the page, continuing from the cursor. Returns 0 when done.
+size_t fillLinkPage(LinkPageCursor& page, uint8_t* out, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (page.lineSent == page.lineLength && !nextLinkLine(page)) {
+      break;
+    }
+    size_t n = page.lineLength - page.lineSent;
+    if (n > maxLen - written) {
+      n = maxLen - written;
+    }
+    memcpy(out + written, page.line + page.lineSent, n);
+    page.lineSent += n;
+    written += n;
+  }
+  return written;
+}
+
+// GET /link: the history as JSON, [rssi, channel, phy, tx dBm, disconnect reason] per sample, oldest first
+void setupLinkEndpoint(AsyncWebServer& webServer) {
+  webServer.on("/link", HTTP_GET, [](AsyncWebServerRequest *request) {
+    LinkPageCursor page = {};   // lives in the response's filler until the page is sent
+    copyLinkHistory(page.ring, page.cursor);
+    AsyncWebServerResponse* response = request->beginChunkedResponse("application/json",
+      [page](uint8_t* buffer, size_t maxLen, size_t index) mutable -> size_t {
+        return fillLinkPage(page, buffer, maxLen);
+      });
+    request->send(response);
+  });
+}
+#endif
+
+#endif
@@ -0,0 +1,341 @@
+/****************************************************************************************
+* ESP Metrics
+* This helper file keeps a fixed registry of runtime metrics & serves them on /metrics in
+* the Prometheus text format:
+* 1. Counters & gauges point at a value the module already keeps, or read it through a
+*    callback when scraped - registering costs one slot, updating costs nothing extra,
+* 2. Histograms have fixed buckets (HISTOGRAM_BUCKETS) & are updated with observe(), a
+*    few compares & increments, no allocation,
+* 3. The page is written line by line from a small cursor straight into the chunked
+*    response buffer, so its size does not depend on the number of metrics.
+*
+* Built in: free heap, largest free block, fragmentation, uptime, scheduler load & a
+* histogram of the time each Scheduler::run() pass spends in tasks. The Wi-Fi helpers add
+* RSSI, connection & reconnect counts and the reachability RTT/loss, ESPOTAVerify.h the
+* last upload, ElegantOTAHelper.h the request count & handler time of its routes.
+*
+* To use this helper:
+* - The helpers call setupMetrics() & register their metrics themselves,
+* - Add your own with registerCounter() / registerGauge() / registerHistogram(), metrics
+*   sharing a name are one family (labels tell them apart),
+* - Wrap a server.on() handler in timedRoute("/path", handler) to count & time it,
+* - ElegantOTAHelper.h serves /metrics, or call setupMetricsEndpoint(server) yourself.
+*
+* Values are read while the page is sent, a scrape may mix updates from before & after.
+****************************************************************************************/
+
+#ifndef ESPMetrics_h
+#define ESPMetrics_h
+
+#include <Arduino.h>
+#include "ESPScheduler.h"   // loop latency from the scheduler passes
+#include "ESPLog.h"         // full table
+
+#if __has_include(<ESPAsyncWebServer.h>)
+#include <ESPAsyncWebServer.h>
+#define METRICS_HTTP 1      // /metrics endpoint & route timing
+#else
+#define METRICS_HTTP 0
+#endif
+
+#define METRICS_MAX        40    // registered metrics
+#define METRICS_MAX_ROUTES 6     // routes timed with timedRoute()
+#define METRICS_LINE_MAX   160   // longest output line
+#define HISTOGRAM_BUCKETS  8     // bounded buckets, plus one above the last bound
+
+// Bucket upper bounds for latencies, in us
+const uint32_t LATENCY_BOUNDS_US[HISTOGRAM_BUCKETS] = { 100, 500, 1000, 5000, 10000, 50000, 100000, 1000000 };
+
+// Fixed bucket histogram
+struct Histogram {
+  const uint32_t* bounds;                    // HISTOGRAM_BUCKETS upper bounds, ascending
+  uint32_t buckets[HISTOGRAM_BUCKETS + 1];   // count per bucket (not cumulative), last = above every bound
+  uint32_t count;                            // observations
+  uint64_t sum;                              // sum of the observed values
+};
+
+typedef int32_t (*MetricRead)(int arg);
+
+enum MetricType : uint8_t {
+  METRIC_COUNTER,
+  METRIC_GAUGE,
+  METRIC_HISTOGRAM
+};
+
+// One registered metric
+struct Metric {
+  const char* name;             // family name
+  const char* help;             // HELP text, the first one of a family is used
+  const char* labels;           // e.g. `target="dns"`, nullptr for none
+  MetricType type;
+  const uint32_t* source;       // counter/gauge value, or
+  MetricRead read;              // callback returning it, with `arg`
+  int arg;
+  const Histogram* histogram;   // METRIC_HISTOGRAM
+};
+
+// Write position in the /metrics output
+struct MetricsCursor {
+  int metric;                   // metric being written, in output order
+  int step;                     // line within it (HELP, TYPE, samples)
+  size_t lineLength;            // bytes in `line`
+  size_t lineSent;              // bytes of `line` already sent
+  char line[METRICS_LINE_MAX];
+};
+
+Metric metrics[METRICS_MAX];
+int metricCount = 0;
+
+Histogram loopHistogram = { LATENCY_BOUNDS_US };   // busy time per Scheduler::run() pass
+
+
+// Add one observation
+void observe(Histogram& histogram, uint32_t value) {
+  int i = 0;
+  while (i < HISTOGRAM_BUCKETS && value > histogram.bounds[i]) {
+    i++;
+  }
+  histogram.buckets[i]++;
+  histogram.count++;
+  histogram.sum += value;
+}
+
+bool addMetric(const Metric& metric) {
+  if (metricCount >= METRICS_MAX) {
+    LOG_E("Metrics full! Could not add %s, raise METRICS_MAX.\n", metric.name);
+    return false;
+  }
+  metrics[metricCount++] = metric;
+  return true;
+}
+
+// Counter kept by the caller at `source` (only ever goes up)
+bool registerCounter(const char* name, const char* help, const char* labels, const uint32_t* source) {
+  return addMetric({ name, help, labels, METRIC_COUNTER, source, nullptr, 0, nullptr });
+}
+
+// Gauge read with read(arg) when scraped
+bool registerGauge(const char* name, const char* help, const char* labels, MetricRead read, int arg = 0) {
+  return addMetric({ name, help, labels, METRIC_GAUGE, nullptr, read, arg, nullptr });
+}
+
+bool registerHistogram(const char* name, const char* help, const char* labels, const Histogram* histogram) {
+  return addMetric({ name, help, labels, METRIC_HISTOGRAM, nullptr, nullptr, 0, histogram });
+}
+
+
+/************************** Rendering **************************/
+
+// First metric registered with the name of metric `i`
+int familyLeader(int i) {
+  for (int j = 0; j < i; j++) {
+    if (strcmp(metrics[j].name, metrics[i].name) == 0) {
+      return j;
+    }
+  }
+  return i;
+}
+
+// Metric written after `i`: the rest of its family, then the next family (a family is one block)
+int nextMetricInOrder(int i) {
+  for (int j = i + 1; j < metricCount; j++) {
+    if (strcmp(metrics[j].name, metrics[i].name) == 0) {
+      return j;
+    }
+  }
+  for (int j = familyLeader(i) + 1; j < metricCount; j++) {
+    if (familyLeader(j) == j) {
+      return j;
+    }
+  }
+  return metricCount;
+}
+
+// `name{labels,extra}`, with the braces only if there are labels. Returns the length written,
+// at most size - 1, so the value can be appended at out + n.
+int formatSeries(char* out, size_t size, const char* name, const char* suffix, const char* labels, const char* extra) {
+  bool hasLabels = labels && labels[0];
+  int n;
+  if (!hasLabels && !extra) {
+    n = snprintf(out, size, "%s%s", name, suffix);
+  } else {
+    n = snprintf(out, size, "%s%s{%s%s%s}", name, suffix, hasLabels ? labels : "",
+                 hasLabels && extra ? "," : "", extra ? extra : "");
+  }
+  return (size_t)n < size ? n : size - 1;
+}
+
+// Sample line `sample` of a histogram: the buckets, +Inf, _sum & _count. -1 past the end.
+int formatHistogramLine(const Metric& metric, int sample, char* out, size_t size) {
+  const Histogram& histogram = *metric.histogram;
+  char le[24];
+  int n;
+  if (sample <= HISTOGRAM_BUCKETS) {
+    uint32_t cumulative = 0;
+    for (int i = 0; i <= sample; i++) {
+      cumulative += histogram.buckets[i];
+    }
+    if (sample < HISTOGRAM_BUCKETS) {
+      snprintf(le, sizeof(le), "le=\"%lu\"", (unsigned long)histogram.bounds[sample]);
+    } else {
+      snprintf(le, sizeof(le), "le=\"+Inf\"");
+    }
+    n = formatSeries(out, size, metric.name, "_bucket", metric.labels, le);
+    n += snprintf(out + n, size - n, " %lu\n", (unsigned long)cumulative);
+  } else if (sample == HISTOGRAM_BUCKETS + 1) {
+    n = formatSeries(out, size, metric.name, "_sum", metric.labels, nullptr);
+    n += snprintf(out + n, size - n, " %llu\n", (unsigned long long)histogram.sum);
+  } else if (sample == HISTOGRAM_BUCKETS + 2) {
+    n = formatSeries(out, size, metric.name, "_count", metric.labels, nullptr);
+    n += snprintf(out + n, size - n, " %lu\n", (unsigned long)histogram.count);
+  } else {
+    return -1;
+  }
+  return n;
+}
+
+// Render the next output line into the cursor, false once everything is written
+bool nextMetricsLine(MetricsCursor& cursor) {
+  const char* typeNames[] = { "counter", "gauge", "histogram" };
+  while (cursor.metric < metricCount) {
+    const Metric& metric = metrics[cursor.metric];
+    int step = cursor.step++;
+    if (familyLeader(cursor.metric) != cursor.metric) {
+      step += 2;   // HELP & TYPE only once per family
+    }
+
+    int n = -1;
+    if (step == 0) {
+      n = snprintf(cursor.line, sizeof(cursor.line), "# HELP %s %s\n", metric.name, metric.help);
+    } else if (step == 1) {
+      n = snprintf(cursor.line, sizeof(cursor.line), "# TYPE %s %s\n", metric.name, typeNames[metric.type]);
+    } else if (metric.type == METRIC_HISTOGRAM) {
+      n = formatHistogramLine(metric, step - 2, cursor.line, sizeof(cursor.line));
+    } else if (step == 2) {
+      n = formatSeries(cursor.line, sizeof(cursor.line), metric.name, "", metric.labels, nullptr);
+      if (metric.source) {
+        n += snprintf(cursor.line + n, sizeof(cursor.line) - n, " %lu\n", (unsigned long)*metric.source);
+      } else {
+        n += snprintf(cursor.line + n, sizeof(cursor.line) - n, " %ld\n", (long)metric.read(metric.arg));
+      }
+    }
+
+    if (n >= 0) {
+      if ((size_t)n >= sizeof(cursor.line)) {
+        n = sizeof(cursor.line) - 1;
+        cursor.line[n - 1] = '\n';   // cut, but still ends the line
+      }
+      cursor.lineLength = n;
+      cursor.lineSent = 0;
+      return true;
+    }
+    cursor.metric = nextMetricInOrder(cursor.metric);
+    cursor.step = 0;
+  }
+  return false;
+}
+
+// Write up to `maxLen` bytes of the output to `out`, continuing from the cursor. Returns 0 when done.
+size_t fillMetrics(MetricsCursor& cursor, uint8_t* out, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (cursor.lineSent == cursor.lineLength && !nextMetricsLine(cursor)) {
+      break;
+    }
+    size_t n = cursor.lineLength - cursor.lineSent;
+    if (n > maxLen - written) {
+      n = maxLen - written;
+    }
+    memcpy(out + written, cursor.line + cursor.lineSent, n);
+    cursor.lineSent += n;
+    written += n;
+  }
+  return written;
+}
+
+/***************************************************************/
+
+
+// Built in gauges
+int32_t readSystemMetric(int arg) {
+  uint32_t freeHeap = ESP.getFreeHeap();
+#ifdef ESP32
+  uint32_t maxBlock = ESP.getMaxAllocHeap();
+#elif defined(ESP8266)
+  uint32_t maxBlock = ESP.getMaxFreeBlockSize();
+#endif
+  switch (arg) {
+    case 0: return freeHeap;
+    case 1: return maxBlock;
+    case 2: return freeHeap ? 100 - (int32_t)((uint64_t)maxBlock * 100 / freeHeap) : 0;   // % of free heap not in the largest block
+    case 3: return millis() / 1000;
+    default: return (int32_t)(Scheduler::activePercent() * 10);
+  }
+}
+
+void observeLoopPass(unsigned long busyUS) {
+  observe(loopHistogram, busyUS);
+}
+
+// Register the built in metrics, safe to call more than once (the helpers each call it)
+void setupMetrics() {
+  static bool done = false;
+  if (done) {
+    return;
+  }
+  done = true;
+  registerGauge("esp_heap_free_bytes", "Free heap", nullptr, readSystemMetric, 0);
+  registerGauge("esp_heap_max_block_bytes", "Largest free heap block", nullptr, readSystemMetric, 1);
+  registerGauge("esp_heap_fragmentation_percent", "Free heap outside the largest block", nullptr, readSystemMetric, 2);
+  registerGauge("esp_uptime_seconds", "Time since boot", nullptr, readSystemMetric, 3);
+  registerGauge("esp_scheduler_active_permille", "Share of time spent in scheduler tasks", nullptr, readSystemMetric, 4);
+  registerHistogram("esp_loop_busy_us", "Time each Scheduler::run() pass spent in tasks", nullptr, &loopHistogram);
+  Scheduler::passObserver = observeLoopPass;
+}
+
+
+#if METRICS_HTTP
+// Request counts & handler times of the routes wrapped with timedRoute()
+uint32_t routeRequests[METRICS_MAX_ROUTES];
+Histogram routeLatency[METRICS_MAX_ROUTES];
+char routeLabels[METRICS_MAX_ROUTES][40];
+int routeCount = 0;
+
+// Wrap `handler` so each request to `route` is counted & its handler time observed
+ArRequestHandlerFunction timedRoute(const char* route, ArRequestHandlerFunction handler) {
+  if (routeCount >= METRICS_MAX_ROUTES) {
+    return handler;
+  }
+  setupMetrics();
+  int id = routeCount++;
+  routeLatency[id].bounds = LATENCY_BOUNDS_US;
+  snprintf(routeLabels[id], sizeof(routeLabels[id]), "route=\"%s\"", route);
+  registerCounter("http_requests_total", "Requests per route", routeLabels[id], &routeRequests[id]);
+  registerHistogram("http_handler_us", "Handler time per route", routeLabels[id], &routeLatency[id]);
+
+  return [id, handler](AsyncWebServerRequest *request) {
+    unsigned long startUS = micros();
+    handler(request);
+    routeRequests[id]++;
+    observe(routeLatency[id], micros() - startUS);
+  };
+}
+
+// Send the metrics page, rendered into the response buffer as it goes out
+void sendMetrics(AsyncWebServerRequest *request) {
+  MetricsCursor cursor = {};   // lives in the response's filler until the page is sent
+  AsyncWebServerResponse* response = request->beginChunkedResponse("text/plain; version=0.0.4",
+    [cursor](uint8_t* buffer, size_t maxLen, size_t index) mutable -> size_t {
+      return fillMetrics(cursor, buffer, maxLen);
+    });
+  request->send(response);
+}
+
+// Register GET /metrics, call in setupOTA() (ElegantOTAHelper.h does)
+void setupMetricsEndpoint(AsyncWebServer& webServer) {
+  setupMetrics();
+  webServer.on("/metrics", HTTP_GET, timedRoute("/metrics", sendMetrics));
+}
+#endif
+
+#endif
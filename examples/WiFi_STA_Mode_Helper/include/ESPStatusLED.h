@@ -0,0 +1,143 @@
+/****************************************************************************************
+* ESP Status LED
+* This helper file plays LED patterns from a timer (Ticker), so a slow loop() cannot
+* stretch or stop a blink:
+* 1. A pattern is a small descriptor: a step length & up to 32 steps, one bit per step
+*    (LED on when set), repeated. Or a breathing ramp up & down over its steps, with
+*    PWM (analogWrite) & a squared curve so it looks even to the eye,
+* 2. Built in: LED_OFF, LED_ON, LED_FAST_BLINK (connecting), LED_SLOW_BLINK (no internet),
+*    LED_BREATHE (setup portal open) & ledErrorCode(n): n short pulses, then a pause,
+* 3. setLEDPattern() is all loop() does, it returns straight away when the pattern does
+*    not change, so the helpers post theirs on every pass. A new pattern starts at its
+*    first step, solid on & off need no timer at all.
+*
+* The Ticker callback runs in the SDK timer context (ESP8266) or the esp_timer task (ESP32),
+* not in loop(). Steps shorter than ~10 ms are not worth it, the LED is for people.
+*
+* This file is used by the Wi-Fi helpers: setupWiFi() calls setupStatusLED(), handleWiFi()
+* posts the pattern of the connection state. With -DHELPER_STATUS_LED=0 (ESPWiFiHelper.h
+* defaults it to WIFI_HELPER_STA) there is no Ticker & no PWM, both calls do nothing & the
+* LED pin is left alone.
+****************************************************************************************/
+
+#ifndef ESPStatusLED_h
+#define ESPStatusLED_h
+
+#include <Arduino.h>
+
+#ifndef HELPER_STATUS_LED
+#define HELPER_STATUS_LED 1   // LED patterns on = 1, set with -D in build_flags
+#endif
+
+#if HELPER_STATUS_LED
+#include <Ticker.h>
+#endif
+
+#define STATUS_LED_PIN        LED_BUILTIN
+#define STATUS_LED_ACTIVE_LOW true     // NodeMCU & most ESP32 boards light the LED on LOW
+#define STATUS_LED_MAX_LEVEL  255      // PWM range used for the LED (analogWriteRange() on ESP8266)
+
+// A repeating LED pattern
+struct LEDPattern {
+  uint16_t stepMS;   // length of one step
+  uint8_t steps;     // steps before it repeats, 1..32
+  bool breathe;      // ramp up & down over `steps` instead of following `bits`
+  uint32_t bits;     // LED on in step i when bit i is set
+};
+
+const LEDPattern LED_OFF        = { 0, 1, false, 0 };
+const LEDPattern LED_ON         = { 0, 1, false, 1 };
+const LEDPattern LED_FAST_BLINK = { 250, 2, false, 0b01 };    // 2 Hz
+const LEDPattern LED_SLOW_BLINK = { 1000, 2, false, 0b01 };   // 0.5 Hz
+const LEDPattern LED_BREATHE    = { 40, 50, true, 0 };        // 2 s per breath
+
+const uint16_t LED_PULSE_MS = 200;   // step of ledErrorCode(): pulses 200 ms on & off
+const uint8_t LED_PAUSE_STEPS = 8;   // off steps after the pulses, 1.6 s
+
+// Error codes shown with ledErrorCode()
+#define LED_ERROR_CONNECT 2   // gave up connecting (MAX_CONNECT_ATTEMPTS)
+
+
+// `count` pulses (1..12), then a pause, repeated
+LEDPattern ledErrorCode(uint8_t count) {
+  count = count < 1 ? 1 : count > 12 ? 12 : count;
+  uint32_t bits = 0x55555555UL & ((1UL << (count * 2)) - 1);   // on, off, on, off...
+  return { LED_PULSE_MS, (uint8_t)(count * 2 + LED_PAUSE_STEPS), false, bits };
+}
+
+bool samePattern(const LEDPattern& a, const LEDPattern& b) {
+  return a.stepMS == b.stepMS && a.steps == b.steps && a.breathe == b.breathe && a.bits == b.bits;
+}
+
+#if HELPER_STATUS_LED
+LEDPattern ledPattern = LED_OFF;   // playing now
+uint8_t ledStep = 0;               // step shown last
+Ticker ledTicker;
+
+#ifdef ESP32
+portMUX_TYPE ledMux = portMUX_INITIALIZER_UNLOCKED;   // the Ticker runs on the esp_timer task
+#define LED_LOCK()   portENTER_CRITICAL(&ledMux)
+#define LED_UNLOCK() portEXIT_CRITICAL(&ledMux)
+#elif defined(ESP8266)
+#define LED_LOCK()                   // Ticker callbacks run between loop() calls
+#define LED_UNLOCK()
+#endif
+
+
+// Brightness of `pattern` at `step`, 0..STATUS_LED_MAX_LEVEL
+uint8_t ledLevel(const LEDPattern& pattern, uint8_t step) {
+  if (!pattern.breathe) {
+    return (pattern.bits >> step) & 1 ? STATUS_LED_MAX_LEVEL : 0;
+  }
+  uint32_t half = pattern.steps / 2;
+  uint32_t rise = step < half ? step : pattern.steps - step;   // 0..half..0
+  return rise * rise * STATUS_LED_MAX_LEVEL / (half * half);   // squared, the eye is not linear
+}
+
+void writeLED(uint8_t level) {
+  analogWrite(STATUS_LED_PIN, STATUS_LED_ACTIVE_LOW ? STATUS_LED_MAX_LEVEL - level : level);
+}
+
+// Ticker callback: show the next step
+void ledTick() {
+  LED_LOCK();
+  ledStep = ledStep + 1 < ledPattern.steps ? ledStep + 1 : 0;
+  uint8_t level = ledLevel(ledPattern, ledStep);
+  LED_UNLOCK();
+  writeLED(level);
+}
+
+// Play `pattern` from its first step, does nothing if it is already playing
+void setLEDPattern(const LEDPattern& pattern) {
+  if (samePattern(pattern, ledPattern)) {
+    return;
+  }
+  ledTicker.detach();
+  LED_LOCK();
+  ledPattern = pattern;
+  ledStep = 0;
+  LED_UNLOCK();
+  writeLED(ledLevel(pattern, 0));
+  if (pattern.steps > 1 && pattern.stepMS > 0) {
+    ledTicker.attach_ms(pattern.stepMS, ledTick);
+  }
+}
+
+// Set up the LED pin (off), call in setupWiFi() (the Wi-Fi helpers do)
+void setupStatusLED() {
+  pinMode(STATUS_LED_PIN, OUTPUT);
+#ifdef ESP8266
+  analogWriteRange(STATUS_LED_MAX_LEVEL);   // the core 3.x default, 1023 on 2.x
+#endif
+  ledTicker.detach();
+  ledPattern = LED_OFF;
+  ledStep = 0;
+  writeLED(0);
+}
+#else
+// Status LED left out: the helpers' calls compile to nothing
+inline void setLEDPattern(const LEDPattern& pattern) {}
+inline void setupStatusLED() {}
+#endif
+
+#endif
@@ -1,7 +1,9 @@
 /****************************************************************************************
 * This is a modified version of the ESP32/8266 WiFi Station Mode example project.
-* To implement this into a project, include the ESPWiFiSTAHelper.h file
-*  and call the setupWiFi() function.
+* To implement this into a project, include the ESPWiFiSTAHelper.h file,
+*  call the setupWiFi() & scheduleWiFi() functions in setup() and Scheduler::run() in loop().
+* setupWiFi() does not wait for the connection, the scheduled handleWiFi() finishes it in the
+*  background and retries with an increasing delay if the network can not be reached.
 *
 * The helper defaults to using DHCP for IP configuration.
 * If you need to use a static IP address:
@@ -9,10 +11,11 @@
 * - set USE_STATIC_IP to true,
 * - configure the IP space to your needs.
 * 
-* LED blink states:
+* LED blink states (played from a timer, ESPStatusLED.h):
 * - fast  > attempting to connect
 * - slow  > connected, no internet
 * - solid > connected, internet access
+* - 2 pulses & a pause > gave up connecting (MAX_CONNECT_ATTEMPTS)
 ****************************************************************************************/
 
 #include <Arduino.h>
@@ -24,11 +27,12 @@ void setup() {
   Serial.println("\nRunning setup functions.\n");
 
   setupWiFi();    // set up Wi-Fi
+  scheduleWiFi(); // run the connection work from the scheduler, it posts the LED patterns
 
   Serial.println("\nSetup completed.\n");
 }
 
 
 void loop() {
-  handleBuiltInLED();  // handle LED blinking based on internet access
+  Scheduler::run();    // connect/retry/reconnect, idles in between (the LED blinks from a timer)
 }
@@ -0,0 +1,244 @@
+/****************************************************************************************
+* ESP Status Push
+* This helper file pushes live status to dashboards over a WebSocket (/status) so they
+* do not have to poll a page every second:
+* 1. The helpers call setStatus(field, value) when something changes: Wi-Fi connected,
+*    internet, RSSI (3 dB steps), gateway RTT & internet loss, SoftAP stations, OTA state
+*    & bytes. It only stores the value & sets a bit, safe from the Wi-Fi event task,
+* 2. Every PUSH_PERIOD_MS handleStatusPush() sends each client one compact JSON delta
+*    with the fields that changed since its last message, e.g. {"connected":1,"rssi":-61}.
+*    A new client first gets every field,
+* 3. Coalescing is bounded per client: a client that cannot take a message keeps one bit
+*    per field (its latest value is sent later), never a backlog of messages. A message is
+*    only queued when the client's TCP send buffer has room for it, so each client holds
+*    at most one message of PUSH_MESSAGE_MAX bytes beyond what lwIP already buffers,
+* 4. A client that could not take a message for PUSH_SLOW_CLIENT_MS is dropped, as are
+*    connections beyond PUSH_MAX_CLIENTS. Below PUSH_MIN_FREE_HEAP nothing is queued.
+*
+* Without ESPAsyncWebServer only setStatus() is built (the values are kept, nothing is sent).
+* With -DHELPER_STATUS_PUSH=0 (ESPHelperFeatures.h) setStatus() does nothing & none of the
+* client table, the fields or the WebSocket is built, the helpers' calls compile away.
+*
+* To use this helper:
+* - ElegantOTAHelper.h sets it up in setupOTA() & scheduleOTA() runs it as the "push" task,
+*   without the scheduler call handleStatusPush() from loop(),
+* - In the browser: new WebSocket("ws://" + location.host + "/status").onmessage = e =>
+*   Object.assign(status, JSON.parse(e.data));
+****************************************************************************************/
+
+#ifndef ESPStatusPush_h
+#define ESPStatusPush_h
+
+#include <Arduino.h>
+#include "ESPLog.h"   // dropped client messages
+
+#ifndef HELPER_STATUS_PUSH
+#define HELPER_STATUS_PUSH 1    // status push on = 1, set with -D in build_flags
+#endif
+
+#if HELPER_STATUS_PUSH && __has_include(<ESPAsyncWebServer.h>)
+#include <ESPAsyncWebServer.h>
+#define STATUS_PUSH_HTTP 1    // WebSocket on /status
+#else
+#define STATUS_PUSH_HTTP 0
+#endif
+
+#define PUSH_MAX_CLIENTS 4      // dashboards connected at once
+#define PUSH_MESSAGE_MAX 192    // longest delta, every field with an 11 character value fits
+
+const unsigned long PUSH_PERIOD_MS = 200;         // changes within this window go out as one message
+const unsigned long PUSH_SLOW_CLIENT_MS = 5000;   // ms a client may be unable to take a message before it is dropped
+const uint32_t PUSH_MIN_FREE_HEAP = 8192;         // bytes, no messages are queued below this
+const char* STATUS_PUSH_PATH = "/status";         // WebSocket path
+
+// Pushed fields
+enum StatusField {
+  STATUS_CONNECTED,       // STA connected 0/1
+  STATUS_INTERNET,        // internet reachable 0/1
+  STATUS_RSSI,            // dBm
+  STATUS_GATEWAY_RTT,     // ms, average of the probe window
+  STATUS_INTERNET_LOSS,   // % of the internet host probes lost
+  STATUS_STATIONS,        // stations on the SoftAP
+  STATUS_OTA_STATE,       // OTA_STATE_* below
+  STATUS_OTA_BYTES,       // bytes of the running (or last) upload
+  STATUS_FIELD_COUNT
+};
+
+const char* const STATUS_FIELD_NAMES[STATUS_FIELD_COUNT] = {
+  "connected", "internet", "rssi", "gatewayRTT", "internetLoss", "stations", "otaState", "otaBytes"
+};
+const uint32_t STATUS_ALL_FIELDS = (1UL << STATUS_FIELD_COUNT) - 1;
+
+// STATUS_OTA_STATE values
+#define OTA_STATE_IDLE      0
+#define OTA_STATE_UPLOADING 1
+#define OTA_STATE_VERIFYING 2
+#define OTA_STATE_PASSED    3
+#define OTA_STATE_FAILED    4
+
+// One connected dashboard
+struct PushClient {
+  uint32_t id;              // WebSocket client id, 0 = free slot
+  uint32_t pending;         // fields changed since its last message, one bit each
+  unsigned long blockedMS;  // when it first could not take a pending message
+  bool blocked;
+};
+
+// What handleStatusPush() does with a client this round
+enum PushAction {
+  PUSH_IDLE,    // nothing to send
+  PUSH_SEND,    // send its pending fields
+  PUSH_WAIT,    // cannot take a message, keep the fields pending
+  PUSH_DROP     // blocked for too long, close it
+};
+
+#if HELPER_STATUS_PUSH
+volatile int32_t statusValues[STATUS_FIELD_COUNT];
+volatile uint32_t statusDirty = 0;     // fields changed since the last push round
+
+PushClient pushClients[PUSH_MAX_CLIENTS];
+uint32_t pushMessages = 0;             // messages sent
+uint32_t pushDropped = 0;              // slow clients dropped
+
+#ifdef ESP32
+portMUX_TYPE pushMux = portMUX_INITIALIZER_UNLOCKED;   // connects & disconnects arrive on the async_tcp task
+#define PUSH_LOCK()   portENTER_CRITICAL(&pushMux)
+#define PUSH_UNLOCK() portEXIT_CRITICAL(&pushMux)
+#elif defined(ESP8266)
+#define PUSH_LOCK()                   // TCP callbacks run between loop() calls
+#define PUSH_UNLOCK()
+#endif
+
+
+// Set a field, it is pushed if it moved by at least `deadband` since the value last marked
+void setStatus(StatusField field, int32_t value, int32_t deadband = 1) {
+  int32_t difference = value - statusValues[field];
+  if (difference >= deadband || -difference >= deadband) {
+    statusValues[field] = value;
+    __atomic_fetch_or(&statusDirty, 1UL << field, __ATOMIC_RELAXED);
+  }
+}
+
+// Write the fields in `fields` as a JSON object, returns its length
+size_t buildStatusDelta(uint32_t fields, char* out, size_t size) {
+  size_t length = snprintf(out, size, "{");
+  for (int i = 0; i < STATUS_FIELD_COUNT && length < size; i++) {
+    if (fields & (1UL << i)) {
+      length += snprintf(out + length, size - length, "%s\"%s\":%ld", length > 1 ? "," : "",
+                         STATUS_FIELD_NAMES[i], (long)statusValues[i]);
+    }
+  }
+  if (length < size) {
+    length += snprintf(out + length, size - length, "}");
+  }
+  return length < size ? length : size - 1;
+}
+
+// Merge `changed` into the client's pending fields & decide what to do. `canSend`: it can take a message now.
+PushAction pushClientAction(PushClient& client, uint32_t changed, bool canSend, unsigned long currentMS) {
+  client.pending |= changed;   // a field changed twice is sent once, with its latest value
+  if (client.pending == 0 || canSend) {
+    client.blocked = false;
+    return client.pending ? PUSH_SEND : PUSH_IDLE;
+  }
+  if (!client.blocked) {
+    client.blocked = true;
+    client.blockedMS = currentMS;
+  }
+  return currentMS - client.blockedMS >= PUSH_SLOW_CLIENT_MS ? PUSH_DROP : PUSH_WAIT;
+}
+
+// Take a slot for a new client, which first gets every field. False if all slots are used.
+bool addPushClient(uint32_t id) {
+  bool added = false;
+  PUSH_LOCK();
+  for (int i = 0; i < PUSH_MAX_CLIENTS && !added; i++) {
+    if (pushClients[i].id == 0) {
+      pushClients[i] = { id, STATUS_ALL_FIELDS, 0, false };
+      added = true;
+    }
+  }
+  PUSH_UNLOCK();
+  return added;
+}
+
+void removePushClient(uint32_t id) {
+  PUSH_LOCK();
+  for (int i = 0; i < PUSH_MAX_CLIENTS; i++) {
+    if (pushClients[i].id == id) {
+      pushClients[i].id = 0;
+    }
+  }
+  PUSH_UNLOCK();
+}
+#else
+// Status push left out: the helpers' calls compile to nothing
+inline void setStatus(StatusField field, int32_t value, int32_t deadband = 1) {}
+#endif
+
+
+#if STATUS_PUSH_HTTP
+AsyncWebSocket statusSocket(STATUS_PUSH_PATH);
+
+// Register the WebSocket, call in setupOTA() (ElegantOTAHelper.h does)
+void setupStatusPush(AsyncWebServer& webServer) {
+  statusSocket.onEvent([](AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type,
+                          void* arg, uint8_t* data, size_t length) {
+    if (type == WS_EVT_CONNECT) {
+      if (!addPushClient(client->id())) {
+        client->close();   // PUSH_MAX_CLIENTS reached
+      }
+    } else if (type == WS_EVT_DISCONNECT) {
+      removePushClient(client->id());
+    }
+  });
+  webServer.addHandler(&statusSocket);
+}
+
+// Send the changes to each client, call often (the "push" task of scheduleOTA() does), runs every PUSH_PERIOD_MS
+void handleStatusPush() {
+  static unsigned long lastPushMS = 0;
+  unsigned long currentMS = millis();
+  if (currentMS - lastPushMS < PUSH_PERIOD_MS / 2) {
+    return;   // half a period, so a scheduled run a ms early is not skipped
+  }
+  lastPushMS = currentMS;
+
+  uint32_t changed = __atomic_exchange_n(&statusDirty, 0, __ATOMIC_RELAXED);
+  bool heapOK = ESP.getFreeHeap() >= PUSH_MIN_FREE_HEAP;
+
+  for (int i = 0; i < PUSH_MAX_CLIENTS; i++) {
+    uint32_t id = pushClients[i].id;
+    AsyncWebSocketClient* client = id ? statusSocket.client(id) : nullptr;
+    if (!client) {
+      continue;
+    }
+    // Room for a whole message in the TCP send buffer: the client has taken everything queued before
+    bool canSend = heapOK && !client->queueIsFull() && client->client()->space() >= PUSH_MESSAGE_MAX;
+
+    PUSH_LOCK();
+    PushAction action = pushClients[i].id == id ? pushClientAction(pushClients[i], changed, canSend, currentMS) : PUSH_IDLE;
+    uint32_t fields = pushClients[i].pending;
+    if (action == PUSH_SEND) {
+      pushClients[i].pending = 0;
+    } else if (action == PUSH_DROP) {
+      pushClients[i].id = 0;   // free the slot now, the disconnect event may come later
+    }
+    PUSH_UNLOCK();
+
+    if (action == PUSH_SEND) {
+      char message[PUSH_MESSAGE_MAX];
+      client->text(message, buildStatusDelta(fields, message, sizeof(message)));
+      pushMessages++;
+    } else if (action == PUSH_DROP) {
+      LOG_W("Status push: dropping client %lu, it took no data for %lu ms\n", (unsigned long)id, PUSH_SLOW_CLIENT_MS);
+      pushDropped++;
+      client->close();
+    }
+  }
+}
+#else
+void handleStatusPush() {}
+#endif
+
+#endif
@@ -1,7 +1,7 @@
 /****************************************************************************************
 * This is a modified version of the ESP32/8266 WiFi SoftAP Mode example project.
 * To implement this into a project, include the ESPWiFiSoftAPHelper.h file
-*  and call the setupWiFi() function.
+*  call the setupWiFi() & scheduleWiFi() functions in setup() and Scheduler::run() in loop().
 *
 * Modify the SSID, password, IP address, and subnet mask as needed.
 * 
@@ -19,11 +19,12 @@ void setup() {
   Serial.println("\nRunning setup functions.\n");
 
   setupWiFi();    // set up Wi-Fi
+  scheduleWiFi(); // check who's connected from the scheduler
 
   Serial.println("\nSetup completed.\n");
 }
 
 
 void loop() {
-  whosConnected();  // handle who's connected to the AP check
+  Scheduler::run();  // handle who's connected to the AP check, idles in between
 }
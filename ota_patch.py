@@ -0,0 +1,206 @@
+"""
+ota_patch.py
+Builds the compressed images & deltas that ESPOTAPatch.h decodes on /ota/patch.
+
+    python ota_patch.py firmware.bin -o fw.otz                  compressed image
+    python ota_patch.py firmware.bin --base old.bin -o fw.otz   delta against old.bin
+
+`old.bin` must be the firmware.bin the board is running, the board checks its MD5.
+The .otz file is decoded again here & compared with firmware.bin before it is written.
+
+Format, all numbers little endian:
+    header  "OTZ1", u32 image size, u32 base size (0 = no base), u16 window, 16 byte base MD5
+    ops     op byte = kind << 6 | length (length 0 = varint length follows)
+            kind 0 literal:     <length> bytes
+            kind 1 window copy: varint distance back into the image written so far
+            kind 2 base copy:   zigzag varint offset in the base, relative to the end of
+                                the previous base copy
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+MAGIC = b"OTZ1"
+HEADER = "<4sIIH16s"
+WINDOW = 2048             # must not exceed OTZ_WINDOW in ESPOTAPatch.h
+OP_LITERAL, OP_WINDOW, OP_BASE = 0, 1, 2
+MIN_MATCH = 4             # shortest copy worth an op
+MIN_BASE_JUMP = 8         # shortest base copy that needs a new offset
+MAX_CHAIN = 16            # positions kept per 4 byte key
+
+
+def varint(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def zigzag(n):
+    return n * 2 if n >= 0 else -n * 2 - 1
+
+
+def op(kind, length):
+    if length < 64:
+        return bytes([kind << 6 | length])
+    return bytes([kind << 6]) + varint(length)
+
+
+def match_length(a, a_pos, b, b_pos, limit):
+    """Bytes a[a_pos:] & b[b_pos:] have in common, up to limit."""
+    limit = min(limit, len(a) - a_pos, len(b) - b_pos)
+    n = 0
+    while n + 256 <= limit and a[a_pos + n:a_pos + n + 256] == b[b_pos + n:b_pos + n + 256]:
+        n += 256
+    while n < limit and a[a_pos + n] == b[b_pos + n]:
+        n += 1
+    return n
+
+
+def add_position(index, key, position):
+    positions = index.setdefault(key, [])
+    positions.append(position)
+    if len(positions) > MAX_CHAIN:
+        del positions[0]
+
+
+def encode(target, base, window):
+    base_index = {}
+    for i in range(len(base) - MIN_MATCH + 1):
+        positions = base_index.setdefault(base[i:i + MIN_MATCH], [])
+        if len(positions) < MAX_CHAIN:
+            positions.append(i)
+
+    window_index = {}
+    out = bytearray()
+    literals = bytearray()
+    base_next = 0          # decoder's offset after the last base copy
+    base_next_target = 0   # image position where that copy ended
+    i = 0
+
+    def flush_literals():
+        if literals:
+            out.extend(op(OP_LITERAL, len(literals)))
+            out.extend(literals)
+            literals.clear()
+
+    while i < len(target):
+        key = target[i:i + MIN_MATCH]
+        best_length, best_kind, best_arg = 0, None, 0
+
+        if base:
+            # Same spot in the base as the last copy (edits keep the rest in step), then index hits
+            shifted = base_next + (i - base_next_target)
+            for candidate in [base_next, shifted] + base_index.get(key, []):
+                if 0 <= candidate < len(base):
+                    length = match_length(base, candidate, target, i, len(target))
+                    needed = MIN_MATCH if candidate == base_next else MIN_BASE_JUMP
+                    if length >= needed and length > best_length:
+                        best_length, best_kind, best_arg = length, OP_BASE, candidate
+
+        for candidate in reversed(window_index.get(key, [])):
+            if i - candidate > window:
+                break
+            length = match_length(target, candidate, target, i, len(target))
+            if length >= MIN_MATCH and length > best_length:
+                best_length, best_kind, best_arg = length, OP_WINDOW, i - candidate
+
+        if best_kind is None:
+            literals.append(target[i])
+            add_position(window_index, key, i)
+            i += 1
+            continue
+
+        flush_literals()
+        out.extend(op(best_kind, best_length))
+        if best_kind == OP_WINDOW:
+            out.extend(varint(best_arg))
+        else:
+            out.extend(varint(zigzag(best_arg - base_next)))
+            base_next = best_arg + best_length
+            base_next_target = i + best_length
+
+        # Only the last `window` bytes can be copied from later on
+        for position in range(max(i, i + best_length - window), i + best_length):
+            add_position(window_index, target[position:position + MIN_MATCH], position)
+        i += best_length
+
+    flush_literals()
+    return bytes(out)
+
+
+def decode(data, base):
+    """Decode an .otz file, op by op like the board."""
+    image = bytearray()
+    stream = iter(data)
+    header = bytes(next(stream) for _ in range(struct.calcsize(HEADER)))
+    magic, size, base_size, window, _ = struct.unpack(HEADER, header)
+    assert magic == MAGIC and window <= WINDOW and base_size == len(base)
+
+    def read_varint():
+        n, shift = 0, 0
+        while True:
+            b = next(stream)
+            n |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return n
+
+    base_next = 0
+    for b in stream:
+        kind, length = b >> 6, b & 0x3F
+        if length == 0:
+            length = read_varint()
+        if kind == OP_LITERAL:
+            image.extend(next(stream) for _ in range(length))
+        elif kind == OP_WINDOW:
+            distance = read_varint()
+            assert 0 < distance <= window
+            for _ in range(length):
+                image.append(image[-distance])
+        else:
+            n = read_varint()
+            offset = base_next + ((n >> 1) ^ -(n & 1))
+            image.extend(base[offset:offset + length])
+            base_next = offset + length
+    assert len(image) == size
+    return bytes(image)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build .otz images for ESPOTAPatch.h")
+    parser.add_argument("image", help="new firmware.bin")
+    parser.add_argument("--base", help="firmware.bin the board is running now, makes a delta")
+    parser.add_argument("-o", "--output", required=True, help=".otz file to write")
+    parser.add_argument("--window", type=int, default=WINDOW, help="back reference window, up to %d" % WINDOW)
+    args = parser.parse_args()
+
+    if not 0 < args.window <= WINDOW:
+        sys.exit("--window must be 1-%d" % WINDOW)
+
+    target = open(args.image, "rb").read()
+    base = open(args.base, "rb").read() if args.base else b""
+    base_md5 = hashlib.md5(base).digest() if base else bytes(16)
+
+    patch = struct.pack(HEADER, MAGIC, len(target), len(base), args.window, base_md5) + encode(target, base, args.window)
+    if decode(patch, base) != target:
+        sys.exit("Round trip check failed, nothing written")
+
+    with open(args.output, "wb") as f:
+        f.write(patch)
+
+    print("%s: %d bytes -> %s: %d bytes (%.1f%%)%s" % (
+        args.image, len(target), args.output, len(patch), 100.0 * len(patch) / len(target),
+        ", delta against " + args.base if base else ""))
+    print("Image SHA-256 (post to /ota/sha256): " + hashlib.sha256(target).hexdigest())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,78 @@
+"""
+size_report.py
+Builds every env of a PlatformIO project & prints its flash & RAM use, so the cost of a
+feature (or a regression) shows up as a number.
+
+    python size_report.py examples/ElegantOTA_AysncWeb_Helper
+    python size_report.py <project> --save sizes.json       keep the numbers
+    python size_report.py <project> --baseline sizes.json   print the change since then
+
+The first env is the reference the others are compared with.
+"""
+
+import argparse
+import configparser
+import json
+import os
+import re
+import subprocess
+import sys
+
+USAGE = re.compile(r"^(RAM|Flash):.*\(used (\d+) bytes from (\d+) bytes\)", re.MULTILINE)
+
+
+def project_envs(project):
+    config = configparser.ConfigParser(interpolation=None, strict=False)
+    config.read(os.path.join(project, "platformio.ini"))
+    return [section[4:] for section in config.sections() if section.startswith("env:")]
+
+
+def build_size(project, env):
+    """Build one env, returns {"RAM": bytes, "Flash": bytes}."""
+    result = subprocess.run(["pio", "run", "-d", project, "-e", env],
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    sizes = {kind: int(used) for kind, used, _ in USAGE.findall(result.stdout)}
+    if result.returncode != 0 or len(sizes) != 2:
+        sys.stdout.write(result.stdout)
+        sys.exit("Build of %s failed" % env)
+    return sizes
+
+
+def change(value, reference):
+    return "%+d" % (value - reference) if reference is not None else ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flash & RAM use per PlatformIO env")
+    parser.add_argument("project", help="PlatformIO project folder")
+    parser.add_argument("-e", "--env", action="append", help="only these envs (default: all)")
+    parser.add_argument("--save", help="write the sizes to this JSON file")
+    parser.add_argument("--baseline", help="JSON file from --save to compare with")
+    args = parser.parse_args()
+
+    envs = args.env or project_envs(args.project)
+    baseline = json.load(open(args.baseline)) if args.baseline else {}
+
+    sizes = {}
+    for env in envs:
+        print("Building %s..." % env)
+        sizes[env] = build_size(args.project, env)
+
+    reference = sizes[envs[0]]
+    print("\n%-28s %10s %9s %8s %9s" % ("env", "flash", "vs first", "RAM", "vs first"))
+    for env in envs:
+        s = sizes[env]
+        line = "%-28s %10d %9s %8d %9s" % (env, s["Flash"], change(s["Flash"], reference["Flash"]),
+                                           s["RAM"], change(s["RAM"], reference["RAM"]))
+        if env in baseline:
+            line += "   since baseline: flash %s, RAM %s" % (change(s["Flash"], baseline[env]["Flash"]),
+                                                         change(s["RAM"], baseline[env]["RAM"]))
+        print(line)
+
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(sizes, f, indent=2, sort_keys=True)
+
+
+if __name__ == "__main__":
+    main()
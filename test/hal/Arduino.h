@@ -0,0 +1,654 @@
+/****************************************************************************************
+* Native HAL - Arduino core
+* Stands in for the ESP8266 Arduino core when the helpers are built on the PC ([env:native]
+* & the bench envs in platformio.ini), so each helper header compiles unchanged:
+* 1. A simulated clock: millis()/micros() only move when delay() or yield() is called (or a
+*    test calls hal::advance()), timed events (Wi-Fi, TCP, Ticker...) run as it passes them,
+* 2. A heap model: operator new/delete are counted (allocations, frees, live & peak bytes)
+*    & ESP.getFreeHeap() is worked out from them,
+* 3. Serial goes into hal::serialOutput through a 128 byte FIFO drained at 115200 baud, so
+*    availableForWrite() & a blocking write() behave like the UART,
+* 4. RTC user memory (512 bytes) survives hal::runBoot(), which runs one boot in a forked
+*    process: fresh globals, like a reset, with the RTC memory of the boot before.
+*
+* Each test & bench program is one translation unit (the helpers keep their state in
+* globals), so the HAL defines its globals in the headers too.
+*
+* The hal:: names are for the tests, the helpers only use the Arduino API.
+****************************************************************************************/
+
+#ifndef HAL_Arduino_h
+#define HAL_Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LED_BUILTIN 2
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define F(s) (s)
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define snprintf_P snprintf
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+namespace hal {
+
+/**************************** Clock & timed events ****************************/
+
+const uint32_t YIELD_US = 10;   // simulated time a yield() takes
+
+inline uint64_t nowUS = 0;      // simulated time since boot
+
+// Something that happens at a set time: a Wi-Fi event, a TCP callback, a Ticker step...
+struct TimedEvent {
+  uint64_t atUS;
+  uint64_t order;               // events due at the same time run in the order they were added
+  std::function<void()> run;
+};
+
+inline std::vector<TimedEvent> timedEvents;
+inline uint64_t timedEventCount = 0;
+
+
+/**************************** Heap model ****************************/
+
+// Counted allocations, the numbers the heap tests & the benchmark look at
+struct HeapStats {
+  uint32_t allocations;   // operator new calls
+  uint32_t frees;         // operator delete calls of counted blocks
+  int64_t liveBytes;      // bytes allocated & not freed
+  int64_t peakBytes;      // most live bytes since the last resetHeapStats()
+  uint32_t liveBlocks;
+};
+
+const uint32_t HEAP_BLOCK_OVERHEAD = 8;   // bytes umm_malloc adds to each block
+
+inline HeapStats heap = {};
+inline uint32_t heapSize = 45000;         // free heap of a sketch with the Wi-Fi helpers before it allocates
+inline uint32_t heapTaken = 0;            // bytes a test takes away, to run the helpers at low heap
+inline int quietDepth = 0;                // > 0 while the HAL allocates its own bookkeeping
+
+// HAL bookkeeping (event lists, captured output, the file store) is not heap the device would use
+struct Quiet {
+  Quiet() { quietDepth++; }
+  ~Quiet() { quietDepth--; }
+};
+
+inline void resetHeapStats() {
+  int64_t live = heap.liveBytes;
+  uint32_t blocks = heap.liveBlocks;
+  heap = {};
+  heap.liveBytes = live;   // blocks still allocated stay counted as live
+  heap.peakBytes = live;
+  heap.liveBlocks = blocks;
+}
+
+inline uint32_t freeHeap() {
+  int64_t used = heap.liveBytes + (int64_t)heap.liveBlocks * HEAP_BLOCK_OVERHEAD + heapTaken;
+  return used >= heapSize ? 0 : heapSize - used;
+}
+
+
+/**************************** Pins ****************************/
+
+inline int pinLevels[32];
+inline uint32_t pinWrites = 0;     // digitalWrite() & analogWrite() calls
+inline uint32_t analogRange = 1023;
+
+
+/**************************** Serial ****************************/
+
+const size_t SERIAL_FIFO_SIZE = 128;
+const uint32_t SERIAL_BYTES_PER_MS = 11;   // 115200 baud, 10 bits per byte
+
+inline std::string serialOutput;       // everything written to Serial
+inline size_t serialFifo = 0;          // bytes waiting in the UART FIFO
+inline uint64_t serialDrainedUS = 0;   // FIFO level last worked out at this time
+inline uint64_t serialBlockedUS = 0;   // time write() waited for room in the FIFO
+inline bool serialEcho = false;        // also print Serial to stdout
+
+
+/**************************** Random ****************************/
+
+inline uint32_t randomState = 12345;
+
+inline uint32_t nextRandom() {
+  randomState = randomState * 1103515245UL + 12345UL;
+  return randomState >> 1;
+}
+
+
+/**************************** Flash, RTC memory & resets ****************************/
+
+const size_t RTC_USER_MEMORY_SIZE = 512;
+const size_t FLASH_SIZE = 4 * 1024 * 1024;
+
+inline std::vector<uint8_t> flash;          // the flash chip, filled with 0xFF when first used
+inline uint32_t sketchSize = 300000;        // bytes of the running firmware at flash offset 0
+inline std::string sketchMD5 = "00000000000000000000000000000000";
+inline uint32_t restarts = 0;
+
+// ESP.deepSleep() does not return: thrown to whoever runs the boot
+struct DeepSleep {
+  uint64_t sleepUS;
+};
+
+// ESP.restart() does not return either
+struct Restart {};
+
+// What a boot run by runBoot() ended with, in memory the forked boot shares with the caller
+struct BootResult {
+  int outcome;               // BOOT_RETURNED, BOOT_DEEP_SLEEP, BOOT_RESTART or BOOT_CRASHED
+  uint64_t sleepUS;          // deep sleep asked for
+  uint64_t elapsedUS;        // simulated time the boot took
+  uint32_t allocations;      // heap allocations during the boot
+  char serial[16384];        // the start of what it wrote to Serial
+};
+
+enum BootOutcome { BOOT_RETURNED, BOOT_DEEP_SLEEP, BOOT_RESTART, BOOT_CRASHED };
+
+struct SharedMemory {
+  uint8_t rtc[RTC_USER_MEMORY_SIZE];
+  BootResult boot;
+};
+
+// RTC memory & the boot result live in a shared mapping, so they come back from a forked boot
+inline SharedMemory* shared() {
+  static SharedMemory* memory = nullptr;
+  if (!memory) {
+    memory = (SharedMemory*)mmap(nullptr, sizeof(SharedMemory), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    memset(memory, 0, sizeof(SharedMemory));
+  }
+  return memory;
+}
+
+inline uint8_t* flashMemory() {
+  if (flash.empty()) {
+    Quiet quiet;
+    flash.assign(FLASH_SIZE, 0xFF);
+  }
+  return flash.data();
+}
+
+// Run one boot of the device in a child process: `boot` starts with the globals as they were
+// before any boot ran & the RTC memory the boots before left, the clock at 0 & Serial empty. Call from a process that has not
+// run helper code itself. Test assertions belong in the caller, on the result & the RTC memory.
+inline BootResult runBoot(const std::function<void()>& boot) {
+  SharedMemory* memory = shared();
+  memset(&memory->boot, 0, sizeof(memory->boot));
+  fflush(stdout);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    {
+      Quiet quiet;
+      nowUS = 0;                 // the clock starts again at boot, pending events are gone
+      timedEvents.clear();
+      serialOutput.clear();
+      serialFifo = 0;
+      serialDrainedUS = 0;
+    }
+    resetHeapStats();
+    int outcome = BOOT_RETURNED;
+    try {
+      boot();
+    } catch (const DeepSleep& sleep) {
+      outcome = BOOT_DEEP_SLEEP;
+      memory->boot.sleepUS = sleep.sleepUS;
+    } catch (const Restart&) {
+      outcome = BOOT_RESTART;
+    }
+    memory->boot.outcome = outcome;
+    memory->boot.elapsedUS = nowUS;
+    memory->boot.allocations = heap.allocations;
+    snprintf(memory->boot.serial, sizeof(memory->boot.serial), "%s", serialOutput.c_str());
+    fflush(stdout);
+    _exit(0);
+  }
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    memory->boot.outcome = BOOT_CRASHED;
+  }
+  return memory->boot;
+}
+
+// Power-up: RTC memory is random, here zeroed
+inline void powerCycle() {
+  memset(shared()->rtc, 0, RTC_USER_MEMORY_SIZE);
+}
+
+}  // namespace hal
+
+
+/**************************** Heap hooks ****************************/
+
+// Each block carries its size & whether it was counted, ahead of the bytes handed out
+struct HalBlockHeader {
+  size_t size;
+  size_t counted;
+};
+
+inline void* halAllocate(size_t size) {
+  HalBlockHeader* block = (HalBlockHeader*)malloc(sizeof(HalBlockHeader) + (size ? size : 1));
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  block->size = size;
+  block->counted = hal::quietDepth == 0;
+  if (block->counted) {
+    hal::heap.allocations++;
+    hal::heap.liveBlocks++;
+    hal::heap.liveBytes += size;
+    hal::heap.peakBytes = std::max(hal::heap.peakBytes, hal::heap.liveBytes);
+  }
+  return block + 1;
+}
+
+inline void halFree(void* pointer) {
+  if (!pointer) {
+    return;
+  }
+  HalBlockHeader* block = (HalBlockHeader*)pointer - 1;
+  if (block->counted) {
+    hal::heap.frees++;
+    hal::heap.liveBlocks--;
+    hal::heap.liveBytes -= block->size;
+  }
+  free(block);
+}
+
+void* operator new(size_t size) { return halAllocate(size); }
+void* operator new[](size_t size) { return halAllocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { try { return halAllocate(size); } catch (...) { return nullptr; } }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { try { return halAllocate(size); } catch (...) { return nullptr; } }
+void operator delete(void* pointer) noexcept { halFree(pointer); }
+void operator delete[](void* pointer) noexcept { halFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { halFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { halFree(pointer); }
+
+
+/**************************** Time ****************************/
+
+namespace hal {
+
+// Run something `delayMS` from now (simulated time)
+inline void after(unsigned long delayMS, std::function<void()> run) {
+  Quiet quiet;
+  timedEvents.push_back({ nowUS + (uint64_t)delayMS * 1000, timedEventCount++, std::move(run) });
+}
+
+// Move the clock forward by `us`, running the events due on the way
+inline void advance(uint64_t us) {
+  uint64_t endUS = nowUS + us;
+  while (true) {
+    auto next = timedEvents.end();
+    for (auto it = timedEvents.begin(); it != timedEvents.end(); ++it) {
+      if (it->atUS <= endUS && (next == timedEvents.end() || it->atUS < next->atUS ||
+                                (it->atUS == next->atUS && it->order < next->order))) {
+        next = it;
+      }
+    }
+    if (next == timedEvents.end()) {
+      break;
+    }
+    std::function<void()> run;
+    {
+      Quiet quiet;
+      run = std::move(next->run);
+      nowUS = std::max(nowUS, next->atUS);
+      timedEvents.erase(next);
+    }
+    run();
+  }
+  nowUS = endUS;
+}
+
+inline void advanceMS(unsigned long ms) {
+  advance((uint64_t)ms * 1000);
+}
+
+}  // namespace hal
+
+inline unsigned long millis() { return hal::nowUS / 1000; }
+inline unsigned long micros() { return hal::nowUS; }
+inline void delay(unsigned long ms) { hal::advanceMS(ms); }
+inline void delayMicroseconds(unsigned int us) { hal::advance(us); }
+inline void yield() { hal::advance(hal::YIELD_US); }
+
+
+/**************************** GPIO ****************************/
+
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+inline void digitalWrite(uint8_t pin, uint8_t value) { hal::pinLevels[pin & 31] = value; hal::pinWrites++; }
+inline int digitalRead(uint8_t pin) { return hal::pinLevels[pin & 31] ? HIGH : LOW; }
+inline void analogWrite(uint8_t pin, int value) { hal::pinLevels[pin & 31] = value; hal::pinWrites++; }
+inline void analogWriteRange(uint32_t range) { hal::analogRange = range; }
+
+
+/**************************** Random & interrupts ****************************/
+
+inline long random(long howBig) { return howBig > 0 ? hal::nextRandom() % howBig : 0; }
+inline long random(long howSmall, long howBig) { return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall); }
+inline void randomSeed(unsigned long seed) { hal::randomState = seed; }
+
+inline uint32_t xt_rsil(int level) { return 0; }
+inline void xt_wsr_ps(uint32_t state) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+
+/**************************** String ****************************/
+
+class String {
+public:
+  String(const char* text = "") : s(text ? text : "") {}
+  String(const std::string& text) : s(text) {}
+  String(char c) : s(1, c) {}
+  String(int value) : s(std::to_string(value)) {}
+  String(unsigned int value) : s(std::to_string(value)) {}
+  String(long value) : s(std::to_string(value)) {}
+  String(unsigned long value) : s(std::to_string(value)) {}
+
+  const char* c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.length(); }
+  bool isEmpty() const { return s.empty(); }
+  char operator[](unsigned int i) const { return i < s.length() ? s[i] : 0; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  bool operator==(const String& other) const { return s == other.s; }
+  bool operator==(const char* other) const { return s == (other ? other : ""); }
+  bool operator!=(const String& other) const { return s != other.s; }
+  bool operator!=(const char* other) const { return !(*this == other); }
+  bool equals(const String& other) const { return s == other.s; }
+  bool equals(const char* other) const { return *this == other; }
+  bool equalsIgnoreCase(const String& other) const {
+    return s.size() == other.s.size() && strcasecmp(s.c_str(), other.s.c_str()) == 0;
+  }
+  bool startsWith(const String& prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+  bool endsWith(const String& suffix) const {
+    return s.size() >= suffix.s.size() && s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0;
+  }
+  int indexOf(char c, unsigned int from = 0) const { size_t i = s.find(c, from); return i == std::string::npos ? -1 : (int)i; }
+  int indexOf(const String& text, unsigned int from = 0) const { size_t i = s.find(text.s, from); return i == std::string::npos ? -1 : (int)i; }
+  String substring(unsigned int from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const { return from < to && from < s.size() ? String(s.substr(from, to - from)) : String(); }
+  long toInt() const { return atol(s.c_str()); }
+  void toLowerCase() { for (char& c : s) c = tolower(c); }
+  void toUpperCase() { for (char& c : s) c = toupper(c); }
+  void trim() {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    size_t end = s.find_last_not_of(" \t\r\n");
+    s = start == std::string::npos ? std::string() : s.substr(start, end - start + 1);
+  }
+  bool reserve(unsigned int size) { s.reserve(size); return true; }
+
+  String& operator+=(const String& other) { s += other.s; return *this; }
+  String& operator+=(const char* other) { s += other ? other : ""; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+  bool concat(const String& other) { s += other.s; return true; }
+  bool concat(const char* other) { s += other ? other : ""; return true; }
+  bool concat(char c) { s += c; return true; }
+  friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+  friend String operator+(const String& a, const char* b) { return String(a.s + (b ? b : "")); }
+  friend String operator+(const char* a, const String& b) { return String((a ? a : "") + b.s); }
+
+  const std::string& str() const { return s; }
+
+private:
+  std::string s;
+};
+
+
+/**************************** IPAddress ****************************/
+
+// IPv4 address, kept like lwIP: first octet in the low byte
+class IPAddress {
+public:
+  IPAddress() : address(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address(a | b << 8 | c << 16 | (uint32_t)d << 24) {}
+  IPAddress(uint32_t address) : address(address) {}
+
+  operator uint32_t() const { return address; }
+  uint32_t v4() const { return address; }
+  uint8_t operator[](int i) const { return address >> (8 * i); }
+  bool isSet() const { return address != 0; }
+  bool operator==(const IPAddress& other) const { return address == other.address; }
+  bool operator!=(const IPAddress& other) const { return address != other.address; }
+  bool operator==(uint32_t other) const { return address == other; }
+
+  bool fromString(const char* text) {
+    unsigned a, b, c, d;
+    char extra;
+    if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+      return false;
+    }
+    *this = IPAddress(a, b, c, d);
+    return true;
+  }
+  bool fromString(const String& text) { return fromString(text.c_str()); }
+
+  String toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(text);
+  }
+
+private:
+  uint32_t address;
+};
+
+#define INADDR_NONE IPAddress(0, 0, 0, 0)
+
+
+/**************************** Print & Serial ****************************/
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t length) {
+    size_t n = 0;
+    while (length--) n += write(*data++);
+    return n;
+  }
+  size_t write(const char* text) { return text ? write((const uint8_t*)text, strlen(text)) : 0; }
+  size_t write(const char* data, size_t length) { return write((const uint8_t*)data, length); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) {
+      return 0;
+    }
+    if ((size_t)length < sizeof(buffer)) {
+      return write((const uint8_t*)buffer, length);
+    }
+    std::vector<char> text(length + 1);   // the core allocates for long lines too
+    va_start(args, format);
+    vsnprintf(text.data(), text.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)text.data(), length);
+  }
+
+  size_t print(const char* text) { return write(text); }
+  size_t print(const String& text) { return write((const uint8_t*)text.c_str(), text.length()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value) { return printf("%d", value); }
+  size_t print(unsigned int value) { return printf("%u", value); }
+  size_t print(long value) { return printf("%ld", value); }
+  size_t print(unsigned long value) { return printf("%lu", value); }
+  size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+  size_t print(const IPAddress& ip) { return print(ip.toString()); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& value) { return print(value) + println(); }
+};
+
+class HardwareSerial : public Print {
+public:
+  using Print::write;
+  void begin(unsigned long baud) {}
+  void end() {}
+  operator bool() const { return true; }
+
+  int availableForWrite() override {
+    drain();
+    return hal::SERIAL_FIFO_SIZE - hal::serialFifo;
+  }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+
+  // Waits for room like the UART does: the time spent goes on the simulated clock
+  size_t write(const uint8_t* data, size_t length) override {
+    {
+      hal::Quiet quiet;
+      hal::serialOutput.append((const char*)data, length);
+    }
+    if (hal::serialEcho) {
+      fwrite(data, 1, length, stdout);
+    }
+    for (size_t left = length; left > 0;) {
+      drain();
+      size_t room = hal::SERIAL_FIFO_SIZE - hal::serialFifo;
+      if (room == 0) {
+        uint64_t waitUS = 1000 / hal::SERIAL_BYTES_PER_MS + 1;
+        hal::serialBlockedUS += waitUS;
+        hal::advance(waitUS);
+        continue;
+      }
+      size_t n = std::min(room, left);
+      hal::serialFifo += n;
+      left -= n;
+    }
+    return length;
+  }
+
+  void flush() override {
+    while (availableForWrite() < (int)hal::SERIAL_FIFO_SIZE) {
+      uint64_t waitUS = hal::serialFifo * 1000 / hal::SERIAL_BYTES_PER_MS + 1;
+      hal::serialBlockedUS += waitUS;
+      hal::advance(waitUS);
+    }
+  }
+
+private:
+  // Bytes the UART sent since the last look
+  void drain() {
+    uint64_t sent = (hal::nowUS - hal::serialDrainedUS) * hal::SERIAL_BYTES_PER_MS / 1000;
+    if (sent > 0) {
+      hal::serialFifo -= std::min<uint64_t>(sent, hal::serialFifo);
+      hal::serialDrainedUS = hal::nowUS;
+    }
+  }
+};
+
+inline HardwareSerial Serial;
+
+
+/**************************** ESP ****************************/
+
+enum RFMode { RF_DEFAULT = 0, RF_CAL = 1, RF_NO_CAL = 2, RF_DISABLED = 4 };
+
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return hal::freeHeap(); }
+  uint32_t getMaxFreeBlockSize() { return hal::freeHeap() * 3 / 4; }   // some fragmentation
+  uint8_t getHeapFragmentation() { return 25; }
+  uint32_t getChipId() { return 0x00C0FFEE; }
+  uint32_t getCpuFreqMHz() { return 80; }
+  uint32_t getCycleCount() { return (uint32_t)(hal::nowUS * 80); }
+  uint32_t getSketchSize() { return hal::sketchSize; }
+  uint32_t getFreeSketchSpace() { return 1044464 - hal::sketchSize; }
+  String getSketchMD5() { return String(hal::sketchMD5.c_str()); }
+  const char* getResetReason() { return "Power On"; }
+  void wdtFeed() {}
+
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size) {
+    if (offset * 4 + size > hal::RTC_USER_MEMORY_SIZE) {
+      return false;
+    }
+    memcpy(data, hal::shared()->rtc + offset * 4, size);
+    return true;
+  }
+
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size) {
+    if (offset * 4 + size > hal::RTC_USER_MEMORY_SIZE) {
+      return false;
+    }
+    memcpy(hal::shared()->rtc + offset * 4, data, size);
+    return true;
+  }
+
+  bool flashRead(uint32_t address, uint32_t* data, size_t size) {
+    if ((address & 3) || address + size > hal::FLASH_SIZE) {
+      return false;
+    }
+    memcpy(data, hal::flashMemory() + address, size);
+    return true;
+  }
+
+  bool flashWrite(uint32_t address, const uint32_t* data, size_t size) {
+    if ((address & 3) || address + size > hal::FLASH_SIZE) {
+      return false;
+    }
+    memcpy(hal::flashMemory() + address, data, size);
+    return true;
+  }
+
+  [[noreturn]] void deepSleep(uint64_t timeUS, RFMode mode = RF_DEFAULT) {
+    throw hal::DeepSleep{ timeUS };
+  }
+
+  [[noreturn]] void restart() {
+    hal::restarts++;
+    throw hal::Restart{};
+  }
+};
+
+inline EspClass ESP;
+
+#endif
@@ -0,0 +1,32 @@
+/****************************************************************************************
+* Native HAL - ESP8266Ping
+* The blocking ping the helpers used before ESPReachability.h: answers while
+* hal::internetUp (or always for LAN addresses) & takes `count` simulated seconds without.
+****************************************************************************************/
+
+#ifndef HAL_ESP8266Ping_h
+#define HAL_ESP8266Ping_h
+
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+
+class PingClass {
+public:
+  bool ping(IPAddress ip, unsigned int count = 5) { return run(nullptr, ip, count); }
+  bool ping(const char* host, unsigned int count = 5) { return run(host, 0, count); }
+  float averageTime() { return average; }
+
+private:
+  bool run(const char* host, uint32_t ip, unsigned int count) {
+    long rttMS = hal::tcpRoute(host, ip, 7);
+    hal::advanceMS(count * (rttMS >= 0 ? rttMS : 1000));   // blocks like the library does
+    average = rttMS >= 0 ? rttMS : 0;
+    return rttMS >= 0;
+  }
+
+  float average = 0;
+};
+
+inline PingClass Ping;
+
+#endif
@@ -0,0 +1,548 @@
+/****************************************************************************************
+* Native HAL - ESP8266WiFi
+* A scripted radio for the STA & SoftAP helpers:
+* 1. Access points (hal::addAccessPoint()) with an SSID, password, BSSID, channel & RSSI
+*    that a test can take down, bring back & move the RSSI of,
+* 2. WiFi.begin() associates after hal::wifiTiming.associateMS (fastAssociateMS when the
+*    channel & BSSID given match the AP, as the scan is skipped), then gets its IP after
+*    dhcpMS - or at once with a static config. The first hal::wifiTiming.failAttempts
+*    attempts fail, to script a flaky network. begin(..., false) only keeps the config for
+*    wifi_station_connect(). With hal::beginResetsListenInterval begin() clears the listen
+*    interval as the ESP32 core does, hal::associatedListenInterval is the one in effect
+*    when the last association happened,
+* 3. The ESP8266 events (onStationModeGotIP()...) fire as it happens, from the clock,
+* 4. Stations join & leave the SoftAP with hal::joinStation() / hal::leaveStation().
+****************************************************************************************/
+
+#ifndef HAL_ESP8266WiFi_h
+#define HAL_ESP8266WiFi_h
+
+#include <Arduino.h>
+#include <sys/queue.h>
+
+enum wl_status_t {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_WRONG_PASSWORD = 6,
+  WL_DISCONNECTED = 7
+};
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED  (-2)
+
+enum WiFiMode_t { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 };
+enum WiFiSleepType_t { WIFI_NONE_SLEEP = 0, WIFI_LIGHT_SLEEP = 1, WIFI_MODEM_SLEEP = 2 };
+enum WiFiPhyMode_t { WIFI_PHY_MODE_11B = 1, WIFI_PHY_MODE_11G = 2, WIFI_PHY_MODE_11N = 3 };
+
+// Disconnect reasons used by the scripts
+enum WiFiDisconnectReason {
+  WIFI_DISCONNECT_REASON_ASSOC_LEAVE = 8,
+  WIFI_DISCONNECT_REASON_BEACON_TIMEOUT = 200,
+  WIFI_DISCONNECT_REASON_NO_AP_FOUND = 201,
+  WIFI_DISCONNECT_REASON_AUTH_FAIL = 202
+};
+
+struct WiFiEventStationModeConnected {
+  String ssid;
+  uint8_t bssid[6];
+  uint8_t channel;
+};
+
+struct WiFiEventStationModeDisconnected {
+  String ssid;
+  uint8_t bssid[6];
+  WiFiDisconnectReason reason;
+};
+
+struct WiFiEventStationModeGotIP {
+  IPAddress ip;
+  IPAddress mask;
+  IPAddress gw;
+};
+
+struct WiFiEventSoftAPModeStationConnected {
+  uint8_t mac[6];
+  uint8_t aid;
+};
+
+struct WiFiEventSoftAPModeStationDisconnected {
+  uint8_t mac[6];
+  uint8_t aid;
+};
+
+struct WiFiEventSoftAPModeProbeRequestReceived {
+  int rssi;
+  uint8_t mac[6];
+};
+
+// Kept alive by the caller, the event stops firing when the last copy goes
+typedef std::shared_ptr<void> WiFiEventHandler;
+
+// SDK station list of the SoftAP (wifi_softap_get_station_info())
+struct station_info {
+  STAILQ_ENTRY(station_info) next;
+  uint8_t bssid[6];
+  struct {
+    uint32_t addr;
+  } ip;
+};
+
+namespace hal {
+
+// One access point in range
+struct AccessPoint {
+  std::string ssid;
+  std::string password;
+  uint8_t bssid[6];
+  int32_t channel;
+  int32_t rssi;
+  bool up;
+};
+
+// How long things take & what goes wrong
+struct WiFiTiming {
+  unsigned long associateMS = 800;       // begin() to associated, with the channel scan
+  unsigned long fastAssociateMS = 150;   // begin() with the right channel & BSSID
+  unsigned long dhcpMS = 300;            // associated to IP with DHCP
+  unsigned long failMS = 3000;           // begin() to giving up when the AP is not there
+  unsigned long scanMS = 2100;           // a full scan
+  int failAttempts = 0;                  // attempts that fail before one works
+};
+
+// A station on the SoftAP
+struct Station {
+  uint8_t mac[6];
+  uint8_t aid;
+  uint32_t ip;
+};
+
+template <typename Event>
+struct WiFiEventSlot {
+  std::function<void(const Event&)> callback;
+};
+
+inline std::vector<AccessPoint> accessPoints;
+inline WiFiTiming wifiTiming;
+inline std::vector<Station> stations;
+
+inline wl_status_t wifiStatus = WL_DISCONNECTED;
+inline int wifiAP = -1;                  // index of the AP associated with, -1 if none
+inline uint32_t wifiGeneration = 0;      // bumped by begin() & disconnect(), stale events are dropped
+inline uint32_t wifiBegins = 0;          // begin() calls
+inline uint32_t wifiFastBegins = 0;      // begin() calls with a channel & BSSID
+inline uint32_t wifiScans = 0;
+inline int wifiMode = WIFI_OFF;
+inline IPAddress staticIP, staticGateway, staticSubnet, staticDNS;
+inline IPAddress dhcpIP(192, 168, 1, 77);
+inline IPAddress dhcpGateway(192, 168, 1, 1);
+inline IPAddress dhcpDNS(192, 168, 1, 1);
+inline IPAddress softAPAddress(192, 168, 4, 1);
+inline bool softAPUp = false;
+inline float outputPowerDBm = 20.5;
+inline int phyMode = WIFI_PHY_MODE_11N;
+inline int sleepMode = WIFI_NONE_SLEEP;
+inline uint8_t listenInterval = 0;   // DTIM beacons slept through, from setSleepMode()
+inline uint8_t associatedListenInterval = 0;   // listenInterval at the last association
+inline bool beginResetsListenInterval = false; // begin() writes a fresh STA config (ESP32 core)
+inline char hostname[33] = "ESP-C0FFEE";
+
+inline std::vector<std::weak_ptr<WiFiEventSlot<WiFiEventStationModeConnected>>> onConnected;
+inline std::vector<std::weak_ptr<WiFiEventSlot<WiFiEventStationModeDisconnected>>> onDisconnected;
+inline std::vector<std::weak_ptr<WiFiEventSlot<WiFiEventStationModeGotIP>>> onGotIP;
+inline std::vector<std::weak_ptr<WiFiEventSlot<int>>> onDHCPTimeout;
+inline std::vector<std::weak_ptr<WiFiEventSlot<WiFiEventSoftAPModeStationConnected>>> onStationJoined;
+inline std::vector<std::weak_ptr<WiFiEventSlot<WiFiEventSoftAPModeStationDisconnected>>> onStationLeft;
+inline std::vector<std::weak_ptr<WiFiEventSlot<WiFiEventSoftAPModeProbeRequestReceived>>> onProbeRequest;
+
+inline std::vector<AccessPoint> scanResults;
+inline bool scanRunning = false;
+
+// Call each live handler of a list
+template <typename Event>
+void fire(std::vector<std::weak_ptr<WiFiEventSlot<Event>>>& handlers, const Event& event) {
+  for (size_t i = 0; i < handlers.size(); i++) {
+    std::shared_ptr<WiFiEventSlot<Event>> slot = handlers[i].lock();
+    if (slot) {
+      slot->callback(event);
+    }
+  }
+}
+
+template <typename Event>
+WiFiEventHandler addHandler(std::vector<std::weak_ptr<WiFiEventSlot<Event>>>& handlers,
+                            std::function<void(const Event&)> callback) {
+  std::shared_ptr<WiFiEventSlot<Event>> slot = std::make_shared<WiFiEventSlot<Event>>();
+  slot->callback = callback;
+  Quiet quiet;
+  handlers.push_back(slot);
+  return slot;
+}
+
+inline int addAccessPoint(const char* ssid, const char* password, uint8_t bssidLast, int32_t channel, int32_t rssi) {
+  Quiet quiet;
+  AccessPoint ap = { ssid, password, { 0x02, 0x00, 0x00, 0x00, 0x00, bssidLast }, channel, rssi, true };
+  accessPoints.push_back(ap);
+  return accessPoints.size() - 1;
+}
+
+inline void fireDisconnected(int ap, WiFiDisconnectReason reason) {
+  WiFiEventStationModeDisconnected event;
+  event.ssid = ap >= 0 ? accessPoints[ap].ssid.c_str() : "";
+  memcpy(event.bssid, ap >= 0 ? accessPoints[ap].bssid : (const uint8_t*)"\0\0\0\0\0\0", 6);
+  event.reason = reason;
+  fire(onDisconnected, event);
+}
+
+// The link to the AP is lost (AP gone, out of range...)
+inline void dropLink(WiFiDisconnectReason reason = WIFI_DISCONNECT_REASON_BEACON_TIMEOUT) {
+  if (wifiStatus != WL_CONNECTED) {
+    return;
+  }
+  int ap = wifiAP;
+  wifiGeneration++;
+  wifiStatus = WL_DISCONNECTED;
+  wifiAP = -1;
+  fireDisconnected(ap, reason);
+}
+
+inline void setAccessPointUp(int ap, bool up) {
+  accessPoints[ap].up = up;
+  if (!up && wifiAP == ap) {
+    dropLink();
+  }
+}
+
+inline bool staticConfig() {
+  return staticIP.isSet();
+}
+
+// Associated: IP next, from DHCP or the static config
+inline void associated(int ap, uint32_t generation) {
+  if (generation != wifiGeneration) {
+    return;
+  }
+  wifiAP = ap;
+  associatedListenInterval = listenInterval;
+  WiFiEventStationModeConnected connected;
+  connected.ssid = accessPoints[ap].ssid.c_str();
+  memcpy(connected.bssid, accessPoints[ap].bssid, 6);
+  connected.channel = accessPoints[ap].channel;
+  fire(onConnected, connected);
+
+  after(staticConfig() ? 0 : wifiTiming.dhcpMS, [ap, generation]() {
+    if (generation != wifiGeneration) {
+      return;
+    }
+    wifiStatus = WL_CONNECTED;
+    WiFiEventStationModeGotIP gotIP;
+    gotIP.ip = staticConfig() ? staticIP : dhcpIP;
+    gotIP.gw = staticConfig() ? staticGateway : dhcpGateway;
+    gotIP.mask = IPAddress(255, 255, 255, 0);
+    fire(onGotIP, gotIP);
+  });
+}
+
+// STA config kept by begin(..., false) for wifi_station_connect()
+struct StationConfig {
+  std::string ssid;
+  std::string password;
+  int32_t channel;
+  uint8_t bssid[6];
+  bool hasBSSID;
+};
+inline StationConfig stationConfig;
+
+// A connection attempt: finds the AP, then associates or fails after the scripted time
+inline void startAttempt(const char* ssid, const char* password, int32_t channel, const uint8_t* bssid) {
+  uint32_t generation = ++wifiGeneration;
+  wifiBegins++;
+  wifiStatus = WL_DISCONNECTED;
+  wifiAP = -1;
+
+  int found = -1;
+  for (size_t i = 0; i < accessPoints.size(); i++) {
+    const AccessPoint& ap = accessPoints[i];
+    bool sameBSSID = !bssid || memcmp(bssid, ap.bssid, 6) == 0;
+    if (ap.up && ap.ssid == ssid && sameBSSID && (!bssid || channel == ap.channel) &&
+        (found < 0 || ap.rssi > accessPoints[found].rssi)) {
+      found = i;
+    }
+  }
+
+  bool fast = bssid && channel > 0;
+  if (fast) {
+    wifiFastBegins++;
+  }
+  if (found < 0 || wifiTiming.failAttempts > 0) {
+    if (wifiTiming.failAttempts > 0) {
+      wifiTiming.failAttempts--;
+    }
+    after(wifiTiming.failMS, [generation]() {
+      if (generation == wifiGeneration) {
+        wifiStatus = WL_NO_SSID_AVAIL;
+        fireDisconnected(-1, WIFI_DISCONNECT_REASON_NO_AP_FOUND);
+      }
+    });
+    return;
+  }
+  if (accessPoints[found].password != (password ? password : "")) {
+    after(wifiTiming.associateMS, [generation]() {
+      if (generation == wifiGeneration) {
+        wifiStatus = WL_WRONG_PASSWORD;
+        fireDisconnected(-1, WIFI_DISCONNECT_REASON_AUTH_FAIL);
+      }
+    });
+    return;
+  }
+  after(fast ? wifiTiming.fastAssociateMS : wifiTiming.associateMS, [found, generation]() {
+    associated(found, generation);
+  });
+}
+
+inline void joinStation(const uint8_t mac[6], uint8_t aid, uint32_t ip) {
+  {
+    Quiet quiet;
+    Station station;
+    memcpy(station.mac, mac, 6);
+    station.aid = aid;
+    station.ip = ip;
+    stations.push_back(station);
+  }
+  WiFiEventSoftAPModeStationConnected event;
+  memcpy(event.mac, mac, 6);
+  event.aid = aid;
+  fire(onStationJoined, event);
+}
+
+inline void leaveStation(const uint8_t mac[6]) {
+  for (size_t i = 0; i < stations.size(); i++) {
+    if (memcmp(stations[i].mac, mac, 6) == 0) {
+      WiFiEventSoftAPModeStationDisconnected event;
+      memcpy(event.mac, mac, 6);
+      event.aid = stations[i].aid;
+      {
+        Quiet quiet;
+        stations.erase(stations.begin() + i);
+      }
+      fire(onStationLeft, event);
+      return;
+    }
+  }
+}
+
+inline void probeRequest(const uint8_t mac[6], int rssi) {
+  WiFiEventSoftAPModeProbeRequestReceived event;
+  memcpy(event.mac, mac, 6);
+  event.rssi = rssi;
+  fire(onProbeRequest, event);
+}
+
+}  // namespace hal
+
+
+class ESP8266WiFiClass {
+public:
+  /************** Mode & settings **************/
+  bool mode(WiFiMode_t mode) { hal::wifiMode = mode; return true; }
+  WiFiMode_t getMode() { return (WiFiMode_t)hal::wifiMode; }
+  void persistent(bool persistent) {}
+  bool setAutoReconnect(bool autoReconnect) { return true; }
+  bool setAutoConnect(bool autoConnect) { return true; }
+  bool hostname(const char* name) { snprintf(hal::hostname, sizeof(hal::hostname), "%s", name); return true; }
+  bool hostname(const String& name) { return hostname(name.c_str()); }
+  String hostname() { return String(hal::hostname); }
+  bool setSleepMode(WiFiSleepType_t type, uint8_t listenInterval = 0) {
+    hal::sleepMode = type;
+    hal::listenInterval = listenInterval;
+    return true;
+  }
+  WiFiSleepType_t getSleepMode() { return (WiFiSleepType_t)hal::sleepMode; }
+  void setOutputPower(float dBm) { hal::outputPowerDBm = dBm; }
+  bool setPhyMode(WiFiPhyMode_t mode) { hal::phyMode = mode; return true; }
+  WiFiPhyMode_t getPhyMode() { return (WiFiPhyMode_t)hal::phyMode; }
+
+  /************** STA **************/
+  wl_status_t begin(const char* ssid, const char* password = nullptr, int32_t channel = 0,
+                    const uint8_t* bssid = nullptr, bool connect = true) {
+    hal::stationConfig = { ssid, password ? password : "", channel, {}, bssid != nullptr };
+    if (bssid) {
+      memcpy(hal::stationConfig.bssid, bssid, 6);
+    }
+    if (hal::beginResetsListenInterval) {
+      hal::listenInterval = 0;
+    }
+    if (connect) {
+      hal::startAttempt(ssid, password, channel, bssid);
+    }
+    return hal::wifiStatus;
+  }
+
+  bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress()) {
+    hal::staticIP = local;
+    hal::staticGateway = gateway;
+    hal::staticSubnet = subnet;
+    hal::staticDNS = dns1;
+    return true;
+  }
+
+  bool disconnect(bool wifiOff = false) {
+    hal::wifiGeneration++;
+    int ap = hal::wifiAP;
+    bool wasConnected = hal::wifiStatus == WL_CONNECTED;
+    hal::wifiStatus = WL_DISCONNECTED;
+    hal::wifiAP = -1;
+    if (wasConnected) {
+      hal::fireDisconnected(ap, WIFI_DISCONNECT_REASON_ASSOC_LEAVE);
+    }
+    return true;
+  }
+
+  bool reconnect() { return false; }
+  bool isConnected() { return hal::wifiStatus == WL_CONNECTED; }
+  wl_status_t status() { return hal::wifiStatus; }
+
+  IPAddress localIP() { return isConnected() ? (hal::staticConfig() ? hal::staticIP : hal::dhcpIP) : IPAddress(); }
+  IPAddress gatewayIP() { return isConnected() ? (hal::staticConfig() ? hal::staticGateway : hal::dhcpGateway) : IPAddress(); }
+  IPAddress subnetMask() { return isConnected() ? IPAddress(255, 255, 255, 0) : IPAddress(); }
+  IPAddress dnsIP(uint8_t index = 0) {
+    if (!isConnected()) return IPAddress();
+    return hal::staticConfig() && hal::staticDNS.isSet() ? hal::staticDNS : hal::dhcpDNS;
+  }
+  int32_t RSSI() { return hal::wifiAP >= 0 ? hal::accessPoints[hal::wifiAP].rssi : 31; }   // 31: not connected
+  int32_t channel() { return hal::wifiAP >= 0 ? hal::accessPoints[hal::wifiAP].channel : 0; }
+  uint8_t* BSSID() {
+    static uint8_t none[6];
+    return hal::wifiAP >= 0 ? hal::accessPoints[hal::wifiAP].bssid : none;
+  }
+  String SSID() const { return hal::wifiAP >= 0 ? String(hal::accessPoints[hal::wifiAP].ssid.c_str()) : String(); }
+  uint8_t* macAddress(uint8_t* mac) {
+    const uint8_t own[6] = { 0x5C, 0xCF, 0x7F, 0xC0, 0xFF, 0xEE };
+    memcpy(mac, own, 6);
+    return mac;
+  }
+
+  /************** Scan **************/
+  int8_t scanNetworks(bool async = false, bool showHidden = false) {
+    hal::wifiScans++;
+    hal::scanRunning = true;
+    uint32_t scan = hal::wifiScans;
+    auto finish = [scan]() {
+      if (scan != hal::wifiScans) {
+        return;
+      }
+      hal::Quiet quiet;
+      hal::scanResults.clear();
+      for (const hal::AccessPoint& ap : hal::accessPoints) {
+        if (ap.up) hal::scanResults.push_back(ap);
+      }
+      hal::scanRunning = false;
+    };
+    if (async) {
+      hal::after(hal::wifiTiming.scanMS, finish);
+      return WIFI_SCAN_RUNNING;
+    }
+    hal::advanceMS(hal::wifiTiming.scanMS);
+    finish();
+    return hal::scanResults.size();
+  }
+  int8_t scanComplete() {
+    if (hal::scanRunning) return WIFI_SCAN_RUNNING;
+    return hal::wifiScans ? (int8_t)hal::scanResults.size() : WIFI_SCAN_FAILED;
+  }
+  void scanDelete() {
+    hal::Quiet quiet;
+    hal::scanResults.clear();
+  }
+  String SSID(uint8_t i) { return i < hal::scanResults.size() ? String(hal::scanResults[i].ssid.c_str()) : String(); }
+  int32_t RSSI(uint8_t i) { return i < hal::scanResults.size() ? hal::scanResults[i].rssi : 0; }
+  uint8_t* BSSID(uint8_t i) { return i < hal::scanResults.size() ? hal::scanResults[i].bssid : nullptr; }
+  int32_t channel(uint8_t i) { return i < hal::scanResults.size() ? hal::scanResults[i].channel : 0; }
+
+  /************** SoftAP **************/
+  bool softAPConfig(IPAddress local, IPAddress gateway, IPAddress subnet) { hal::softAPAddress = local; return true; }
+  bool softAP(const char* ssid, const char* password = nullptr, int channel = 1, int hidden = 0, int maxConnection = 4) {
+    if (password && *password && strlen(password) < 8) {
+      return false;   // WPA2 needs at least 8 characters
+    }
+    hal::softAPUp = true;
+    return true;
+  }
+  bool softAPdisconnect(bool wifiOff = false) { hal::softAPUp = false; return true; }
+  IPAddress softAPIP() { return hal::softAPUp ? hal::softAPAddress : IPAddress(); }
+  uint8_t softAPgetStationNum() { return hal::stations.size(); }
+
+  /************** Events **************/
+  WiFiEventHandler onStationModeConnected(std::function<void(const WiFiEventStationModeConnected&)> f) {
+    return hal::addHandler(hal::onConnected, f);
+  }
+  WiFiEventHandler onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected&)> f) {
+    return hal::addHandler(hal::onDisconnected, f);
+  }
+  WiFiEventHandler onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP&)> f) {
+    return hal::addHandler(hal::onGotIP, f);
+  }
+  WiFiEventHandler onStationModeDHCPTimeout(std::function<void(void)> f) {
+    return hal::addHandler<int>(hal::onDHCPTimeout, [f](const int&) { f(); });
+  }
+  WiFiEventHandler onSoftAPModeStationConnected(std::function<void(const WiFiEventSoftAPModeStationConnected&)> f) {
+    return hal::addHandler(hal::onStationJoined, f);
+  }
+  WiFiEventHandler onSoftAPModeStationDisconnected(std::function<void(const WiFiEventSoftAPModeStationDisconnected&)> f) {
+    return hal::addHandler(hal::onStationLeft, f);
+  }
+  WiFiEventHandler onSoftAPModeProbeRequestReceived(std::function<void(const WiFiEventSoftAPModeProbeRequestReceived&)> f) {
+    return hal::addHandler(hal::onProbeRequest, f);
+  }
+};
+
+inline ESP8266WiFiClass WiFi;
+
+
+/************** SDK (user_interface.h) **************/
+
+inline char* wifi_station_get_hostname() {
+  return hal::hostname;
+}
+
+// Connect with the config the last WiFi.begin() wrote
+inline bool wifi_station_connect() {
+  const hal::StationConfig& config = hal::stationConfig;
+  hal::startAttempt(config.ssid.c_str(), config.password.c_str(), config.channel,
+                    config.hasBSSID ? config.bssid : nullptr);
+  return true;
+}
+
+// The SDK allocates the list, freed by wifi_softap_free_station_info()
+inline station_info* halStationList = nullptr;
+
+inline void wifi_softap_free_station_info() {
+  while (halStationList) {
+    station_info* next = STAILQ_NEXT(halStationList, next);
+    delete halStationList;
+    halStationList = next;
+  }
+}
+
+inline station_info* wifi_softap_get_station_info() {
+  wifi_softap_free_station_info();
+  station_info* last = nullptr;
+  for (const hal::Station& station : hal::stations) {
+    station_info* info = new station_info();
+    memcpy(info->bssid, station.mac, 6);
+    info->ip.addr = station.ip;
+    STAILQ_NEXT(info, next) = nullptr;
+    if (last) {
+      STAILQ_NEXT(last, next) = info;
+    } else {
+      halStationList = info;
+    }
+    last = info;
+  }
+  return halStationList;
+}
+
+#endif
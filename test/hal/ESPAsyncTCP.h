@@ -0,0 +1,97 @@
+/****************************************************************************************
+* Native HAL - ESPAsyncTCP
+* AsyncClient::connect() returns at once, the connect or error callback fires later on the
+* simulated clock. hal::tcpRoute() decides what happens to a connect: answered after some
+* ms, or an error - by default the gateway, the DNS server & internet hosts all answer
+* while hal::internetUp (the LAN always does).
+****************************************************************************************/
+
+#ifndef HAL_ESPAsyncTCP_h
+#define HAL_ESPAsyncTCP_h
+
+#include <Arduino.h>
+
+class AsyncClient;
+typedef std::function<void(void*, AsyncClient*)> AcConnectHandler;
+typedef std::function<void(void*, AsyncClient*, int8_t)> AcErrorHandler;
+
+namespace hal {
+
+// A connect: to `host` (a name) or `ip`
+typedef std::function<long(const char* host, uint32_t ip, uint16_t port)> TcpRoute;
+
+const unsigned long TCP_ERROR_MS = 1000;   // connect to error when there is no answer (lwIP gives up sooner than the probe timeout here)
+
+inline bool internetUp = true;
+inline unsigned long lanRTTMS = 4;
+inline unsigned long internetRTTMS = 35;
+inline uint32_t tcpConnects = 0;
+
+// RTT in ms, or -1 for no answer
+inline TcpRoute tcpRoute = [](const char* host, uint32_t ip, uint16_t port) -> long {
+  bool lan = !host && (ip & 0xFFFFFF) == (IPAddress(192, 168, 1, 0) & 0xFFFFFF);
+  if (lan) {
+    return lanRTTMS;
+  }
+  return internetUp ? internetRTTMS : -1;
+};
+
+}  // namespace hal
+
+class AsyncClient {
+public:
+  AsyncClient() {}
+  ~AsyncClient() { generation++; }
+
+  bool connect(IPAddress ip, uint16_t port) { return start(nullptr, ip, port); }
+  bool connect(const char* host, uint16_t port) { return start(host, 0, port); }
+
+  void close(bool now = false) {
+    generation++;
+    isConnected = false;
+  }
+  void abort() { close(true); }
+  void stop() { close(); }
+  bool connected() { return isConnected; }
+  size_t space() { return sendSpace; }
+  IPAddress remoteIP() { return remote; }
+  IPAddress localIP() { return IPAddress(192, 168, 1, 77); }
+
+  void onConnect(AcConnectHandler handler, void* arg = nullptr) { connectHandler = handler; connectArg = arg; }
+  void onError(AcErrorHandler handler, void* arg = nullptr) { errorHandler = handler; errorArg = arg; }
+  void onDisconnect(AcConnectHandler handler, void* arg = nullptr) { disconnectHandler = handler; disconnectArg = arg; }
+
+  size_t sendSpace = 2920;   // free TCP send buffer, tests shrink it to play a slow client
+  IPAddress remote;
+
+private:
+  bool start(const char* host, uint32_t ip, uint16_t port) {
+    hal::tcpConnects++;
+    uint32_t ticket = ++generation;
+    remote = IPAddress(ip);
+    long rttMS = hal::tcpRoute(host, ip, port);
+    hal::after(rttMS >= 0 ? rttMS : hal::TCP_ERROR_MS, [this, ticket, rttMS]() {
+      if (ticket != generation) {
+        return;   // closed before it got an answer
+      }
+      if (rttMS >= 0) {
+        isConnected = true;
+        if (connectHandler) connectHandler(connectArg, this);
+      } else if (errorHandler) {
+        errorHandler(errorArg, this, -13);   // ERR_ABRT
+      }
+    });
+    return true;
+  }
+
+  uint32_t generation = 0;
+  bool isConnected = false;
+  AcConnectHandler connectHandler;
+  AcErrorHandler errorHandler;
+  AcConnectHandler disconnectHandler;
+  void* connectArg = nullptr;
+  void* errorArg = nullptr;
+  void* disconnectArg = nullptr;
+};
+
+#endif
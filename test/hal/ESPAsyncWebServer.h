@@ -0,0 +1,744 @@
+/****************************************************************************************
+* Native HAL - ESPAsyncWebServer
+* A facade of me-no-dev's AsyncWebServer that runs a request through the handlers the way
+* the library does, without a socket:
+* 1. The query string is parsed, then the first handler whose canHandle() is true takes the
+*    request (the catch-all / onNotFound() handler if none),
+* 2. Headers no handler asked for with addInterestingHeader() are dropped before the
+*    handler runs, as the library does (AsyncCallbackWebHandler asks for all of them),
+* 3. Upload & body data go to the handler in pieces, then handleRequest(),
+* 4. The response is rendered: chunked & callback responses are drained through their
+*    filler with a TCP window of the request's size, files are read from LittleFS,
+* 5. The connection closes: onDisconnect() callbacks run & the request is freed.
+* hal::serve(server, request) does all of it & returns what the client got.
+*
+* AsyncWebSocket clients are opened with hal::wsConnect(), their messages queue until
+* hal::wsDeliver() says the client took them.
+****************************************************************************************/
+
+#ifndef HAL_ESPAsyncWebServer_h
+#define HAL_ESPAsyncWebServer_h
+
+#include <Arduino.h>
+#include <ESPAsyncTCP.h>
+#include <LittleFS.h>
+#include <deque>
+
+enum WebRequestMethod {
+  HTTP_GET = 0b00000001,
+  HTTP_POST = 0b00000010,
+  HTTP_DELETE = 0b00000100,
+  HTTP_PUT = 0b00001000,
+  HTTP_PATCH = 0b00010000,
+  HTTP_HEAD = 0b00100000,
+  HTTP_OPTIONS = 0b01000000,
+  HTTP_ANY = 0b01111111
+};
+typedef uint8_t WebRequestMethodComposite;
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+class AsyncWebHandler;
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const String& name, const String& value, bool form = false, bool file = false, size_t size = 0)
+    : _name(name), _value(value), _size(size), _isForm(form), _isFile(file) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+  size_t size() const { return _size; }
+  bool isPost() const { return _isForm; }
+  bool isFile() const { return _isFile; }
+
+private:
+  String _name;
+  String _value;
+  size_t _size;
+  bool _isForm;
+  bool _isFile;
+};
+
+class AsyncWebHeader {
+public:
+  AsyncWebHeader(const String& name, const String& value) : _name(name), _value(value) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+
+private:
+  String _name;
+  String _value;
+};
+
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, const String&, size_t, uint8_t*, size_t, bool)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, uint8_t*, size_t, size_t, size_t)> ArBodyHandlerFunction;
+typedef std::function<void(void)> ArDisconnectHandler;
+typedef std::function<bool(AsyncWebServerRequest*)> ArRequestFilterFunction;
+
+// One response, whatever kind: text, flash, file, chunked or callback
+class AsyncWebServerResponse {
+public:
+  virtual ~AsyncWebServerResponse() {}
+  void setCode(int code) { _code = code; }
+  void setContentType(const String& type) { _contentType = type; }
+  void setContentLength(size_t length) { _contentLength = length; }
+  void addHeader(const String& name, const String& value) { _headers.push_back(new AsyncWebHeader(name, value)); }
+
+  int _code = 200;
+  String _contentType;
+  std::string _content;                    // text & flash responses
+  AwsResponseFiller _filler;               // chunked & callback responses
+  bool _chunked = false;
+  size_t _contentLength = 0;
+  File _file;                              // file responses, opened when the response is made
+  std::vector<AsyncWebHeader*> _headers;
+
+  void freeHeaders() {
+    for (AsyncWebHeader* header : _headers) delete header;
+    _headers.clear();
+  }
+};
+
+class AsyncWebHandler {
+public:
+  virtual ~AsyncWebHandler() {}
+  AsyncWebHandler& setFilter(ArRequestFilterFunction fn) { _filter = fn; return *this; }
+  bool filter(AsyncWebServerRequest* request) { return _filter == nullptr || _filter(request); }
+  virtual bool canHandle(AsyncWebServerRequest* request) { return false; }
+  virtual void handleRequest(AsyncWebServerRequest* request) {}
+  virtual void handleUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final) {}
+  virtual void handleBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {}
+  virtual bool isRequestHandlerTrivial() { return true; }
+
+protected:
+  ArRequestFilterFunction _filter;
+};
+
+class AsyncWebServerRequest {
+public:
+  AsyncWebServerRequest(AsyncWebServer* server) : _server(server) {}
+  ~AsyncWebServerRequest() {
+    for (AsyncWebParameter* param : _params) delete param;
+    for (AsyncWebHeader* header : _headers) delete header;
+    if (_response) {
+      _response->freeHeaders();
+      delete _response;
+    }
+  }
+
+  AsyncWebServer* server() { return _server; }
+  AsyncClient* client() { return &_client; }
+  WebRequestMethodComposite method() const { return _method; }
+  const String& url() const { return _url; }
+  const String& host() const { return _host; }
+  const String& contentType() const { return _contentType; }
+  size_t contentLength() const { return _contentLength; }
+  bool multipart() const { return _isMultipart; }
+  const char* methodToString() const { return _method == HTTP_POST ? "POST" : "GET"; }
+
+  /************** Headers **************/
+  void addInterestingHeader(const String& name) {
+    for (const String& header : _interestingHeaders) {
+      if (header.equalsIgnoreCase(name)) return;
+    }
+    _interestingHeaders.push_back(name);
+  }
+  size_t headers() const { return _headers.size(); }
+  bool hasHeader(const String& name) const { return getHeader(name) != nullptr; }
+  AsyncWebHeader* getHeader(const String& name) const {
+    for (AsyncWebHeader* header : _headers) {
+      if (header->name().equalsIgnoreCase(name)) return header;
+    }
+    return nullptr;
+  }
+  AsyncWebHeader* getHeader(size_t index) const { return index < _headers.size() ? _headers[index] : nullptr; }
+
+  /************** Parameters **************/
+  size_t params() const { return _params.size(); }
+  bool hasParam(const String& name, bool post = false, bool file = false) const { return getParam(name, post, file) != nullptr; }
+  AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false) const {
+    for (AsyncWebParameter* param : _params) {
+      if (param->name() == name && param->isPost() == post && param->isFile() == file) return param;
+    }
+    return nullptr;
+  }
+  AsyncWebParameter* getParam(size_t index) const { return index < _params.size() ? _params[index] : nullptr; }
+  bool hasArg(const char* name) const { return hasParam(name) || hasParam(name, true); }
+  const String& arg(const String& name) const {
+    static String empty;
+    AsyncWebParameter* param = getParam(name);
+    if (!param) param = getParam(name, true);
+    return param ? param->value() : empty;
+  }
+
+  void onDisconnect(ArDisconnectHandler fn) { _disconnectHandlers.push_back(fn); }
+
+  /************** Authentication **************/
+  // Basic only: the Authorization header against base64("username:password")
+  bool authenticate(const char* username, const char* password, const char* realm = nullptr, bool passwordIsHash = false) const {
+    AsyncWebHeader* header = getHeader("Authorization");
+    if (!header) return false;
+    hal::Quiet quiet;
+    return header->value().str() == "Basic " + _base64(std::string(username) + ":" + password);
+  }
+  // 401 asking for credentials, Digest by default like the library
+  void requestAuthentication(const char* realm = nullptr, bool isDigest = true) {
+    AsyncWebServerResponse* response = beginResponse(401);
+    String challenge = isDigest ? "Digest realm=\"" : "Basic realm=\"";
+    challenge += realm ? realm : "Login Required";
+    challenge += "\"";
+    response->addHeader("WWW-Authenticate", challenge);
+    send(response);
+  }
+  static std::string _base64(const std::string& in) {
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < in.size(); i += 3) {
+      uint32_t n = (uint8_t)in[i] << 16 | (i + 1 < in.size() ? (uint8_t)in[i + 1] << 8 : 0) | (i + 2 < in.size() ? (uint8_t)in[i + 2] : 0);
+      out += digits[n >> 18 & 63];
+      out += digits[n >> 12 & 63];
+      out += i + 1 < in.size() ? digits[n >> 6 & 63] : '=';
+      out += i + 2 < in.size() ? digits[n & 63] : '=';
+    }
+    return out;
+  }
+
+  /************** Responses **************/
+  AsyncWebServerResponse* beginResponse(int code, const String& contentType = String(), const String& content = String()) {
+    AsyncWebServerResponse* response = new AsyncWebServerResponse();
+    response->_code = code;
+    response->_contentType = contentType;
+    response->_content = content.str();
+    return response;
+  }
+  AsyncWebServerResponse* beginResponse(FS& fs, const String& path, const String& contentType = String(), bool download = false) {
+    AsyncWebServerResponse* response = new AsyncWebServerResponse();
+    response->_file = fs.open(path, "r");
+    response->_code = response->_file ? 200 : 404;
+    response->_contentType = contentType;
+    return response;
+  }
+  AsyncWebServerResponse* beginResponse_P(int code, const String& contentType, const uint8_t* content, size_t length) {
+    AsyncWebServerResponse* response = beginResponse(code, contentType);
+    response->_content.assign((const char*)content, length);
+    return response;
+  }
+  AsyncWebServerResponse* beginResponse_P(int code, const String& contentType, PGM_P content) {
+    return beginResponse_P(code, contentType, (const uint8_t*)content, strlen(content));
+  }
+  AsyncWebServerResponse* beginResponse(const String& contentType, size_t length, AwsResponseFiller filler) {
+    AsyncWebServerResponse* response = beginResponse(200, contentType);
+    response->_filler = filler;
+    response->_contentLength = length;
+    return response;
+  }
+  AsyncWebServerResponse* beginChunkedResponse(const String& contentType, AwsResponseFiller filler) {
+    AsyncWebServerResponse* response = beginResponse(200, contentType);
+    response->_filler = filler;
+    response->_chunked = true;
+    return response;
+  }
+
+  void send(AsyncWebServerResponse* response) {
+    if (_response) {
+      _response->freeHeaders();
+      delete _response;   // the library keeps the first one, a second send is a bug
+    }
+    _response = response;
+  }
+  void send(int code, const String& contentType = String(), const String& content = String()) {
+    send(beginResponse(code, contentType, content));
+  }
+  void send(FS& fs, const String& path, const String& contentType = String(), bool download = false) {
+    send(beginResponse(fs, path, contentType, download));
+  }
+  void send_P(int code, const String& contentType, const uint8_t* content, size_t length) {
+    send(beginResponse_P(code, contentType, content, length));
+  }
+  void send_P(int code, const String& contentType, PGM_P content) {
+    send(beginResponse_P(code, contentType, content));
+  }
+  void sendChunked(const String& contentType, AwsResponseFiller filler) {
+    send(beginChunkedResponse(contentType, filler));
+  }
+  void redirect(const String& url) {
+    AsyncWebServerResponse* response = beginResponse(302);
+    response->addHeader("Location", url);
+    send(response);
+  }
+
+  // Filled in by hal::serve()
+  AsyncWebServer* _server;
+  AsyncClient _client;
+  WebRequestMethodComposite _method = HTTP_GET;
+  String _url;
+  String _host;
+  String _contentType;
+  size_t _contentLength = 0;
+  bool _isMultipart = false;
+  std::vector<AsyncWebParameter*> _params;
+  std::vector<AsyncWebHeader*> _headers;
+  std::vector<String> _interestingHeaders;
+  std::vector<ArDisconnectHandler> _disconnectHandlers;
+  AsyncWebHandler* _handler = nullptr;
+  AsyncWebServerResponse* _response = nullptr;
+};
+
+// Handler made by server.on(): a URI, methods & callbacks
+class AsyncCallbackWebHandler : public AsyncWebHandler {
+public:
+  void setUri(const String& uri) { _uri = uri; }
+  void setMethod(WebRequestMethodComposite method) { _method = method; }
+  void onRequest(ArRequestHandlerFunction fn) { _onRequest = fn; }
+  void onUpload(ArUploadHandlerFunction fn) { _onUpload = fn; }
+  void onBody(ArBodyHandlerFunction fn) { _onBody = fn; }
+
+  bool canHandle(AsyncWebServerRequest* request) override {
+    if (!_onRequest || !(_method & request->method())) {
+      return false;
+    }
+    const std::string& uri = _uri.str();
+    const std::string& url = request->url().str();
+    if (uri.size() && uri.back() == '*') {
+      if (url.compare(0, uri.size() - 1, uri, 0, uri.size() - 1) != 0) return false;
+    } else if (uri.size() && url != uri && url.compare(0, uri.size() + 1, uri + "/") != 0) {
+      return false;
+    }
+    request->addInterestingHeader("ANY");
+    return true;
+  }
+
+  void handleRequest(AsyncWebServerRequest* request) override {
+    if (_onRequest) _onRequest(request);
+    else request->send(500);
+  }
+  void handleUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final) override {
+    if (_onUpload) _onUpload(request, filename, index, data, len, final);
+  }
+  void handleBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) override {
+    if (_onBody) _onBody(request, data, len, index, total);
+  }
+  bool isRequestHandlerTrivial() override { return !_onBody && !_onUpload; }
+
+private:
+  String _uri;
+  WebRequestMethodComposite _method = HTTP_ANY;
+  ArRequestHandlerFunction _onRequest;
+  ArUploadHandlerFunction _onUpload;
+  ArBodyHandlerFunction _onBody;
+};
+
+class AsyncWebServer {
+public:
+  AsyncWebServer(uint16_t port) : _port(port) {}
+  ~AsyncWebServer() {
+    for (AsyncCallbackWebHandler* handler : _ownHandlers) delete handler;
+  }
+
+  void begin() { _running = true; }
+  void end() { _running = false; }
+
+  AsyncWebHandler& addHandler(AsyncWebHandler* handler) {
+    _handlers.push_back(handler);
+    return *handler;
+  }
+  bool removeHandler(AsyncWebHandler* handler) {
+    for (size_t i = 0; i < _handlers.size(); i++) {
+      if (_handlers[i] == handler) {
+        _handlers.erase(_handlers.begin() + i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  AsyncCallbackWebHandler& on(const char* uri, ArRequestHandlerFunction onRequest) {
+    return on(uri, HTTP_ANY, onRequest);
+  }
+  AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                              ArUploadHandlerFunction onUpload = nullptr, ArBodyHandlerFunction onBody = nullptr) {
+    AsyncCallbackWebHandler* handler = new AsyncCallbackWebHandler();
+    handler->setUri(uri);
+    handler->setMethod(method);
+    handler->onRequest(onRequest);
+    handler->onUpload(onUpload);
+    handler->onBody(onBody);
+    _ownHandlers.push_back(handler);
+    addHandler(handler);
+    return *handler;
+  }
+
+  void onNotFound(ArRequestHandlerFunction fn) { _catchAllHandler.onRequest(fn); }
+  void onFileUpload(ArUploadHandlerFunction fn) { _catchAllHandler.onUpload(fn); }
+  void onRequestBody(ArBodyHandlerFunction fn) { _catchAllHandler.onBody(fn); }
+
+  // Pick the handler, as AsyncWebServer::_attachHandler() does
+  void _attachHandler(AsyncWebServerRequest* request) {
+    for (AsyncWebHandler* handler : _handlers) {
+      if (handler->filter(request) && handler->canHandle(request)) {
+        request->_handler = handler;
+        return;
+      }
+    }
+    request->addInterestingHeader("ANY");
+    request->_handler = &_catchAllHandler;
+  }
+
+  uint16_t _port;
+  bool _running = false;
+  std::vector<AsyncWebHandler*> _handlers;
+  std::vector<AsyncCallbackWebHandler*> _ownHandlers;
+  AsyncCallbackWebHandler _catchAllHandler;
+};
+
+
+/**************************** WebSocket ****************************/
+
+enum AwsEventType { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA };
+enum AwsClientStatus { WS_DISCONNECTED, WS_CONNECTED, WS_DISCONNECTING };
+
+#define WS_MAX_QUEUED_MESSAGES 8   // ESP8266 default of the library
+
+class AsyncWebSocket;
+
+class AsyncWebSocketClient {
+public:
+  AsyncWebSocketClient(AsyncWebSocket* server, uint32_t id) : _server(server), _id(id) {}
+
+  uint32_t id() const { return _id; }
+  AwsClientStatus status() const { return _status; }
+  AsyncClient* client() { return &_tcp; }
+  AsyncWebSocket* server() { return _server; }
+  IPAddress remoteIP() { return _tcp.remote; }
+  bool queueIsFull() const { return _queue.size() >= WS_MAX_QUEUED_MESSAGES || _status != WS_CONNECTED; }
+  bool canSend() const { return !queueIsFull(); }
+
+  // The message is copied into a queued buffer until the TCP stack takes it
+  void text(const char* message, size_t length) {
+    if (queueIsFull()) {
+      _dropped++;
+      return;
+    }
+    _queue.push_back(std::string(message, length));
+    {
+      hal::Quiet quiet;
+      _sent.push_back(_queue.back());
+    }
+  }
+  void text(const char* message) { text(message, strlen(message)); }
+  void text(const String& message) { text(message.c_str(), message.length()); }
+
+  void close(uint16_t code = 0, const char* message = nullptr);
+
+  AsyncWebSocket* _server;
+  uint32_t _id;
+  AwsClientStatus _status = WS_CONNECTED;
+  AsyncClient _tcp;
+  std::deque<std::string> _queue;   // messages waiting for the client
+  std::vector<std::string> _sent;   // every message queued, for the tests
+  uint32_t _dropped = 0;            // messages the queue had no room for
+};
+
+typedef std::function<void(AsyncWebSocket*, AsyncWebSocketClient*, AwsEventType, void*, uint8_t*, size_t)> AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+  AsyncWebSocket(const String& url) : _url(url) {}
+  ~AsyncWebSocket() {
+    for (AsyncWebSocketClient* client : _clients) delete client;
+  }
+
+  void onEvent(AwsEventHandler handler) { _eventHandler = handler; }
+  const char* url() const { return _url.c_str(); }
+
+  AsyncWebSocketClient* client(uint32_t id) {
+    for (AsyncWebSocketClient* client : _clients) {
+      if (client->id() == id && client->status() == WS_CONNECTED) return client;
+    }
+    return nullptr;
+  }
+  size_t count() const {
+    size_t n = 0;
+    for (AsyncWebSocketClient* client : _clients) n += client->status() == WS_CONNECTED;
+    return n;
+  }
+  void textAll(const char* message, size_t length) {
+    for (AsyncWebSocketClient* client : _clients) client->text(message, length);
+  }
+  void cleanupClients(uint16_t maxClients = 4) {}
+
+  bool canHandle(AsyncWebServerRequest* request) override {
+    return request->method() == HTTP_GET && request->url() == _url;   // the upgrade itself is hal::wsConnect()
+  }
+
+  void _event(AsyncWebSocketClient* client, AwsEventType type) {
+    if (_eventHandler) _eventHandler(this, client, type, nullptr, nullptr, 0);
+  }
+
+  // The TCP connection is gone: the event, then the client is freed
+  void _closed(AsyncWebSocketClient* client) {
+    for (size_t i = 0; i < _clients.size(); i++) {
+      if (_clients[i] == client) {
+        _clients.erase(_clients.begin() + i);
+        client->_status = WS_DISCONNECTED;
+        _event(client, WS_EVT_DISCONNECT);
+        delete client;
+        return;
+      }
+    }
+  }
+
+  String _url;
+  AwsEventHandler _eventHandler;
+  std::vector<AsyncWebSocketClient*> _clients;
+  uint32_t _nextId = 1;
+};
+
+// Closing sends a close frame, the disconnect event follows when the TCP connection is gone
+inline void AsyncWebSocketClient::close(uint16_t code, const char* message) {
+  if (_status != WS_CONNECTED) {
+    return;
+  }
+  _status = WS_DISCONNECTING;
+  AsyncWebSocket* server = _server;
+  AsyncWebSocketClient* client = this;
+  hal::after(0, [server, client]() { server->_closed(client); });
+}
+
+
+namespace hal {
+
+typedef std::vector<std::pair<std::string, std::string>> HttpFields;
+
+struct HttpRequest {
+  WebRequestMethod method = HTTP_GET;
+  std::string url = "/";
+  HttpFields query;               // ?name=value
+  HttpFields form;                // POST form fields
+  HttpFields headers;
+  uint32_t ip = IPAddress(192, 168, 1, 50);
+  std::string host = "esp8266.local";
+  std::string upload;             // multipart file upload data
+  std::string filename = "firmware.bin";
+  size_t uploadChunk = 1436;      // upload data per handleUpload() call
+  std::string body;               // raw body, to handleBody()
+  size_t window = 1436;           // bytes the response filler gets per call
+  bool disconnect = true;         // close the connection once the response is sent
+};
+
+struct HttpResponse {
+  int code = 0;                   // 0 if no response was sent
+  std::string contentType;
+  std::string body;
+  HttpFields headers;
+  uint32_t fillerCalls = 0;       // filler calls that returned data
+  std::string handlerHeaders;     // headers the handler saw, "name:value\n" each
+
+  std::string header(const char* name) const {
+    for (const auto& field : headers) {
+      if (strcasecmp(field.first.c_str(), name) == 0) return field.second;
+    }
+    return std::string();
+  }
+  bool hasHeader(const char* name) const {
+    for (const auto& field : headers) {
+      if (strcasecmp(field.first.c_str(), name) == 0) return true;
+    }
+    return false;
+  }
+};
+
+inline std::vector<AsyncWebServerRequest*> openRequests;   // requests served with disconnect = false
+inline uint32_t requestsServed = 0;
+
+// The connection of a request closes: disconnect callbacks, then it is freed
+inline void closeRequest(AsyncWebServerRequest* request) {
+  std::vector<ArDisconnectHandler> handlers = request->_disconnectHandlers;
+  for (ArDisconnectHandler& handler : handlers) {
+    handler();
+  }
+  delete request;
+}
+
+inline void closeRequests() {
+  std::vector<AsyncWebServerRequest*> requests;
+  {
+    Quiet quiet;
+    requests.swap(openRequests);
+  }
+  for (AsyncWebServerRequest* request : requests) {
+    closeRequest(request);
+  }
+}
+
+// Send the response to the client: what it gets, the filler drained a window at a time
+inline void renderResponse(AsyncWebServerResponse* response, size_t window, HttpResponse& out) {
+  out.code = response->_code;
+  {
+    Quiet quiet;
+    out.contentType = response->_contentType.str();
+    for (AsyncWebHeader* header : response->_headers) {
+      out.headers.push_back({ header->name().str(), header->value().str() });
+    }
+    out.body = response->_content;
+  }
+
+  if (response->_file) {
+    uint8_t buffer[512];
+    size_t n;
+    while ((n = response->_file.read(buffer, sizeof(buffer))) > 0) {
+      Quiet quiet;
+      out.body.append((const char*)buffer, n);
+    }
+    response->_file.close();
+  }
+
+  if (response->_filler) {
+    std::vector<uint8_t> buffer(window);
+    size_t index = 0;
+    for (int retries = 0; retries < 1000;) {
+      size_t n = response->_filler(buffer.data(), window, index);
+      if (n == RESPONSE_TRY_AGAIN) {
+        retries++;
+        continue;
+      }
+      if (n == 0 || (response->_contentLength && index >= response->_contentLength)) {
+        break;
+      }
+      out.fillerCalls++;
+      index += n;
+      Quiet quiet;
+      out.body.append((const char*)buffer.data(), n);
+    }
+  }
+}
+
+// Run a request through the server, returns what the client got
+inline HttpResponse serve(AsyncWebServer& server, const HttpRequest& in) {
+  HttpResponse out;
+  requestsServed++;
+
+  // Request line & headers, as received
+  AsyncWebServerRequest* request = new AsyncWebServerRequest(&server);
+  request->_method = in.method;
+  request->_url = in.url.c_str();
+  request->_host = in.host.c_str();
+  request->_client.remote = IPAddress(in.ip);
+  for (const auto& field : in.query) {
+    request->_params.push_back(new AsyncWebParameter(field.first.c_str(), field.second.c_str()));
+  }
+  for (const auto& field : in.headers) {
+    request->_headers.push_back(new AsyncWebHeader(field.first.c_str(), field.second.c_str()));
+  }
+  request->_contentLength = in.upload.size() ? in.upload.size() : in.body.size();
+  request->_isMultipart = !in.upload.empty();
+
+  // End of the headers: pick the handler, drop the headers nobody asked for
+  server._attachHandler(request);
+  bool keepAll = false;
+  for (const String& name : request->_interestingHeaders) {
+    keepAll |= name.equalsIgnoreCase("ANY");
+  }
+  if (!keepAll) {
+    for (size_t i = 0; i < request->_headers.size();) {
+      bool interesting = false;
+      for (const String& name : request->_interestingHeaders) {
+        interesting |= request->_headers[i]->name().equalsIgnoreCase(name);
+      }
+      if (interesting) {
+        i++;
+      } else {
+        delete request->_headers[i];
+        request->_headers.erase(request->_headers.begin() + i);
+      }
+    }
+  }
+  {
+    Quiet quiet;
+    for (AsyncWebHeader* header : request->_headers) {
+      out.handlerHeaders += header->name().str() + ":" + header->value().str() + "\n";
+    }
+  }
+
+  // Body: form fields, upload pieces, raw body
+  for (const auto& field : in.form) {
+    request->_params.push_back(new AsyncWebParameter(field.first.c_str(), field.second.c_str(), true));
+  }
+  AsyncWebHandler* handler = request->_handler;
+  if (!in.upload.empty()) {
+    std::vector<uint8_t> piece;
+    for (size_t index = 0; index < in.upload.size(); index += in.uploadChunk) {
+      size_t n = std::min(in.uploadChunk, in.upload.size() - index);
+      {
+        Quiet quiet;
+        piece.assign(in.upload.begin() + index, in.upload.begin() + index + n);
+      }
+      handler->handleUpload(request, String(in.filename.c_str()), index, piece.data(), n, index + n == in.upload.size());
+    }
+  }
+  if (!in.body.empty()) {
+    std::vector<uint8_t> body(in.body.begin(), in.body.end());
+    handler->handleBody(request, body.data(), body.size(), 0, body.size());
+  }
+
+  handler->handleRequest(request);
+  if (request->_response) {
+    renderResponse(request->_response, in.window, out);
+  }
+
+  if (in.disconnect) {
+    closeRequest(request);
+  } else {
+    Quiet quiet;
+    openRequests.push_back(request);
+  }
+  return out;
+}
+
+inline HttpResponse get(AsyncWebServer& server, const char* url, const HttpFields& headers = {}) {
+  HttpRequest request;
+  request.url = url;
+  request.headers = headers;
+  return serve(server, request);
+}
+
+// A browser opens the WebSocket, returns the client id
+inline uint32_t wsConnect(AsyncWebSocket& socket, uint32_t ip = IPAddress(192, 168, 1, 50)) {
+  AsyncWebSocketClient* client = new AsyncWebSocketClient(&socket, socket._nextId++);
+  client->_tcp.remote = IPAddress(ip);
+  socket._clients.push_back(client);
+  socket._event(client, WS_EVT_CONNECT);
+  return client->id();
+}
+
+// Client state, including one closing (nullptr once it is gone)
+inline AsyncWebSocketClient* wsClient(AsyncWebSocket& socket, uint32_t id) {
+  for (AsyncWebSocketClient* client : socket._clients) {
+    if (client->id() == id) return client;
+  }
+  return nullptr;
+}
+
+// The client took everything queued, returns the bytes it got
+inline size_t wsDeliver(AsyncWebSocket& socket, uint32_t id) {
+  AsyncWebSocketClient* client = wsClient(socket, id);
+  size_t bytes = 0;
+  while (client && !client->_queue.empty()) {
+    bytes += client->_queue.front().size();
+    client->_queue.pop_front();
+  }
+  return bytes;
+}
+
+// The browser closed the connection
+inline void wsDisconnect(AsyncWebSocket& socket, uint32_t id) {
+  AsyncWebSocketClient* client = wsClient(socket, id);
+  if (client) socket._closed(client);
+}
+
+}  // namespace hal
+
+#endif
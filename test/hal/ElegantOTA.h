@@ -0,0 +1,152 @@
+/****************************************************************************************
+* Native HAL - ElegantOTA
+* The endpoints & callbacks of ElegantOTA 3 (async mode), so an upload runs like the
+* library runs it:
+* 1. GET /ota/start?mode=fr|fs&hash=... : onStart(), then Update.begin() for the firmware
+*    (fr) or the filesystem (fs),
+* 2. POST /ota/upload : the data goes to Update.write() & onProgress(), Update.end(true) on
+*    the last piece, then onEnd(!Update.hasError()) & the reboot is armed,
+* 3. loop() reboots 2 s after a successful upload when auto reboot is on.
+* With a username given to begin() (or setAuth()) every route asks for it first.
+* hal::otaUpload(server, image, filesystem) sends both requests like the web page does.
+****************************************************************************************/
+
+#ifndef HAL_ElegantOTA_h
+#define HAL_ElegantOTA_h
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <Updater.h>
+
+enum OTA_Mode { OTA_MODE_FIRMWARE = 0, OTA_MODE_FILESYSTEM = 1 };
+
+class ElegantOTAClass {
+public:
+  void begin(AsyncWebServer* server, const char* username = "", const char* password = "") {
+    _server = server;
+    setAuth(username, password);
+
+    _server->on("/update", HTTP_GET, [this](AsyncWebServerRequest* request) {
+      if (_authenticate && !request->authenticate(_username.c_str(), _password.c_str())) {
+        return request->requestAuthentication();
+      }
+      request->send(200, "text/html", "ElegantOTA");
+    });
+
+    _server->on("/ota/start", HTTP_GET, [this](AsyncWebServerRequest* request) {
+      if (_authenticate && !request->authenticate(_username.c_str(), _password.c_str())) {
+        return request->requestAuthentication();
+      }
+      int mode = U_FLASH;
+      if (request->hasParam("mode")) {
+        mode = request->getParam("mode")->value() == "fs" ? U_FS : U_FLASH;
+      }
+      if (preUpdateCallback != nullptr) {
+        preUpdateCallback();
+      }
+      _updateResult = false;
+      Update.runAsync(true);
+      if (!Update.begin(UPDATE_SIZE_UNKNOWN, mode)) {
+        return request->send(400, "text/plain", "Failed to start update process");
+      }
+      return request->send(200, "text/plain", "OK");
+    });
+
+    _server->on(
+      "/ota/upload", HTTP_POST,
+      [this](AsyncWebServerRequest* request) {
+        if (_authenticate && !request->authenticate(_username.c_str(), _password.c_str())) {
+          return request->requestAuthentication();
+        }
+        if (postUpdateCallback != nullptr) {
+          postUpdateCallback(!Update.hasError());
+        }
+        AsyncWebServerResponse* response = request->beginResponse(Update.hasError() ? 400 : 200, "text/plain", Update.hasError() ? "Update failed" : "OK");
+        response->addHeader("Connection", "close");
+        request->send(response);
+        if (!Update.hasError()) {
+          _rebootAtMS = millis() + 2000;
+          _rebootPending = _autoReboot;
+        }
+      },
+      [this](AsyncWebServerRequest* request, String filename, size_t index, uint8_t* data, size_t len, bool final) {
+        if (_authenticate && !request->authenticate(_username.c_str(), _password.c_str())) {
+          return request->requestAuthentication();
+        }
+        if (len) {
+          if (Update.write(data, len) != len) {
+            return request->send(400, "text/plain", "Failed to write chunked data to free space");
+          }
+          _current += len;
+          if (progressUpdateCallback != nullptr) {
+            progressUpdateCallback(_current, request->contentLength());
+          }
+        }
+        if (final) {
+          _current = 0;
+          if (!Update.end(true)) {
+            return request->send(400, "text/plain", "Could not end OTA");
+          }
+        }
+      });
+  }
+
+  void setAuth(const char* username, const char* password) {
+    _username = username;
+    _password = password;
+    _authenticate = _username.length() > 0;
+  }
+  void clearAuth() { _authenticate = false; }
+  void setAutoReboot(bool enable) { _autoReboot = enable; }
+  void onStart(void (*callback)()) { preUpdateCallback = callback; }
+  void onProgress(void (*callback)(size_t current, size_t final)) { progressUpdateCallback = callback; }
+  void onEnd(void (*callback)(bool success)) { postUpdateCallback = callback; }
+
+  void loop() {
+    if (_rebootPending && (int32_t)(millis() - _rebootAtMS) >= 0) {
+      _rebootPending = false;
+      ESP.restart();
+    }
+  }
+
+private:
+  AsyncWebServer* _server = nullptr;
+  String _username;
+  String _password;
+  bool _authenticate = false;
+  bool _autoReboot = true;
+  bool _rebootPending = false;
+  bool _updateResult = false;
+  uint32_t _rebootAtMS = 0;
+  size_t _current = 0;
+  void (*preUpdateCallback)() = nullptr;
+  void (*progressUpdateCallback)(size_t, size_t) = nullptr;
+  void (*postUpdateCallback)(bool) = nullptr;
+};
+
+inline ElegantOTAClass ElegantOTA;
+
+namespace hal {
+
+// Upload an image like the ElegantOTA page does: /ota/start, then /ota/upload
+inline HttpResponse otaUpload(AsyncWebServer& server, const std::string& image, bool filesystem = false, size_t chunk = 1436) {
+  HttpRequest start;
+  start.url = "/ota/start";
+  start.query = { { "mode", filesystem ? "fs" : "fr" }, { "hash", "" } };
+  HttpResponse started = serve(server, start);
+  if (started.code != 200) {
+    return started;
+  }
+
+  HttpRequest upload;
+  upload.method = HTTP_POST;
+  upload.url = "/ota/upload";
+  upload.upload = image;
+  upload.uploadChunk = chunk;
+  upload.filename = filesystem ? "littlefs.bin" : "firmware.bin";
+  return serve(server, upload);
+}
+
+}  // namespace hal
+
+#endif
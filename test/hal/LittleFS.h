@@ -0,0 +1,204 @@
+/****************************************************************************************
+* Native HAL - LittleFS
+* An in memory file system: hal::putFile() / hal::readFile() for the tests, opens are
+* counted (hal::fsOpens) so a test can check a path that must not touch the file system.
+* A begin() that cannot mount (hal::fsMountable false) formats & mounts an empty file
+* system unless LittleFSConfig::setAutoFormat(false) was set, as the ESP8266 core does.
+* An open File holds a handle on the heap, as on the device.
+****************************************************************************************/
+
+#ifndef HAL_LittleFS_h
+#define HAL_LittleFS_h
+
+#include <Arduino.h>
+
+namespace hal {
+
+typedef std::vector<uint8_t> FileData;
+
+inline std::map<std::string, std::shared_ptr<FileData>> files;
+inline uint32_t fsOpens = 0;       // open() calls that found (or created) a file
+inline bool fsMountable = true;    // begin() result
+inline bool fsMounted = false;
+inline bool fsAutoFormat = true;   // setConfig()
+inline uint32_t fsFormats = 0;     // format() calls, the auto format included
+
+inline void putFile(const char* path, const void* data, size_t length) {
+  Quiet quiet;
+  files[path] = std::make_shared<FileData>((const uint8_t*)data, (const uint8_t*)data + length);
+}
+
+inline void putFile(const char* path, const char* text) {
+  putFile(path, text, strlen(text));
+}
+
+inline std::string readFile(const char* path) {
+  Quiet quiet;
+  auto it = files.find(path);
+  return it == files.end() ? std::string() : std::string(it->second->begin(), it->second->end());
+}
+
+inline bool hasFile(const char* path) {
+  return files.count(path) > 0;
+}
+
+}  // namespace hal
+
+namespace fs {
+
+// Open file state, on the heap like the core's FileImpl
+struct FileImpl {
+  std::shared_ptr<hal::FileData> data;
+  std::string path;
+  size_t position;
+  bool writable;
+};
+
+class File : public Print {
+public:
+  File() {}
+  File(std::shared_ptr<FileImpl> impl) : impl(impl) {}
+
+  operator bool() const { return impl != nullptr; }
+
+  int available() { return impl ? impl->data->size() - impl->position : 0; }
+  int read() {
+    if (!impl || impl->position >= impl->data->size()) return -1;
+    return (*impl->data)[impl->position++];
+  }
+  int peek() { return impl && impl->position < impl->data->size() ? (*impl->data)[impl->position] : -1; }
+  size_t read(uint8_t* buffer, size_t length) {
+    size_t n = std::min(length, (size_t)available());
+    if (n) memcpy(buffer, impl->data->data() + impl->position, n);
+    if (impl) impl->position += n;
+    return n;
+  }
+  size_t readBytes(char* buffer, size_t length) { return read((uint8_t*)buffer, length); }
+
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t length) override {
+    if (!impl || !impl->writable) return 0;
+    hal::Quiet quiet;
+    hal::FileData& bytes = *impl->data;
+    if (impl->position + length > bytes.size()) bytes.resize(impl->position + length);
+    memcpy(bytes.data() + impl->position, data, length);
+    impl->position += length;
+    return length;
+  }
+
+  bool seek(uint32_t position) {
+    if (!impl || position > impl->data->size()) return false;
+    impl->position = position;
+    return true;
+  }
+  size_t position() const { return impl ? impl->position : 0; }
+  size_t size() const { return impl ? impl->data->size() : 0; }
+  const char* name() const { return impl ? impl->path.c_str() : ""; }
+  void flush() override {}
+  void close() { impl.reset(); }
+
+private:
+  std::shared_ptr<FileImpl> impl;
+};
+
+class FSConfig {
+public:
+  bool _autoFormat = true;
+};
+
+class LittleFSConfig : public FSConfig {
+public:
+  LittleFSConfig& setAutoFormat(bool autoFormat) {
+    _autoFormat = autoFormat;
+    return *this;
+  }
+};
+
+class FS {
+public:
+  bool setConfig(const FSConfig& config) {
+    hal::fsAutoFormat = config._autoFormat;
+    return true;
+  }
+  bool begin() {
+    if (!hal::fsMountable && hal::fsAutoFormat) {
+      format();
+      hal::fsMountable = true;
+    }
+    hal::fsMounted = hal::fsMountable;
+    return hal::fsMounted;
+  }
+  void end() { hal::fsMounted = false; }
+  bool format() {
+    hal::Quiet quiet;
+    hal::files.clear();
+    hal::fsFormats++;
+    return true;
+  }
+
+  File open(const char* path, const char* mode) {
+    if (!hal::fsMounted) {
+      return File();
+    }
+    std::shared_ptr<hal::FileData> data;
+    {
+      hal::Quiet quiet;
+      auto it = hal::files.find(path);
+      if (mode[0] == 'r' && it == hal::files.end()) {
+        return File();
+      }
+      if (mode[0] == 'w' || it == hal::files.end()) {
+        data = std::make_shared<hal::FileData>();
+        hal::files[path] = data;
+      } else {
+        data = it->second;
+      }
+    }
+    hal::fsOpens++;
+    size_t position = mode[0] == 'a' ? data->size() : 0;
+    std::shared_ptr<FileImpl> impl = std::make_shared<FileImpl>();   // counted, the core allocates one too
+    impl->data = data;
+    {
+      hal::Quiet quiet;
+      impl->path = path;
+    }
+    impl->position = position;
+    impl->writable = mode[0] != 'r' || mode[1] == '+';
+    return File(impl);
+  }
+  File open(const String& path, const char* mode) { return open(path.c_str(), mode); }
+
+  bool exists(const char* path) { return hal::fsMounted && hal::hasFile(path); }
+  bool exists(const String& path) { return exists(path.c_str()); }
+
+  bool remove(const char* path) {
+    hal::Quiet quiet;
+    return hal::fsMounted && hal::files.erase(path) > 0;
+  }
+
+  bool rename(const char* from, const char* to) {
+    hal::Quiet quiet;
+    auto it = hal::files.find(from);
+    if (!hal::fsMounted || it == hal::files.end()) {
+      return false;
+    }
+    std::shared_ptr<hal::FileData> data = it->second;
+    hal::files.erase(it);
+    hal::files[to] = data;
+    return true;
+  }
+
+  bool mkdir(const char* path) { return true; }
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::FSConfig;
+using fs::LittleFSConfig;
+
+inline fs::FS LittleFS;
+
+#endif
@@ -0,0 +1,56 @@
+/****************************************************************************************
+* Native HAL - Ticker
+* Timer callbacks on the simulated clock, they run while delay() / yield() move it.
+****************************************************************************************/
+
+#ifndef HAL_Ticker_h
+#define HAL_Ticker_h
+
+#include <Arduino.h>
+
+class Ticker {
+public:
+  typedef void (*callback_t)();
+
+  ~Ticker() { detach(); }
+
+  void attach_ms(uint32_t periodMS, callback_t callback) {
+    detach();
+    schedule(++generation, periodMS, callback, true);
+  }
+
+  void attach(float seconds, callback_t callback) { attach_ms(seconds * 1000, callback); }
+
+  void once_ms(uint32_t delayMS, callback_t callback) {
+    detach();
+    schedule(++generation, delayMS, callback, false);
+  }
+
+  void detach() {
+    generation++;
+    running = false;
+  }
+
+  bool active() const { return running; }
+
+private:
+  void schedule(uint32_t ticket, uint32_t periodMS, callback_t callback, bool repeat) {
+    running = true;
+    hal::after(periodMS, [this, ticket, periodMS, callback, repeat]() {
+      if (ticket != generation) {
+        return;   // detached or attached again since
+      }
+      if (repeat) {
+        schedule(ticket, periodMS, callback, true);
+      } else {
+        running = false;
+      }
+      callback();
+    });
+  }
+
+  uint32_t generation = 0;
+  bool running = false;
+};
+
+#endif
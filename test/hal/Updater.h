@@ -0,0 +1,112 @@
+/****************************************************************************************
+* Native HAL - Updater
+* Writes a firmware update to flash after the running sketch & leaves the copy command for
+* the bootloader on end(), as the core does. A filesystem update (U_FS) goes to
+* hal::fsImage, without a command. hal::updateFailWrite makes a write fail.
+****************************************************************************************/
+
+#ifndef HAL_Updater_h
+#define HAL_Updater_h
+
+#include <Arduino.h>
+#include <eboot_command.h>
+
+#define U_FLASH 0
+#define U_FS    100
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+#define UPDATE_ERROR_OK       0
+#define UPDATE_ERROR_WRITE    1
+#define UPDATE_ERROR_SPACE    4
+#define UPDATE_ERROR_SIZE     5
+#define UPDATE_ERROR_ABORT    8
+
+namespace hal {
+
+const uint32_t UPDATE_ADDRESS = 0x100000;   // where the new image is written, above the running one
+const uint32_t UPDATE_MAX_SIZE = 1024 * 1024 - 0x1000;
+
+inline std::vector<uint8_t> fsImage;        // last filesystem update
+inline bool updateFailWrite = false;
+inline uint32_t updateBegins = 0;
+
+}  // namespace hal
+
+class UpdaterClass {
+public:
+  bool begin(size_t size, int command = U_FLASH) {
+    hal::updateBegins++;
+    if (running) {
+      return false;
+    }
+    error = UPDATE_ERROR_OK;
+    if (size == 0 || (size > hal::UPDATE_MAX_SIZE && size != UPDATE_SIZE_UNKNOWN)) {
+      error = UPDATE_ERROR_SPACE;
+      return false;
+    }
+    expected = size;
+    written = 0;
+    mode = command;
+    running = true;
+    if (mode == U_FS) {
+      hal::Quiet quiet;
+      hal::fsImage.clear();
+    }
+    return true;
+  }
+
+  size_t write(uint8_t* data, size_t length) {
+    if (!running || hal::updateFailWrite || (expected != UPDATE_SIZE_UNKNOWN && written + length > expected)) {
+      error = UPDATE_ERROR_WRITE;
+      return 0;
+    }
+    if (mode == U_FS) {
+      hal::Quiet quiet;
+      hal::fsImage.insert(hal::fsImage.end(), data, data + length);
+    } else {
+      memcpy(hal::flashMemory() + hal::UPDATE_ADDRESS + written, data, length);
+    }
+    written += length;
+    return length;
+  }
+
+  // Commit the image: evenIfRemaining takes a short image (an upload of unknown size)
+  bool end(bool evenIfRemaining = false) {
+    if (!running) {
+      return false;
+    }
+    running = false;
+    if (hasError() || (!evenIfRemaining && expected != UPDATE_SIZE_UNKNOWN && written != expected)) {
+      if (!hasError()) error = UPDATE_ERROR_SIZE;
+      return false;
+    }
+    if (mode == U_FLASH) {
+      eboot_command command = {};
+      command.action = ACTION_COPY_RAW;
+      command.args[0] = hal::UPDATE_ADDRESS;
+      command.args[1] = 0;
+      command.args[2] = written;
+      eboot_command_write(&command);
+    }
+    return true;
+  }
+
+  void runAsync(bool async) {}
+  bool isRunning() { return running; }
+  bool hasError() { return error != UPDATE_ERROR_OK; }
+  uint8_t getError() { return error; }
+  size_t progress() { return written; }
+  size_t size() { return expected; }
+  bool setMD5(const char* md5) { return true; }
+
+private:
+  bool running = false;
+  uint8_t error = UPDATE_ERROR_OK;
+  size_t expected = 0;
+  size_t written = 0;
+  int mode = U_FLASH;
+};
+
+inline UpdaterClass Update;
+
+#endif
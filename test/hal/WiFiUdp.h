@@ -0,0 +1,88 @@
+/****************************************************************************************
+* Native HAL - WiFiUdp
+* Packets a test puts in hal::udpInbox are read with parsePacket() / read(), what the helper
+* sends ends up in hal::udpSent.
+****************************************************************************************/
+
+#ifndef HAL_WiFiUdp_h
+#define HAL_WiFiUdp_h
+
+#include <ESP8266WiFi.h>
+#include <deque>
+
+namespace hal {
+
+struct UdpPacket {
+  std::vector<uint8_t> data;
+  IPAddress ip;     // sender, or destination of a sent packet
+  uint16_t port;
+};
+
+inline std::deque<UdpPacket> udpInbox;
+inline std::vector<UdpPacket> udpSent;
+
+inline void receiveUdp(const uint8_t* data, size_t length, IPAddress ip, uint16_t port) {
+  Quiet quiet;
+  udpInbox.push_back({ std::vector<uint8_t>(data, data + length), ip, port });
+}
+
+}  // namespace hal
+
+class WiFiUDP {
+public:
+  uint8_t begin(uint16_t port) { localPort = port; return 1; }
+  void stop() { localPort = 0; }
+
+  int parsePacket() {
+    hal::Quiet quiet;
+    current.data.clear();
+    readPos = 0;
+    if (localPort == 0 || hal::udpInbox.empty()) {
+      return 0;
+    }
+    current = hal::udpInbox.front();
+    hal::udpInbox.pop_front();
+    return current.data.size();
+  }
+
+  int available() { return current.data.size() - readPos; }
+
+  int read(uint8_t* buffer, size_t length) {
+    size_t n = std::min(length, current.data.size() - readPos);
+    memcpy(buffer, current.data.data() + readPos, n);
+    readPos += n;
+    return n;
+  }
+
+  int read(char* buffer, size_t length) { return read((uint8_t*)buffer, length); }
+  IPAddress remoteIP() { return current.ip; }
+  uint16_t remotePort() { return current.port; }
+
+  int beginPacket(IPAddress ip, uint16_t port) {
+    hal::Quiet quiet;
+    outgoing = { {}, ip, port };
+    return 1;
+  }
+
+  size_t write(const uint8_t* data, size_t length) {
+    hal::Quiet quiet;
+    outgoing.data.insert(outgoing.data.end(), data, data + length);
+    return length;
+  }
+
+  size_t write(uint8_t b) { return write(&b, 1); }
+
+  int endPacket() {
+    hal::Quiet quiet;
+    hal::udpSent.push_back(outgoing);
+    return 1;
+  }
+
+private:
+  uint16_t localPort = 0;
+  hal::UdpPacket current;
+  hal::UdpPacket outgoing;
+  size_t readPos = 0;
+};
+
+#endif
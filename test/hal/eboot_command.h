@@ -0,0 +1,48 @@
+/****************************************************************************************
+* Native HAL - eboot_command
+* The command Updater leaves in RTC memory for the bootloader: copy the new image over the
+* running one on the next boot.
+****************************************************************************************/
+
+#ifndef HAL_eboot_command_h
+#define HAL_eboot_command_h
+
+#include <Arduino.h>
+
+#define EBOOT_MAGIC 0xeb001000
+#define EBOOT_MAGIC_MASK 0xfffff000
+
+enum action_t {
+  ACTION_COPY_RAW = 0x00000001,
+  ACTION_LOAD_APP = 0xffffffff
+};
+
+struct eboot_command {
+  uint32_t magic;
+  enum action_t action;
+  uint32_t args[29];
+  uint32_t crc32;
+};
+
+namespace hal {
+inline eboot_command ebootCommand = {};
+}
+
+inline int eboot_command_read(struct eboot_command* command) {
+  if ((hal::ebootCommand.magic & EBOOT_MAGIC_MASK) != EBOOT_MAGIC) {
+    return 1;
+  }
+  *command = hal::ebootCommand;
+  return 0;
+}
+
+inline void eboot_command_write(struct eboot_command* command) {
+  hal::ebootCommand = *command;
+  hal::ebootCommand.magic = EBOOT_MAGIC;
+}
+
+inline void eboot_command_clear() {
+  hal::ebootCommand = {};
+}
+
+#endif
@@ -0,0 +1,253 @@
+/****************************************************************************************
+* ESPAdmission.h in front of ElegantOTAHelper.h's server: per-IP token buckets (burst,
+* refill, the idle IP making room), the in-flight limit & its stale slots, the answer
+* keeping the reason a request was turned away for (503, or 429 for the rate limit only),
+* OTA priority & a load simulation: 50 clients arrive within 50 ms at a node a little above the heap
+* floor, each connection holding the TCP memory the stack gives it. Admitted requests stay
+* open (slow clients), turned away ones close at once. The heap never goes more than one
+* request below ADMIT_MIN_FREE_HEAP & is all back afterwards, where the same burst at a
+* server without the guard runs the heap out.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ElegantOTAHelper.h"
+#include <unity.h>
+
+const uint32_t CONNECTION_BYTES = 1600;   // lwIP per connection: PCB & a receive pbuf, ballpark
+const uint32_t BURST_CLIENTS = 50;
+const uint32_t BURST_IPS = 10;
+const uint32_t START_FREE_HEAP = ADMIT_MIN_FREE_HEAP + 5000;   // a node already busy, room for 2 requests
+
+AsyncWebServer bare(8080);   // the same landing page, no guard
+
+struct BurstResult {
+  uint32_t ok, busy, rateLimited, lowHeap, other;
+  uint32_t lowestFree;   // sampled after each request, admitted ones still open
+  uint32_t maxOpen;
+};
+
+uint32_t clientIP(int i) {
+  return IPAddress(192, 168, 1, 100 + i % BURST_IPS);
+}
+
+// One client connects, sends GET / & keeps the connection open if the answer was a 200
+hal::HttpResponse arrive(AsyncWebServer& target, int i) {
+  hal::heapTaken += CONNECTION_BYTES;
+  hal::HttpRequest request;
+  request.ip = clientIP(i);
+  request.disconnect = false;
+  hal::HttpResponse response = hal::serve(target, request);
+  if (response.code != 200) {
+    AsyncWebServerRequest* turnedAway = hal::openRequests.back();
+    {
+      hal::Quiet quiet;
+      hal::openRequests.pop_back();
+    }
+    hal::closeRequest(turnedAway);
+    hal::heapTaken -= CONNECTION_BYTES;
+  }
+  return response;
+}
+
+void closeAll() {
+  hal::heapTaken -= hal::openRequests.size() * CONNECTION_BYTES;
+  hal::closeRequests();
+}
+
+BurstResult runBurst(AsyncWebServer& target) {
+  BurstResult result = {};
+  result.lowestFree = hal::freeHeap();
+  for (uint32_t i = 0; i < BURST_CLIENTS; i++) {
+    int code = arrive(target, i).code;
+    result.ok += code == 200;
+    result.busy += code == 503;
+    result.rateLimited += code == 429;
+    result.other += code != 200 && code != 503 && code != 429;
+    result.lowestFree = min(result.lowestFree, hal::freeHeap());
+    result.maxOpen = max(result.maxOpen, (uint32_t)hal::openRequests.size());
+    delay(1);
+  }
+  return result;
+}
+
+// Take heap away so the node starts the burst with START_FREE_HEAP
+void startAt(uint32_t freeHeap) {
+  hal::heapTaken = 0;
+  hal::heapTaken = hal::freeHeap() - freeHeap;
+}
+
+void setUp() {
+  delay(ADMIT_BURST * ADMIT_REFILL_MS);   // every bucket full again
+}
+
+void tearDown() {
+  closeAll();
+  setOTAPriority(false);
+  hal::heapTaken = 0;
+}
+
+
+void test_ip_burst_then_refill() {
+  for (int i = 0; i < ADMIT_BURST; i++) {
+    TEST_ASSERT_EQUAL(200, hal::get(server, "/").code);
+  }
+  hal::HttpResponse limited = hal::get(server, "/");
+  TEST_ASSERT_EQUAL(429, limited.code);
+  TEST_ASSERT_EQUAL_STRING(ADMIT_RATE_TEXT, limited.body.c_str());
+
+  hal::HttpRequest other;
+  other.ip = IPAddress(192, 168, 1, 51);   // another client is not held up
+  TEST_ASSERT_EQUAL(200, hal::serve(server, other).code);
+
+  delay(ADMIT_REFILL_MS);   // one token back
+  TEST_ASSERT_EQUAL(200, hal::get(server, "/").code);
+  TEST_ASSERT_EQUAL(429, hal::get(server, "/").code);
+}
+
+void test_idle_ip_makes_room_in_the_table() {
+  for (int i = 0; i <= ADMIT_RATE_TABLE; i++) {
+    hal::HttpRequest request;
+    request.ip = IPAddress(10, 0, 0, 1 + i);
+    TEST_ASSERT_EQUAL(200, hal::serve(server, request).code);
+    delay(10);
+  }
+  bool firstKept = false, lastKept = false;
+  for (int i = 0; i < ADMIT_RATE_TABLE; i++) {
+    firstKept |= rateBuckets[i].ip == (uint32_t)IPAddress(10, 0, 0, 1);
+    lastKept |= rateBuckets[i].ip == (uint32_t)IPAddress(10, 0, 0, 1 + ADMIT_RATE_TABLE);
+  }
+  TEST_ASSERT_FALSE(firstKept);   // idle longest
+  TEST_ASSERT_TRUE(lastKept);
+}
+
+void test_in_flight_limit_and_stale_slots() {
+  for (int i = 0; i < ADMIT_MAX_REQUESTS; i++) {
+    TEST_ASSERT_EQUAL(200, arrive(server, i).code);
+  }
+  TEST_ASSERT_EQUAL(503, arrive(server, ADMIT_MAX_REQUESTS).code);
+  TEST_ASSERT_EQUAL(ADMIT_MAX_REQUESTS, hal::openRequests.size());
+
+  // An OTA route is not counted against the limit
+  TEST_ASSERT_EQUAL(200, hal::get(server, "/update").code);
+
+  // A slot whose disconnect never came is taken over, its late release changes nothing
+  delay(ADMIT_STALE_MS);
+  TEST_ASSERT_EQUAL(200, arrive(server, 0).code);
+  AsyncWebServerRequest* oldest = hal::openRequests.front();
+  {
+    hal::Quiet quiet;
+    hal::openRequests.erase(hal::openRequests.begin());
+  }
+  hal::closeRequest(oldest);
+  hal::heapTaken -= CONNECTION_BYTES;
+  TEST_ASSERT_TRUE(admitSlotUsed[0]);   // still the new request's
+
+  closeAll();
+  for (int i = 0; i < ADMIT_MAX_REQUESTS; i++) {
+    TEST_ASSERT_FALSE(admitSlotUsed[i]);
+  }
+}
+
+void test_answer_keeps_the_reason_it_was_turned_away_for() {
+  for (int i = 0; i < ADMIT_MAX_REQUESTS; i++) {
+    TEST_ASSERT_EQUAL(200, arrive(server, i).code);
+  }
+  // Turned away while busy, then the slots free up before the body is in & it is answered
+  AsyncWebServerRequest request(&server);
+  request._method = HTTP_POST;
+  request._url = "/";
+  request._client.remote = IPAddress(192, 168, 1, 60);
+  TEST_ASSERT_TRUE(admissionGuard.canHandle(&request));
+  closeAll();
+  TEST_ASSERT_EQUAL(ADMIT_OK, admitReason("/", request._client.remote, millis(), ESP.getFreeHeap()));
+  admissionGuard.handleRequest(&request);
+  TEST_ASSERT_EQUAL(503, request._response->_code);
+
+  // Rate limited, then refilled before the answer: still the 429 it was turned away with
+  for (int i = 0; i < ADMIT_BURST; i++) {
+    hal::get(server, "/");
+  }
+  AsyncWebServerRequest limited(&server);
+  limited._url = "/";
+  limited._client.remote = IPAddress(192, 168, 1, 50);
+  TEST_ASSERT_TRUE(admissionGuard.canHandle(&limited));
+  delay(ADMIT_REFILL_MS);
+  admissionGuard.handleRequest(&limited);
+  TEST_ASSERT_EQUAL(429, limited._response->_code);
+}
+
+void test_ota_priority_sheds_other_routes() {
+  setOTAPriority(true);
+  TEST_ASSERT_EQUAL(503, hal::get(server, "/").code);
+  TEST_ASSERT_EQUAL(503, hal::get(server, "/metrics").code);
+  TEST_ASSERT_EQUAL(200, hal::get(server, "/update").code);
+
+  delay(ADMIT_OTA_IDLE_MS);   // upload stalled: priority ends by itself
+  TEST_ASSERT_EQUAL(200, hal::get(server, "/").code);
+}
+
+void test_turned_away_costs_less_than_served() {
+  hal::get(server, "/");
+  hal::resetHeapStats();
+  hal::get(server, "/");
+  uint32_t served = hal::heap.peakBytes;
+
+  startAt(ADMIT_MIN_FREE_HEAP - 1);
+  hal::resetHeapStats();
+  hal::HttpResponse rejected = hal::get(server, "/");
+  TEST_ASSERT_EQUAL(503, rejected.code);
+  TEST_ASSERT_EQUAL_STRING(ADMIT_BUSY_TEXT, rejected.body.c_str());
+  printf("peak heap of a request: %u bytes served, %u turned away\n", served, (unsigned)hal::heap.peakBytes);
+  TEST_ASSERT_LESS_THAN(served, hal::heap.peakBytes);
+}
+
+void test_burst_of_50_holds_the_heap_floor() {
+  uint32_t rejectedBefore = admitCounts[ADMIT_LOW_HEAP] + admitCounts[ADMIT_BUSY] + admitCounts[ADMIT_RATE_LIMITED];
+  startAt(START_FREE_HEAP);
+  hal::resetHeapStats();
+  BurstResult guarded = runBurst(server);
+  uint32_t requestBytes = hal::heap.peakBytes;   // heap of the requests at their peak
+  closeAll();
+  TEST_ASSERT_EQUAL(START_FREE_HEAP, hal::freeHeap());   // everything given back
+
+  startAt(START_FREE_HEAP);
+  BurstResult unguarded = runBurst(bare);
+  closeAll();
+  hal::heapTaken = 0;
+
+  printf("burst of %u: guarded %u served, %u 503, %u 429, lowest free heap %u (floor %u); "
+         "unguarded %u served, lowest free heap %u\n", BURST_CLIENTS, guarded.ok, guarded.busy,
+         guarded.rateLimited, guarded.lowestFree, ADMIT_MIN_FREE_HEAP, unguarded.ok, unguarded.lowestFree);
+
+  TEST_ASSERT_EQUAL(BURST_CLIENTS, guarded.ok + guarded.busy + guarded.rateLimited);
+  TEST_ASSERT_GREATER_THAN(0, guarded.ok);
+  TEST_ASSERT_LESS_OR_EQUAL(ADMIT_MAX_REQUESTS, guarded.maxOpen);
+  TEST_ASSERT_EQUAL(0, guarded.rateLimited);   // 5 requests per IP, within the burst
+  // Admitted only at or above the floor, so at most one request's heap below it
+  TEST_ASSERT_GREATER_OR_EQUAL(ADMIT_MIN_FREE_HEAP - CONNECTION_BYTES - requestBytes, guarded.lowestFree);
+  TEST_ASSERT_GREATER_THAN(0, admitCounts[ADMIT_LOW_HEAP]);
+
+  uint32_t rejectedAfter = admitCounts[ADMIT_LOW_HEAP] + admitCounts[ADMIT_BUSY] + admitCounts[ADMIT_RATE_LIMITED];
+  TEST_ASSERT_EQUAL(guarded.busy + guarded.rateLimited, rejectedAfter - rejectedBefore);
+
+  TEST_ASSERT_EQUAL(0, unguarded.lowestFree);   // out of heap: an ESP8266 resets here
+}
+
+
+int main() {
+  setupOTA();
+  bare.on("/", HTTP_GET, [](AsyncWebServerRequest* request) {
+    sendTemplate(request, "text/plain", INDEX_PAGE, indexPageFields);
+  });
+  bare.begin();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_ip_burst_then_refill);
+  RUN_TEST(test_idle_ip_makes_room_in_the_table);
+  RUN_TEST(test_in_flight_limit_and_stale_slots);
+  RUN_TEST(test_answer_keeps_the_reason_it_was_turned_away_for);
+  RUN_TEST(test_ota_priority_sheds_other_routes);
+  RUN_TEST(test_turned_away_costs_less_than_served);
+  RUN_TEST(test_burst_of_50_holds_the_heap_floor);
+  return UNITY_END();
+}
@@ -0,0 +1,207 @@
+/****************************************************************************************
+* ESPCaptivePortal.h's DNS responder on recorded queries (the connectivity checks of
+* Android, iOS & Windows, an HTTPS record lookup): A queries are answered with the AP's
+* IP in place, other types get an empty answer, EDNS records are dropped, malformed
+* packets get no answer, & a burst from many phones is answered DNS_BURST per call to
+* the right sender without heap use.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPCaptivePortal.h"
+#include <unity.h>
+
+const IPAddress AP_IP(192, 168, 4, 1);
+const IPAddress PHONE_IP(192, 168, 4, 2);
+
+// Android: A connectivitycheck.gstatic.com, recursion desired
+const uint8_t ANDROID_CHECK[] = {
+  0x1A, 0x2B, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11, 0x63,
+  0x6F, 0x6E, 0x6E, 0x65, 0x63, 0x74, 0x69, 0x76, 0x69, 0x74, 0x79, 0x63, 0x68, 0x65,
+  0x63, 0x6B, 0x07, 0x67, 0x73, 0x74, 0x61, 0x74, 0x69, 0x63, 0x03, 0x63, 0x6F, 0x6D,
+  0x00, 0x00, 0x01, 0x00, 0x01
+};
+
+// iOS: A captive.apple.com with an EDNS OPT record
+const uint8_t IOS_CHECK[] = {
+  0x77, 0xE1, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x07, 0x63,
+  0x61, 0x70, 0x74, 0x69, 0x76, 0x65, 0x05, 0x61, 0x70, 0x70, 0x6C, 0x65, 0x03, 0x63,
+  0x6F, 0x6D, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x29, 0x04, 0xD0, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00
+};
+
+// Windows: AAAA www.msftconnecttest.com
+const uint8_t WINDOWS_AAAA[] = {
+  0x00, 0x42, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x77,
+  0x77, 0x77, 0x0F, 0x6D, 0x73, 0x66, 0x74, 0x63, 0x6F, 0x6E, 0x6E, 0x65, 0x63, 0x74,
+  0x74, 0x65, 0x73, 0x74, 0x03, 0x63, 0x6F, 0x6D, 0x00, 0x00, 0x1C, 0x00, 0x01
+};
+
+// Chrome: HTTPS example.com, AD bit set
+const uint8_t HTTPS_RECORD[] = {
+  0x51, 0x50, 0x01, 0x20, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x65,
+  0x78, 0x61, 0x6D, 0x70, 0x6C, 0x65, 0x03, 0x63, 0x6F, 0x6D, 0x00, 0x00, 0x41, 0x00,
+  0x01
+};
+
+const uint8_t ANSWER_RECORD[] = { 0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, DNS_TTL, 0x00, 0x04, 192, 168, 4, 1 };
+
+// Send one query to the responder, returns the answers it sent back
+std::vector<hal::UdpPacket> exchange(const uint8_t* query, size_t length, uint16_t port = 5353) {
+  hal::udpSent.clear();
+  hal::receiveUdp(query, length, PHONE_IP, port);
+  handleCaptivePortal();
+  hal::udpInbox.clear();
+  return hal::udpSent;
+}
+
+// The answer repeats the header & question with the response flags set
+void checkHeaderAndQuestion(const uint8_t* query, size_t questionEnd, const hal::UdpPacket& answer, int answers) {
+  TEST_ASSERT_GREATER_OR_EQUAL(questionEnd, answer.data.size());
+  TEST_ASSERT_EQUAL_HEX8(query[0], answer.data[0]);   // same id
+  TEST_ASSERT_EQUAL_HEX8(query[1], answer.data[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x85, answer.data[2]);       // response, authoritative, recursion desired
+  TEST_ASSERT_EQUAL_HEX8(0x80, answer.data[3]);       // recursion available, no error
+  const uint8_t counts[8] = { 0, 1, 0, (uint8_t)answers, 0, 0, 0, 0 };
+  TEST_ASSERT_EQUAL_MEMORY(counts, answer.data.data() + 4, 8);
+  TEST_ASSERT_EQUAL_MEMORY(query + 12, answer.data.data() + 12, questionEnd - 12);
+  TEST_ASSERT_EQUAL(PHONE_IP, answer.ip);
+}
+
+void setUp() {
+  hal::udpSent.clear();
+  hal::udpInbox.clear();
+}
+
+void tearDown() {}
+
+
+void test_a_queries_get_the_ap_ip() {
+  std::vector<hal::UdpPacket> sent = exchange(ANDROID_CHECK, sizeof(ANDROID_CHECK), 40001);
+  TEST_ASSERT_EQUAL(1, sent.size());
+  checkHeaderAndQuestion(ANDROID_CHECK, sizeof(ANDROID_CHECK), sent[0], 1);
+  TEST_ASSERT_EQUAL(sizeof(ANDROID_CHECK) + sizeof(ANSWER_RECORD), sent[0].data.size());
+  TEST_ASSERT_EQUAL_MEMORY(ANSWER_RECORD, sent[0].data.data() + sizeof(ANDROID_CHECK), sizeof(ANSWER_RECORD));
+  TEST_ASSERT_EQUAL(40001, sent[0].port);
+}
+
+void test_edns_record_is_dropped() {
+  size_t questionEnd = sizeof(IOS_CHECK) - 11;   // the OPT record is 11 bytes
+  std::vector<hal::UdpPacket> sent = exchange(IOS_CHECK, sizeof(IOS_CHECK));
+  TEST_ASSERT_EQUAL(1, sent.size());
+  checkHeaderAndQuestion(IOS_CHECK, questionEnd, sent[0], 1);   // additional count back to 0
+  TEST_ASSERT_EQUAL(questionEnd + sizeof(ANSWER_RECORD), sent[0].data.size());
+  TEST_ASSERT_EQUAL_MEMORY(ANSWER_RECORD, sent[0].data.data() + questionEnd, sizeof(ANSWER_RECORD));
+}
+
+void test_other_types_get_an_empty_answer() {
+  std::vector<hal::UdpPacket> sent = exchange(WINDOWS_AAAA, sizeof(WINDOWS_AAAA));
+  TEST_ASSERT_EQUAL(1, sent.size());
+  checkHeaderAndQuestion(WINDOWS_AAAA, sizeof(WINDOWS_AAAA), sent[0], 0);
+  TEST_ASSERT_EQUAL(sizeof(WINDOWS_AAAA), sent[0].data.size());
+
+  sent = exchange(HTTPS_RECORD, sizeof(HTTPS_RECORD));
+  TEST_ASSERT_EQUAL(1, sent.size());
+  checkHeaderAndQuestion(HTTPS_RECORD, sizeof(HTTPS_RECORD), sent[0], 0);
+}
+
+void test_malformed_packets_get_no_answer() {
+  uint8_t packet[DNS_MAX_PACKET + 16];
+
+  memcpy(packet, ANDROID_CHECK, sizeof(ANDROID_CHECK));
+  packet[2] |= 0x80;   // a response
+  TEST_ASSERT_EQUAL(0, exchange(packet, sizeof(ANDROID_CHECK)).size());
+
+  memcpy(packet, ANDROID_CHECK, sizeof(ANDROID_CHECK));
+  packet[2] |= 0x10;   // opcode 2, server status
+  TEST_ASSERT_EQUAL(0, exchange(packet, sizeof(ANDROID_CHECK)).size());
+
+  memcpy(packet, ANDROID_CHECK, sizeof(ANDROID_CHECK));
+  packet[5] = 2;       // two questions
+  TEST_ASSERT_EQUAL(0, exchange(packet, sizeof(ANDROID_CHECK)).size());
+
+  memcpy(packet, ANDROID_CHECK, sizeof(ANDROID_CHECK));
+  packet[12] = 0xC0;   // a compressed name in the question
+  TEST_ASSERT_EQUAL(0, exchange(packet, sizeof(ANDROID_CHECK)).size());
+
+  TEST_ASSERT_EQUAL(0, exchange(ANDROID_CHECK, 11).size());                          // shorter than a header
+  TEST_ASSERT_EQUAL(0, exchange(ANDROID_CHECK, 30).size());                          // cut in the name
+  TEST_ASSERT_EQUAL(0, exchange(ANDROID_CHECK, sizeof(ANDROID_CHECK) - 2).size());   // cut in the type
+
+  // A name longer than 255 bytes
+  memcpy(packet, ANDROID_CHECK, 12);
+  size_t pos = 12;
+  for (int label = 0; label < 5; label++) {
+    packet[pos++] = 63;
+    memset(packet + pos, 'a', 63);
+    pos += 63;
+  }
+  packet[pos++] = 0;
+  memcpy(packet + pos, "\x00\x01\x00\x01", 4);
+  TEST_ASSERT_EQUAL(0, exchange(packet, pos + 4).size());
+
+  // Larger than DNS_MAX_PACKET
+  memcpy(packet, ANDROID_CHECK, sizeof(ANDROID_CHECK));
+  memset(packet + sizeof(ANDROID_CHECK), 0, sizeof(packet) - sizeof(ANDROID_CHECK));
+  TEST_ASSERT_EQUAL(0, exchange(packet, sizeof(packet)).size());
+}
+
+void test_no_room_for_the_answer() {
+  uint8_t packet[sizeof(ANDROID_CHECK) + 16];
+  const size_t length = sizeof(ANDROID_CHECK);
+  memcpy(packet, ANDROID_CHECK, length);
+  TEST_ASSERT_EQUAL(0, buildDnsAnswer(packet, length, length + 15, portalIP));
+  TEST_ASSERT_EQUAL_MEMORY(ANDROID_CHECK, packet, length);   // left as it was
+  TEST_ASSERT_EQUAL(length + 16, buildDnsAnswer(packet, length, length + 16, portalIP));
+}
+
+void test_burst_from_many_phones() {
+  const int PHONES = 40;
+  for (int phone = 0; phone < PHONES; phone++) {
+    uint8_t query[sizeof(ANDROID_CHECK)];
+    memcpy(query, ANDROID_CHECK, sizeof(query));
+    query[0] = phone;   // its own id
+    hal::receiveUdp(query, sizeof(query), IPAddress(192, 168, 4, 2 + phone), 50000 + phone);
+  }
+
+  hal::resetHeapStats();
+  int calls = 0;
+  while (!hal::udpInbox.empty()) {
+    size_t before = hal::udpSent.size();
+    handleCaptivePortal();
+    calls++;
+    TEST_ASSERT_LESS_OR_EQUAL(DNS_BURST, hal::udpSent.size() - before);
+  }
+  TEST_ASSERT_EQUAL((PHONES + DNS_BURST - 1) / DNS_BURST, calls);
+  TEST_ASSERT_EQUAL(0, hal::heap.allocations);
+
+  TEST_ASSERT_EQUAL(PHONES, hal::udpSent.size());
+  for (int phone = 0; phone < PHONES; phone++) {
+    const hal::UdpPacket& answer = hal::udpSent[phone];
+    TEST_ASSERT_EQUAL(phone, answer.data[0]);
+    TEST_ASSERT_EQUAL(IPAddress(192, 168, 4, 2 + phone), answer.ip);
+    TEST_ASSERT_EQUAL(50000 + phone, answer.port);
+    TEST_ASSERT_EQUAL_MEMORY(ANSWER_RECORD, answer.data.data() + sizeof(ANDROID_CHECK), sizeof(ANSWER_RECORD));
+  }
+}
+
+void test_closed_portal_answers_nothing() {
+  stopCaptivePortal();
+  TEST_ASSERT_EQUAL(0, exchange(ANDROID_CHECK, sizeof(ANDROID_CHECK)).size());
+  startCaptivePortal(AP_IP);
+  TEST_ASSERT_EQUAL(1, exchange(ANDROID_CHECK, sizeof(ANDROID_CHECK)).size());
+}
+
+
+int main() {
+  startCaptivePortal(AP_IP);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_a_queries_get_the_ap_ip);
+  RUN_TEST(test_edns_record_is_dropped);
+  RUN_TEST(test_other_types_get_an_empty_answer);
+  RUN_TEST(test_malformed_packets_get_no_answer);
+  RUN_TEST(test_no_room_for_the_answer);
+  RUN_TEST(test_burst_from_many_phones);
+  RUN_TEST(test_closed_portal_answers_nothing);
+  return UNITY_END();
+}
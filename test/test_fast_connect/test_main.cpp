@@ -0,0 +1,147 @@
+/****************************************************************************************
+* ESPWiFiFastConnect.h with ESPWiFiSTAHelper.h over simulated boots (hal::runBoot(), RTC
+* memory kept between them): the simulated connect latency of the scanning & the cached
+* path, the BSSID/channel hints & the cached lease, the fallback when the AP moved, & a
+* power-up or a corrupted cache taking the normal path.
+* The boots run the helper, this process only sets up the HAL & reads the RTC memory.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPWiFiSTAHelper.h"
+#include <unity.h>
+
+bool fastConnect = true;
+
+// What a boot reports back on Serial
+struct ConnectResult {
+  int connected;
+  unsigned long connectMS;   // setupWiFi() to connected
+  unsigned fastBegins;       // WiFi.begin() calls with channel & BSSID hints
+  unsigned begins;
+  bool fastPath;             // connected on the hints
+};
+
+ConnectResult bootAndConnect() {
+  hal::BootResult boot = hal::runBoot([]() {
+    Serial.begin(115200);
+    USE_FAST_CONNECT = fastConnect;
+    setupWiFi();
+    while (!isConnected && millis() < 30000) {
+      handleWiFi();
+      delay(10);
+    }
+    unsigned long connectMS = millis() - connectStartMS;
+    flushLog();   // waits for the UART, not part of the connect
+    Serial.printf("\nresult %d %lu %u %u\n", isConnected, connectMS,
+                  (unsigned)hal::wifiFastBegins, (unsigned)hal::wifiBegins);
+  });
+  TEST_ASSERT_EQUAL(hal::BOOT_RETURNED, boot.outcome);
+
+  ConnectResult result = {};
+  const char* line = strstr(boot.serial, "\nresult ");
+  TEST_ASSERT_NOT_NULL(line);
+  sscanf(line, "\nresult %d %lu %u %u", &result.connected, &result.connectMS, &result.fastBegins, &result.begins);
+  result.fastPath = strstr(boot.serial, "(fast connect)") != nullptr;
+  return result;
+}
+
+bool rtcCache(FastConnectCache& cache) {
+  ESP.rtcUserMemoryRead(FAST_CONNECT_RTC_OFFSET, (uint32_t*)&cache, sizeof(cache));
+  return cache.magic == FAST_CONNECT_MAGIC && cache.crc == fastConnectCRC((const uint8_t*)&cache, offsetof(FastConnectCache, crc));
+}
+
+unsigned long uncachedMS = 0;
+
+void setUp() {
+  fastConnect = true;
+}
+
+void tearDown() {}
+
+
+void test_first_boot_scans_and_caches() {
+  hal::powerCycle();
+  ConnectResult result = bootAndConnect();
+  TEST_ASSERT_EQUAL(1, result.connected);
+  TEST_ASSERT_FALSE(result.fastPath);
+  TEST_ASSERT_EQUAL(0, result.fastBegins);
+  uncachedMS = result.connectMS;
+  TEST_ASSERT_UINT32_WITHIN(20, hal::wifiTiming.associateMS + hal::wifiTiming.dhcpMS, uncachedMS);
+
+  FastConnectCache cache;
+  TEST_ASSERT_TRUE(rtcCache(cache));
+  TEST_ASSERT_EQUAL(6, cache.channel);
+  TEST_ASSERT_EQUAL_HEX8(0x11, cache.bssid[5]);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)hal::dhcpIP, cache.ip);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)hal::dhcpGateway, cache.gateway);
+}
+
+void test_cached_boot_skips_scan_and_dhcp() {
+  ConnectResult result = bootAndConnect();
+  TEST_ASSERT_EQUAL(1, result.connected);
+  TEST_ASSERT_TRUE(result.fastPath);
+  TEST_ASSERT_EQUAL(1, result.fastBegins);
+  TEST_ASSERT_EQUAL(1, result.begins);
+  TEST_ASSERT_UINT32_WITHIN(20, hal::wifiTiming.fastAssociateMS, result.connectMS);   // no DHCP either
+  TEST_ASSERT_LESS_THAN(uncachedMS / 3, result.connectMS);
+  printf("connect latency: %lu ms scanning, %lu ms cached\n", uncachedMS, result.connectMS);
+}
+
+void test_moved_ap_falls_back_to_the_normal_path() {
+  hal::accessPoints[0].channel = 11;   // the router picked another channel
+  ConnectResult result = bootAndConnect();
+  TEST_ASSERT_EQUAL(1, result.connected);
+  TEST_ASSERT_FALSE(result.fastPath);
+  TEST_ASSERT_EQUAL(1, result.fastBegins);
+  TEST_ASSERT_EQUAL(2, result.begins);
+  // The hints fail after the AP search, then a full connect with DHCP
+  TEST_ASSERT_UINT32_WITHIN(30, hal::wifiTiming.failMS + hal::wifiTiming.associateMS + hal::wifiTiming.dhcpMS, result.connectMS);
+
+  FastConnectCache cache;
+  TEST_ASSERT_TRUE(rtcCache(cache));
+  TEST_ASSERT_EQUAL(11, cache.channel);   // cached again from the new connection
+
+  TEST_ASSERT_TRUE(bootAndConnect().fastPath);
+}
+
+void test_corrupted_cache_takes_the_normal_path() {
+  FastConnectCache cache;
+  rtcCache(cache);
+  cache.ip ^= 0x01000000;   // a flipped bit, the CRC no longer matches
+  ESP.rtcUserMemoryWrite(FAST_CONNECT_RTC_OFFSET, (uint32_t*)&cache, sizeof(cache));
+
+  ConnectResult result = bootAndConnect();
+  TEST_ASSERT_FALSE(result.fastPath);
+  TEST_ASSERT_EQUAL(0, result.fastBegins);
+  TEST_ASSERT_TRUE(rtcCache(cache));   // written again
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)hal::dhcpIP, cache.ip);
+}
+
+void test_power_up_takes_the_normal_path() {
+  hal::powerCycle();
+  ConnectResult result = bootAndConnect();
+  TEST_ASSERT_FALSE(result.fastPath);
+  TEST_ASSERT_EQUAL(0, result.fastBegins);
+}
+
+void test_off_by_default_neither_reads_nor_writes() {
+  hal::powerCycle();
+  fastConnect = false;
+  bootAndConnect();
+  FastConnectCache cache;
+  TEST_ASSERT_FALSE(rtcCache(cache));
+}
+
+
+int main() {
+  hal::addAccessPoint("YOUR_SSID_NAME", "YOUR_SSID_PW", 0x11, 6, -60);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_first_boot_scans_and_caches);
+  RUN_TEST(test_cached_boot_skips_scan_and_dhcp);
+  RUN_TEST(test_moved_ap_falls_back_to_the_normal_path);
+  RUN_TEST(test_corrupted_cache_takes_the_normal_path);
+  RUN_TEST(test_power_up_takes_the_normal_path);
+  RUN_TEST(test_off_by_default_neither_reads_nor_writes);
+  return UNITY_END();
+}
@@ -0,0 +1,185 @@
+/****************************************************************************************
+* Native HAL checks: the behaviour the helper suites & the benchmarks lean on - the
+* simulated clock & timed events, heap counting, the Serial FIFO, RTC memory across
+* forked boots, LittleFS & the web server's handler order & header filtering.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <ESPAsyncWebServer.h>
+#include <LittleFS.h>
+#include <Ticker.h>
+#include <unity.h>
+
+AsyncWebServer server(80);
+
+void setUp() {}
+void tearDown() {}
+
+
+void test_clock_runs_events_in_order() {
+  std::string order;
+  uint64_t start = hal::nowUS;
+  hal::after(20, [&order]() { order += "b"; });
+  hal::after(10, [&order]() { order += "a"; });
+  hal::after(20, [&order]() { order += "c"; });
+  delay(15);
+  TEST_ASSERT_EQUAL_STRING("a", order.c_str());
+  delay(5);
+  TEST_ASSERT_EQUAL_STRING("abc", order.c_str());
+  TEST_ASSERT_EQUAL(20000, hal::nowUS - start);
+}
+
+void test_ticker_repeats_until_detached() {
+  static int ticks = 0;
+  Ticker ticker;
+  ticker.attach_ms(100, []() { ticks++; });
+  delay(350);
+  TEST_ASSERT_EQUAL(3, ticks);
+  ticker.detach();
+  delay(300);
+  TEST_ASSERT_EQUAL(3, ticks);
+}
+
+void test_heap_counts_allocations_not_hal_bookkeeping() {
+  hal::resetHeapStats();
+  uint32_t free = ESP.getFreeHeap();
+  char* block = new char[100];
+  TEST_ASSERT_EQUAL(1, hal::heap.allocations);
+  TEST_ASSERT_EQUAL(free - 100 - hal::HEAP_BLOCK_OVERHEAD, ESP.getFreeHeap());
+  delete[] block;
+  TEST_ASSERT_EQUAL(free, ESP.getFreeHeap());
+
+  hal::after(10, []() {});   // event list growth is the HAL's, not the sketch's
+  TEST_ASSERT_EQUAL(1, hal::heap.allocations);
+  TEST_ASSERT_EQUAL(100, hal::heap.peakBytes - hal::heap.liveBytes);
+}
+
+void test_serial_blocks_when_the_fifo_is_full() {
+  Serial.flush();
+  TEST_ASSERT_EQUAL(128, Serial.availableForWrite());
+  uint64_t start = hal::nowUS;
+  char line[300];
+  memset(line, 'x', sizeof(line));
+  Serial.write((const uint8_t*)line, sizeof(line));   // 172 bytes past the FIFO wait for room
+  TEST_ASSERT_GREATER_OR_EQUAL(15000, hal::nowUS - start);
+  TEST_ASSERT_LESS_THAN(128, Serial.availableForWrite());
+}
+
+void test_rtc_memory_survives_a_forked_boot() {
+  hal::powerCycle();
+  hal::BootResult boot = hal::runBoot([]() {
+    uint32_t value = 0xC0FFEE;
+    ESP.rtcUserMemoryWrite(8, &value, sizeof(value));
+    Serial.print("slept");
+    ESP.deepSleep(5000000);
+  });
+  TEST_ASSERT_EQUAL(hal::BOOT_DEEP_SLEEP, boot.outcome);
+  TEST_ASSERT_EQUAL(5000000, boot.sleepUS);
+  TEST_ASSERT_EQUAL_STRING("slept", boot.serial);
+
+  uint32_t value = 0;
+  ESP.rtcUserMemoryRead(8, &value, sizeof(value));
+  TEST_ASSERT_EQUAL_HEX32(0xC0FFEE, value);
+}
+
+void test_wifi_connects_after_the_scripted_time() {
+  hal::addAccessPoint("lab", "password", 1, 6, -60);
+  unsigned long start = millis();
+  WiFi.mode(WIFI_STA);
+  WiFi.begin("lab", "password");
+  while (WiFi.status() != WL_CONNECTED && millis() - start < 5000) {
+    delay(10);
+  }
+  TEST_ASSERT_EQUAL(WL_CONNECTED, WiFi.status());
+  TEST_ASSERT_UINT32_WITHIN(10, hal::wifiTiming.associateMS + hal::wifiTiming.dhcpMS, millis() - start);
+  TEST_ASSERT_EQUAL(-60, WiFi.RSSI());
+
+  hal::dropLink();
+  TEST_ASSERT_EQUAL(WL_DISCONNECTED, WiFi.status());
+}
+
+void test_littlefs_files() {
+  hal::putFile("/a.txt", "hello");
+  LittleFS.begin();
+  File file = LittleFS.open("/a.txt", "r");
+  TEST_ASSERT_TRUE(file);
+  TEST_ASSERT_EQUAL(5, file.size());
+  file.close();
+  TEST_ASSERT_FALSE(LittleFS.open("/missing", "r"));
+
+  file = LittleFS.open("/b.txt", "w");
+  file.print("written");
+  file.close();
+  TEST_ASSERT_EQUAL_STRING("written", hal::readFile("/b.txt").c_str());
+}
+
+// A handler that only asks for one header sees only that one
+class HeaderHandler : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest* request) override {
+    if (request->url() != "/headers") return false;
+    request->addInterestingHeader("If-None-Match");
+    return true;
+  }
+  void handleRequest(AsyncWebServerRequest* request) override {
+    request->send(200, "text/plain", request->hasHeader("Accept") ? "accept" : "no accept");
+  }
+};
+
+void test_web_server_handler_order_and_headers() {
+  static HeaderHandler headers;
+  server.addHandler(&headers);
+  server.on("/first", HTTP_GET, [](AsyncWebServerRequest* request) { request->send(200, "text/plain", "first"); });
+  server.on("/first", HTTP_GET, [](AsyncWebServerRequest* request) { request->send(200, "text/plain", "second"); });
+  server.onNotFound([](AsyncWebServerRequest* request) { request->send(404); });
+  server.begin();
+
+  TEST_ASSERT_EQUAL_STRING("first", hal::get(server, "/first").body.c_str());
+  TEST_ASSERT_EQUAL(404, hal::get(server, "/nothing").code);
+
+  hal::HttpResponse response = hal::get(server, "/headers", { { "Accept", "*/*" }, { "If-None-Match", "\"1\"" } });
+  TEST_ASSERT_EQUAL_STRING("no accept", response.body.c_str());
+  TEST_ASSERT_EQUAL_STRING("If-None-Match:\"1\"\n", response.handlerHeaders.c_str());
+}
+
+void test_chunked_response_drains_through_the_window() {
+  server.on("/chunked", HTTP_GET, [](AsyncWebServerRequest* request) {
+    request->sendChunked("text/plain", [](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+      if (index >= 1000) return 0;
+      size_t n = std::min(maxLen, (size_t)(1000 - index));
+      memset(buffer, 'c', n);
+      return n;
+    });
+  });
+  hal::HttpRequest request;
+  request.url = "/chunked";
+  request.window = 256;
+  hal::HttpResponse response = hal::serve(server, request);
+  TEST_ASSERT_EQUAL(1000, response.body.size());
+  TEST_ASSERT_EQUAL(4, response.fillerCalls);
+}
+
+void test_request_is_freed() {
+  hal::resetHeapStats();
+  int64_t live = hal::heap.liveBytes;
+  hal::get(server, "/first", { { "Accept", "*/*" } });
+  TEST_ASSERT_GREATER_THAN(0, hal::heap.allocations);
+  TEST_ASSERT_EQUAL(live, hal::heap.liveBytes);
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_clock_runs_events_in_order);
+  RUN_TEST(test_ticker_repeats_until_detached);
+  RUN_TEST(test_heap_counts_allocations_not_hal_bookkeeping);
+  RUN_TEST(test_serial_blocks_when_the_fifo_is_full);
+  RUN_TEST(test_rtc_memory_survives_a_forked_boot);
+  RUN_TEST(test_wifi_connects_after_the_scripted_time);
+  RUN_TEST(test_littlefs_files);
+  RUN_TEST(test_web_server_handler_order_and_headers);
+  RUN_TEST(test_chunked_response_drains_through_the_window);
+  RUN_TEST(test_request_is_freed);
+  return UNITY_END();
+}
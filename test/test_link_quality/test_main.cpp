@@ -0,0 +1,197 @@
+/****************************************************************************************
+* ESPLinkQuality.h's adaptation policy run over a scripted RSSI trace, sample by sample:
+* a strong link steps the TX power down one step per LINK_HOLD_SAMPLES, a fade below
+* LINK_MIN_MARGIN goes straight back up as far as LINK_TARGET_MARGIN needs, in between it
+* holds, a disconnect goes back to full power & the PHY mode only moves at disconnects.
+* The same trace is then played through the HAL's RSSI: the radio follows the policy, the
+* history decodes back to the trace & a disconnect from the event bus is recorded.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPLinkQuality.h"
+#include <unity.h>
+#include <math.h>
+#include <vector>
+
+// One sample of the trace & the TX step expected after it
+struct TraceStep {
+  int8_t rssi;
+  bool disconnected;
+  uint8_t txStep;
+};
+
+const int8_t STRONG = -45;   // 30 dB over the floor, room for every step
+const int8_t MEDIUM = -62;   // 13 dB over the floor: step 1 at most
+
+// `samples` samples of `rssi` from a change to `step`: one step down per hold, to `lowest`
+void expectSteady(std::vector<TraceStep>& trace, int8_t rssi, int samples, uint8_t step, uint8_t lowest) {
+  for (int i = 1; i <= samples; i++) {
+    if (i % (LINK_HOLD_SAMPLES + 1) == 0 && step < lowest) {
+      step++;
+    }
+    trace.push_back({ rssi, false, step });
+  }
+}
+
+// The scripted link: strong, a slow fade, a drop, a disconnect & recovery
+std::vector<TraceStep> scriptedTrace() {
+  std::vector<TraceStep> trace;
+  expectSteady(trace, STRONG, 40, 0, LINK_TX_STEPS - 1);   // down a step every 7 samples to the lowest
+  trace.push_back({ -60, false, 5 });    // 4 dB margin left at step 5: holds
+  trace.push_back({ -62, false, 1 });    // 2 dB: straight up to step 1, the first with 10 dB
+  trace.push_back({ MEDIUM, false, 1 });
+  expectSteady(trace, MEDIUM, 10, 1, 1);   // step 2 would leave 9 dB: stays
+  trace.push_back({ -66, false, 1 });    // 7 dB at step 1: between the margins, holds
+  trace.push_back({ -70, false, 0 });    // 3 dB: full power
+  trace.push_back({ -70, true, 0 });     // disconnect
+  expectSteady(trace, MEDIUM, 8, 0, 1);    // back to step 1 after the hold
+  trace.push_back({ -80, false, 0 });    // below the floor
+  return trace;
+}
+
+// TX power the HAL radio was set to, in 0.1 dBm
+int radioDBm10() {
+  return (int)lroundf(hal::outputPowerDBm * 10);
+}
+
+void setUp() {}
+void tearDown() {}
+
+
+void test_policy_follows_the_trace() {
+  LinkPolicy policy = { 0, LINK_PHY_N, 0 };
+  std::vector<TraceStep> trace = scriptedTrace();
+  int changes = 0;
+  for (size_t i = 0; i < trace.size(); i++) {
+    uint8_t step = policy.txStep;
+    bool changed = adaptLink(policy, trace[i].rssi, trace[i].disconnected);
+    char message[32];
+    snprintf(message, sizeof(message), "sample %u", (unsigned)i);
+    TEST_ASSERT_EQUAL_MESSAGE(trace[i].txStep, policy.txStep, message);
+    TEST_ASSERT_EQUAL_MESSAGE(step != policy.txStep, changed, message);
+    TEST_ASSERT_EQUAL(LINK_PHY_N, policy.phy);   // linkAdaptPhy is off
+    changes += changed;
+  }
+  TEST_ASSERT_EQUAL(9, changes);   // 5 down, 2 up, 1 down after the reconnect, 1 up
+}
+
+void test_power_never_leaves_less_than_the_minimum_margin() {
+  // A random walk: after every decision the estimated margin is at least LINK_MIN_MARGIN, or full power
+  LinkPolicy policy = { 0, LINK_PHY_N, 0 };
+  int rssi = -55;
+  randomSeed(25);
+  for (int i = 0; i < 20000; i++) {
+    rssi = constrain(rssi + (int)random(-3, 4), -90, -30);
+    uint8_t step = policy.txStep;
+    adaptLink(policy, rssi, false);
+    int margin = rssi - LINK_RSSI_FLOOR - (LINK_TX_DBM10[0] - LINK_TX_DBM10[policy.txStep]) / 10;
+    TEST_ASSERT_TRUE(margin >= LINK_MIN_MARGIN || policy.txStep == 0);
+    TEST_ASSERT_LESS_OR_EQUAL(step + 1, policy.txStep);   // down one step at most
+  }
+}
+
+void test_phy_mode_moves_only_at_disconnects() {
+  linkAdaptPhy = true;
+  LinkPolicy policy = { 2, LINK_PHY_N, 0 };
+  for (int i = 0; i < 20; i++) {
+    adaptLink(policy, -85, false);   // weak, but connected
+  }
+  TEST_ASSERT_EQUAL(LINK_PHY_N, policy.phy);
+
+  const struct { int8_t rssi; uint8_t phy; } disconnects[] = {
+    { -80, LINK_PHY_G }, { -85, LINK_PHY_B }, { -90, LINK_PHY_B },   // weak: down to 11b
+    { -70, LINK_PHY_B },                                             // in between: stays
+    { -60, LINK_PHY_G }, { -50, LINK_PHY_N }, { -40, LINK_PHY_N },   // strong: back up a step each time
+  };
+  for (const auto& disconnect : disconnects) {
+    policy.txStep = 3;
+    adaptLink(policy, disconnect.rssi, true);
+    TEST_ASSERT_EQUAL(disconnect.phy, policy.phy);
+    TEST_ASSERT_EQUAL(0, policy.txStep);
+    TEST_ASSERT_EQUAL(0, policy.steadySamples);
+  }
+  linkAdaptPhy = false;
+}
+
+void test_full_power_when_adaptation_is_off() {
+  linkAdaptTxPower = false;
+  LinkPolicy policy = { 4, LINK_PHY_N, 0 };
+  TEST_ASSERT_TRUE(adaptLink(policy, STRONG, false));
+  TEST_ASSERT_EQUAL(0, policy.txStep);
+  for (int i = 0; i < 20; i++) {
+    TEST_ASSERT_FALSE(adaptLink(policy, STRONG, false));
+  }
+  TEST_ASSERT_EQUAL(0, policy.txStep);
+  linkAdaptTxPower = true;
+}
+
+// Feed readings of `rssi` to the sampler until it closes a sample
+void runSample(int8_t rssi) {
+  hal::accessPoints[0].rssi = rssi;
+  uint32_t head = linkHistoryHead;
+  while (linkHistoryHead == head) {
+    handleLinkQuality(millis());
+    delay(100);
+  }
+}
+
+void test_radio_and_history_follow_the_trace() {
+  WiFi.mode(WIFI_STA);
+  WiFi.begin("YOUR_SSID_NAME", "YOUR_SSID_PW");
+  delay(2000);
+  TEST_ASSERT_EQUAL(WL_CONNECTED, WiFi.status());
+  applyLinkPolicy(linkPolicy, false);   // the radio keeps its own default (20.5 dBm) until the policy first changes
+
+  std::vector<TraceStep> trace = scriptedTrace();
+  std::vector<LinkSample> expected;
+  float dBmSum = 0;
+  for (const TraceStep& step : trace) {
+    if (step.disconnected) {
+      hal::dropLink(WIFI_DISCONNECT_REASON_BEACON_TIMEOUT);
+      handleWiFiEvents();
+      TEST_ASSERT_EQUAL(LINK_TX_DBM10[0], radioDBm10());
+      WiFi.begin("YOUR_SSID_NAME", "YOUR_SSID_PW");
+      delay(2000);
+      handleWiFiEvents();
+      continue;
+    }
+    expected.push_back({ step.rssi, (uint8_t)WiFi.channel(), linkPolicy.phy, linkPolicy.txStep, 0 });
+    runSample(step.rssi);
+    TEST_ASSERT_EQUAL(step.txStep, linkPolicy.txStep);
+    TEST_ASSERT_EQUAL(LINK_TX_DBM10[step.txStep], radioDBm10());
+    dBmSum += hal::outputPowerDBm;
+  }
+  printf("trace of %u samples: average TX power %.1f dBm against %.1f at full power, %u history bytes\n",
+         (unsigned)expected.size(), dBmSum / expected.size(), LINK_TX_DBM10[0] / 10.0, linkHistoryHead - linkHistoryTail);
+
+  LinkSample samples[LINK_HISTORY_BYTES];
+  int n = readLinkSamples(samples, LINK_HISTORY_BYTES);
+  TEST_ASSERT_EQUAL(expected.size(), n);   // all of it still fits
+  int disconnects = 0;
+  for (int i = 0; i < n; i++) {
+    TEST_ASSERT_EQUAL(expected[i].rssi, samples[i].rssi);
+    TEST_ASSERT_EQUAL(expected[i].channel, samples[i].channel);
+    TEST_ASSERT_EQUAL(expected[i].phy, samples[i].phy);
+    TEST_ASSERT_EQUAL(expected[i].txStep, samples[i].txStep);   // the step the sample was taken at
+    if (samples[i].reason) {
+      TEST_ASSERT_EQUAL(WIFI_DISCONNECT_REASON_BEACON_TIMEOUT, samples[i].reason);
+      disconnects++;
+    }
+  }
+  TEST_ASSERT_EQUAL(1, disconnects);
+}
+
+
+int main() {
+  hal::addAccessPoint("YOUR_SSID_NAME", "YOUR_SSID_PW", 1, 6, STRONG);
+  setupWiFiEvents();
+  setupLinkQuality();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_policy_follows_the_trace);
+  RUN_TEST(test_power_never_leaves_less_than_the_minimum_margin);
+  RUN_TEST(test_phy_mode_moves_only_at_disconnects);
+  RUN_TEST(test_full_power_when_adaptation_is_off);
+  RUN_TEST(test_radio_and_history_follow_the_trace);
+  return UNITY_END();
+}
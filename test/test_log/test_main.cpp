@@ -0,0 +1,215 @@
+/****************************************************************************************
+* ESPLog.h: messages queue without waiting for the UART, drain in order as the FIFO takes
+* them, a full ring drops whole messages & reports the count where they went missing,
+* sinks & the file sink get the same bytes, & ESPWiFiHelper.h drains the log in every
+* Wi-Fi mode.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPWiFiHelper.h"
+#include <unity.h>
+
+// Everything queued, drained into Serial
+std::string drained() {
+  hal::serialOutput.clear();
+  flushLog();
+  return hal::serialOutput;
+}
+
+std::string sinkOutput;
+
+void captureSink(const char* data, size_t length) {
+  hal::Quiet quiet;
+  sinkOutput.append(data, length);
+}
+
+void setUp() {
+  flushLog();
+  hal::serialOutput.clear();
+  logLevel = HELPER_LOG_LEVEL;
+  logToSerial = true;
+}
+
+void tearDown() {}
+
+
+void test_softap_mode_drains_the_log() {
+  wifiConfig.mode = WIFI_MODE_SOFTAP;
+  setupWiFi();
+  scheduleWiFi();
+  TEST_ASSERT_EQUAL(0, hal::serialOutput.size());   // queued, not printed from setupWiFi()
+
+  for (unsigned long end = millis() + 1000; millis() < end;) {
+    Scheduler::run();
+  }
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, hal::serialOutput.find("SoftAP"));
+  TEST_ASSERT_EQUAL(logHead, logTail);
+}
+
+void test_messages_queue_without_waiting_for_the_uart() {
+  uint64_t start = hal::nowUS;
+  uint64_t blocked = hal::serialBlockedUS;
+  for (int i = 0; i < 20; i++) {
+    LOG_I("message %02d with some text to fill the FIFO quickly\n", i);
+  }
+  TEST_ASSERT_EQUAL(start, hal::nowUS);   // the writers did not wait
+
+  // Drain as the scheduler would: never more than the FIFO takes
+  std::string expected;
+  for (int i = 0; i < 20; i++) {
+    char line[80];
+    snprintf(line, sizeof(line), "message %02d with some text to fill the FIFO quickly\n", i);
+    expected += line;
+  }
+  while (logTail != logHead) {
+    handleLog();
+    delay(LOG_TASK_PERIOD_MS);
+  }
+  TEST_ASSERT_EQUAL(blocked, hal::serialBlockedUS);
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), hal::serialOutput.c_str());
+}
+
+void test_full_ring_drops_whole_messages_and_reports_them() {
+  char message[100];
+  memset(message, 'm', sizeof(message));
+  message[sizeof(message) - 1] = '\n';
+  uint32_t dropped = logDropped;
+
+  int written = 0;
+  for (int i = 0; i < 30; i++) {
+    written += logWrite(message, sizeof(message));
+  }
+  TEST_ASSERT_EQUAL(LOG_BUFFER_SIZE / sizeof(message), written);
+  TEST_ASSERT_EQUAL(30 - written, logDropped - dropped);
+
+  std::string output = drained();
+  char report[48];
+  snprintf(report, sizeof(report), "[log] %d messages dropped\n", 30 - written);
+  TEST_ASSERT_EQUAL(written * sizeof(message), output.find(report));      // after the text queued before the drops
+  TEST_ASSERT_EQUAL(strlen(report) + written * sizeof(message), output.size());   // no partial message
+  TEST_ASSERT_EQUAL(LOG_BUFFER_SIZE / sizeof(message) * sizeof(message), logHighWater);
+}
+
+void test_drop_report_is_in_sequence() {
+  char message[100];
+  memset(message, 'o', sizeof(message));
+  message[sizeof(message) - 1] = '\n';
+  std::string expected;
+  while (logWrite(message, sizeof(message))) {   // full, the last one dropped
+    expected.append(message, sizeof(message));
+  }
+  logWrite(message, sizeof(message));            // another one
+  expected += "[log] 2 messages dropped\n";
+
+  handleLog();                                   // the FIFO takes the start of the old text
+  TEST_ASSERT_EQUAL(std::string::npos, hal::serialOutput.find("[log]"));   // not ahead of it
+  while (LOG_BUFFER_SIZE - (logHead - logTail) < 32) {
+    delay(5);
+    handleLog();
+  }
+  LOG_I("after the drops\n");                   // queued while old text is still waiting
+  expected += "after the drops\n";
+  flushLog();
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), hal::serialOutput.c_str());
+}
+
+void test_messages_across_the_ring_end_keep_their_order() {
+  std::string expected;
+  for (int i = 0; i < 150; i++) {   // 3 laps of the ring
+    char line[60];
+    int length = snprintf(line, sizeof(line), "line %03d, long enough to lap the ring soon\n", i);
+    logWrite(line, length);
+    expected += line;
+    while (i % 10 == 9 && logTail != logHead) {
+      handleLog();
+      delay(5);
+    }
+  }
+  TEST_ASSERT_EQUAL(0, logDropped - logDroppedReported);
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), hal::serialOutput.c_str());
+}
+
+void test_long_messages_are_cut_short() {
+  char text[300];
+  memset(text, 'x', sizeof(text) - 1);
+  text[sizeof(text) - 1] = '\0';
+  LOG_E("%s", text);
+  TEST_ASSERT_EQUAL(LOG_LINE_MAX - 1, drained().size());
+}
+
+void test_runtime_level() {
+  logLevel = HELPER_LOG_WARN;
+  LOG_I("info\n");
+  LOG_W("warn\n");
+  LOG_E("error\n");
+  TEST_ASSERT_EQUAL_STRING("warn\nerror\n", drained().c_str());
+}
+
+void test_sinks_get_the_same_bytes() {
+  sinkOutput.clear();
+  TEST_ASSERT_TRUE(addLogSink(captureSink));
+  LOG_I("to every sink %d\n", 42);
+  std::string output = drained();
+  removeLogSink(captureSink);
+  TEST_ASSERT_EQUAL_STRING("to every sink 42\n", output.c_str());
+  TEST_ASSERT_EQUAL_STRING(output.c_str(), sinkOutput.c_str());
+
+  logToSerial = false;   // sinks only, no FIFO to wait for
+  hal::serialOutput.clear();
+  addLogSink(captureSink);
+  sinkOutput.clear();
+  LOG_I("sink only\n");
+  handleLog();
+  removeLogSink(captureSink);
+  TEST_ASSERT_EQUAL_STRING("sink only\n", sinkOutput.c_str());
+  TEST_ASSERT_EQUAL(0, hal::serialOutput.size());
+}
+
+void test_file_sink_moves_a_full_file_aside() {
+  LittleFS.begin();
+  LittleFS.remove(LOG_FILE_PATH);
+  LittleFS.remove("/log.old");
+  logToSerial = false;
+  addLogSink(logFileSink);
+
+  char line[101];
+  memset(line, 'f', 99);
+  line[99] = '\n';
+  line[100] = '\0';
+  for (size_t written = 0; written < LOG_FILE_MAX_SIZE + 500; written += 100) {
+    LOG_I("%s", line);
+    handleLog();
+  }
+  removeLogSink(logFileSink);
+
+  TEST_ASSERT_TRUE(hal::hasFile("/log.old"));
+  TEST_ASSERT_LESS_OR_EQUAL(LOG_FILE_MAX_SIZE, hal::readFile("/log.old").size());
+  TEST_ASSERT_EQUAL(600, hal::readFile(LOG_FILE_PATH).size());
+}
+
+void test_logging_does_not_allocate() {
+  hal::resetHeapStats();
+  for (int i = 0; i < 50; i++) {
+    LOG_I("reading %d: %s\n", i, "ok");
+    handleLog();
+    delay(5);
+  }
+  flushLog();
+  TEST_ASSERT_EQUAL(0, hal::heap.allocations);
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_softap_mode_drains_the_log);   // first: sets the helper up
+  RUN_TEST(test_messages_queue_without_waiting_for_the_uart);
+  RUN_TEST(test_full_ring_drops_whole_messages_and_reports_them);
+  RUN_TEST(test_drop_report_is_in_sequence);
+  RUN_TEST(test_messages_across_the_ring_end_keep_their_order);
+  RUN_TEST(test_long_messages_are_cut_short);
+  RUN_TEST(test_runtime_level);
+  RUN_TEST(test_sinks_get_the_same_bytes);
+  RUN_TEST(test_file_sink_moves_a_full_file_aside);
+  RUN_TEST(test_logging_does_not_allocate);
+  return UNITY_END();
+}
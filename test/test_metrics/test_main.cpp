@@ -0,0 +1,202 @@
+/****************************************************************************************
+* ESPMetrics.h rendered from a registry the test fills in: the Prometheus text is exact
+* (HELP & TYPE once per family, labels, cumulative histogram buckets, _sum & _count),
+* every response window gives the same page, over-long lines are cut, a full registry
+* refuses more. observe() & rendering allocate nothing, & a /metrics scrape costs the same
+* heap allocations with METRICS_MAX metrics as with a handful - & frees them all again.
+* timedRoute() counts & times the routes it wraps.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPMetrics.h"
+#include <unity.h>
+
+AsyncWebServer server(80);
+
+uint32_t boots = 3;
+Histogram readTime = { LATENCY_BOUNDS_US };
+
+const char* EXPECTED_PAGE =
+  "# HELP app_boots_total Boots since the flash was erased\n"
+  "# TYPE app_boots_total counter\n"
+  "app_boots_total 3\n"
+  "# HELP app_temperature_decicelsius Sensor temperature\n"
+  "# TYPE app_temperature_decicelsius gauge\n"
+  "app_temperature_decicelsius{sensor=\"attic\"} 215\n"
+  "app_temperature_decicelsius{sensor=\"garden\"} -40\n"
+  "# HELP app_read_us Sensor read time\n"
+  "# TYPE app_read_us histogram\n"
+  "app_read_us_bucket{le=\"100\"} 1\n"
+  "app_read_us_bucket{le=\"500\"} 2\n"
+  "app_read_us_bucket{le=\"1000\"} 2\n"
+  "app_read_us_bucket{le=\"5000\"} 2\n"
+  "app_read_us_bucket{le=\"10000\"} 2\n"
+  "app_read_us_bucket{le=\"50000\"} 2\n"
+  "app_read_us_bucket{le=\"100000\"} 2\n"
+  "app_read_us_bucket{le=\"1000000\"} 2\n"
+  "app_read_us_bucket{le=\"+Inf\"} 3\n"
+  "app_read_us_sum 2000201\n"
+  "app_read_us_count 3\n";
+
+int32_t readArg(int arg) {
+  return arg;
+}
+
+// The fake registry: a counter, a gauge family of two (in between, another family) & a histogram
+void registerFakeMetrics() {
+  metricCount = 0;
+  readTime = { LATENCY_BOUNDS_US };
+  registerCounter("app_boots_total", "Boots since the flash was erased", nullptr, &boots);
+  registerGauge("app_temperature_decicelsius", "Sensor temperature", "sensor=\"attic\"", readArg, 215);
+  registerHistogram("app_read_us", "Sensor read time", nullptr, &readTime);
+  registerGauge("app_temperature_decicelsius", "Not used, the family has one", "sensor=\"garden\"", readArg, -40);
+  observe(readTime, 100);       // on a bound: that bucket
+  observe(readTime, 101);
+  observe(readTime, 2000000);   // above every bound
+}
+
+// The whole page, `window` bytes per fillMetrics() call
+std::string render(size_t window) {
+  std::string page;
+  MetricsCursor cursor = {};
+  uint8_t buffer[METRICS_LINE_MAX * 2];
+  size_t n;
+  while ((n = fillMetrics(cursor, buffer, window)) > 0) {
+    TEST_ASSERT_LESS_OR_EQUAL(window, n);
+    page.append((const char*)buffer, n);
+  }
+  return page;
+}
+
+// Heap allocations of one scrape
+uint32_t scrapeAllocations() {
+  hal::get(server, "/metrics");   // warm up
+  hal::resetHeapStats();
+  int64_t live = hal::heap.liveBytes;
+  hal::HttpResponse response = hal::get(server, "/metrics");
+  TEST_ASSERT_EQUAL(200, response.code);
+  uint32_t allocations = hal::heap.allocations;
+  {
+    hal::Quiet quiet;
+    response = hal::HttpResponse();
+  }
+  TEST_ASSERT_EQUAL(live, hal::heap.liveBytes);   // all freed with the request
+  return allocations;
+}
+
+void setUp() {}
+void tearDown() {}
+
+
+void test_page_from_a_fake_registry() {
+  registerFakeMetrics();
+  TEST_ASSERT_EQUAL_STRING(EXPECTED_PAGE, render(64).c_str());
+}
+
+void test_any_window_gives_the_same_page() {
+  registerFakeMetrics();
+  for (size_t window = 1; window <= METRICS_LINE_MAX * 2; window++) {
+    TEST_ASSERT_EQUAL_STRING(EXPECTED_PAGE, render(window).c_str());
+  }
+}
+
+void test_long_lines_are_cut() {
+  static char help[METRICS_LINE_MAX * 2];
+  memset(help, 'h', sizeof(help) - 1);
+  metricCount = 0;
+  registerCounter("long_help_total", help, nullptr, &boots);
+  std::string page = render(64);
+  size_t firstLine = page.find('\n') == std::string::npos ? page.size() : page.find('\n');
+  TEST_ASSERT_EQUAL(METRICS_LINE_MAX - 2, firstLine);   // cut, the newline kept
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, page.find("\n# TYPE long_help_total counter\n"));
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, page.find("\nlong_help_total 3\n"));
+
+  // Labels longer than a line, on every kind of sample line
+  static char labels[METRICS_LINE_MAX * 2];
+  memset(labels, 'l', sizeof(labels) - 1);
+  registerGauge("long_labels", "Long labels", labels, readArg, 1);
+  registerHistogram("long_labels_us", "Long labels", labels, &readTime);
+  page = render(64);
+  int lines = 0;
+  for (size_t start = 0, end; (end = page.find('\n', start)) != std::string::npos; start = end + 1, lines++) {
+    TEST_ASSERT_LESS_OR_EQUAL(METRICS_LINE_MAX - 2, end - start);
+  }
+  TEST_ASSERT_EQUAL(3 + 3 + 2 + HISTOGRAM_BUCKETS + 3, lines);
+  TEST_ASSERT_EQUAL('\n', page.back());
+}
+
+void test_full_registry_refuses_more() {
+  metricCount = 0;
+  for (int i = 0; i < METRICS_MAX; i++) {
+    TEST_ASSERT_TRUE(registerCounter("many_total", "Many", nullptr, &boots));
+  }
+  TEST_ASSERT_FALSE(registerCounter("one_more_total", "Too many", nullptr, &boots));
+  TEST_ASSERT_EQUAL(METRICS_MAX, metricCount);
+}
+
+void test_observe_and_render_do_not_allocate() {
+  registerFakeMetrics();
+  MetricsCursor cursor = {};
+  uint8_t buffer[100];
+  hal::resetHeapStats();
+  for (uint32_t value = 0; value < 100000; value += 7) {
+    observe(readTime, value);
+  }
+  while (fillMetrics(cursor, buffer, sizeof(buffer)) > 0) {
+  }
+  TEST_ASSERT_EQUAL(0, hal::heap.allocations);
+  TEST_ASSERT_EQUAL(3 + 100000 / 7 + 1, readTime.count);
+}
+
+void test_scrape_heap_does_not_grow_with_the_registry() {
+  registerFakeMetrics();
+  uint32_t few = scrapeAllocations();
+
+  static char labels[METRICS_MAX][16];
+  while (metricCount < METRICS_MAX) {
+    snprintf(labels[metricCount], sizeof(labels[0]), "n=\"%d\"", metricCount);
+    if (metricCount % 2) {
+      registerHistogram("filler_us", "Filler", labels[metricCount], &readTime);
+    } else {
+      registerGauge("filler", "Filler", labels[metricCount], readArg, metricCount);
+    }
+  }
+  uint32_t full = scrapeAllocations();
+  size_t pageBytes = hal::get(server, "/metrics").body.size();
+  printf("scrape: %u allocations with 5 metrics, %u with %d (a %u byte page)\n",
+         few, full, METRICS_MAX, (unsigned)pageBytes);
+  TEST_ASSERT_EQUAL(few, full);
+  TEST_ASSERT_GREATER_THAN(METRICS_LINE_MAX * METRICS_MAX, pageBytes);   // far bigger than the one line buffer
+}
+
+void test_timed_routes_are_counted() {
+  registerFakeMetrics();
+  server.on("/slow", HTTP_GET, timedRoute("/slow", [](AsyncWebServerRequest* request) {
+    delay(7);   // in the 10 ms bucket
+    request->send(200, "text/plain", "done");
+  }));
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL(200, hal::get(server, "/slow").code);
+  }
+  std::string page = hal::get(server, "/metrics").body;
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, page.find("http_requests_total{route=\"/slow\"} 4\n"));
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, page.find("http_handler_us_bucket{route=\"/slow\",le=\"5000\"} 0\n"));
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, page.find("http_handler_us_bucket{route=\"/slow\",le=\"10000\"} 4\n"));
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, page.find("http_handler_us_count{route=\"/slow\"} 4\n"));
+}
+
+
+int main() {
+  setupMetricsEndpoint(server);
+  server.begin();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_page_from_a_fake_registry);
+  RUN_TEST(test_any_window_gives_the_same_page);
+  RUN_TEST(test_long_lines_are_cut);
+  RUN_TEST(test_full_registry_refuses_more);
+  RUN_TEST(test_observe_and_render_do_not_allocate);
+  RUN_TEST(test_scrape_heap_does_not_grow_with_the_registry);
+  RUN_TEST(test_timed_routes_are_counted);
+  return UNITY_END();
+}
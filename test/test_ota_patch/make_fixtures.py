@@ -0,0 +1,90 @@
+"""
+make_fixtures.py
+Runs ota_patch.py on two made up firmware images & writes the .otz files it produces into
+otz_fixtures.h, so test_main.cpp decodes real ota_patch.py output. Run it again after a
+change to ota_patch.py's format:
+
+    python test/test_ota_patch/make_fixtures.py
+
+The images come from firmware_image() here & in test_main.cpp (same generator), only the
+.otz bytes, the base MD5 & the new image's SHA-256 are stored.
+"""
+
+import hashlib
+import os
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(os.path.dirname(HERE))
+BASE_SIZE = 12000
+
+
+def firmware_image(seed, size):
+    """Bytes that compress like code: repeated 8 byte tokens with single random bytes between."""
+    tokens = [b"token%02d_" % i for i in range(16)]
+    out = bytearray()
+    state = seed
+    while len(out) < size:
+        state = (state * 1103515245 + 12345) & 0xFFFFFFFF
+        r = state >> 16
+        out += bytes([r & 0xFF]) if r % 4 == 0 else tokens[r % 16]
+    return bytes(out[:size])
+
+
+def new_image(base):
+    """The base with code inserted, moved & dropped, like a rebuilt firmware."""
+    return firmware_image(2, 500) + base[0:6000] + firmware_image(3, 300) + base[6500:BASE_SIZE]
+
+
+def ota_patch(image, base, folder):
+    paths = {}
+    for name, data in (("new.bin", image), ("base.bin", base)):
+        paths[name] = os.path.join(folder, name)
+        with open(paths[name], "wb") as f:
+            f.write(data)
+    results = []
+    for extra in ([], ["--base", paths["base.bin"]]):
+        output = os.path.join(folder, "out.otz")
+        subprocess.check_call([sys.executable, os.path.join(ROOT, "ota_patch.py"), paths["new.bin"], "-o", output] + extra)
+        results.append(open(output, "rb").read())
+    return results
+
+
+def c_array(name, data):
+    lines = ["const uint8_t %s[] PROGMEM = {" % name]
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    lines.append("};")
+    return "\r\n".join(lines)
+
+
+def main():
+    base = firmware_image(1, BASE_SIZE)
+    image = new_image(base)
+    with tempfile.TemporaryDirectory() as folder:
+        compressed, delta = ota_patch(image, base, folder)
+
+    text = "\r\n".join([
+        "// Made by make_fixtures.py from ota_patch.py output, do not edit",
+        "",
+        "const uint32_t FIXTURE_BASE_SIZE = %d;" % len(base),
+        "const uint32_t FIXTURE_IMAGE_SIZE = %d;" % len(image),
+        'const char* FIXTURE_BASE_MD5 = "%s";' % hashlib.md5(base).hexdigest(),
+        'const char* FIXTURE_IMAGE_SHA256 = "%s";' % hashlib.sha256(image).hexdigest(),
+        "",
+        "// python ota_patch.py new.bin -o compressed.otz",
+        c_array("OTZ_COMPRESSED", compressed),
+        "",
+        "// python ota_patch.py new.bin --base base.bin -o delta.otz",
+        c_array("OTZ_DELTA", delta),
+        "",
+    ])
+    with open(os.path.join(HERE, "otz_fixtures.h"), "wb") as f:
+        f.write(text.encode())
+    print("otz_fixtures.h: compressed %d bytes, delta %d bytes, image %d bytes" % (len(compressed), len(delta), len(image)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,271 @@
+// Made by make_fixtures.py from ota_patch.py output, do not edit
+
+const uint32_t FIXTURE_BASE_SIZE = 12000;
+const uint32_t FIXTURE_IMAGE_SIZE = 12300;
+const char* FIXTURE_BASE_MD5 = "d886a2915844d046b6ddd04b75475b7b";
+const char* FIXTURE_IMAGE_SHA256 = "91da6500f8d0e349b7e8c9afede5ba7716419009f85b2da9ec52bafc18013a58";
+
+// python ota_patch.py new.bin -o compressed.otz
+const uint8_t OTZ_COMPRESSED[] PROGMEM = {
+  0x4f, 0x54, 0x5a, 0x31, 0x0c, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x09, 0x8c,
+  0x74, 0x6f, 0x6b, 0x65, 0x6e, 0x30, 0x31, 0x5f, 0x45, 0x08, 0x02, 0x31, 0x35, 0x46, 0x08, 0x02,
+  0x30, 0x32, 0x47, 0x10, 0x01, 0x33, 0x47, 0x10, 0x03, 0x37, 0x5f, 0x18, 0x46, 0x09, 0x01, 0x39,
+  0x47, 0x19, 0x01, 0x34, 0x47, 0x19, 0x48, 0x21, 0x48, 0x39, 0x03, 0x33, 0x5f, 0xdc, 0x46, 0x21,
+  0x47, 0x52, 0x04, 0x30, 0x33, 0x5f, 0xfc, 0x4e, 0x2a, 0x01, 0x36, 0x4e, 0x08, 0x04, 0x31, 0x35,
+  0x5f, 0x9c, 0x4e, 0x43, 0x03, 0x36, 0x5f, 0xe0, 0x48, 0x7d, 0x01, 0xb0, 0x46, 0x09, 0x01, 0x30,
+  0x4e, 0x65, 0x50, 0xa6, 0x01, 0x49, 0x3a, 0x01, 0x37, 0x49, 0x9d, 0x01, 0x01, 0x34, 0x48, 0x74,
+  0x01, 0xbc, 0x4d, 0x7d, 0x49, 0x96, 0x01, 0x48, 0x3a, 0x03, 0x32, 0x5f, 0xc0, 0x46, 0x09, 0x48,
+  0x19, 0x04, 0x31, 0x5f, 0x8c, 0x80, 0x4d, 0x33, 0x04, 0x30, 0x39, 0x5f, 0xec, 0x46, 0x3c, 0x48,
+  0x44, 0x48, 0x86, 0x01, 0x03, 0x33, 0x5f, 0x64, 0x48, 0x6f, 0x47, 0xc2, 0x01, 0x01, 0x33, 0x47,
+  0x2b, 0x48, 0x89, 0x01, 0x04, 0x30, 0x37, 0x5f, 0x50, 0x4e, 0x80, 0x01, 0x48, 0xaa, 0x01, 0x48,
+  0x6f, 0x4a, 0xf4, 0x01, 0x4e, 0x5c, 0x03, 0x30, 0x5f, 0x5c, 0x4d, 0x29, 0x05, 0x31, 0x35, 0x5f,
+  0xec, 0x00, 0x46, 0x12, 0x02, 0x39, 0x5f, 0x47, 0x09, 0x48, 0xee, 0x01, 0x48, 0x44, 0x48, 0x08,
+  0x03, 0x39, 0x5f, 0xa0, 0x48, 0x3c, 0x01, 0x30, 0x48, 0x7e, 0x01, 0xd8, 0x4c, 0x23, 0x4e, 0x73,
+  0x48, 0xca, 0x03, 0x48, 0x6a, 0x57, 0x08, 0x49, 0x93, 0x04, 0x03, 0x31, 0x5f, 0x54, 0x4e, 0x41,
+  0x4a, 0xdc, 0x01, 0x02, 0x7c, 0x1c, 0x4d, 0x4b, 0x49, 0x87, 0x02, 0x50, 0xde, 0x04, 0x48, 0x10,
+  0x48, 0x7b, 0x48, 0x93, 0x04, 0x48, 0x63, 0x4f, 0xd0, 0x03, 0x49, 0x08, 0x48, 0x28, 0x48, 0x10,
+  0x48, 0x8d, 0x05, 0x04, 0x30, 0x5f, 0x88, 0x3c, 0x50, 0x12, 0x4e, 0x32, 0x58, 0x80, 0x04, 0x4a,
+  0x92, 0x01, 0x02, 0xd8, 0x3c, 0x47, 0xd7, 0x01, 0x50, 0xe5, 0x04, 0x4a, 0xd5, 0x04, 0x4e, 0x20,
+  0x48, 0xc5, 0x01, 0x48, 0x6b, 0x48, 0x53, 0x04, 0x39, 0x5f, 0x98, 0xcc, 0x4e, 0x75, 0x4f, 0x8d,
+  0x01, 0x48, 0x4a, 0x49, 0x62, 0x47, 0xb5, 0x01, 0x49, 0xbd, 0x01, 0x4f, 0x82, 0x01, 0x49, 0x28,
+  0x50, 0xb2, 0x03, 0x03, 0x33, 0x5f, 0x78, 0x46, 0x11, 0x48, 0x69, 0x4f, 0x71, 0x50, 0xe0, 0x02,
+  0x04, 0x31, 0x30, 0x5f, 0xe4, 0x50, 0x4a, 0x46, 0xae, 0x07, 0x49, 0x7b, 0x48, 0x42, 0x50, 0xa3,
+  0x01, 0x48, 0xc8, 0x02, 0x04, 0x31, 0x5f, 0x70, 0x20, 0x46, 0x1a, 0x52, 0xd4, 0x03, 0x01, 0x58,
+  0x46, 0x09, 0x03, 0x35, 0x5f, 0x90, 0x48, 0x09, 0x48, 0x5c, 0x47, 0x65, 0x58, 0xa7, 0x01, 0x03,
+  0x31, 0x5f, 0x48, 0x4d, 0x86, 0x01, 0x49, 0xcb, 0x02, 0x48, 0x83, 0x07, 0x50, 0x8e, 0x09, 0x52,
+  0xae, 0x06, 0x4e, 0x72, 0x48, 0x40, 0x4a, 0xfe, 0x03, 0x01, 0x98, 0x56, 0x61, 0x4a, 0x89, 0x05,
+  0x01, 0xac, 0x48, 0x19, 0x01, 0x88, 0x48, 0x1a, 0x47, 0xd4, 0x07, 0x50, 0x4c, 0x4f, 0xc4, 0x05,
+  0x50, 0x8c, 0x01, 0x51, 0xac, 0x05, 0x4f, 0xda, 0x02, 0x4b, 0x8c, 0x03, 0x02, 0x88, 0x74, 0x48,
+  0x52, 0x02, 0x98, 0x7c, 0x48, 0x3c, 0x4f, 0xf6, 0x07, 0x48, 0x08, 0x48, 0x3d, 0x4f, 0xb9, 0x06,
+  0x04, 0x31, 0x35, 0x5f, 0x70, 0x4d, 0x66, 0x51, 0xf2, 0x06, 0x50, 0xa6, 0x03, 0x4f, 0x83, 0x03,
+  0x02, 0x30, 0x31, 0x47, 0x80, 0x0a, 0x49, 0x11, 0x48, 0xd3, 0x02, 0x50, 0xac, 0x03, 0x48, 0xef,
+  0x01, 0x50, 0x18, 0x48, 0x8a, 0x01, 0x4f, 0xb1, 0x04, 0x4b, 0xfb, 0x04, 0x01, 0x68, 0x47, 0xe7,
+  0x01, 0x4a, 0xf9, 0x01, 0x48, 0x7b, 0x4d, 0x52, 0x49, 0x08, 0x03, 0x31, 0x5f, 0xa8, 0x46, 0xd8,
+  0x0a, 0x49, 0xfa, 0x06, 0x4a, 0xea, 0x06, 0x02, 0xe0, 0x60, 0x55, 0x3c, 0x4b, 0xca, 0x06, 0x4e,
+  0x9c, 0x0a, 0x51, 0xca, 0x04, 0x01, 0x35, 0x4a, 0x9c, 0x0a, 0x4e, 0x08, 0x48, 0x31, 0x50, 0xc3,
+  0x04, 0x03, 0x35, 0x5f, 0xa8, 0x4d, 0x63, 0x50, 0xf1, 0x01, 0x49, 0xe0, 0x03, 0x03, 0x31, 0x5f,
+  0x94, 0x48, 0x29, 0x47, 0xb6, 0x0d, 0x48, 0x74, 0x4f, 0xb3, 0x0e, 0x4b, 0xf7, 0x05, 0x46, 0x20,
+  0x03, 0x36, 0x5f, 0x70, 0x47, 0xf3, 0x0c, 0x52, 0xcc, 0x04, 0x01, 0x0c, 0x4d, 0x19, 0x49, 0x9e,
+  0x03, 0x03, 0x30, 0x5f, 0xd8, 0x46, 0xb1, 0x05, 0x02, 0x31, 0x31, 0x47, 0xd1, 0x01, 0x49, 0x4e,
+  0x4a, 0x9c, 0x0a, 0x01, 0x24, 0x46, 0x09, 0x52, 0xcd, 0x06, 0x01, 0x48, 0x47, 0x6f, 0x50, 0xdd,
+  0x07, 0x50, 0x84, 0x02, 0x4a, 0xff, 0x0a, 0x02, 0x8c, 0x90, 0x46, 0xb9, 0x08, 0x4b, 0x87, 0x04,
+  0x01, 0x44, 0x4e, 0x5e, 0x4a, 0xeb, 0x06, 0x49, 0x8c, 0x0e, 0x4e, 0x4d, 0x58, 0x86, 0x02, 0x48,
+  0x8f, 0x04, 0x02, 0x33, 0x5f, 0x46, 0xdc, 0x03, 0x51, 0xf2, 0x04, 0x50, 0xf4, 0x05, 0x4a, 0xf9,
+  0x02, 0x01, 0x8c, 0x46, 0x09, 0x4f, 0x8e, 0x0c, 0x51, 0x9d, 0x04, 0x50, 0x8e, 0x0a, 0x50, 0xb6,
+  0x08, 0x03, 0x33, 0x5f, 0xac, 0x49, 0xf5, 0x07, 0x46, 0x08, 0x4a, 0xee, 0x09, 0x46, 0x2a, 0x48,
+  0x18, 0x4a, 0x99, 0x02, 0x47, 0xfa, 0x0f, 0x48, 0x43, 0x57, 0xba, 0x0b, 0x49, 0x49, 0x01, 0x32,
+  0x48, 0xa6, 0x03, 0x4a, 0xe5, 0x05, 0x4e, 0x52, 0x48, 0xc7, 0x02, 0x4f, 0xf3, 0x05, 0x50, 0xa8,
+  0x0d, 0x51, 0xe7, 0x06, 0x48, 0x50, 0x05, 0x36, 0x5f, 0x38, 0xcc, 0x10, 0x4d, 0x13, 0x4a, 0xa8,
+  0x0f, 0x02, 0x31, 0x5f, 0x46, 0x97, 0x0f, 0x4b, 0xa3, 0x04, 0x46, 0xab, 0x05, 0x49, 0xba, 0x02,
+  0x4f, 0xd5, 0x07, 0x4b, 0xb3, 0x04, 0x01, 0xd4, 0x48, 0x5f, 0x4d, 0x87, 0x01, 0x51, 0xbe, 0x06,
+  0x04, 0x31, 0x5f, 0x38, 0x38, 0x4d, 0x53, 0x4b, 0x97, 0x0c, 0x01, 0x04, 0x4e, 0x5c, 0x48, 0xba,
+  0x01, 0x02, 0x31, 0x5f, 0x46, 0x86, 0x05, 0x50, 0x9b, 0x09, 0x04, 0x30, 0x35, 0x5f, 0xa4, 0x46,
+  0x09, 0x03, 0x39, 0x5f, 0x88, 0x46, 0x98, 0x0a, 0x53, 0x86, 0x0d, 0x46, 0x18, 0x4a, 0xc2, 0x03,
+  0x4d, 0x7d, 0x50, 0xa3, 0x0f, 0x49, 0xd0, 0x01, 0x50, 0x08, 0x04, 0x33, 0x5f, 0x5c, 0x50, 0x55,
+  0x5a, 0x02, 0x30, 0x36, 0x47, 0x85, 0x01, 0x50, 0x93, 0x02, 0x02, 0x31, 0x30, 0x47, 0xa3, 0x0b,
+  0x50, 0xd0, 0x0b, 0x49, 0x3a, 0x48, 0x86, 0x05, 0x50, 0xcc, 0x02, 0x48, 0xb4, 0x01, 0x4f, 0x9c,
+  0x01, 0x49, 0xc4, 0x01, 0x03, 0x36, 0x5f, 0x2c, 0x48, 0x29, 0x47, 0xaf, 0x0e, 0x01, 0x32, 0x47,
+  0x97, 0x0e, 0x4b, 0x86, 0x0c, 0x02, 0x14, 0xe0, 0x4e, 0x5d, 0x50, 0xcb, 0x05, 0x4f, 0x8e, 0x07,
+  0x4b, 0x5d, 0x01, 0xc8, 0x48, 0x43, 0x46, 0x8c, 0x04, 0x50, 0x81, 0x05, 0x50, 0x9d, 0x06, 0x02,
+  0x30, 0x32, 0x48, 0xda, 0x0c, 0x48, 0x9c, 0x04, 0x03, 0x35, 0x5f, 0x6c, 0x55, 0x7c, 0x49, 0x21,
+  0x48, 0x52, 0x03, 0x33, 0x5f, 0x20, 0x4e, 0x5b, 0x48, 0x21, 0x4a, 0x93, 0x0c, 0x47, 0xf5, 0x02,
+  0x4a, 0xed, 0x02, 0x46, 0x85, 0x0d, 0x4b, 0x83, 0x0c, 0x48, 0x74, 0x46, 0x10, 0x02, 0x39, 0x5f,
+  0x46, 0xde, 0x04, 0x50, 0xf5, 0x0a, 0x50, 0x08, 0x51, 0xfe, 0x0c, 0x50, 0xa8, 0x05, 0x4a, 0xad,
+  0x0b, 0x4d, 0x08, 0x50, 0x81, 0x06, 0x50, 0xc8, 0x07, 0x51, 0x9e, 0x02, 0x4f, 0x08, 0x4b, 0xa2,
+  0x03, 0x4d, 0x70, 0x04, 0x31, 0x35, 0x5f, 0x4c, 0x48, 0x11, 0x47, 0xad, 0x09, 0x01, 0x32, 0x47,
+  0xd3, 0x06, 0x49, 0x96, 0x09, 0x03, 0x35, 0x5f, 0xd8, 0x46, 0x1a, 0x50, 0x86, 0x0b, 0x4a, 0x9e,
+  0x02, 0x4d, 0x84, 0x01, 0x51, 0x64, 0x48, 0x9c, 0x01, 0x48, 0xa2, 0x05, 0x4a, 0x98, 0x03, 0x46,
+  0xb4, 0x0b, 0x02, 0x30, 0x37, 0x47, 0x85, 0x01, 0x53, 0xfa, 0x0e, 0x47, 0xdf, 0x0c, 0x50, 0xcf,
+  0x02, 0x03, 0x37, 0x5f, 0x58, 0x4d, 0x32, 0x04, 0x31, 0x33, 0x5f, 0x78, 0x47, 0x8b, 0x07, 0x01,
+  0x30, 0x4f, 0xbd, 0x03, 0x50, 0xaf, 0x0b, 0x51, 0xd8, 0x0b, 0x02, 0x39, 0x5f, 0x46, 0xdd, 0x0a,
+  0x4b, 0xff, 0x03, 0x01, 0x14, 0x46, 0x09, 0x4a, 0xbd, 0x02, 0x01, 0xb0, 0x46, 0xfb, 0x05, 0x51,
+  0xe7, 0x02, 0x50, 0xeb, 0x01, 0x4a, 0x10, 0x47, 0xc6, 0x05, 0x03, 0x37, 0x5f, 0x28, 0x48, 0x2a,
+  0x01, 0x30, 0x48, 0x12, 0x02, 0xb0, 0x08, 0x4e, 0x2d, 0x50, 0xdd, 0x01, 0x4f, 0x55, 0x4b, 0xda,
+  0x07, 0x48, 0x42, 0x4d, 0x40, 0x05, 0x31, 0x33, 0x5f, 0xb4, 0xf8, 0x4e, 0x1a, 0x50, 0xf7, 0x08,
+  0x50, 0xd7, 0x08, 0x48, 0x6a, 0x4f, 0xd2, 0x03, 0x02, 0x31, 0x35, 0x48, 0x8c, 0x0a, 0x50, 0x84,
+  0x0e, 0x04, 0x35, 0x5f, 0xc0, 0x68, 0x47, 0x83, 0x02, 0x4a, 0x80, 0x07, 0x4e, 0x6c, 0x48, 0x54,
+  0x4a, 0x6c, 0x01, 0x00, 0x4e, 0x29, 0x4a, 0xf3, 0x05, 0x01, 0x34, 0x47, 0xaf, 0x01, 0x48, 0x7f,
+  0x50, 0x9d, 0x06, 0x48, 0xd9, 0x01, 0x01, 0x30, 0x47, 0xe6, 0x03, 0x49, 0xdf, 0x02, 0x4a, 0xae,
+  0x06, 0x01, 0xcc, 0x4e, 0x6d, 0x50, 0xab, 0x02, 0x48, 0xf9, 0x01, 0x50, 0xab, 0x05, 0x50, 0xaf,
+  0x06, 0x4a, 0x9c, 0x04, 0x01, 0xbc, 0x4e, 0x29, 0x57, 0x41, 0x51, 0x59, 0x60, 0xd0, 0x07, 0x50,
+  0x20, 0x48, 0xac, 0x06, 0x50, 0xa8, 0x07, 0x48, 0x50, 0x50, 0x93, 0x02, 0x03, 0x33, 0x5f, 0xf4,
+  0x4d, 0x41, 0x02, 0x31, 0x30, 0x48, 0xfb, 0x01, 0x01, 0x35, 0x47, 0xbe, 0x0e, 0x51, 0x7b, 0x03,
+  0x35, 0x5f, 0xc8, 0x46, 0xcc, 0x0f, 0x4b, 0xd8, 0x02, 0x01, 0x5c, 0x46, 0xac, 0x0a, 0x49, 0x84,
+  0x06, 0x01, 0x35, 0x48, 0xe3, 0x05, 0x4f, 0xb8, 0x0e, 0x04, 0x31, 0x30, 0x5f, 0x9c, 0x48, 0x3c,
+  0x01, 0xb4, 0x48, 0x82, 0x01, 0x47, 0x9d, 0x07, 0x4f, 0xc3, 0x01, 0x02, 0x30, 0x36, 0x4a, 0x87,
+  0x0c, 0x50, 0x81, 0x01, 0x46, 0x08, 0x4f, 0xd4, 0x01, 0x50, 0xb4, 0x09, 0x51, 0xa1, 0x07, 0x48,
+  0x18, 0x4a, 0xe5, 0x07, 0x4d, 0x08, 0x51, 0xfc, 0x09, 0x4a, 0xd1, 0x07, 0x01, 0xfc, 0x55, 0x29,
+  0x49, 0x89, 0x01, 0x57, 0x8d, 0x0b, 0x03, 0x30, 0x35, 0x5f, 0x46, 0xae, 0x0d, 0x4b, 0x87, 0x0f,
+  0x01, 0x84, 0x48, 0x53, 0x46, 0x08, 0x4a, 0xbb, 0x09, 0x46, 0xb0, 0x02, 0x4b, 0x9b, 0x05, 0x4d,
+  0x21, 0x58, 0x96, 0x06, 0x51, 0xc8, 0x0b, 0x48, 0x28, 0x03, 0x36, 0x5f, 0xe4, 0x46, 0xd3, 0x0c,
+  0x51, 0x8a, 0x04, 0x50, 0x9a, 0x0e, 0x50, 0x9e, 0x02, 0x50, 0xb6, 0x02, 0x03, 0x30, 0x5f, 0xc4,
+  0x48, 0x21, 0x46, 0xc2, 0x0b, 0x58, 0x94, 0x01, 0x49, 0xd0, 0x02, 0x4a, 0xe0, 0x02, 0x01, 0x60,
+  0x48, 0x09, 0x46, 0xc1, 0x02, 0x50, 0xa6, 0x0c, 0x49, 0x10, 0x48, 0x52, 0x01, 0x31, 0x48, 0x9e,
+  0x04, 0x50, 0xd7, 0x01, 0x4f, 0x8f, 0x06, 0x04, 0x30, 0x33, 0x5f, 0x48, 0x47, 0xbb, 0x07, 0x50,
+  0x8d, 0x04, 0x01, 0x37, 0x47, 0xf4, 0x02, 0x4b, 0x85, 0x03, 0x46, 0x4b, 0x4a, 0x3b, 0x01, 0xa8,
+  0x46, 0x09, 0x4f, 0x8b, 0x06, 0x49, 0xc7, 0x01, 0x01, 0x33, 0x47, 0xd9, 0x08, 0x51, 0xe4, 0x02,
+  0x04, 0x34, 0x5f, 0x64, 0x24, 0x4d, 0x2b, 0x02, 0x31, 0x31, 0x48, 0x9c, 0x02, 0x57, 0xd9, 0x01,
+  0x04, 0x30, 0x35, 0x5f, 0x18, 0x50, 0x5d, 0x4d, 0x75, 0x4b, 0xc4, 0x02, 0x49, 0xd4, 0x06, 0x47,
+  0xc8, 0x0b, 0x4a, 0x64, 0x48, 0x4b, 0x46, 0x08, 0x52, 0xa0, 0x03, 0x4e, 0x28, 0x01, 0x36, 0x47,
+  0xc4, 0x02, 0x44, 0xb3, 0x0d, 0x48, 0x12, 0x01, 0xd0, 0x4e, 0x7d, 0x50, 0xc6, 0x09, 0x03, 0x35,
+  0x5f, 0x90, 0x48, 0x5c, 0x01, 0xb0, 0x48, 0x33, 0x46, 0x22, 0x4a, 0x75, 0x02, 0x34, 0x80, 0x4d,
+  0x1a, 0x4b, 0xc1, 0x08, 0x4e, 0x10, 0x01, 0x35, 0x48, 0x76, 0x4a, 0xad, 0x06, 0x47, 0xb0, 0x0e,
+  0x4f, 0xaa, 0x03, 0x4b, 0xac, 0x08, 0x46, 0x18, 0x4a, 0x89, 0x05, 0x01, 0x94, 0x4d, 0x29, 0x44,
+  0xcc, 0x05, 0x4e, 0x2a, 0x03, 0x39, 0x5f, 0x38, 0x48, 0x11, 0x47, 0xc0, 0x0f, 0x4f, 0x8d, 0x02,
+  0x51, 0xf5, 0x03, 0x04, 0x31, 0x5f, 0xbc, 0x48, 0x48, 0x3c, 0x48, 0x55, 0x4d, 0x86, 0x01, 0x50,
+  0xaf, 0x04, 0x4b, 0xe0, 0x01, 0x02, 0xd4, 0x48, 0x46, 0xc1, 0x01, 0x51, 0xd0, 0x0e, 0x48, 0x65,
+  0x48, 0x18, 0x03, 0x37, 0x5f, 0x7c, 0x46, 0x09, 0x50, 0x86, 0x04, 0x03, 0x32, 0x5f, 0x5c, 0x46,
+  0x11, 0x4a, 0x83, 0x02, 0x01, 0xb0, 0x46, 0x89, 0x0e, 0x49, 0xce, 0x03, 0x01, 0x34, 0x48, 0xa9,
+  0x04, 0x51, 0xfe, 0x04, 0x4a, 0x9c, 0x06, 0x01, 0xc4, 0x49, 0xf4, 0x0f, 0x48, 0x12, 0x01, 0x50,
+  0x47, 0x88, 0x02, 0x48, 0x24, 0x4a, 0x2c, 0x4d, 0x89, 0x01, 0x04, 0x30, 0x35, 0x5f, 0x20, 0x4d,
+  0x11, 0x49, 0x29, 0x03, 0x33, 0x5f, 0xa4, 0x46, 0xef, 0x04, 0x02, 0x31, 0x35, 0x47, 0xe5, 0x02,
+  0x49, 0x5e, 0x01, 0x30, 0x48, 0x11, 0x4f, 0xff, 0x0a, 0x49, 0xe4, 0x02, 0x50, 0xfc, 0x0d, 0x03,
+  0x31, 0x5f, 0x80, 0x46, 0xa4, 0x04, 0x50, 0xf3, 0x08, 0x49, 0xcb, 0x01, 0x4a, 0x8f, 0x01, 0x01,
+  0xcc, 0x47, 0xe8, 0x04, 0x48, 0x5c, 0x4a, 0xcb, 0x02, 0x47, 0xe7, 0x04, 0x4a, 0xce, 0x05, 0x02,
+  0xe4, 0xcc, 0x46, 0xea, 0x07, 0x51, 0xdf, 0x0b, 0x50, 0xff, 0x02, 0x01, 0x35, 0x48, 0xbd, 0x08,
+  0x4b, 0x77, 0x03, 0xa0, 0xf0, 0x28, 0x4e, 0x35, 0x4a, 0xa4, 0x09, 0x02, 0xdc, 0x38, 0x46, 0xe9,
+  0x02, 0x02, 0x30, 0x33, 0x48, 0xc5, 0x07, 0x01, 0x34, 0x58, 0xf2, 0x0d, 0x48, 0x8c, 0x04, 0x50,
+  0xc8, 0x01, 0x4f, 0xf9, 0x09, 0x4b, 0xcc, 0x04, 0x01, 0x24, 0x46, 0x53, 0x02, 0x30, 0x36, 0x47,
+  0xed, 0x08, 0x4b, 0xa8, 0x0b, 0x47, 0x64, 0x4a, 0xfe, 0x05, 0x01, 0x70, 0x47, 0xe0, 0x01, 0x50,
+  0xd8, 0x02, 0x48, 0x76, 0x01, 0x34, 0x47, 0x92, 0x04, 0x53, 0x95, 0x07, 0x48, 0x18, 0x47, 0xbc,
+  0x04, 0x4f, 0xa8, 0x01, 0x51, 0xc6, 0x0a, 0x01, 0x33, 0x50, 0x88, 0x0b, 0x03, 0x34, 0x5f, 0x70,
+  0x4f, 0xee, 0x08, 0x03, 0x30, 0x5f, 0xd4, 0x47, 0xad, 0x08, 0x48, 0xdd, 0x01, 0x01, 0x32, 0x48,
+  0x9d, 0x08, 0x48, 0xfa, 0x07, 0x03, 0x32, 0x5f, 0x6c, 0x46, 0x2c, 0x50, 0x87, 0x02, 0x48, 0x56,
+  0x4a, 0x90, 0x06, 0x48, 0x66, 0x48, 0x7f, 0x4d, 0x08, 0x49, 0xa1, 0x09, 0x04, 0x31, 0x34, 0x5f,
+  0xb4, 0x50, 0x3a, 0x46, 0xae, 0x07, 0x49, 0xf4, 0x03, 0x48, 0x19, 0x48, 0x83, 0x02, 0x52, 0x8b,
+  0x07, 0x03, 0x70, 0x24, 0x4c, 0x46, 0x1b, 0x01, 0x31, 0x48, 0xca, 0x0a, 0x06, 0x33, 0x5f, 0x58,
+  0xfc, 0x78, 0x74, 0x46, 0x15, 0x01, 0x30, 0x47, 0xbc, 0x0d, 0x49, 0xb4, 0x02, 0x01, 0x35, 0x50,
+  0x93, 0x07, 0x48, 0x08, 0x4a, 0xf7, 0x01, 0x48, 0x46, 0x46, 0x28, 0x50, 0xc5, 0x01, 0x4a, 0xd4,
+  0x02, 0x01, 0x2c, 0x4d, 0x41, 0x03, 0x31, 0x33, 0x5f, 0x46, 0x89, 0x01, 0x49, 0x9c, 0x01, 0x4f,
+  0x08, 0x49, 0xb9, 0x0b, 0x48, 0x08, 0x03, 0x35, 0x5f, 0xdc, 0x48, 0x53, 0x44, 0x8d, 0x03, 0x4c,
+  0x1c, 0x51, 0xaa, 0x0b, 0x02, 0x33, 0x5f, 0x47, 0xf7, 0x0d, 0x01, 0x33, 0x48, 0xed, 0x05, 0x4a,
+  0x86, 0x07, 0x01, 0x28, 0x49, 0x1b, 0x4d, 0x1a, 0x04, 0x31, 0x34, 0x5f, 0x44, 0x46, 0x09, 0x48,
+  0xb3, 0x01, 0x03, 0x32, 0x5f, 0xa4, 0x46, 0x11, 0x03, 0x30, 0x5f, 0x98, 0x4d, 0x33, 0x51, 0xf2,
+  0x0d, 0x48, 0xd3, 0x06, 0x49, 0xd2, 0x04, 0x4a, 0x84, 0x04, 0x48, 0x21, 0x46, 0x10, 0x50, 0xec,
+  0x01, 0x03, 0x32, 0x5f, 0xc8, 0x46, 0x8c, 0x0a, 0x4b, 0xf9, 0x05, 0x4d, 0x22, 0x50, 0x52, 0x51,
+  0xd2, 0x03, 0x48, 0x6a, 0x48, 0xd7, 0x02, 0x03, 0x31, 0x5f, 0x3c, 0x4e, 0x21, 0x4a, 0xfe, 0x05,
+  0x47, 0xb1, 0x05, 0x04, 0x31, 0x5f, 0x1c, 0xd8, 0x48, 0x4c, 0x47, 0x94, 0x03, 0x01, 0x39, 0x47,
+  0x1c, 0x49, 0x6e, 0x4a, 0xab, 0x05, 0x01, 0xd0, 0x47, 0xd5, 0x06, 0x4a, 0x99, 0x08, 0x47, 0xaa,
+  0x07, 0x4f, 0xb5, 0x09, 0x04, 0x30, 0x36, 0x5f, 0xc0, 0x4e, 0x3c, 0x01, 0x35, 0x48, 0x71, 0x01,
+  0x37, 0x47, 0xb7, 0x05, 0x51, 0xac, 0x01, 0x57, 0xaa, 0x09, 0x4b, 0x08, 0x01, 0xb8, 0x46, 0x21,
+  0x48, 0xd5, 0x04, 0x48, 0x41, 0x01, 0x31, 0x47, 0xb9, 0x01, 0x01, 0x31, 0x48, 0x94, 0x09, 0x05,
+  0x30, 0x32, 0x5f, 0x38, 0x28, 0x47, 0xe4, 0x0d, 0x4f, 0xb2, 0x0d, 0x4b, 0xd3, 0x09, 0x49, 0xf1,
+  0x0f, 0x4f, 0xc3, 0x0b, 0x48, 0xb4, 0x02, 0x50, 0xff, 0x01, 0x4b, 0xa8, 0x0c, 0x49, 0xf9, 0x0f,
+  0x4e, 0x89, 0x01, 0x50, 0xa6, 0x03, 0x4a, 0xcd, 0x0f, 0x4e, 0x30, 0x4a, 0xa8, 0x05, 0x47, 0xe0,
+  0x06, 0x48, 0x8f, 0x05, 0x03, 0x35, 0x5f, 0x14, 0x47, 0x96, 0x01, 0x03, 0x34, 0x5f, 0x14, 0x48,
+  0x09, 0x46, 0xfe, 0x08, 0x50, 0x89, 0x06, 0x49, 0x4d, 0x02, 0x37, 0x5f, 0x46, 0xad, 0x0b, 0x04,
+  0x30, 0x32, 0x5f, 0x94, 0x4d, 0x5f, 0x49, 0xeb, 0x01, 0x48, 0xe2, 0x01, 0x51, 0xe8, 0x0f, 0x4a,
+  0x94, 0x02, 0x46, 0xc6, 0x03, 0x04, 0x30, 0x31, 0x5f, 0xe0, 0x4e, 0x3b, 0x03, 0x39, 0x5f, 0xb4,
+  0x47, 0xa6, 0x0a, 0x48, 0xcc, 0x01, 0x4a, 0xc0, 0x02, 0x4f, 0x8b, 0x08, 0x48, 0x85, 0x02, 0x52,
+  0xa9, 0x07, 0x48, 0x4b, 0x46, 0x08, 0x48, 0x91, 0x04, 0x58, 0xd0, 0x01, 0x01, 0x39, 0x48, 0xd9,
+  0x07, 0x01, 0x37, 0x48, 0xb2, 0x04, 0x48, 0x32, 0x57, 0xca, 0x0b, 0x49, 0xa5, 0x06, 0x50, 0xad,
+  0x06, 0x01, 0x34, 0x45, 0x9a, 0x08, 0x52, 0xa3, 0x01, 0x49, 0xc1, 0x04, 0x4a, 0x88, 0x0a, 0x4e,
+  0x18, 0x01, 0x35, 0x48, 0xca, 0x02, 0x48, 0x4a, 0x4a, 0xc4, 0x01, 0x47, 0xac, 0x0f, 0x03, 0x33,
+  0x5f, 0xe8, 0x56, 0x3b, 0x04, 0x39, 0x5f, 0x04, 0x40, 0x56, 0x9a, 0x0d, 0x4b, 0xbf, 0x0c, 0x4e,
+  0xe0, 0x04, 0x4b, 0x8b, 0x0f, 0x4d, 0x76, 0x50, 0xf0, 0x01, 0x49, 0x80, 0x05, 0x48, 0x6c, 0x4a,
+  0x98, 0x02, 0x01, 0x38, 0x4d, 0x11, 0x04, 0x31, 0x33, 0x5f, 0x24, 0x4e, 0x52, 0x50, 0x85, 0x06,
+  0x50, 0xa4, 0x03, 0x50, 0x9d, 0x06, 0x03, 0x39, 0x5f, 0x84, 0x48, 0x39, 0x46, 0xa2, 0x05, 0x06,
+  0x31, 0x35, 0x5f, 0xcc, 0x24, 0x3c, 0x47, 0xe7, 0x06, 0x4a, 0xc9, 0x01, 0x4d, 0x46, 0x49, 0x66,
+  0x48, 0xd8, 0x01, 0x48, 0x08, 0x03, 0x34, 0x5f, 0x64, 0x46, 0x21, 0x50, 0xe4, 0x0a, 0x4a, 0xbe,
+  0x09, 0x01, 0x08, 0x4e, 0x19, 0x01, 0x34, 0x48, 0x94, 0x07, 0x57, 0xe3, 0x0a, 0x50, 0xcf, 0x09,
+  0x50, 0x9b, 0x02, 0x4b, 0xe1, 0x01, 0x01, 0xf8, 0x46, 0x09, 0x4a, 0x8c, 0x06, 0x4d, 0x29, 0x51,
+  0x41, 0x01, 0x30, 0x4a, 0xf5, 0x04, 0x01, 0xb0, 0x4d, 0x32, 0x51, 0xd8, 0x05, 0x01, 0x30, 0x48,
+  0xe5, 0x02, 0x4a, 0x87, 0x09, 0x4e, 0x4b, 0x4f, 0xa7, 0x03, 0x04, 0x31, 0x31, 0x5f, 0x88, 0x4d,
+  0x42, 0x02, 0x30, 0x36, 0x48, 0xf1, 0x0a, 0x4a, 0xff, 0x07, 0x4d, 0x08, 0x02, 0x31, 0x35, 0x48,
+  0xfc, 0x07, 0x4a, 0xaf, 0x0d, 0x48, 0x10, 0x01, 0x04, 0x4e, 0x7c, 0x4f, 0xe1, 0x03, 0x51, 0xa0,
+  0x0c, 0x50, 0xa4, 0x01, 0x4a, 0x89, 0x04, 0x46, 0xbb, 0x04, 0x04, 0x31, 0x31, 0x5f, 0x40, 0x48,
+  0x5b, 0x01, 0x10, 0x46, 0x09, 0x50, 0xf0, 0x01, 0x4a, 0x08, 0x01, 0x78, 0x4d, 0x21, 0x50, 0xc6,
+  0x06, 0x49, 0x6c, 0x48, 0xcd, 0x03, 0x48, 0x88, 0x06, 0x4a, 0xbd, 0x01, 0x4e, 0x10, 0x48, 0xc7,
+  0x05, 0x4f, 0xa8, 0x06, 0x02, 0x30, 0x33, 0x47, 0xc3, 0x0c, 0x58, 0x85, 0x0e, 0x4b, 0xaf, 0x07,
+  0x48, 0x31, 0x4d, 0x81, 0x01, 0x50, 0x98, 0x08, 0x50, 0x98, 0x05, 0x50, 0xb7, 0x0b, 0x49, 0x99,
+  0x01, 0x50, 0xa7, 0x0f, 0x01, 0x32, 0x48, 0xb2, 0x0d, 0x52, 0xb8, 0x05, 0x46, 0x10, 0x49, 0xad,
+  0x0b, 0x04, 0x35, 0x5f, 0xdc, 0x4c, 0x46, 0x1b, 0x4a, 0x94, 0x01, 0x02, 0xe8, 0xac, 0x48, 0x12,
+  0x47, 0xe5, 0x05, 0x48, 0x77, 0x05, 0x32, 0x5f, 0x44, 0x84, 0x24, 0x47, 0xd0, 0x08, 0x4f, 0x9a,
+  0x0b, 0x50, 0xd3, 0x01, 0x04, 0x31, 0x35, 0x5f, 0x78, 0x46, 0xa6, 0x0f, 0x59, 0xe5, 0x01, 0x48,
+  0xc5, 0x01, 0x03, 0x39, 0x5f, 0xbc, 0x4e, 0x3b, 0x52, 0xae, 0x02, 0x4f, 0xb9, 0x0b, 0x4a, 0x90,
+  0x03, 0x01, 0xd4, 0x47, 0x90, 0x05, 0x01, 0x32, 0x47, 0x87, 0x0c, 0x4b, 0xf5, 0x0b, 0x01, 0x70,
+  0x48, 0x6e, 0x46, 0x87, 0x01, 0x04, 0x31, 0x33, 0x5f, 0x60, 0x48, 0x57, 0x01, 0x44, 0x48, 0x12,
+  0x56, 0x57, 0x4f, 0xa3, 0x05, 0x49, 0x8e, 0x03, 0x48, 0xe5, 0x05, 0x50, 0xae, 0x08, 0x48, 0x48,
+  0x4f, 0x9f, 0x04, 0x04, 0x31, 0x35, 0x5f, 0x6c, 0x4e, 0x41, 0x4a, 0x9f, 0x0f, 0x46, 0x8f, 0x0f,
+  0x51, 0xde, 0x09, 0x50, 0xef, 0x0d, 0x48, 0x82, 0x02, 0x4f, 0xd2, 0x05, 0x51, 0x80, 0x04, 0x48,
+  0x7a, 0x58, 0xa2, 0x01, 0x48, 0xe2, 0x01, 0x01, 0x31, 0x48, 0xfb, 0x01, 0x48, 0x69, 0x50, 0xc2,
+  0x05, 0x48, 0x51, 0x48, 0x08, 0x03, 0x33, 0x5f, 0x1c, 0x4e, 0x4a, 0x4a, 0xeb, 0x05, 0x46, 0x08,
+  0x48, 0x8b, 0x06, 0x50, 0x18, 0x03, 0x31, 0x5f, 0xbc, 0x47, 0xef, 0x02, 0x48, 0x12, 0x48, 0x9c,
+  0x01, 0x4f, 0xf4, 0x01, 0x50, 0xfd, 0x06, 0x50, 0xcc, 0x0c, 0x02, 0x30, 0x31, 0x48, 0xbe, 0x07,
+  0x02, 0x37, 0x5f, 0x47, 0xd9, 0x0f, 0x48, 0xc9, 0x04, 0x03, 0x35, 0x5f, 0x98, 0x48, 0x53, 0x01,
+  0x20, 0x47, 0xd8, 0x01, 0x50, 0xca, 0x09, 0x4a, 0xc9, 0x02, 0x46, 0xca, 0x09, 0x02, 0x30, 0x36,
+  0x48, 0xf9, 0x05, 0x03, 0x34, 0x5f, 0x28, 0x48, 0x12, 0x01, 0x20, 0x47, 0x9a, 0x0e, 0x4f, 0x83,
+  0x09, 0x49, 0xa9, 0x04, 0x4b, 0xe7, 0x06, 0x01, 0x60, 0x47, 0xcd, 0x04, 0x01, 0x31, 0x48, 0xcd,
+  0x04, 0x01, 0x35, 0x48, 0xea, 0x06, 0x50, 0xe0, 0x0b, 0x52, 0x08, 0x01, 0xcc, 0x48, 0x45, 0x47,
+  0x56, 0x4a, 0x8c, 0x07, 0x49, 0x3a, 0x4e, 0x88, 0x01, 0x50, 0x88, 0x06, 0x01, 0x39, 0x47, 0xdb,
+  0x0d, 0x49, 0xed, 0x02, 0x4a, 0xb6, 0x03, 0x02, 0xe8, 0xf0, 0x4d, 0x3b, 0x53, 0xf4, 0x06, 0x01,
+  0xf4, 0x4d, 0x33, 0x51, 0xfa, 0x04, 0x4b, 0x10, 0x4e, 0x19, 0x4f, 0xb7, 0x03, 0x50, 0x8d, 0x06,
+  0x02, 0x30, 0x37, 0x47, 0xf4, 0x09, 0x4b, 0x19, 0x46, 0xea, 0x0b, 0x51, 0x87, 0x0b, 0x52, 0xc1,
+  0x0d, 0x01, 0xc4, 0x4e, 0x7c, 0x4f, 0x88, 0x07, 0x04, 0x31, 0x30, 0x5f, 0x20, 0x4e, 0x3a, 0x48,
+  0xb2, 0x02, 0x4a, 0xe7, 0x09, 0x4d, 0x41, 0x02, 0x30, 0x37, 0x47, 0xf5, 0x07, 0x05, 0x30, 0x36,
+  0x5f, 0x7c, 0x5c, 0x47, 0x91, 0x08, 0x06, 0x33, 0x5f, 0xbc, 0xf8, 0x04, 0x9c, 0x4e, 0x59, 0x4a,
+  0x8f, 0x06, 0x48, 0x69, 0x01, 0xd4, 0x47, 0x2e, 0x4f, 0xfb, 0x02, 0x49, 0xd0, 0x02, 0x48, 0x32,
+  0x03, 0x39, 0x5f, 0x7c, 0x4e, 0x3b, 0x4f, 0xf7, 0x09, 0x02, 0x30, 0x37, 0x4f, 0xac, 0x09, 0x54,
+  0xe9, 0x02, 0x4e, 0x32, 0x4a, 0xfc, 0x07, 0x01, 0xb8, 0x47, 0x90, 0x02, 0x4f, 0xe6, 0x07, 0x51,
+  0xce, 0x07, 0x50, 0x96, 0x0c, 0x50, 0x97, 0x02, 0x50, 0xb3, 0x03, 0x4a, 0xbd, 0x01, 0x46, 0x08,
+  0x01, 0x37, 0x48, 0x83, 0x01, 0x4a, 0xbd, 0x01, 0x46, 0xd6, 0x01, 0x06, 0x31, 0x35, 0x5f, 0x08,
+  0x6c, 0xec, 0x48, 0x5d, 0x47, 0xdb, 0x0a, 0x48, 0x46, 0x48, 0x9b, 0x02, 0x01, 0x34, 0x47, 0xef,
+  0x0e, 0x02, 0x31, 0x31, 0x48, 0xeb, 0x01, 0x4a, 0xc2, 0x01, 0x4e, 0x68, 0x4a, 0xe9, 0x03, 0x01,
+  0x88, 0x47, 0x81, 0x03, 0x48, 0xbd, 0x0f, 0x05, 0x30, 0x37, 0x5f, 0xc4, 0x78, 0x47, 0xb3, 0x05,
+  0x48, 0xae, 0x01, 0x4f, 0x8a, 0x05, 0x50, 0xe5, 0x0e, 0x49, 0x56, 0x4a, 0xe2, 0x08, 0x48, 0x18,
+  0x01, 0x3c, 0x4d, 0x29, 0x49, 0x87, 0x02, 0x4f, 0xbf, 0x02, 0x49, 0xe9, 0x02, 0x50, 0x61, 0x4a,
+  0x49, 0x46, 0x20, 0x4f, 0xee, 0x04, 0x05, 0x30, 0x36, 0x5f, 0xc8, 0x24, 0x4e, 0x4a, 0x4a, 0xd9,
+  0x01, 0x48, 0x18, 0x01, 0xe0, 0x46, 0xc3, 0x08, 0x51, 0xc5, 0x01, 0x4f, 0xe0, 0x0a, 0x49, 0x32,
+  0x48, 0x20, 0x03, 0x31, 0x5f, 0xd4, 0x48, 0x6d, 0x47, 0x93, 0x0c, 0x50, 0xd5, 0x0c, 0x4f, 0xe1,
+  0x04, 0x50, 0xce, 0x06, 0x51, 0x52, 0x48, 0x94, 0x06, 0x48, 0xa7, 0x02, 0x01, 0x32, 0x47, 0x62,
+  0x51, 0x93, 0x0a, 0x4a, 0x83, 0x01, 0x48, 0x82, 0x01, 0x4d, 0x41, 0x4b, 0xd2, 0x05, 0x50, 0x51,
+  0x4e, 0x40, 0x50, 0xa1, 0x01, 0x48, 0xeb, 0x01, 0x03, 0x30, 0x5f, 0x34, 0x48, 0x79, 0x47, 0xfe,
+  0x03, 0x48, 0xcd, 0x06, 0x04, 0x32, 0x5f, 0x14, 0xe4, 0x48, 0x1b, 0x46, 0x08, 0x03, 0x35, 0x5f,
+  0x00, 0x4d, 0x4d, 0x04, 0x31, 0x33, 0x5f, 0x54, 0x46, 0x11, 0x4f, 0xea, 0x0d, 0x49, 0x8f, 0x02,
+  0x05, 0x36, 0x5f, 0x50, 0xec, 0xb0, 0x48, 0x13, 0x47, 0xaa, 0x05, 0x50, 0xaa, 0x04, 0x48, 0x10,
+  0x50, 0x8b, 0x07, 0x01, 0x30, 0x48, 0x8d, 0x0a, 0x49, 0x8b, 0x0b, 0x4a, 0xf2, 0x0f, 0x02, 0x94,
+  0xc8, 0x46, 0x0a, 0x4f, 0x9e, 0x02, 0x03, 0x31, 0x35, 0x5f, 0x47, 0x98, 0x06, 0x50, 0xae, 0x04,
+  0x48, 0x10, 0x48, 0x43, 0x01, 0x39, 0x47, 0x90, 0x0a, 0x49, 0xf0, 0x02, 0x4f, 0xe0, 0x0d, 0x50,
+  0xe6, 0x09, 0x03, 0x30, 0x33, 0x5f, 0x46, 0xc8, 0x01, 0x51, 0x99, 0x03, 0x4a, 0x87, 0x0a, 0x46,
+  0x10, 0x4f, 0xb0, 0x05, 0x51, 0x18, 0x03, 0x32, 0x5f, 0xdc, 0x46, 0xd3, 0x06, 0x51, 0xa9, 0x08,
+  0x4b, 0xcd, 0x01, 0x47, 0xd7, 0x02, 0x48, 0x44, 0x48, 0x08, 0x50, 0xb8, 0x05, 0x48, 0x8c, 0x01,
+  0x50, 0xeb, 0x08, 0x4f, 0x18, 0x06, 0x30, 0x33, 0x5f, 0x24, 0x94, 0xdc, 0x47, 0xc5, 0x02, 0x50,
+  0x81, 0x04, 0x4a, 0xd0, 0x01, 0x02, 0x4c, 0x80, 0x47, 0xf7, 0x07, 0x50, 0x93, 0x07, 0x03, 0x36,
+  0x5f, 0xa8, 0x4e, 0xb9, 0x0f, 0x51, 0xb1, 0x06, 0x4a, 0xf0, 0x03, 0x4d, 0x65, 0x51, 0xa1, 0x01,
+  0x03, 0x33, 0x5f, 0x6c, 0x4d, 0x41, 0x04, 0x30, 0x39, 0x5f, 0x08, 0x48, 0x1a, 0x46, 0xd7, 0x0a,
+  0x53, 0xdf, 0x0f, 0x4e, 0x32, 0x48, 0x6b, 0x4a, 0xe2, 0x03, 0x01, 0xa0, 0x46, 0x29, 0x03, 0x31,
+  0x5f, 0xa8, 0x48, 0x12, 0x46, 0x08, 0x48, 0x83, 0x06, 0x04, 0x34, 0x5f, 0xec, 0xd8, 0x4d, 0x4c,
+  0x50, 0x9e, 0x04, 0x49, 0xa7, 0x01, 0x50, 0xc2, 0x0d, 0x4a, 0x7c, 0x01, 0xd0, 0x48, 0x75, 0x02,
+  0x84, 0x14, 0x47, 0xb1, 0x01, 0x4a, 0xb6, 0x03, 0x01, 0x80, 0x4d, 0x45, 0x4b, 0xe3, 0x04, 0x4d,
+  0x10, 0x49, 0xe9, 0x02, 0x48, 0x28, 0x01, 0x32, 0x48, 0xe6, 0x0a, 0x50, 0x19, 0x48, 0xea, 0x01,
+  0x01, 0x36, 0x48, 0x21, 0x48, 0xe6, 0x02, 0x02, 0x34, 0x5f, 0x47, 0x8d, 0x0b, 0x4f, 0xff, 0x02,
+  0x02, 0x30, 0x35, 0x48, 0xd7, 0x02, 0x03, 0x39, 0x5f, 0x48, 0x4e, 0x85, 0x01, 0x4a, 0xce, 0x02,
+  0x01, 0xe8, 0x47, 0xb8, 0x01, 0x4f, 0xb3, 0x06, 0x49, 0x22, 0x04, 0x31, 0x5f, 0x64, 0xb4, 0x47,
+  0x46, 0x4a, 0xdc, 0x08, 0x01, 0x4c, 0x48, 0x57, 0x48, 0x81, 0x01, 0x4d, 0x08, 0x4b, 0xed, 0x0c,
+  0x46, 0x08, 0x50, 0xc8, 0x02, 0x01, 0x32, 0x48, 0xfc, 0x0c, 0x4a, 0xca, 0x04, 0x4d, 0x10, 0x04,
+  0x31, 0x33, 0x5f, 0x78, 0x46, 0x19, 0x4a, 0xbd, 0x02, 0x02, 0xd4, 0x84, 0x49, 0x23,
+};
+
+// python ota_patch.py new.bin --base base.bin -o delta.otz
+const uint8_t OTZ_DELTA[] PROGMEM = {
+  0x4f, 0x54, 0x5a, 0x31, 0x0c, 0x30, 0x00, 0x00, 0xe0, 0x2e, 0x00, 0x00, 0x00, 0x08, 0xd8, 0x86,
+  0xa2, 0x91, 0x58, 0x44, 0xd0, 0x46, 0xb6, 0xdd, 0xd0, 0x4b, 0x75, 0x47, 0x5b, 0x7b, 0x8e, 0xb0,
+  0x96, 0x01, 0x89, 0xdb, 0x94, 0x01, 0x90, 0xe0, 0x08, 0x89, 0xa8, 0x87, 0x01, 0x8f, 0xdd, 0x7c,
+  0x91, 0xcc, 0x03, 0x03, 0x33, 0x5f, 0xdc, 0x8e, 0x99, 0x19, 0x88, 0x82, 0x5b, 0x89, 0xad, 0x51,
+  0x88, 0xbf, 0x08, 0x8a, 0xd0, 0x08, 0x8e, 0x98, 0x4c, 0x02, 0x30, 0x36, 0x88, 0xf9, 0x15, 0x88,
+  0xf8, 0x6b, 0x90, 0xc7, 0xa2, 0x01, 0x50, 0xa6, 0x01, 0x90, 0xfe, 0x0c, 0x04, 0x31, 0x34, 0x5f,
+  0x34, 0x48, 0x74, 0x8f, 0x80, 0x71, 0x90, 0x85, 0x86, 0x01, 0x01, 0x32, 0x8f, 0xc2, 0x94, 0x01,
+  0x05, 0x30, 0x31, 0x5f, 0x8c, 0x80, 0x4d, 0x33, 0x02, 0x30, 0x39, 0x88, 0xb0, 0x13, 0x8a, 0x97,
+  0xab, 0x01, 0x88, 0x1f, 0x01, 0x64, 0x88, 0x91, 0x01, 0x89, 0x9c, 0x19, 0x46, 0x2b, 0x8b, 0xfd,
+  0x16, 0x01, 0x50, 0x4e, 0x80, 0x01, 0x90, 0x94, 0x0a, 0x90, 0xb9, 0x06, 0x8a, 0x92, 0x04, 0x8f,
+  0x90, 0x03, 0x04, 0x35, 0x5f, 0xec, 0x00, 0x46, 0x12, 0x90, 0xe0, 0x04, 0x89, 0xe3, 0x11, 0x8a,
+  0x8e, 0x04, 0x89, 0xd6, 0x0d, 0x01, 0x30, 0x48, 0x7e, 0x01, 0xd8, 0x4c, 0x23, 0x80, 0xf0, 0x2e,
+  0x8b, 0x14, 0x48, 0x7f, 0x4d, 0x08, 0x89, 0x97, 0x12, 0x02, 0x31, 0x34, 0x8a, 0xd1, 0x0d, 0x88,
+  0xd5, 0x3c, 0x46, 0xae, 0x07, 0x89, 0xe8, 0x04, 0x90, 0xa2, 0x04, 0x52, 0x8b, 0x07, 0x03, 0x70,
+  0x24, 0x4c, 0x88, 0xe1, 0x0a, 0x47, 0xca, 0x0a, 0x06, 0x33, 0x5f, 0x58, 0xfc, 0x78, 0x74, 0x86,
+  0x00, 0x01, 0x30, 0x90, 0xe2, 0x95, 0x01, 0x91, 0xb1, 0x0c, 0x90, 0x8b, 0x7f, 0x8f, 0x8f, 0x01,
+  0x51, 0xc5, 0x01, 0x4a, 0xd4, 0x02, 0x01, 0x2c, 0x4d, 0x41, 0x89, 0xb6, 0x33, 0x99, 0xa5, 0x13,
+  0x90, 0x91, 0x24, 0x01, 0x35, 0x88, 0x54, 0x01, 0x31, 0x45, 0xfb, 0x0b, 0x8c, 0x91, 0x07, 0x91,
+  0xb4, 0x09, 0x80, 0xdf, 0x2a, 0x80, 0x5b,
+};
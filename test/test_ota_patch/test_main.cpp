@@ -0,0 +1,212 @@
+/****************************************************************************************
+* ESPOTAPatch.h: the decoder against real ota_patch.py output (otz_fixtures.h, see
+* make_fixtures.py), fed in pieces cut anywhere, then /ota/patch end to end through
+* ElegantOTAHelper.h's server - the image in flash, the SHA-256 check & the reboot, &
+* every abort path ending the upload (status, metrics, OTA priority).
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ElegantOTAHelper.h"
+#include "otz_fixtures.h"
+#include <unity.h>
+
+// Same generator as make_fixtures.py. The test's images are not the device's heap.
+std::vector<uint8_t> firmwareImage(uint32_t seed, size_t size) {
+  hal::Quiet quiet;
+  static const char* tokens = "token00_token01_token02_token03_token04_token05_token06_token07_"
+                              "token08_token09_token10_token11_token12_token13_token14_token15_";
+  std::vector<uint8_t> out;
+  uint32_t state = seed;
+  while (out.size() < size) {
+    state = state * 1103515245UL + 12345UL;
+    uint32_t r = state >> 16;
+    if (r % 4 == 0) {
+      out.push_back(r & 0xFF);
+    } else {
+      out.insert(out.end(), tokens + (r % 16) * 8, tokens + (r % 16) * 8 + 8);
+    }
+  }
+  out.resize(size);
+  return out;
+}
+
+std::vector<uint8_t> baseImage = firmwareImage(1, FIXTURE_BASE_SIZE);
+std::vector<uint8_t> newImage;
+
+std::vector<uint8_t> decoded;
+
+bool memoryHeader(OtzDecoder& d) {
+  return true;
+}
+
+bool memoryWrite(const uint8_t* data, size_t length) {
+  hal::Quiet quiet;
+  decoded.insert(decoded.end(), data, data + length);
+  return true;
+}
+
+bool memoryReadBase(uint32_t offset, uint8_t* out, size_t length) {
+  memcpy(out, baseImage.data() + offset, length);
+  return true;
+}
+
+// Decode a whole stream in pieces of `piece` bytes, returns the decoder's error or nullptr
+const char* decodeInPieces(const uint8_t* stream, size_t length, size_t piece) {
+  static OtzDecoder decoder;
+  decoded.clear();
+  otzBegin(decoder, memoryHeader, memoryWrite, memoryReadBase);
+  for (size_t i = 0; i < length; i += piece) {
+    if (!otzFeed(decoder, stream + i, min(piece, length - i))) {
+      return decoder.error;
+    }
+  }
+  return otzFinish(decoder) ? nullptr : decoder.error;
+}
+
+hal::HttpResponse uploadPatch(const uint8_t* stream, size_t length) {
+  hal::HttpRequest request;
+  request.method = HTTP_POST;
+  request.url = "/ota/patch";
+  request.filename = "fw.otz";
+  request.upload.assign((const char*)stream, length);
+  return hal::serve(server, request);
+}
+
+bool verifyRebooted() {
+  try {
+    handleOTAVerify();
+  } catch (const hal::Restart&) {
+    return true;
+  }
+  return false;
+}
+
+void setUp() {
+  delay(10000);   // admission token buckets refill
+  eboot_command_clear();
+}
+
+void tearDown() {}
+
+
+void test_compressed_image_round_trip() {
+  const size_t pieces[] = { 1, 7, 64, 1436, sizeof(OTZ_COMPRESSED) };
+  for (size_t piece : pieces) {
+    TEST_ASSERT_NULL(decodeInPieces(OTZ_COMPRESSED, sizeof(OTZ_COMPRESSED), piece));
+    TEST_ASSERT_EQUAL(newImage.size(), decoded.size());
+    TEST_ASSERT_TRUE(decoded == newImage);
+  }
+}
+
+void test_delta_round_trip() {
+  const size_t pieces[] = { 1, 3, 100, sizeof(OTZ_DELTA) };
+  for (size_t piece : pieces) {
+    TEST_ASSERT_NULL(decodeInPieces(OTZ_DELTA, sizeof(OTZ_DELTA), piece));
+    TEST_ASSERT_TRUE(decoded == newImage);
+  }
+}
+
+void test_decoder_refuses_broken_streams() {
+  std::vector<uint8_t> stream(OTZ_COMPRESSED, OTZ_COMPRESSED + sizeof(OTZ_COMPRESSED));
+
+  stream[0] = 'X';
+  TEST_ASSERT_EQUAL_STRING("not an .otz image", decodeInPieces(stream.data(), stream.size(), 1436));
+
+  TEST_ASSERT_EQUAL_STRING("image cut short", decodeInPieces(OTZ_COMPRESSED, sizeof(OTZ_COMPRESSED) - 10, 1436));
+
+  stream.assign(OTZ_COMPRESSED, OTZ_COMPRESSED + OTZ_HEADER_SIZE);
+  stream.push_back(OTZ_OP_WINDOW << 6 | 4);   // copy before anything was written
+  stream.push_back(1);
+  TEST_ASSERT_EQUAL_STRING("bad window distance", decodeInPieces(stream.data(), stream.size(), 1436));
+
+  stream.assign(OTZ_COMPRESSED, OTZ_COMPRESSED + OTZ_HEADER_SIZE);
+  stream.push_back(OTZ_OP_BASE << 6 | 4);     // base copy in an image without a base
+  TEST_ASSERT_EQUAL_STRING("base copy in an image without a base", decodeInPieces(stream.data(), stream.size(), 1436));
+}
+
+void test_patch_upload_is_verified_and_booted() {
+  hal::HttpResponse response = uploadPatch(OTZ_DELTA, sizeof(OTZ_DELTA));
+  TEST_ASSERT_EQUAL(200, response.code);
+  TEST_ASSERT_EQUAL(OTA_VERIFY_PENDING, otaVerifyState);
+  TEST_ASSERT_EQUAL(newImage.size(), otaStats.imageSize);
+  TEST_ASSERT_EQUAL(sizeof(OTZ_DELTA), otaStats.bytes);
+  TEST_ASSERT_EQUAL_MEMORY(newImage.data(), hal::flashMemory() + hal::UPDATE_ADDRESS, newImage.size());
+
+  hal::serialOutput.clear();
+  TEST_ASSERT_TRUE(verifyRebooted());
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, hal::serialOutput.find(FIXTURE_IMAGE_SHA256));
+}
+
+// Each abort path: the upload is reported failed & other routes are let through again
+void assertUploadEnded(const char* error) {
+  TEST_ASSERT_EQUAL_STRING(error, otaPatchDecoder.error);
+  TEST_ASSERT_FALSE(otaStats.success);
+  TEST_ASSERT_EQUAL(OTA_VERIFY_IDLE, otaVerifyState);
+  TEST_ASSERT_EQUAL(OTA_STATE_FAILED, statusValues[STATUS_OTA_STATE]);
+  TEST_ASSERT_FALSE(otaPriority);
+  TEST_ASSERT_EQUAL(200, hal::get(server, "/").code);   // not a 503 "update running"
+  TEST_ASSERT_FALSE(verifyRebooted());
+  eboot_command command;
+  TEST_ASSERT_NOT_EQUAL(0, eboot_command_read(&command));   // nothing for the bootloader
+}
+
+void test_delta_against_other_firmware_ends_the_upload() {
+  hal::sketchMD5 = "00000000000000000000000000000000";
+  snprintf(runningMD5, sizeof(runningMD5), "%s", ESP.getSketchMD5().c_str());
+  hal::HttpResponse response = uploadPatch(OTZ_DELTA, sizeof(OTZ_DELTA));
+  hal::sketchMD5 = FIXTURE_BASE_MD5;
+  snprintf(runningMD5, sizeof(runningMD5), "%s", ESP.getSketchMD5().c_str());
+
+  TEST_ASSERT_EQUAL(400, response.code);
+  assertUploadEnded("delta was made against different firmware");
+}
+
+void test_cut_short_upload_ends_the_upload() {
+  hal::HttpResponse response = uploadPatch(OTZ_COMPRESSED, sizeof(OTZ_COMPRESSED) - 100);
+  TEST_ASSERT_EQUAL(400, response.code);
+  assertUploadEnded("image cut short");
+}
+
+void test_write_failure_ends_the_upload() {
+  hal::updateFailWrite = true;
+  hal::HttpResponse response = uploadPatch(OTZ_COMPRESSED, sizeof(OTZ_COMPRESSED));
+  hal::updateFailWrite = false;
+  TEST_ASSERT_EQUAL(400, response.code);
+  assertUploadEnded("write failed");
+}
+
+void test_decoder_state_fits_the_heap() {
+  TEST_ASSERT_LESS_THAN(2600, sizeof(OtzDecoder));   // ~2.4 KB, allocated once as a global
+  hal::resetHeapStats();
+  TEST_ASSERT_NULL(decodeInPieces(OTZ_DELTA, sizeof(OTZ_DELTA), 1436));
+  TEST_ASSERT_EQUAL(0, hal::heap.allocations);   // decoding allocates nothing
+}
+
+
+int main() {
+  {
+    hal::Quiet quiet;
+    newImage = firmwareImage(2, 500);
+    newImage.insert(newImage.end(), baseImage.begin(), baseImage.begin() + 6000);
+    std::vector<uint8_t> inserted = firmwareImage(3, 300);
+    newImage.insert(newImage.end(), inserted.begin(), inserted.end());
+    newImage.insert(newImage.end(), baseImage.begin() + 6500, baseImage.end());
+  }
+
+  // The running firmware is the delta's base
+  memcpy(hal::flashMemory(), baseImage.data(), baseImage.size());
+  hal::sketchSize = FIXTURE_BASE_SIZE;
+  hal::sketchMD5 = FIXTURE_BASE_MD5;
+  setupOTA();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_compressed_image_round_trip);
+  RUN_TEST(test_delta_round_trip);
+  RUN_TEST(test_decoder_refuses_broken_streams);
+  RUN_TEST(test_patch_upload_is_verified_and_booted);
+  RUN_TEST(test_delta_against_other_firmware_ends_the_upload);
+  RUN_TEST(test_cut_short_upload_ends_the_upload);
+  RUN_TEST(test_write_failure_ends_the_upload);
+  RUN_TEST(test_decoder_state_fits_the_heap);
+  return UNITY_END();
+}
@@ -0,0 +1,182 @@
+/****************************************************************************************
+* ESPOTAVerify.h through ElegantOTAHelper.h's server: an upload goes to /ota/start &
+* /ota/upload like the ElegantOTA page sends it, then handleOTAVerify() checks it.
+* - SHA-256 of the image read back from flash, against a posted digest,
+* - a mismatch discards the copy command & keeps the running firmware,
+* - no copy command is left between the upload & the check, so a reset there keeps the
+*   running firmware,
+* - /ota/sha256 & /ota/patch ask for ElegantOTA's login when one is set,
+* - filesystem uploads skip the hash & reboot,
+* - upload metrics on /metrics.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ElegantOTAHelper.h"
+#include <unity.h>
+
+// SHA-256 of image(5000), worked out with Python's hashlib
+const char* IMAGE_SHA256 = "1b5c855ff1052578ee7d262a7a7b784281ff77178d83435e3fc858874e8a5b10";
+
+std::string image(size_t size) {
+  std::string bytes(size, '\0');
+  for (size_t i = 0; i < size; i++) {
+    bytes[i] = (char)(i * 7 + i / 256);
+  }
+  return bytes;
+}
+
+void postDigest(const char* digest) {
+  hal::HttpRequest request;
+  request.method = HTTP_POST;
+  request.url = "/ota/sha256";
+  request.form = { { "digest", digest } };
+  TEST_ASSERT_EQUAL(200, hal::serve(server, request).code);
+}
+
+// Runs the check, true if it rebooted
+bool verifyRebooted() {
+  try {
+    handleOTAVerify();
+  } catch (const hal::Restart&) {
+    return true;
+  }
+  return false;
+}
+
+void setUp() {
+  delay(10000);   // admission token buckets refill between tests
+  hal::serialOutput.clear();
+  eboot_command_clear();
+}
+
+void tearDown() {}
+
+
+void test_matching_digest_reboots_into_the_image() {
+  postDigest(IMAGE_SHA256);
+  hal::HttpResponse response = hal::otaUpload(server, image(5000));
+  TEST_ASSERT_EQUAL(200, response.code);
+  TEST_ASSERT_EQUAL(OTA_VERIFY_PENDING, otaVerifyState);
+  TEST_ASSERT_FALSE(otaStats.filesystem);
+  eboot_command command;
+  TEST_ASSERT_NOT_EQUAL(0, eboot_command_read(&command));   // held back: a reset now boots the running firmware
+
+  TEST_ASSERT_TRUE(verifyRebooted());
+  TEST_ASSERT_EQUAL(OTA_VERIFY_PASSED, otaVerifyState);
+  TEST_ASSERT_TRUE(otaStats.verified);
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, hal::serialOutput.find(IMAGE_SHA256));
+  TEST_ASSERT_EQUAL(0, eboot_command_read(&command));   // written back, the bootloader copies it
+  TEST_ASSERT_EQUAL(ACTION_COPY_RAW, command.action);
+  TEST_ASSERT_EQUAL(5000, command.args[2]);
+}
+
+void test_mismatching_digest_keeps_the_running_firmware() {
+  postDigest("0000000000000000000000000000000000000000000000000000000000000000");
+  hal::otaUpload(server, image(5000));
+
+  TEST_ASSERT_FALSE(verifyRebooted());
+  TEST_ASSERT_EQUAL(OTA_VERIFY_FAILED, otaVerifyState);
+  TEST_ASSERT_EQUAL(OTA_STATE_FAILED, statusValues[STATUS_OTA_STATE]);
+  eboot_command command;
+  TEST_ASSERT_NOT_EQUAL(0, eboot_command_read(&command));   // copy command cleared
+  TEST_ASSERT_FALSE(otaHasExpectedDigest);                 // used up
+}
+
+void test_without_a_digest_the_image_is_hashed_and_booted() {
+  hal::otaUpload(server, image(5000));
+  TEST_ASSERT_TRUE(verifyRebooted());
+  TEST_ASSERT_FALSE(otaStats.verified);
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, hal::serialOutput.find(IMAGE_SHA256));
+}
+
+void test_filesystem_upload_reboots_without_a_hash() {
+  postDigest(IMAGE_SHA256);   // for the firmware that comes next, not this image
+  hal::HttpResponse response = hal::otaUpload(server, image(3000), true);
+  TEST_ASSERT_EQUAL(200, response.code);
+  TEST_ASSERT_TRUE(otaStats.filesystem);
+  TEST_ASSERT_EQUAL(3000, hal::fsImage.size());
+
+  TEST_ASSERT_TRUE(verifyRebooted());
+  TEST_ASSERT_EQUAL(OTA_VERIFY_PASSED, otaVerifyState);
+  TEST_ASSERT_EQUAL(std::string::npos, hal::serialOutput.find("could not find"));
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, hal::serialOutput.find("filesystem image written"));
+  TEST_ASSERT_TRUE(otaHasExpectedDigest);   // still there for the firmware
+}
+
+void test_firmware_after_a_filesystem_upload_is_hashed_again() {
+  hal::otaUpload(server, image(5000));   // the digest posted before the filesystem upload
+  TEST_ASSERT_FALSE(otaStats.filesystem);
+  TEST_ASSERT_TRUE(verifyRebooted());
+  TEST_ASSERT_TRUE(otaStats.verified);
+}
+
+void test_failed_upload_is_not_verified() {
+  hal::updateFailWrite = true;
+  hal::HttpResponse response = hal::otaUpload(server, image(5000));
+  hal::updateFailWrite = false;
+  TEST_ASSERT_EQUAL(400, response.code);
+  TEST_ASSERT_EQUAL(OTA_VERIFY_IDLE, otaVerifyState);
+  TEST_ASSERT_EQUAL(OTA_STATE_FAILED, statusValues[STATUS_OTA_STATE]);
+  TEST_ASSERT_FALSE(verifyRebooted());
+}
+
+void test_login_is_asked_for_when_set() {
+  setOTAAuth("admin", "secret");
+  ElegantOTA.setAuth("admin", "secret");
+
+  hal::HttpRequest request;
+  request.method = HTTP_POST;
+  request.url = "/ota/sha256";
+  request.form = { { "digest", IMAGE_SHA256 } };
+  hal::HttpResponse response = hal::serve(server, request);
+  TEST_ASSERT_EQUAL(401, response.code);
+  TEST_ASSERT_TRUE(response.hasHeader("WWW-Authenticate"));
+  TEST_ASSERT_FALSE(otaHasExpectedDigest);
+
+  request.headers = { { "Authorization", "Basic YWRtaW46c2VjcmV0" } };   // admin:secret
+  TEST_ASSERT_EQUAL(200, hal::serve(server, request).code);
+  TEST_ASSERT_TRUE(otaHasExpectedDigest);
+
+  OTAVerifyState state = otaVerifyState;
+  hal::HttpRequest patch;
+  patch.method = HTTP_POST;
+  patch.url = "/ota/patch";
+  patch.upload = image(100);
+  patch.filename = "fw.otz";
+  TEST_ASSERT_EQUAL(401, hal::serve(server, patch).code);
+  TEST_ASSERT_EQUAL(state, otaVerifyState);   // nothing was started
+  TEST_ASSERT_EQUAL(401, hal::otaUpload(server, image(5000)).code);
+
+  setOTAAuth("", "");
+  ElegantOTA.clearAuth();
+  otaHasExpectedDigest = false;
+}
+
+void test_upload_metrics() {
+  hal::otaUpload(server, image(5000), false, 1000);
+  TEST_ASSERT_EQUAL(5000, otaStats.bytes);
+  TEST_ASSERT_EQUAL(5, otaStats.chunks);
+  TEST_ASSERT_EQUAL(1000, otaStats.minChunk);
+  TEST_ASSERT_EQUAL(1000, otaStats.maxChunk);
+  TEST_ASSERT_TRUE(otaStats.success);
+  TEST_ASSERT_TRUE(verifyRebooted());
+
+  hal::HttpResponse metrics = hal::get(server, "/metrics");
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, metrics.body.find("ota_last_bytes 5000"));
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, metrics.body.find("ota_last_success 1"));
+}
+
+
+int main() {
+  setupOTA();
+  UNITY_BEGIN();
+  RUN_TEST(test_matching_digest_reboots_into_the_image);
+  RUN_TEST(test_mismatching_digest_keeps_the_running_firmware);
+  RUN_TEST(test_without_a_digest_the_image_is_hashed_and_booted);
+  RUN_TEST(test_filesystem_upload_reboots_without_a_hash);
+  RUN_TEST(test_firmware_after_a_filesystem_upload_is_hashed_again);
+  RUN_TEST(test_login_is_asked_for_when_set);
+  RUN_TEST(test_upload_metrics);
+  RUN_TEST(test_failed_upload_is_not_verified);   // last: ElegantOTA leaves the failed Update open
+  return UNITY_END();
+}
@@ -0,0 +1,180 @@
+/****************************************************************************************
+* ESPPageTemplate.h & ElegantOTAHelper.h's flash pages: %NAME% fields are filled in from
+* the callback, unknown names, a lone % & over-long values are handled, a page rendered
+* through any TCP window is the same page, each piece goes on from the last (the template
+* is read once, not again from the start per piece) & a field read once is sent whole
+* even when its value changes between pieces. Rendering allocates nothing, & "/" & the 404
+* page cost no more heap allocations than the server's own floor (a route sending an empty
+* chunked response) but the filler holding the cursor, where the String built with +=
+* they replaced allocates per request.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ElegantOTAHelper.h"
+#include <unity.h>
+
+const char TEST_PAGE[] PROGMEM = "a=%A% b=%B% unknown=%NOPE% 100% lone %% %A%";
+const char LONG_NAME_PAGE[] PROGMEM = "%ABCDEFGHIJKLMNOPQRSTUVWXYZ% end";
+
+
+bool testFields(const char* name, char* out, size_t outSize) {
+  if (strcmp(name, "A") == 0) {
+    snprintf(out, outSize, "%d", 42);
+  } else if (strcmp(name, "B") == 0) {
+    memset(out, 'x', outSize);   // longer than the buffer, cut to TEMPLATE_MAX_VALUE - 1
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Render a whole page `window` bytes at a time, like the chunked response does
+std::string render(PGM_P page, TemplateFields fields, size_t window) {
+  std::string text;
+  uint8_t buffer[64];
+  TemplateCursor cursor;
+  size_t n;
+  while ((n = renderTemplate(page, fields, cursor, buffer, window)) > 0) {
+    text.append((const char*)buffer, n);
+  }
+  return text;
+}
+
+int fieldReads = 0;
+
+// A value one character longer on each read, like a counter ticking during a response
+bool growingFields(const char* name, char* out, size_t outSize) {
+  fieldReads++;
+  memset(out, 'a' + fieldReads - 1, min((size_t)fieldReads, outSize));
+  out[min((size_t)fieldReads, outSize - 1)] = '\0';
+  return true;
+}
+
+// Heap allocations of one GET, HAL bookkeeping excluded
+uint32_t allocationsOf(AsyncWebServer& target, const char* url) {
+  hal::get(target, url);   // warm up: admission's per-IP slot, route stats
+  hal::resetHeapStats();
+  hal::get(target, url);
+  return hal::heap.allocations;
+}
+
+void setUp() {}
+void tearDown() {}
+
+
+void test_fields_are_filled_in() {
+  std::string x(TEMPLATE_MAX_VALUE - 1, 'x');
+  TEST_ASSERT_EQUAL_STRING(("a=42 b=" + x + " unknown=%NOPE% 100% lone %% 42").c_str(),
+                           render(TEST_PAGE, testFields, 64).c_str());
+  TEST_ASSERT_EQUAL_STRING("%ABCDEFGHIJKLMNOPQRSTUVWXYZ% end", render(LONG_NAME_PAGE, testFields, 64).c_str());
+}
+
+void test_any_window_renders_the_same_page() {
+  std::string whole = render(TEST_PAGE, testFields, 64);
+  for (size_t window = 1; window < 64; window++) {
+    TEST_ASSERT_EQUAL_STRING(whole.c_str(), render(TEST_PAGE, testFields, window).c_str());
+  }
+}
+
+void test_each_field_is_read_once_and_sent_whole() {
+  const char page[] PROGMEM = "%N%|%N%|%N%";
+  fieldReads = 0;
+  TEST_ASSERT_EQUAL_STRING("a|bb|ccc", render(page, growingFields, 1).c_str());   // a byte per piece
+  TEST_ASSERT_EQUAL(3, fieldReads);
+}
+
+void test_pieces_go_on_from_the_last() {
+  // Every piece reads only its own template bytes: a field per piece, not one per piece so far
+  const char page[] PROGMEM = "%N%%N%%N%%N%%N%%N%%N%%N%";
+  fieldReads = 0;
+  std::string text = render(page, growingFields, 2);
+  TEST_ASSERT_EQUAL(8, fieldReads);
+  TEST_ASSERT_EQUAL(36, text.size());   // 1 + 2 + ... + 8
+}
+
+void test_rendering_does_not_allocate() {
+  uint8_t buffer[16];
+  TemplateCursor cursor;
+  hal::resetHeapStats();
+  while (renderTemplate(INDEX_PAGE, indexPageFields, cursor, buffer, sizeof(buffer)) > 0) {
+  }
+  TEST_ASSERT_EQUAL(0, hal::heap.allocations);
+}
+
+void test_landing_page_from_flash() {
+  delay(5000);
+  hal::HttpRequest request;
+  request.url = "/";
+  request.window = 16;   // several filler calls
+  hal::HttpResponse response = hal::serve(server, request);
+  TEST_ASSERT_EQUAL(200, response.code);
+  TEST_ASSERT_EQUAL_STRING("text/plain", response.contentType.c_str());
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, response.body.find("I am ESP-C0FFEE"));
+  char uptime[32];
+  snprintf(uptime, sizeof(uptime), "Up for %lu s.", millis() / 1000);
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, response.body.find(uptime));
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, response.body.find("http://192.168.1.77/update"));
+  TEST_ASSERT_EQUAL(std::string::npos, response.body.find('%'));
+
+  hal::HttpResponse missing = hal::get(server, "/nothing-here");
+  TEST_ASSERT_EQUAL(404, missing.code);
+  TEST_ASSERT_EQUAL_STRING("404 - Page Not Found, oops!", missing.body.c_str());
+}
+
+void test_pages_allocate_no_more_than_the_library() {
+  uint32_t floor = allocationsOf(server, "/floor");
+  uint32_t index = allocationsOf(server, "/");
+  uint32_t notFound = allocationsOf(server, "/nothing-here");
+
+  // The page the "/" handler used to build per request
+  hal::resetHeapStats();
+  {
+    String page = "Hi! I am ";
+    page += wifi_station_get_hostname();
+    page += ", and look! No wires!!.\nUp for ";
+    page += String(millis() / 1000);
+    page += " s.\n\nBrowse to http://";
+    page += WiFi.localIP().toString();
+    page += "/update to update my firmware.";
+  }
+  uint32_t concatenated = hal::heap.allocations;
+
+  printf("allocations per request: server floor %u, \"/\" %u, 404 %u, String += page alone %u\n",
+         floor, index, notFound, concatenated);
+  TEST_ASSERT_EQUAL(floor + 2, index);   // the filler holding its TemplateCursor, built & copied into the response
+  TEST_ASSERT_LESS_OR_EQUAL(floor, notFound);
+  TEST_ASSERT_GREATER_THAN(0, concatenated);
+}
+
+void test_polling_does_not_grow_the_heap() {
+  delay(ADMIT_BURST * ADMIT_REFILL_MS);   // the earlier tests' tokens back
+  hal::get(server, "/");
+  int64_t live = hal::heap.liveBytes;
+  for (int i = 0; i < 500; i++) {
+    TEST_ASSERT_EQUAL(200, hal::get(server, "/").code);
+    delay(ADMIT_REFILL_MS);   // a monitoring system polling as fast as admission allows
+  }
+  TEST_ASSERT_EQUAL(live, hal::heap.liveBytes);
+}
+
+
+int main() {
+  hal::addAccessPoint("YOUR_SSID_NAME", "YOUR_SSID_PW", 1, 6, -55);
+  WiFi.mode(WIFI_STA);
+  WiFi.begin("YOUR_SSID_NAME", "YOUR_SSID_PW");
+  setupOTA();
+  server.on("/floor", HTTP_GET, timedRoute("/floor", [](AsyncWebServerRequest* request) {
+    request->send(request->beginChunkedResponse("text/plain", [](uint8_t*, size_t, size_t) -> size_t { return 0; }));
+  }));
+
+  UNITY_BEGIN();
+  RUN_TEST(test_fields_are_filled_in);
+  RUN_TEST(test_any_window_renders_the_same_page);
+  RUN_TEST(test_each_field_is_read_once_and_sent_whole);
+  RUN_TEST(test_pieces_go_on_from_the_last);
+  RUN_TEST(test_rendering_does_not_allocate);
+  RUN_TEST(test_landing_page_from_flash);
+  RUN_TEST(test_pages_allocate_no_more_than_the_library);
+  RUN_TEST(test_polling_does_not_grow_the_heap);
+  return UNITY_END();
+}
@@ -0,0 +1,210 @@
+/****************************************************************************************
+* ESPPowerSave.h with ESPScheduler.h in a typical config (the ElegantOTA example in STA
+* mode: ElegantOTAHelper.h & ESPWiFiSTAHelper.h, listen interval 3), one boot per idle
+* mode: the sleep type & listen interval reach the Wi-Fi stack, Scheduler::run() only
+* wakes when a task is due, & a request arriving while it sleeps is served at once.
+* The listen interval is still set when the radio associates, also when WiFi.begin()
+* clears it as the ESP32 core does, on the first connection & after a reconnect.
+* A duty-cycle model over 10 connected minutes prints the estimated active time & average
+* current of each idle mode (the constants below are ESP8266 datasheet ballparks).
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ElegantOTAHelper.h"
+#include "ESPWiFiSTAHelper.h"
+#include <unity.h>
+
+const unsigned long SETTLE_MS = 60000;     // connect & the first probe rounds, not measured
+const unsigned long MODEL_MS = 600000;     // connected time the model covers
+const unsigned long REQUEST_AT_MS = 30007; // a browser request, between task deadlines
+
+// Energy model
+const float ACTIVE_MA = 70.0f;          // CPU running, radio receiving
+const float MODEM_SLEEP_MA = 15.0f;     // CPU idle, radio off between beacons
+const float LIGHT_SLEEP_MA = 0.9f;      // CPU paused, radio off between beacons
+const float WAKE_US = 1000.0f;          // wake-up, one scheduler pass & back to sleep
+const float BEACON_US = 2000.0f;        // radio on for a DTIM beacon
+const float BEACON_INTERVAL_US = 102400.0f;
+
+IdleMode bootMode = IDLE_DELAY;
+uint8_t bootListenInterval = 3;
+
+// What a boot reports back on Serial
+struct IdleResult {
+  int sleepType;
+  unsigned listenInterval;
+  unsigned long wakes;        // Scheduler::run() calls
+  unsigned long passes;       // of which ran a task
+  unsigned long long busyUS;  // in task callbacks
+  unsigned long servedMS;     // when the request was answered, from its arrival
+  int code;
+};
+
+unsigned long taskPasses = 0;
+Scheduler::PassObserver metricsObserver = nullptr;
+
+void countPass(unsigned long busyUS) {
+  taskPasses++;
+  metricsObserver(busyUS);   // still feeds the /metrics loop histogram
+}
+
+IdleResult bootAndIdle(IdleMode mode, uint8_t interval = 3) {
+  bootMode = mode;
+  bootListenInterval = interval;
+  hal::BootResult boot = hal::runBoot([]() {
+    Serial.begin(115200);
+    idleMode = bootMode;
+    listenInterval = bootListenInterval;
+    setupWiFi();
+    setupOTA();
+    scheduleWiFi();
+    scheduleOTA();
+    while (millis() < SETTLE_MS) {
+      Scheduler::run();
+    }
+
+    metricsObserver = Scheduler::passObserver;
+    Scheduler::passObserver = countPass;
+    static unsigned long servedMS = 0;
+    static int code = 0;
+    unsigned long start = millis();
+    hal::after(REQUEST_AT_MS, [start]() {
+      code = hal::get(server, "/metrics").code;
+      servedMS = millis() - start - REQUEST_AT_MS;
+    });
+
+    unsigned long long busyUS = Scheduler::busyUS;
+    unsigned long wakes = 0;
+    while (millis() - start < MODEL_MS) {
+      Scheduler::run();
+      wakes++;
+    }
+    busyUS = Scheduler::busyUS - busyUS;
+    Scheduler::printStats();
+    flushLog();
+    Serial.printf("\nresult %d %u %lu %lu %llu %lu %d\n", hal::sleepMode, (unsigned)hal::listenInterval,
+                  wakes, taskPasses, busyUS, servedMS, code);
+  });
+  TEST_ASSERT_EQUAL(hal::BOOT_RETURNED, boot.outcome);
+
+  IdleResult result = {};
+  const char* line = strstr(boot.serial, "\nresult ");
+  TEST_ASSERT_NOT_NULL(line);
+  sscanf(line, "\nresult %d %u %lu %lu %llu %lu %d", &result.sleepType, &result.listenInterval,
+         &result.wakes, &result.passes, &result.busyUS, &result.servedMS, &result.code);
+  return result;
+}
+
+// Share of MODEL_MS the chip is awake: task time, a wake-up per pass & the DTIM beacons
+float activePercent(const IdleResult& result, IdleMode mode) {
+  if (mode == IDLE_DELAY) {
+    return 100.0f;   // the radio never sleeps
+  }
+  float beacons = MODEL_MS * 1000.0f / (BEACON_INTERVAL_US * result.listenInterval);
+  float activeUS = result.busyUS + result.wakes * WAKE_US + beacons * BEACON_US;
+  return activeUS * 100.0f / (MODEL_MS * 1000.0f);
+}
+
+float averageMA(float activePercent, float sleepMA) {
+  return (activePercent * ACTIVE_MA + (100.0f - activePercent) * sleepMA) / 100.0f;
+}
+
+void checkCommon(const IdleResult& result) {
+  TEST_ASSERT_EQUAL(result.passes, result.wakes);   // every wake ran a task, no spinning
+  TEST_ASSERT_EQUAL(200, result.code);              // incoming TCP woke the node
+  TEST_ASSERT_EQUAL(0, result.servedMS);            // straight away, not at the next deadline
+}
+
+float delayMA = 0, modemMA = 0, lightMA = 0;
+
+void setUp() {}
+void tearDown() {}
+
+
+void test_delay_leaves_the_radio_on() {
+  IdleResult result = bootAndIdle(IDLE_DELAY);
+  TEST_ASSERT_EQUAL(WIFI_NONE_SLEEP, result.sleepType);
+  checkCommon(result);
+  delayMA = averageMA(activePercent(result, IDLE_DELAY), 0);
+  printf("idle delay:  %5lu wakes/min, active 100%%, %.1f mA average\n", result.wakes * 60000 / MODEL_MS, delayMA);
+}
+
+void test_modem_sleep_with_listen_interval() {
+  IdleResult result = bootAndIdle(IDLE_MODEM_SLEEP);
+  TEST_ASSERT_EQUAL(WIFI_MODEM_SLEEP, result.sleepType);
+  TEST_ASSERT_EQUAL(3, result.listenInterval);
+  checkCommon(result);
+  float active = activePercent(result, IDLE_MODEM_SLEEP);
+  modemMA = averageMA(active, MODEM_SLEEP_MA);
+  printf("modem sleep: %5lu wakes/min, active %.2f%%, %.1f mA average\n", result.wakes * 60000 / MODEL_MS, active, modemMA);
+  TEST_ASSERT_LESS_THAN(delayMA, modemMA);
+}
+
+void test_light_sleep_with_listen_interval() {
+  IdleResult result = bootAndIdle(IDLE_LIGHT_SLEEP);
+  TEST_ASSERT_EQUAL(WIFI_LIGHT_SLEEP, result.sleepType);
+  TEST_ASSERT_EQUAL(3, result.listenInterval);
+  checkCommon(result);
+  float active = activePercent(result, IDLE_LIGHT_SLEEP);
+  lightMA = averageMA(active, LIGHT_SLEEP_MA);
+  printf("light sleep: %5lu wakes/min, active %.2f%%, %.1f mA average\n", result.wakes * 60000 / MODEL_MS, active, lightMA);
+  TEST_ASSERT_LESS_THAN(10.0f, active);
+  TEST_ASSERT_LESS_THAN(modemMA, lightMA);
+}
+
+void test_longer_listen_interval_sleeps_more() {
+  IdleResult result = bootAndIdle(IDLE_LIGHT_SLEEP, 10);
+  TEST_ASSERT_EQUAL(10, result.listenInterval);
+  checkCommon(result);
+  float active = activePercent(result, IDLE_LIGHT_SLEEP);
+  printf("light sleep, listen interval 10: active %.2f%%, %.1f mA average\n", active, averageMA(active, LIGHT_SLEEP_MA));
+  TEST_ASSERT_LESS_THAN(lightMA, averageMA(active, LIGHT_SLEEP_MA));
+}
+
+void test_listen_interval_survives_begin() {
+  hal::beginResetsListenInterval = true;   // the ESP32 core writes a fresh STA config in WiFi.begin()
+  hal::BootResult boot = hal::runBoot([]() {
+    Serial.begin(115200);
+    idleMode = IDLE_MODEM_SLEEP;
+    listenInterval = 5;
+    setupWiFi();
+    scheduleWiFi();
+    while (millis() < 10000) {
+      Scheduler::run();
+    }
+    unsigned first = hal::associatedListenInterval;
+    uint32_t begins = hal::wifiBegins;
+    hal::dropLink();
+    unsigned long lostMS = millis();
+    while (millis() - lostMS < 30000) {
+      Scheduler::run();
+    }
+    Serial.printf("\nintervals %u %u %u %d\n", first, hal::associatedListenInterval,
+                  (unsigned)(hal::wifiBegins - begins), WiFi.status());
+  });
+  hal::beginResetsListenInterval = false;
+  TEST_ASSERT_EQUAL(hal::BOOT_RETURNED, boot.outcome);
+
+  unsigned first = 0, reconnected = 0, begins = 0;
+  int status = 0;
+  const char* line = strstr(boot.serial, "\nintervals ");
+  TEST_ASSERT_NOT_NULL(line);
+  sscanf(line, "\nintervals %u %u %u %d", &first, &reconnected, &begins, &status);
+  TEST_ASSERT_EQUAL(5, first);         // put back between begin() & the association
+  TEST_ASSERT_GREATER_OR_EQUAL(1, begins);
+  TEST_ASSERT_EQUAL(WL_CONNECTED, status);
+  TEST_ASSERT_EQUAL(5, reconnected);   // and on the reconnect's begin()
+}
+
+
+int main() {
+  hal::addAccessPoint("YOUR_SSID_NAME", "YOUR_SSID_PW", 1, 6, -55);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_delay_leaves_the_radio_on);
+  RUN_TEST(test_modem_sleep_with_listen_interval);
+  RUN_TEST(test_light_sleep_with_listen_interval);
+  RUN_TEST(test_longer_listen_interval_sleeps_more);
+  RUN_TEST(test_listen_interval_survives_begin);
+  return UNITY_END();
+}
@@ -0,0 +1,215 @@
+/****************************************************************************************
+* ESPProfiler.h with HELPER_PROFILE on: PROFILE_SCOPE() counts calls, total & longest time
+* per site, a probe or loop() pass at PROFILE_STALL_US is a stall kept in the ring with the
+* responsible site, the time Scheduler::run() waits is not loop() time, & the histogram's
+* percentiles are within a bucket (25%) of the real ones.
+* Also prints the host cost of one probe (a scoped function against the same function
+* without PROFILE_SCOPE()), which has to stay far below the per-probe budget.
+****************************************************************************************/
+
+#include <Arduino.h>
+#define HELPER_PROFILE 1
+#include "ESPProfiler.h"
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+const int BENCH_CALLS = 1000000;
+
+volatile uint32_t sink = 0;
+
+void work(unsigned long us) {
+  PROFILE_SCOPE("work");
+  delayMicroseconds(us);
+}
+
+void sensorRead() {
+  PROFILE_SCOPE("sensorRead");
+  delay(25);   // a blocking read, longer than PROFILE_STALL_US
+}
+
+__attribute__((noinline)) void plain() {
+  sink++;
+}
+
+__attribute__((noinline)) void probed() {
+  PROFILE_SCOPE("probed");
+  sink++;
+}
+
+// A loop() pass: the profiler, `us` of work in a probe & the scheduler waiting `idleMS`
+void loopPass(unsigned long us, unsigned long idleMS = 0) {
+  profileLoop();
+  work(us);
+  if (idleMS) {
+    unsigned long long idle = Scheduler::idleUS;
+    delay(idleMS);
+    Scheduler::idleUS = idle + idleMS * 1000;   // as run() counts its wait
+  }
+}
+
+int siteNamed(const char* name) {
+  for (int i = 0; i < profileSiteCount; i++) {
+    if (strcmp(profileSites[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const ProfileStall& lastStall() {
+  return profileStalls[(profileStallCount - 1) % PROFILE_MAX_STALLS];
+}
+
+void resetLoopStats() {
+  memset(profileLoopBuckets, 0, sizeof(profileLoopBuckets));
+  profileLoopPasses = 0;
+  profileLoopMaxUS = 0;
+  profileLoopStarted = false;
+}
+
+void setUp() {}
+void tearDown() {}
+
+
+void test_buckets_cover_every_time_once() {
+  int previous = 0;
+  for (uint32_t us = 0; us < 40000000; us += 1 + us / 64) {
+    int bucket = profileBucket(us);
+    TEST_ASSERT_GREATER_OR_EQUAL(previous, bucket);
+    if (bucket < PROFILE_LOOP_BUCKETS - 1) {   // the last one takes everything longer
+      TEST_ASSERT_LESS_OR_EQUAL(profileBucketLimit(bucket), us);
+    }
+    if (bucket > 0 && bucket < PROFILE_LOOP_BUCKETS - 1) {
+      TEST_ASSERT_GREATER_THAN(profileBucketLimit(bucket - 1), us);
+      TEST_ASSERT_LESS_OR_EQUAL(us / 4 + 1, profileBucketLimit(bucket) - us);   // within 25%
+    }
+    previous = bucket;
+  }
+  TEST_ASSERT_EQUAL(PROFILE_LOOP_BUCKETS - 1, profileBucket(0xFFFFFFFF));
+}
+
+void test_scope_counts_calls_and_time() {
+  work(100);
+  work(300);
+  work(200);
+  int site = siteNamed("work");
+  TEST_ASSERT_GREATER_OR_EQUAL(0, site);
+  TEST_ASSERT_EQUAL(3, profileSites[site].calls);
+  TEST_ASSERT_EQUAL(600 * profileCpuMHz, profileSites[site].totalCycles);
+  TEST_ASSERT_EQUAL(300 * profileCpuMHz, profileSites[site].maxCycles);
+  TEST_ASSERT_EQUAL(0, profileStallCount);
+}
+
+void test_blocking_probe_is_a_stall() {
+  sensorRead();
+  TEST_ASSERT_EQUAL(1, profileStallCount);
+  TEST_ASSERT_EQUAL_STRING("sensorRead", lastStall().site);
+  TEST_ASSERT_EQUAL(25000, lastStall().us);
+  TEST_ASSERT_FALSE(lastStall().loopPass);
+  TEST_ASSERT_EQUAL(millis(), lastStall().atMS);
+}
+
+void test_slow_loop_pass_names_its_longest_probe() {
+  uint32_t stalls = profileStallCount;
+  profileLoop();
+  for (int i = 0; i < 4; i++) {
+    work(4000);   // none a stall alone, 24 ms together
+  }
+  work(8000);
+  profileLoop();
+  TEST_ASSERT_EQUAL(stalls + 1, profileStallCount);
+  TEST_ASSERT_TRUE(lastStall().loopPass);
+  TEST_ASSERT_EQUAL_STRING("work", lastStall().site);
+  TEST_ASSERT_EQUAL(24000, lastStall().us);
+
+  // Waiting in Scheduler::run() is not loop() time
+  loopPass(1000, 500);
+  profileLoop();
+  TEST_ASSERT_EQUAL(stalls + 1, profileStallCount);
+  TEST_ASSERT_EQUAL(24000, profileLoopMaxUS);
+}
+
+void test_stall_ring_keeps_the_last() {
+  for (int i = 0; i < PROFILE_MAX_STALLS + 3; i++) {
+    work(PROFILE_STALL_US + i);
+  }
+  TEST_ASSERT_EQUAL(PROFILE_STALL_US + PROFILE_MAX_STALLS + 2, lastStall().us);
+  uint32_t shortestKept = 0xFFFFFFFF;
+  for (int i = 0; i < PROFILE_MAX_STALLS; i++) {
+    shortestKept = min(shortestKept, profileStalls[i].us);
+  }
+  TEST_ASSERT_EQUAL(PROFILE_STALL_US + 3, shortestKept);   // the 3 oldest were replaced
+
+  printProfile();
+  TEST_ASSERT_NOT_NULL(strstr(hal::serialOutput.c_str(), "stalls of 20000 us or more since boot"));
+}
+
+void test_percentiles_within_a_bucket() {
+  resetLoopStats();
+  std::vector<uint32_t> passes;
+  for (int i = 0; i < 2000; i++) {
+    uint32_t us = i % 100 == 0 ? random(5000, 15000) : random(50, 400);   // a few slow passes
+    passes.push_back(us);
+    loopPass(us);
+  }
+  profileLoop();
+  std::sort(passes.begin(), passes.end());
+  const int percents[] = { 50, 95, 99 };
+  for (int percent : percents) {
+    uint32_t exact = passes[(passes.size() * percent + 99) / 100 - 1];
+    uint32_t estimate = profileLoopPercentile(percent);
+    TEST_ASSERT_GREATER_OR_EQUAL(exact, estimate);
+    TEST_ASSERT_LESS_OR_EQUAL(exact + exact / 4 + 1, estimate);
+  }
+  TEST_ASSERT_EQUAL(passes.back(), profileLoopMaxUS);
+  TEST_ASSERT_EQUAL(passes.back(), profileLoopPercentile(100));
+}
+
+// Host time of `calls` calls of `f`, in ns per call
+template <typename F>
+double nsPerCall(F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_CALLS; i++) {
+    f();
+  }
+  auto took = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(took).count() / (double)BENCH_CALLS;
+}
+
+void test_probe_overhead() {
+  probed();   // registers the site
+  hal::resetHeapStats();
+  double without = nsPerCall(plain);
+  double with = nsPerCall(probed);
+  printf("probe overhead: %.1f ns per call (%.1f ns scoped, %.1f ns plain)\n", with - without, with, without);
+  TEST_ASSERT_EQUAL(0, hal::heap.allocations);
+  TEST_ASSERT_EQUAL(BENCH_CALLS + 1, profileSites[siteNamed("probed")].calls);
+  TEST_ASSERT_LESS_THAN(200.0, with - without);
+}
+
+void test_full_site_table_is_ignored() {
+  while (profileSiteCount < PROFILE_MAX_SITES) {
+    profileSite("filler");
+  }
+  TEST_ASSERT_EQUAL(-1, profileSite("one too many"));
+  profileRecord(-1, 1000000000);   // a probe with no site records nothing
+  TEST_ASSERT_EQUAL(PROFILE_MAX_SITES, profileSiteCount);
+}
+
+
+int main() {
+  Serial.begin(115200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_buckets_cover_every_time_once);
+  RUN_TEST(test_scope_counts_calls_and_time);
+  RUN_TEST(test_blocking_probe_is_a_stall);
+  RUN_TEST(test_slow_loop_pass_names_its_longest_probe);
+  RUN_TEST(test_stall_ring_keeps_the_last);
+  RUN_TEST(test_percentiles_within_a_bucket);
+  RUN_TEST(test_probe_overhead);
+  RUN_TEST(test_full_site_table_is_ignored);
+  return UNITY_END();
+}
@@ -0,0 +1,198 @@
+/****************************************************************************************
+* ESPReachability.h through ESPWiFiSTAHelper.h with a fake probe backend (hal::tcpRoute
+* answering per target after a scripted RTT, with an error or never): a loop() pass stays
+* within LOOP_BUDGET_US whatever the probes do, a round probes the gateway, the DNS server
+* & the internet host in turn every PROBE_INTERVAL_MS, and the RTT/loss window drives
+* hasInternet & the LED pattern.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPWiFiSTAHelper.h"
+#include <unity.h>
+
+const uint64_t LOOP_BUDGET_US = 1000;   // longest a loop() pass may take, change to tighten
+const long NO_ANSWER = -1;              // the connect errors
+const long HANGS = 600000;              // the connect never completes within a test
+
+// Fake probe backend: scripted RTT per target
+long gatewayRTT = 4;
+long dnsRTT = 12;
+long hostRTT = 80;
+int probesSeen[PROBE_TARGET_COUNT];
+uint64_t longestPassUS = 0;
+
+long fakeProbe(const char* host, uint32_t ip, uint16_t port) {
+  if (host) {
+    probesSeen[PROBE_HOST]++;
+    return hostRTT;
+  }
+  if (port == dnsProbePort) {
+    probesSeen[PROBE_DNS]++;
+    return dnsRTT;
+  }
+  probesSeen[PROBE_GATEWAY]++;
+  return gatewayRTT;
+}
+
+// loop() for `ms`: handleWiFi() & handleLog() every 10 ms, timing each pass
+void runLoop(unsigned long ms) {
+  for (unsigned long start = millis(); millis() - start < ms;) {
+    uint64_t before = hal::nowUS;
+    handleWiFi();
+    handleLog();
+    longestPassUS = max(longestPassUS, hal::nowUS - before);
+    delay(10);
+  }
+}
+
+// Run until the next round has started & finished
+void runRound() {
+  runLoop(PROBE_INTERVAL_MS - (millis() - lastRoundMS) + 10);
+  while (reachabilityBusy()) {
+    runLoop(10);
+  }
+}
+
+void setUp() {
+  longestPassUS = 0;
+  memset(probesSeen, 0, sizeof(probesSeen));
+}
+
+void tearDown() {
+  TEST_ASSERT_LESS_OR_EQUAL(LOOP_BUDGET_US, longestPassUS);
+}
+
+
+void test_first_round_probes_each_target_in_turn() {
+  setupWiFi();
+  runLoop(hal::wifiTiming.associateMS + hal::wifiTiming.dhcpMS + 100);
+  TEST_ASSERT_TRUE(isConnected);
+
+  runLoop(500);   // one probe in flight at a time, the round is done well within this
+  TEST_ASSERT_FALSE(reachabilityBusy());
+  for (int i = 0; i < PROBE_TARGET_COUNT; i++) {
+    TEST_ASSERT_EQUAL(1, probesSeen[i]);
+    TEST_ASSERT_EQUAL(1, probeStats[i].count);
+  }
+  // RTT rounded up to the 10 ms loop() pass that saw the callback
+  TEST_ASSERT_UINT32_WITHIN(10, gatewayRTT, reachabilityRTT(PROBE_GATEWAY));
+  TEST_ASSERT_UINT32_WITHIN(10, dnsRTT, reachabilityRTT(PROBE_DNS));
+  TEST_ASSERT_UINT32_WITHIN(10, hostRTT, reachabilityRTT(PROBE_HOST));
+  TEST_ASSERT_TRUE(hasInternet);
+  TEST_ASSERT_TRUE(samePattern(LED_ON, wifiLEDPattern()));
+}
+
+void test_rounds_follow_the_interval() {
+  runLoop(PROBE_INTERVAL_MS - 1000);
+  TEST_ASSERT_EQUAL(0, probesSeen[PROBE_GATEWAY]);   // not due yet
+  runLoop(1500);
+  TEST_ASSERT_EQUAL(1, probesSeen[PROBE_GATEWAY]);
+  TEST_ASSERT_EQUAL(1, probesSeen[PROBE_HOST]);
+}
+
+void test_hanging_probes_time_out_without_blocking() {
+  gatewayRTT = HANGS;
+  dnsRTT = HANGS;
+  hostRTT = HANGS;
+  runLoop(PROBE_INTERVAL_MS - (millis() - lastRoundMS) + 10);
+  unsigned long start = millis();
+  while (reachabilityBusy()) {
+    runLoop(10);
+  }
+  // Each target waited out PROBE_TIMEOUT_MS in turn, loop() ran all along
+  TEST_ASSERT_UINT32_WITHIN(50, PROBE_TARGET_COUNT * PROBE_TIMEOUT_MS, millis() - start);
+  TEST_ASSERT_EQUAL(34, reachabilityLoss(PROBE_HOST));   // 2 answered, 1 lost
+  TEST_ASSERT_TRUE(hasInternet);                         // one lost probe is not an outage
+}
+
+void test_loss_window_drives_has_internet() {
+  gatewayRTT = 4;
+  dnsRTT = 12;
+  hostRTT = 40;
+  for (int round = 0; round < REACH_WINDOW; round++) {
+    runRound();
+  }
+  TEST_ASSERT_EQUAL(0, reachabilityLoss(PROBE_HOST));   // the lost probes left the window
+  TEST_ASSERT_TRUE(hasInternet);
+  TEST_ASSERT_EQUAL(REACH_WINDOW, probeStats[PROBE_HOST].count);
+  TEST_ASSERT_UINT32_WITHIN(10, 40, reachabilityRTT(PROBE_HOST));
+
+  // An upstream outage: the LAN answers, the internet host errors
+  hostRTT = NO_ANSWER;
+  int lost = 0;
+  while (hasInternet) {
+    runRound();
+    lost++;
+  }
+  TEST_ASSERT_EQUAL(REACH_WINDOW * REACH_LOSS_LIMIT / 100, lost);
+  TEST_ASSERT_EQUAL(0, reachabilityLoss(PROBE_GATEWAY));
+  TEST_ASSERT_EQUAL(0, statusValues[STATUS_INTERNET]);
+
+  // Back up: the new answers push the old ones out first, so it takes one more round than
+  // were lost before hasInternet is back
+  hostRTT = 40;
+  int answered = 0;
+  while (!hasInternet) {
+    runRound();
+    answered++;
+  }
+  TEST_ASSERT_EQUAL(lost + 1, answered);   // until the lost probes are a minority of the window
+  TEST_ASSERT_TRUE(samePattern(LED_ON, wifiLEDPattern()));
+}
+
+void test_errors_finish_a_probe_early() {
+  hostRTT = NO_ANSWER;
+  runLoop(PROBE_INTERVAL_MS - (millis() - lastRoundMS) + 10);
+  unsigned long start = millis();
+  while (reachabilityBusy()) {
+    runLoop(10);
+  }
+  TEST_ASSERT_LESS_THAN(PROBE_TIMEOUT_MS, millis() - start);   // TCP_ERROR_MS, no timeout needed
+  hostRTT = 40;
+}
+
+void test_link_drop_stops_probing() {
+  hostRTT = HANGS;
+  runLoop(PROBE_INTERVAL_MS - (millis() - lastRoundMS) + 10);
+  while (probeTarget != PROBE_HOST) {
+    runLoop(10);
+  }
+  TEST_ASSERT_TRUE(reachabilityBusy());   // a probe is in flight
+
+  hal::setAccessPointUp(0, false);
+  hal::dropLink();
+  runLoop(100);
+  TEST_ASSERT_FALSE(isConnected);
+  TEST_ASSERT_FALSE(hasInternet);
+  TEST_ASSERT_FALSE(reachabilityBusy());   // dropped, not left pending
+
+  uint32_t connects = hal::tcpConnects;
+  runLoop(PROBE_INTERVAL_MS * 2);
+  TEST_ASSERT_EQUAL(connects, hal::tcpConnects);
+
+  // Joined again: a fresh window, probed at once
+  hostRTT = 40;
+  hal::setAccessPointUp(0, true);
+  TEST_ASSERT_TRUE(connState == CONN_CONNECTED || connState == CONN_BACKOFF || connState == CONN_CONNECTING);
+  unsigned long limit = millis() + BACKOFF_MAX_MS + CONNECT_TIMEOUT_MS;
+  while (!hasInternet && millis() < limit) {
+    runLoop(10);
+  }
+  TEST_ASSERT_TRUE(hasInternet);
+  TEST_ASSERT_EQUAL(1, probeStats[PROBE_HOST].count);
+}
+
+
+int main() {
+  hal::addAccessPoint("YOUR_SSID_NAME", "YOUR_SSID_PW", 1, 6, -55);
+  hal::tcpRoute = fakeProbe;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_first_round_probes_each_target_in_turn);
+  RUN_TEST(test_rounds_follow_the_interval);
+  RUN_TEST(test_hanging_probes_time_out_without_blocking);
+  RUN_TEST(test_loss_window_drives_has_internet);
+  RUN_TEST(test_errors_finish_a_probe_early);
+  RUN_TEST(test_link_drop_stops_probing);
+  return UNITY_END();
+}
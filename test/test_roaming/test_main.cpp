@@ -0,0 +1,254 @@
+/****************************************************************************************
+* ESPWiFiRoaming.h & the STA helper's roaming against scripted scans & access points:
+* scan results are ranked strongest first (only our networks, the earlier one wins a tie,
+* the table keeps the strongest ROAM_MAX_CANDIDATES) & tried in that order, the async scan
+* never blocks, a single RSSI dip does not start a scan, a candidate less than
+* ROAM_HYSTERESIS_DB stronger is not joined, one that is gets roamed to, & after joining
+* an AP the STA holds it for ROAM_HOLD_MS before roaming away again.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPWiFiSTAHelper.h"
+#include <unity.h>
+
+const WiFiNetwork testNetworks[] = {
+  { "WAREHOUSE", "pw1" },
+  { "OFFICE", "pw2" },
+};
+
+int apA = -1, apB = -1;   // two APs of the STA helper's network
+
+void makeBSSID(uint8_t bssid[6], uint8_t last) {
+  uint8_t base[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, last };
+  memcpy(bssid, base, 6);
+}
+
+// Script one scan result
+void scanned(const char* ssid, uint8_t bssidLast, int rssi, int channel) {
+  uint8_t bssid[6];
+  makeBSSID(bssid, bssidLast);
+  addRoamCandidate(ssid, bssid, rssi, channel);
+}
+
+void resetRoaming(const WiFiNetwork* networks, int count) {
+  setupRoaming(networks, count);
+  clearRoamCandidates();
+  roamScanned = false;
+  roamScanning = false;
+  roamRSSI = 0;
+  roamAssociatedMS = 0;
+}
+
+// Run handleWiFi() every 10 ms like loop() would, until `done` or `limitMS`
+template <typename Done>
+bool runUntil(Done done, unsigned long limitMS) {
+  for (unsigned long start = millis(); millis() - start < limitMS;) {
+    uint64_t before = hal::nowUS;
+    handleWiFi();
+    handleLog();
+    TEST_ASSERT_EQUAL(before, hal::nowUS);   // a loop() pass never waits, scans included
+    if (done()) {
+      return true;
+    }
+    delay(10);
+  }
+  return false;
+}
+
+void runFor(unsigned long ms) {
+  runUntil([]() { return false; }, ms);
+}
+
+bool connectedTo(int ap) {
+  return connState == CONN_CONNECTED && memcmp(WiFi.BSSID(), hal::accessPoints[ap].bssid, 6) == 0;
+}
+
+void setUp() {}
+void tearDown() {}
+
+
+void test_candidates_are_ranked_strongest_first() {
+  resetRoaming(testNetworks, 2);
+  scanned("WAREHOUSE", 1, -70, 1);
+  scanned("NEIGHBOUR", 2, -40, 6);   // not ours
+  scanned("OFFICE", 3, -60, 11);
+  scanned("WAREHOUSE", 4, -60, 6);   // tie: the earlier network first
+  scanned("WAREHOUSE", 5, -85, 1);
+  roamScanned = true;
+  roamScanMS = millis();
+
+  TEST_ASSERT_EQUAL(4, roamCandidateCount);
+  const int order[] = { 4, 3, 1, 5 };
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL(order[i], roamCandidates[i].bssid[5]);
+  }
+  TEST_ASSERT_EQUAL(0, roamCandidates[0].network);
+  TEST_ASSERT_EQUAL(1, roamCandidates[1].network);
+  TEST_ASSERT_EQUAL(11, roamCandidates[1].channel);
+
+  // Tried in that order, then a new scan is needed
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(roamCandidatesLeft(millis()));
+    TEST_ASSERT_EQUAL(order[i], roamCandidates[roamNextCandidate++].bssid[5]);
+  }
+  TEST_ASSERT_FALSE(roamCandidatesLeft(millis()));
+}
+
+void test_table_keeps_the_strongest() {
+  resetRoaming(testNetworks, 2);
+  for (int i = 0; i < 3 * ROAM_MAX_CANDIDATES; i++) {
+    scanned(i % 2 ? "OFFICE" : "WAREHOUSE", i + 1, -90 + (i * 7) % 50, 1);
+  }
+  TEST_ASSERT_EQUAL(ROAM_MAX_CANDIDATES, roamCandidateCount);
+  int weakestKept = roamCandidates[ROAM_MAX_CANDIDATES - 1].rssi;
+  for (int i = 1; i < ROAM_MAX_CANDIDATES; i++) {
+    TEST_ASSERT_LESS_OR_EQUAL(roamCandidates[i - 1].rssi, roamCandidates[i].rssi);
+  }
+  int stronger = 0;
+  for (int i = 0; i < 3 * ROAM_MAX_CANDIDATES; i++) {
+    stronger += -90 + (i * 7) % 50 > weakestKept;
+  }
+  TEST_ASSERT_LESS_THAN(ROAM_MAX_CANDIDATES, stronger);   // nothing stronger was dropped
+
+  scanned("WAREHOUSE", 99, -120, 1);   // weaker than everything kept
+  TEST_ASSERT_EQUAL(weakestKept, roamCandidates[ROAM_MAX_CANDIDATES - 1].rssi);
+}
+
+void test_async_scan_fills_the_table() {
+  resetRoaming(testNetworks, 2);
+  int office = hal::addAccessPoint("OFFICE", "pw2", 0x21, 11, -58);
+  int warehouse = hal::addAccessPoint("WAREHOUSE", "pw1", 0x22, 6, -66);
+  int neighbour = hal::addAccessPoint("NEIGHBOUR", "x", 0x23, 1, -30);
+
+  unsigned long start = millis();
+  startRoamScan(start);
+  TEST_ASSERT_EQUAL(start, millis());   // returned straight away
+  TEST_ASSERT_TRUE(roamScanning);
+  delay(hal::wifiTiming.scanMS / 2);
+  TEST_ASSERT_FALSE(pollRoamScan(millis()));
+  delay(hal::wifiTiming.scanMS / 2 + 10);
+  TEST_ASSERT_TRUE(pollRoamScan(millis()));
+  TEST_ASSERT_FALSE(roamScanning);
+
+  // The STA helper's own APs are not in this list
+  TEST_ASSERT_EQUAL(2, roamCandidateCount);
+  TEST_ASSERT_EQUAL(0x21, roamCandidates[0].bssid[5]);
+  TEST_ASSERT_EQUAL(1, roamCandidates[0].network);
+  TEST_ASSERT_EQUAL(0x22, roamCandidates[1].bssid[5]);
+  TEST_ASSERT_TRUE(roamCandidatesLeft(millis()));
+  TEST_ASSERT_FALSE(roamCandidatesLeft(millis() + ROAM_CANDIDATE_MAX_AGE_MS));   // too old to try
+
+  hal::setAccessPointUp(office, false);
+  hal::setAccessPointUp(warehouse, false);
+  hal::setAccessPointUp(neighbour, false);
+}
+
+void test_rssi_average_and_scan_due() {
+  resetRoaming(testNetworks, 2);
+  roamAssociated(100000);
+  updateRoamRSSI(31);   // not associated, ignored
+  TEST_ASSERT_EQUAL(0, roamRSSI);
+  updateRoamRSSI(-60);
+  TEST_ASSERT_EQUAL(-60, roamRSSI);
+  updateRoamRSSI(-92);   // one dip moves it a quarter of the way
+  TEST_ASSERT_EQUAL(-68, roamRSSI);
+  TEST_ASSERT_FALSE(roamScanDue(100000 + ROAM_HOLD_MS));
+  for (int i = 0; i < 10; i++) {
+    updateRoamRSSI(-80);
+  }
+  TEST_ASSERT_LESS_THAN(ROAM_RSSI_THRESHOLD, roamRSSI);
+
+  TEST_ASSERT_FALSE(roamScanDue(100000 + ROAM_HOLD_MS - 1));   // still holding the new AP
+  TEST_ASSERT_TRUE(roamScanDue(100000 + ROAM_HOLD_MS));
+  roamScanned = true;
+  roamLastScanMS = 100000 + ROAM_HOLD_MS;
+  TEST_ASSERT_FALSE(roamScanDue(roamLastScanMS + ROAM_SCAN_INTERVAL_MS - 1));
+  TEST_ASSERT_TRUE(roamScanDue(roamLastScanMS + ROAM_SCAN_INTERVAL_MS));
+}
+
+void test_pick_applies_hysteresis() {
+  resetRoaming(testNetworks, 2);
+  uint8_t current[6];
+  makeBSSID(current, 1);
+  unsigned long now = ROAM_HOLD_MS;
+  scanned("WAREHOUSE", 1, -60, 1);   // the current AP scanned stronger than its average
+  scanned("WAREHOUSE", 2, -76 + ROAM_HYSTERESIS_DB - 1, 6);
+  roamScanned = true;
+  roamScanMS = now;
+
+  TEST_ASSERT_EQUAL(-1, pickRoamCandidate(current, -76, now));      // 7 dB better: stay
+  TEST_ASSERT_EQUAL(1, pickRoamCandidate(current, -77, now));       // 8 dB: move, the current AP skipped
+  TEST_ASSERT_EQUAL(-1, pickRoamCandidate(current, ROAM_RSSI_THRESHOLD, now));   // not weak
+  TEST_ASSERT_EQUAL(-1, pickRoamCandidate(current, -90, now - 1));                // holding
+  TEST_ASSERT_EQUAL(-1, pickRoamCandidate(current, -90, now + ROAM_CANDIDATE_MAX_AGE_MS));   // stale scan
+}
+
+
+// The STA helper on a network with two APs
+void test_joins_the_stronger_ap() {
+  resetRoaming(wifiNetworks, WIFI_NETWORK_COUNT);
+  setupWiFi();
+  TEST_ASSERT_TRUE(runUntil([]() { return isConnected; }, 5000));
+  TEST_ASSERT_TRUE(connectedTo(apA));
+}
+
+void test_strong_signal_and_a_single_dip_do_not_scan() {
+  uint32_t scans = hal::wifiScans;
+  runFor(ROAM_HOLD_MS + 60000);
+  hal::accessPoints[apA].rssi = -95;   // one sample
+  runFor(WIFI_IDLE_PERIOD_MS);
+  hal::accessPoints[apA].rssi = -55;
+  runFor(60000);
+  TEST_ASSERT_EQUAL(scans, hal::wifiScans);
+  TEST_ASSERT_EQUAL(0, wifiRoams);
+}
+
+void test_weak_signal_scans_but_stays_within_hysteresis() {
+  uint32_t scans = hal::wifiScans;
+  hal::accessPoints[apA].rssi = -78;
+  hal::accessPoints[apB].rssi = -70;   // better, but not by ROAM_HYSTERESIS_DB over the average
+  runFor(3 * ROAM_SCAN_INTERVAL_MS);
+  TEST_ASSERT_GREATER_OR_EQUAL(scans + 2, hal::wifiScans);   // kept looking every ROAM_SCAN_INTERVAL_MS
+  TEST_ASSERT_LESS_OR_EQUAL(scans + 4, hal::wifiScans);
+  TEST_ASSERT_EQUAL(0, wifiRoams);
+  TEST_ASSERT_TRUE(connectedTo(apA));
+}
+
+void test_clearly_stronger_ap_is_roamed_to() {
+  uint32_t reconnects = wifiReconnects;
+  uint32_t fastBegins = hal::wifiFastBegins;
+  hal::accessPoints[apB].rssi = -62;
+  TEST_ASSERT_TRUE(runUntil([]() { return connectedTo(apB); }, ROAM_SCAN_INTERVAL_MS + 10000));
+  TEST_ASSERT_EQUAL(1, wifiRoams);
+  TEST_ASSERT_EQUAL(reconnects, wifiReconnects);   // a planned move, not a lost link
+  TEST_ASSERT_EQUAL(fastBegins + 1, hal::wifiFastBegins);   // joined by BSSID & channel from the scan
+  TEST_ASSERT_TRUE(isConnected);
+}
+
+void test_new_ap_is_held_before_roaming_back() {
+  unsigned long joinedMS = roamAssociatedMS;
+  hal::accessPoints[apB].rssi = -85;   // the two swap straight away
+  hal::accessPoints[apA].rssi = -55;
+  TEST_ASSERT_TRUE(runUntil([]() { return connectedTo(apA); }, ROAM_HOLD_MS + 2 * ROAM_SCAN_INTERVAL_MS));
+  TEST_ASSERT_GREATER_OR_EQUAL(ROAM_HOLD_MS, millis() - joinedMS);
+  TEST_ASSERT_EQUAL(2, wifiRoams);
+}
+
+
+int main() {
+  apA = hal::addAccessPoint("YOUR_SSID_NAME", "YOUR_SSID_PW", 1, 1, -55);
+  apB = hal::addAccessPoint("YOUR_SSID_NAME", "YOUR_SSID_PW", 2, 6, -80);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_candidates_are_ranked_strongest_first);
+  RUN_TEST(test_table_keeps_the_strongest);
+  RUN_TEST(test_async_scan_fills_the_table);
+  RUN_TEST(test_rssi_average_and_scan_due);
+  RUN_TEST(test_pick_applies_hysteresis);
+  RUN_TEST(test_joins_the_stronger_ap);
+  RUN_TEST(test_strong_signal_and_a_single_dip_do_not_scan);
+  RUN_TEST(test_weak_signal_scans_but_stays_within_hysteresis);
+  RUN_TEST(test_clearly_stronger_ap_is_roamed_to);
+  RUN_TEST(test_new_ap_is_held_before_roaming_back);
+  return UNITY_END();
+}
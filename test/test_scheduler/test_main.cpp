@@ -0,0 +1,221 @@
+/****************************************************************************************
+* ESPScheduler.h: tasks run on their period & keep their phase, run() sleeps until the
+* next deadline, a slow task counts overruns & re-syncs instead of bursting, deadlines
+* compare across the millis() rollover, & dispatch allocates nothing.
+* Also prints the host cost of one run() with 1, 8 & 32 tasks: a tick with nothing due
+* (the deadline scan) & a tick with every task due (per task), for comparing changes.
+****************************************************************************************/
+
+#include <Arduino.h>
+#define SCHEDULER_MAX_TASKS 32
+#include "ESPScheduler.h"
+#include <unity.h>
+#include <chrono>
+#include <utility>
+
+const int BENCH_TICKS = 20000;   // run() calls timed per measurement
+
+unsigned long runsOf[SCHEDULER_MAX_TASKS];
+unsigned long lastRunMS[SCHEDULER_MAX_TASKS];
+unsigned long shortestGapMS[SCHEDULER_MAX_TASKS];
+unsigned long taskWorkMS[SCHEDULER_MAX_TASKS];   // simulated time a task's callback takes
+
+// A distinct callback per slot (add() tells tasks apart by callback)
+template <int N>
+void task() {
+  if (runsOf[N] > 0) {
+    shortestGapMS[N] = min(shortestGapMS[N], millis() - lastRunMS[N]);
+  }
+  runsOf[N]++;
+  lastRunMS[N] = millis();
+  if (taskWorkMS[N]) {
+    delay(taskWorkMS[N]);
+  }
+}
+
+template <size_t... N>
+const Scheduler::TaskCallback* makeCallbacks(std::index_sequence<N...>) {
+  static const Scheduler::TaskCallback table[] = { task<N>... };
+  return table;
+}
+
+const Scheduler::TaskCallback* callbacks = makeCallbacks(std::make_index_sequence<SCHEDULER_MAX_TASKS>());
+
+void resetScheduler() {
+  Scheduler::taskCount = 0;
+  Scheduler::busyUS = 0;
+  Scheduler::idleUS = 0;
+  Scheduler::sleepWhenIdle = true;
+  for (int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+    runsOf[i] = 0;
+    shortestGapMS[i] = 0xFFFFFFFF;
+    taskWorkMS[i] = 0;
+  }
+}
+
+// Call Scheduler::run() like loop() would for `ms`, returns the number of calls
+int runFor(unsigned long ms) {
+  int calls = 0;
+  for (unsigned long start = millis(); millis() - start < ms; calls++) {
+    Scheduler::run();
+  }
+  return calls;
+}
+
+void setUp() {
+  resetScheduler();
+}
+
+void tearDown() {}
+
+
+void test_add_fills_the_slots_then_refuses() {
+  for (int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+    TEST_ASSERT_EQUAL(i, Scheduler::add("task", callbacks[i], 100));
+  }
+  TEST_ASSERT_EQUAL(-1, Scheduler::add("extra", []() {}, 100));
+
+  TEST_ASSERT_EQUAL(3, Scheduler::add("again", callbacks[3], 250));   // same callback: new period only
+  TEST_ASSERT_EQUAL(SCHEDULER_MAX_TASKS, Scheduler::taskCount);
+  TEST_ASSERT_EQUAL(250, Scheduler::tasks[3].periodMS);
+}
+
+void test_tasks_run_on_their_period() {
+  Scheduler::add("fast", callbacks[0], 10);
+  Scheduler::add("mid", callbacks[1], 25);
+  Scheduler::add("slow", callbacks[2], 100);
+  runFor(1000);
+  TEST_ASSERT_EQUAL(100, runsOf[0]);
+  TEST_ASSERT_EQUAL(40, runsOf[1]);
+  TEST_ASSERT_EQUAL(10, runsOf[2]);
+  TEST_ASSERT_EQUAL(10, shortestGapMS[0]);
+  TEST_ASSERT_EQUAL(25, shortestGapMS[1]);
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_EQUAL(0, Scheduler::tasks[i].overruns);
+  }
+}
+
+void test_run_sleeps_until_the_next_deadline() {
+  Scheduler::add("slow", callbacks[0], 100);
+  Scheduler::run();
+  unsigned long start = millis();
+  TEST_ASSERT_EQUAL(100, Scheduler::run());   // waited out the whole period in one call
+  TEST_ASSERT_EQUAL(100, millis() - start);
+
+  int calls = runFor(1000);
+  TEST_ASSERT_LESS_OR_EQUAL(11, calls);   // one wake per run, not a spin
+  TEST_ASSERT_LESS_THAN(1.0f, Scheduler::activePercent());
+
+  // Only yields when told not to sleep
+  Scheduler::sleepWhenIdle = false;
+  calls = runFor(100);
+  TEST_ASSERT_GREATER_THAN(1000, calls);
+}
+
+void test_idle_wait_is_capped() {
+  Scheduler::add("hourly", callbacks[0], 3600000);
+  Scheduler::run();
+  unsigned long start = millis();
+  Scheduler::run();
+  TEST_ASSERT_EQUAL(Scheduler::MAX_IDLE_MS, millis() - start);
+}
+
+void test_slow_task_counts_overruns_without_bursts() {
+  taskWorkMS[0] = 25;   // takes longer than its period
+  Scheduler::add("slow", callbacks[0], 10);
+  Scheduler::add("fast", callbacks[1], 10);
+  runFor(1000);
+
+  TEST_ASSERT_GREATER_THAN(0, Scheduler::tasks[0].overruns);
+  TEST_ASSERT_EQUAL(runsOf[0], Scheduler::tasks[0].overruns);   // behind after every run
+  TEST_ASSERT_GREATER_OR_EQUAL(10, shortestGapMS[0]);           // re-synced, no catch-up calls
+  TEST_ASSERT_GREATER_OR_EQUAL(10, shortestGapMS[1]);
+  TEST_ASSERT_EQUAL(25000, Scheduler::tasks[0].maxRunUS);
+
+  // The other task is held up by the slow one & missed whole periods too
+  TEST_ASSERT_GREATER_THAN(0, Scheduler::tasks[1].overruns);
+  TEST_ASSERT_LESS_THAN(100, runsOf[1]);
+}
+
+void test_run_soon_and_set_period() {
+  int id = Scheduler::add("task", callbacks[0], 1000);
+  Scheduler::run();
+  delay(10);
+  Scheduler::runSoon(id);
+  Scheduler::sleepWhenIdle = false;
+  Scheduler::run();
+  TEST_ASSERT_EQUAL(2, runsOf[0]);
+
+  Scheduler::setPeriod(id, 50);   // after the deadline already set
+  Scheduler::sleepWhenIdle = true;
+  unsigned long start = millis();
+  while (runsOf[0] < 4) {
+    Scheduler::run();
+  }
+  TEST_ASSERT_EQUAL(1000 + 50, lastRunMS[0] - start);
+  TEST_ASSERT_EQUAL(50, shortestGapMS[0]);
+}
+
+void test_deadlines_compare_across_the_rollover() {
+  const unsigned long top = (unsigned long)-1;
+  TEST_ASSERT_TRUE(Scheduler::reached(5, top - 5));    // a deadline just before the wrap
+  TEST_ASSERT_FALSE(Scheduler::reached(top - 5, 5));   // one just after it
+  TEST_ASSERT_TRUE(Scheduler::reached(top, top));
+
+  int id = Scheduler::add("task", callbacks[0], 100);
+  Scheduler::tasks[id].nextRunMS = 5;                    // due 11 ms after the wrap
+  TEST_ASSERT_EQUAL(11, Scheduler::msUntilNext(top - 5));
+  TEST_ASSERT_EQUAL(0, Scheduler::msUntilNext(5));
+  TEST_ASSERT_EQUAL(0, Scheduler::msUntilNext(6));
+}
+
+// Host time of one run() in ns: every task idle (deadline scan only), or every task due
+double dispatchNS(int tasks, bool allDue) {
+  resetScheduler();
+  Scheduler::sleepWhenIdle = false;
+  for (int i = 0; i < tasks; i++) {
+    Scheduler::add("bench", callbacks[i], allDue ? 0 : 3600000);
+  }
+  Scheduler::run();   // the first runs
+
+  auto start = std::chrono::steady_clock::now();
+  for (int tick = 0; tick < BENCH_TICKS; tick++) {
+    Scheduler::run();
+  }
+  auto took = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(took).count() / (double)BENCH_TICKS;
+}
+
+void test_dispatch_cost_with_1_8_and_32_tasks() {
+  const int counts[] = { 1, 8, 32 };
+  double idle[3], due[3];
+
+  hal::resetHeapStats();
+  for (int i = 0; i < 3; i++) {
+    idle[i] = dispatchNS(counts[i], false);
+    due[i] = dispatchNS(counts[i], true);
+    printf("dispatch %2d tasks: %7.1f ns per idle tick, %7.1f ns per tick with all due (%5.1f ns per task)\n",
+           counts[i], idle[i], due[i], due[i] / counts[i]);
+  }
+  TEST_ASSERT_EQUAL(0, hal::heap.allocations);   // no heap in add() or run()
+
+  // Every task ran on every timed tick (period 0), none left behind
+  for (int i = 0; i < 32; i++) {
+    TEST_ASSERT_EQUAL(BENCH_TICKS + 1, runsOf[i]);
+  }
+  TEST_ASSERT_LESS_THAN(20000.0, idle[2]);   // a short loop over the slots, far below a 1 ms tick
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_add_fills_the_slots_then_refuses);
+  RUN_TEST(test_tasks_run_on_their_period);
+  RUN_TEST(test_run_sleeps_until_the_next_deadline);
+  RUN_TEST(test_idle_wait_is_capped);
+  RUN_TEST(test_slow_task_counts_overruns_without_bursts);
+  RUN_TEST(test_run_soon_and_set_period);
+  RUN_TEST(test_deadlines_compare_across_the_rollover);
+  RUN_TEST(test_dispatch_cost_with_1_8_and_32_tasks);
+  return UNITY_END();
+}
@@ -0,0 +1,160 @@
+/****************************************************************************************
+* ESPSleepCycle.h over several simulated boots (hal::runBoot(), RTC memory kept between
+* them): the phase timestamps of each wake, the failure backoff doubling up to
+* CYCLE_MAX_SLEEP_MS & starting over after a good cycle, the Wi-Fi timeout, & a power-up
+* or a corrupted RTC state starting from zero.
+* The boots run the helper, this process only sets up the HAL & reads the RTC memory.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPWiFiSTAHelper.h"
+#include "ESPSleepCycle.h"
+#include <unity.h>
+
+bool callbackResult = true;   // what the next boots' callback returns
+bool fastConnect = false;
+
+bool cycleCallback() {
+  delay(20);   // read a sensor
+  return callbackResult;
+}
+
+// One wake of the node, until it deep sleeps
+hal::BootResult wake() {
+  return hal::runBoot([]() {
+    Serial.begin(115200);
+    USE_FAST_CONNECT = fastConnect;
+    runSleepCycle(cycleCallback);
+  });
+}
+
+SleepCycleState rtcState() {
+  SleepCycleState state;
+  ESP.rtcUserMemoryRead(SLEEP_CYCLE_RTC_OFFSET, (uint32_t*)&state, sizeof(state));
+  return state;
+}
+
+void setUp() {
+  callbackResult = true;
+  fastConnect = false;
+  hal::setAccessPointUp(0, true);
+}
+
+void tearDown() {}
+
+
+void test_phases_are_recorded_in_order() {
+  hal::powerCycle();
+  hal::BootResult boot = wake();
+  TEST_ASSERT_EQUAL(hal::BOOT_DEEP_SLEEP, boot.outcome);
+  TEST_ASSERT_EQUAL(CYCLE_SLEEP_MS * 1000ULL, boot.sleepUS);
+
+  SleepCycleState state = rtcState();
+  TEST_ASSERT_EQUAL(1, state.bootCount);
+  TEST_ASSERT_EQUAL(0, state.consecutiveFailures);
+
+  // Radio on once setupWiFi() returned, not at 0 ms (0 reads as "not reached")
+  TEST_ASSERT_GREATER_OR_EQUAL(100, state.lastPhaseMS[PHASE_RADIO_ON]);
+  TEST_ASSERT_LESS_THAN(state.lastPhaseMS[PHASE_ASSOCIATED], state.lastPhaseMS[PHASE_RADIO_ON]);
+  TEST_ASSERT_UINT32_WITHIN(20, hal::wifiTiming.associateMS,
+                            state.lastPhaseMS[PHASE_ASSOCIATED] - state.lastPhaseMS[PHASE_RADIO_ON]);
+  TEST_ASSERT_UINT32_WITHIN(20, hal::wifiTiming.dhcpMS,
+                            state.lastPhaseMS[PHASE_GOT_IP] - state.lastPhaseMS[PHASE_ASSOCIATED]);
+  TEST_ASSERT_GREATER_OR_EQUAL(state.lastPhaseMS[PHASE_GOT_IP] + 20, state.lastPhaseMS[PHASE_CALLBACK_DONE]);
+  TEST_ASSERT_NOT_NULL(strstr(boot.serial, "Cycle 1 phases"));
+}
+
+void test_failures_back_off_up_to_the_limit() {
+  callbackResult = false;
+  unsigned long expectedMS = CYCLE_SLEEP_MS;
+  for (int failures = 1; failures <= 8; failures++) {
+    expectedMS = min(expectedMS * 2, CYCLE_MAX_SLEEP_MS);
+    hal::BootResult boot = wake();
+    TEST_ASSERT_EQUAL(hal::BOOT_DEEP_SLEEP, boot.outcome);
+    TEST_ASSERT_EQUAL((uint64_t)expectedMS * 1000, boot.sleepUS);
+
+    SleepCycleState state = rtcState();
+    TEST_ASSERT_EQUAL(failures, state.consecutiveFailures);
+    TEST_ASSERT_EQUAL(CYCLE_CALLBACK_FAILED, state.lastFailure);
+    TEST_ASSERT_EQUAL(1 + failures, state.bootCount);
+  }
+  TEST_ASSERT_EQUAL(CYCLE_MAX_SLEEP_MS, expectedMS);   // reached the limit & stayed there
+}
+
+void test_good_cycle_starts_the_backoff_over() {
+  hal::BootResult boot = wake();
+  TEST_ASSERT_EQUAL(CYCLE_SLEEP_MS * 1000ULL, boot.sleepUS);
+  SleepCycleState state = rtcState();
+  TEST_ASSERT_EQUAL(0, state.consecutiveFailures);
+  TEST_ASSERT_EQUAL(CYCLE_CALLBACK_FAILED, state.lastFailure);   // kept for the record
+  TEST_ASSERT_EQUAL(10, state.bootCount);
+
+  callbackResult = false;
+  TEST_ASSERT_EQUAL(CYCLE_SLEEP_MS * 2000ULL, wake().sleepUS);
+}
+
+void test_no_wifi_times_out_and_backs_off() {
+  hal::setAccessPointUp(0, false);
+  uint16_t failures = rtcState().consecutiveFailures;
+  hal::BootResult boot = wake();
+  TEST_ASSERT_EQUAL(hal::BOOT_DEEP_SLEEP, boot.outcome);
+  TEST_ASSERT_GREATER_OR_EQUAL(CYCLE_WIFI_TIMEOUT_MS * 1000ULL, boot.elapsedUS);
+  TEST_ASSERT_LESS_THAN((CYCLE_WIFI_TIMEOUT_MS + 1000) * 1000ULL, boot.elapsedUS);
+
+  SleepCycleState state = rtcState();
+  TEST_ASSERT_EQUAL(CYCLE_WIFI_TIMEOUT, state.lastFailure);
+  TEST_ASSERT_EQUAL(failures + 1, state.consecutiveFailures);
+  TEST_ASSERT_GREATER_THAN(0, state.lastPhaseMS[PHASE_RADIO_ON]);
+  TEST_ASSERT_EQUAL(0, state.lastPhaseMS[PHASE_ASSOCIATED]);   // never reached
+  TEST_ASSERT_EQUAL(0, state.lastPhaseMS[PHASE_CALLBACK_DONE]);
+  TEST_ASSERT_NOT_NULL(strstr(boot.serial, "No Wi-Fi this cycle"));
+}
+
+void test_fast_connect_shortens_the_wake() {
+  fastConnect = true;
+  wake();                       // scans, then caches the AP & lease
+  SleepCycleState scanned = rtcState();
+  wake();                       // from the cache
+  SleepCycleState cached = rtcState();
+  TEST_ASSERT_LESS_THAN(scanned.lastPhaseMS[PHASE_GOT_IP] - scanned.lastPhaseMS[PHASE_RADIO_ON],
+                        cached.lastPhaseMS[PHASE_GOT_IP] - cached.lastPhaseMS[PHASE_RADIO_ON]);
+  TEST_ASSERT_UINT32_WITHIN(20, hal::wifiTiming.fastAssociateMS,
+                            cached.lastPhaseMS[PHASE_ASSOCIATED] - cached.lastPhaseMS[PHASE_RADIO_ON]);
+}
+
+void test_corrupted_state_starts_over() {
+  uint8_t rtc[sizeof(SleepCycleState)];
+  ESP.rtcUserMemoryRead(SLEEP_CYCLE_RTC_OFFSET, (uint32_t*)rtc, sizeof(rtc));
+  rtc[offsetof(SleepCycleState, consecutiveFailures)] ^= 0x04;   // a flipped bit, CRC no longer matches
+  ESP.rtcUserMemoryWrite(SLEEP_CYCLE_RTC_OFFSET, (uint32_t*)rtc, sizeof(rtc));
+
+  TEST_ASSERT_EQUAL(CYCLE_SLEEP_MS * 1000ULL, wake().sleepUS);
+  TEST_ASSERT_EQUAL(1, rtcState().bootCount);
+}
+
+void test_power_up_starts_over() {
+  callbackResult = false;
+  wake();
+  hal::powerCycle();
+  callbackResult = true;
+  wake();
+  SleepCycleState state = rtcState();
+  TEST_ASSERT_EQUAL(1, state.bootCount);
+  TEST_ASSERT_EQUAL(0, state.consecutiveFailures);
+  TEST_ASSERT_EQUAL(CYCLE_OK, state.lastFailure);
+}
+
+
+int main() {
+  hal::addAccessPoint("YOUR_SSID_NAME", "YOUR_SSID_PW", 1, 6, -58);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_phases_are_recorded_in_order);
+  RUN_TEST(test_failures_back_off_up_to_the_limit);
+  RUN_TEST(test_good_cycle_starts_the_backoff_over);
+  RUN_TEST(test_no_wifi_times_out_and_backs_off);
+  RUN_TEST(test_fast_connect_shortens_the_wake);
+  RUN_TEST(test_corrupted_state_starts_over);
+  RUN_TEST(test_power_up_starts_over);
+  return UNITY_END();
+}
@@ -0,0 +1,135 @@
+/****************************************************************************************
+* ESPWiFiSTAHelper.h connection state machine against the HAL's scripted access point:
+* setupWiFi() returns at once so loop() starts while the AP is still answering, an attempt
+* times out after CONNECT_TIMEOUT_MS, the backoff doubles with up to 25% jitter up to
+* BACKOFF_MAX_MS, handleWiFi() never waits, & a lost link is joined again.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPWiFiSTAHelper.h"
+#include <unity.h>
+
+// Run handleWiFi() every 10 ms like loop() would, until `done` or `limitMS`
+template <typename Done>
+bool runUntil(Done done, unsigned long limitMS) {
+  for (unsigned long start = millis(); millis() - start < limitMS;) {
+    uint64_t before = hal::nowUS;
+    handleWiFi();
+    handleLog();
+    TEST_ASSERT_EQUAL(before, hal::nowUS);   // a loop() pass never waits in the helper
+    if (done()) {
+      return true;
+    }
+    delay(10);
+  }
+  return false;
+}
+
+// Time of the next attempt (a WiFi.begin()) from now, 0 if none came within `limitMS`
+unsigned long nextAttemptMS(unsigned long limitMS) {
+  uint32_t begins = hal::wifiBegins;
+  unsigned long start = millis();
+  return runUntil([begins]() { return hal::wifiBegins != begins; }, limitMS) ? millis() - start : 0;
+}
+
+void setUp() {}
+void tearDown() {}
+
+
+void test_setup_returns_before_the_ap_answers() {
+  hal::setAccessPointUp(0, false);
+  unsigned long start = millis();
+  setupWiFi();
+  TEST_ASSERT_LESS_OR_EQUAL(100, millis() - start);   // WiFi.mode() settle delay only, then loop() runs
+  TEST_ASSERT_EQUAL(CONN_CONNECTING, connState);
+  TEST_ASSERT_EQUAL(1, hal::wifiBegins);
+  TEST_ASSERT_FALSE(isConnected);
+}
+
+void test_attempt_times_out_then_backs_off_with_jitter() {
+  // Timed out at CONNECT_TIMEOUT_MS, then waits 1 s + up to 25%
+  TEST_ASSERT_TRUE(runUntil([]() { return connState == CONN_BACKOFF; }, CONNECT_TIMEOUT_MS + 100));
+  TEST_ASSERT_UINT32_WITHIN(20, CONNECT_TIMEOUT_MS, millis() - connectStartMS);
+  TEST_ASSERT_GREATER_OR_EQUAL(BACKOFF_BASE_MS, backoffMS);
+  TEST_ASSERT_LESS_OR_EQUAL(BACKOFF_BASE_MS * 5 / 4, backoffMS);
+
+  unsigned long waitMS = backoffMS;
+  TEST_ASSERT_UINT32_WITHIN(20, waitMS, nextAttemptMS(BACKOFF_MAX_MS));
+  TEST_ASSERT_EQUAL(CONN_CONNECTING, connState);
+
+  // Each failure doubles the base
+  unsigned long base = BACKOFF_BASE_MS;
+  for (int failure = 2; failure <= 8; failure++) {
+    base = min(base * 2, BACKOFF_MAX_MS);
+    TEST_ASSERT_TRUE(runUntil([]() { return connState == CONN_BACKOFF; }, CONNECT_TIMEOUT_MS + 100));
+    TEST_ASSERT_GREATER_OR_EQUAL(base, backoffMS);
+    TEST_ASSERT_LESS_OR_EQUAL(base * 5 / 4, backoffMS);
+    TEST_ASSERT_UINT32_WITHIN(20, backoffMS, nextAttemptMS(BACKOFF_MAX_MS * 2));
+  }
+  TEST_ASSERT_EQUAL(BACKOFF_MAX_MS, base);   // reached the limit
+}
+
+void test_jitter_spreads_the_retries() {
+  int saved = connectAttempts;
+  connectAttempts = 3;
+  unsigned long lowest = 0xFFFFFFFF, highest = 0;
+  for (int node = 0; node < 50; node++) {
+    unsigned long waitMS = nextBackoffMS();
+    lowest = min(lowest, waitMS);
+    highest = max(highest, waitMS);
+  }
+  connectAttempts = saved;
+  TEST_ASSERT_GREATER_OR_EQUAL(4000, lowest);
+  TEST_ASSERT_LESS_OR_EQUAL(5000, highest);
+  TEST_ASSERT_GREATER_THAN(500, highest - lowest);   // not in lock-step
+}
+
+void test_connects_once_the_ap_is_back() {
+  hal::setAccessPointUp(0, true);
+  TEST_ASSERT_TRUE(runUntil([]() { return isConnected; }, BACKOFF_MAX_MS * 2 + CONNECT_TIMEOUT_MS));
+  TEST_ASSERT_EQUAL(CONN_CONNECTED, connState);
+  TEST_ASSERT_EQUAL(0, connectAttempts);   // backoff starts over
+  TEST_ASSERT_EQUAL(1, statusValues[STATUS_CONNECTED]);
+}
+
+void test_lost_link_is_joined_again() {
+  uint32_t reconnects = wifiReconnects;
+  unsigned long start = millis();
+  hal::dropLink();
+  TEST_ASSERT_TRUE(runUntil([]() { return connState != CONN_CONNECTED; }, 100));
+  TEST_ASSERT_FALSE(isConnected);
+  TEST_ASSERT_EQUAL(reconnects + 1, wifiReconnects);
+
+  TEST_ASSERT_TRUE(runUntil([]() { return isConnected; }, 5000));
+  TEST_ASSERT_UINT32_WITHIN(30, hal::wifiTiming.associateMS + hal::wifiTiming.dhcpMS, millis() - start);
+}
+
+void test_scheduled_connect_from_boot() {
+  hal::setAccessPointUp(0, true);
+  WiFi.disconnect();
+  connState = CONN_IDLE;
+  isConnected = false;
+  setupWiFi();
+  scheduleWiFi();
+  unsigned long start = millis();
+  while (!isConnected && millis() - start < 5000) {
+    Scheduler::run();
+  }
+  TEST_ASSERT_TRUE(isConnected);
+  // Found by a poll at most WIFI_TASK_PERIOD_MS after the IP came
+  TEST_ASSERT_LESS_OR_EQUAL(hal::wifiTiming.associateMS + hal::wifiTiming.dhcpMS + WIFI_TASK_PERIOD_MS, millis() - start);
+}
+
+
+int main() {
+  hal::addAccessPoint("YOUR_SSID_NAME", "YOUR_SSID_PW", 1, 6, -55);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_setup_returns_before_the_ap_answers);
+  RUN_TEST(test_attempt_times_out_then_backs_off_with_jitter);
+  RUN_TEST(test_jitter_spreads_the_retries);
+  RUN_TEST(test_connects_once_the_ap_is_back);
+  RUN_TEST(test_lost_link_is_joined_again);
+  RUN_TEST(test_scheduled_connect_from_boot);
+  return UNITY_END();
+}
@@ -0,0 +1,140 @@
+/****************************************************************************************
+* ESPStaticAssets.h through ElegantOTAHelper.h's server, with a LittleFS image laid out
+* like gzip_assets.py builds it: the .gz copy for a browser that accepts gzip, the plain
+* file otherwise, & a 304 for a matching If-None-Match without opening the file. The
+* request headers only reach the handler because it asks for them, & a path that shares
+* a file's FNV-1a hash is not served as that file.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ElegantOTAHelper.h"
+#include <unity.h>
+
+const char* MANIFEST =
+  "/app.js 0123456789abcdef gp\n"
+  "/style.css 1111222233334444 g\n"
+  "/aavlo.txt 5555666677778888 p\n"
+  "/logo.png aaaabbbbccccdddd p";   // last line without a newline
+
+const char* APP_ETAG = "\"0123456789abcdef\"";
+const char* APP_GZ_ETAG = "\"0123456789abcdef-gz\"";
+
+void setUp() {
+  delay(10000);   // admission token buckets refill
+}
+
+void tearDown() {}
+
+
+void test_manifest_is_loaded() {
+  TEST_ASSERT_EQUAL(4, staticAssetCount);
+  TEST_ASSERT_NOT_NULL(findStaticAsset("/logo.png"));
+  TEST_ASSERT_NULL(findStaticAsset("/app.js.gz"));
+}
+
+void test_path_with_the_same_hash_is_not_a_match() {
+  TEST_ASSERT_EQUAL(assetPathHash("/aavlo.txt"), assetPathHash("/a9pda.txt"));   // an FNV-1a collision
+  TEST_ASSERT_NOT_NULL(findStaticAsset("/aavlo.txt"));
+  TEST_ASSERT_NULL(findStaticAsset("/a9pda.txt"));
+  TEST_ASSERT_EQUAL(404, hal::get(server, "/a9pda.txt").code);
+  TEST_ASSERT_EQUAL_STRING("text", hal::get(server, "/aavlo.txt").body.c_str());
+}
+
+void test_gzip_copy_for_a_browser_that_accepts_it() {
+  hal::HttpResponse response = hal::get(server, "/app.js", { { "Accept-Encoding", "gzip, deflate, br" } });
+  TEST_ASSERT_EQUAL(200, response.code);
+  TEST_ASSERT_EQUAL_STRING("gzipped app", response.body.c_str());
+  TEST_ASSERT_EQUAL_STRING("gzip", response.header("Content-Encoding").c_str());
+  TEST_ASSERT_EQUAL_STRING(APP_GZ_ETAG, response.header("ETag").c_str());
+  TEST_ASSERT_EQUAL_STRING("Accept-Encoding", response.header("Vary").c_str());
+  TEST_ASSERT_EQUAL_STRING("application/javascript", response.contentType.c_str());
+  TEST_ASSERT_EQUAL_STRING(ASSET_CACHE_CONTROL, response.header("Cache-Control").c_str());
+}
+
+void test_plain_file_otherwise() {
+  hal::HttpResponse response = hal::get(server, "/app.js", { { "Accept-Encoding", "identity" } });
+  TEST_ASSERT_EQUAL_STRING("plain app", response.body.c_str());
+  TEST_ASSERT_FALSE(response.hasHeader("Content-Encoding"));
+  TEST_ASSERT_EQUAL_STRING(APP_ETAG, response.header("ETag").c_str());
+
+  response = hal::get(server, "/app.js");
+  TEST_ASSERT_EQUAL_STRING("plain app", response.body.c_str());
+}
+
+void test_single_representation_is_sent_either_way() {
+  hal::HttpResponse response = hal::get(server, "/style.css");   // gzip only: sent anyway
+  TEST_ASSERT_EQUAL(200, response.code);
+  TEST_ASSERT_EQUAL_STRING("gzip", response.header("Content-Encoding").c_str());
+
+  response = hal::get(server, "/logo.png", { { "Accept-Encoding", "gzip" } });   // plain only
+  TEST_ASSERT_EQUAL_STRING("png", response.body.c_str());
+  TEST_ASSERT_FALSE(response.hasHeader("Content-Encoding"));
+}
+
+void test_matching_etag_is_a_304_without_opening_the_file() {
+  uint32_t opens = hal::fsOpens;
+  hal::HttpResponse response = hal::get(server, "/app.js", { { "Accept-Encoding", "gzip" }, { "If-None-Match", APP_GZ_ETAG } });
+  TEST_ASSERT_EQUAL(304, response.code);
+  TEST_ASSERT_EQUAL(0, response.body.size());
+  TEST_ASSERT_EQUAL_STRING(APP_GZ_ETAG, response.header("ETag").c_str());
+  TEST_ASSERT_EQUAL(opens, hal::fsOpens);
+
+  std::string list = std::string("W/\"old\", ") + APP_ETAG;   // one of a list
+  response = hal::get(server, "/app.js", { { "If-None-Match", list.c_str() } });
+  TEST_ASSERT_EQUAL(304, response.code);
+  TEST_ASSERT_EQUAL(opens, hal::fsOpens);
+}
+
+void test_other_representation_etag_is_not_a_match() {
+  // The browser cached the plain file & now takes gzip: the gzip copy has its own ETag
+  hal::HttpResponse response = hal::get(server, "/app.js", { { "Accept-Encoding", "gzip" }, { "If-None-Match", APP_ETAG } });
+  TEST_ASSERT_EQUAL(200, response.code);
+  TEST_ASSERT_EQUAL_STRING("gzipped app", response.body.c_str());
+}
+
+void test_handler_sees_only_the_headers_it_asked_for() {
+  hal::HttpResponse response = hal::get(server, "/app.js", { { "Accept-Encoding", "gzip" }, { "Cookie", "a=1" } });
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, response.handlerHeaders.find("Accept-Encoding:gzip"));
+  TEST_ASSERT_EQUAL(std::string::npos, response.handlerHeaders.find("Cookie"));
+}
+
+void test_other_paths_and_methods_pass_by() {
+  TEST_ASSERT_EQUAL(404, hal::get(server, "/missing.js").code);
+
+  hal::HttpRequest request;
+  request.method = HTTP_POST;
+  request.url = "/app.js";
+  TEST_ASSERT_EQUAL(404, hal::serve(server, request).code);
+}
+
+void test_requests_are_freed() {
+  hal::get(server, "/app.js", { { "Accept-Encoding", "gzip" } });   // warm up
+  int64_t live = hal::heap.liveBytes;
+  hal::get(server, "/app.js", { { "Accept-Encoding", "gzip" }, { "If-None-Match", APP_GZ_ETAG } });
+  hal::get(server, "/logo.png");
+  TEST_ASSERT_EQUAL(live, hal::heap.liveBytes);
+}
+
+
+int main() {
+  hal::putFile("/assets.manifest", MANIFEST);
+  hal::putFile("/app.js.gz", "gzipped app");
+  hal::putFile("/app.js", "plain app");
+  hal::putFile("/style.css.gz", "gzipped css");
+  hal::putFile("/logo.png", "png");
+  hal::putFile("/aavlo.txt", "text");
+  setupOTA();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_manifest_is_loaded);
+  RUN_TEST(test_path_with_the_same_hash_is_not_a_match);
+  RUN_TEST(test_gzip_copy_for_a_browser_that_accepts_it);
+  RUN_TEST(test_plain_file_otherwise);
+  RUN_TEST(test_single_representation_is_sent_either_way);
+  RUN_TEST(test_matching_etag_is_a_304_without_opening_the_file);
+  RUN_TEST(test_other_representation_etag_is_not_a_match);
+  RUN_TEST(test_handler_sees_only_the_headers_it_asked_for);
+  RUN_TEST(test_other_paths_and_methods_pass_by);
+  RUN_TEST(test_requests_are_freed);
+  return UNITY_END();
+}
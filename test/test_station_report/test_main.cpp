@@ -0,0 +1,208 @@
+/****************************************************************************************
+* ESPStationTable.h's report API against printf: for 1 to 32 stations, formatStations()
+* gives the same text & JSON as snprintf with the same fields & binary records that decode
+* back to the table, whole records per buffer however small, with no heap allocation.
+* Also prints the host time of a report to a Print sink with the hand-rolled encoders &
+* with the printf loop it replaced (a copy of each entry, one printf per station).
+* The table is built with 64 slots here, so 32 stations fit at the default load.
+****************************************************************************************/
+
+#include <Arduino.h>
+#define STATION_TABLE_SIZE 64
+#include "ESPStationTable.h"
+#include <unity.h>
+#include <chrono>
+
+const int STATION_COUNTS[] = { 1, 2, 4, 8, 16, 32 };
+const int BENCH_STATIONS = 20000;   // stations reported per measurement
+
+// Keeps what is written
+class StringPrint : public Print {
+public:
+  std::string text;
+  size_t write(uint8_t c) override {
+    text += (char)c;
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t length) override {
+    text.append((const char*)data, length);
+    return length;
+  }
+};
+
+// Counts what is written, like a UART with room to spare
+class CountingPrint : public Print {
+public:
+  size_t bytes = 0;
+  size_t write(uint8_t) override {
+    return ++bytes, 1;
+  }
+  size_t write(const uint8_t* data, size_t length) override {
+    bytes += length;
+    return length;
+  }
+};
+
+uint8_t macOf(int i, int byte) {
+  const uint8_t base[6] = { 0xA4, 0xCF, 0x12, 0x00, 0x00, 0x00 };
+  return byte < 3 ? base[byte] : (uint8_t)(i * (byte * 37 + 11) + byte);
+}
+
+// Join stations 0..count-1 with an IP & RSSI (the last one still waiting for both)
+void connectStations(int count) {
+  for (int i = 0; i < 64; i++) {
+    uint8_t mac[6];
+    for (int b = 0; b < 6; b++) mac[b] = macOf(i, b);
+    hal::leaveStation(mac);
+  }
+  for (int i = 0; i < count; i++) {
+    uint8_t mac[6];
+    for (int b = 0; b < 6; b++) mac[b] = macOf(i, b);
+    bool waiting = i == count - 1 && count > 1;
+    hal::joinStation(mac, i + 1, waiting ? 0 : (uint32_t)IPAddress(192, 168, 10, 2 + i));
+    delay(1000);
+    if (!waiting) {
+      hal::probeRequest(mac, -40 - i);
+    }
+  }
+  updateStationTable();
+  delay(2500);
+  TEST_ASSERT_EQUAL(count, stationCount());
+}
+
+// The report as the old loop built it: an entry copied out, then one printf per station
+void printfReport(Print& sink, StationFormat format) {
+  unsigned long currentMS = millis();
+  bool first = true;
+  if (format == STATION_JSON) {
+    sink.write("[");
+  }
+  for (int i = 0; i < STATION_TABLE_SIZE; i++) {
+    StationInfo station = stationTable[i];
+    if (station.aid == 0) {
+      continue;
+    }
+    const uint8_t* ip = (const uint8_t*)&station.ip;
+    unsigned long connectedS = (currentMS - station.connectedMS) / 1000;
+    unsigned long seenS = (currentMS - station.lastSeenMS) / 1000;
+    if (format == STATION_JSON) {
+      sink.printf("%s{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"ip\":\"%u.%u.%u.%u\",\"rssi\":%d,"
+                  "\"connected\":%lu,\"seen\":%lu}", first ? "" : ",",
+                  station.mac[0], station.mac[1], station.mac[2], station.mac[3], station.mac[4], station.mac[5],
+                  ip[0], ip[1], ip[2], ip[3], station.rssi, connectedS, seenS);
+    } else {
+      sink.printf("MAC: %02X:%02X:%02X:%02X:%02X:%02X, IP: %u.%u.%u.%u, RSSI: %d dBm, connected %lu s, seen %lu s ago\n",
+                  station.mac[0], station.mac[1], station.mac[2], station.mac[3], station.mac[4], station.mac[5],
+                  ip[0], ip[1], ip[2], ip[3], station.rssi, connectedS, seenS);
+    }
+    first = false;
+  }
+  if (format == STATION_JSON) {
+    sink.write("]\n");
+  }
+}
+
+std::string formatted(StationFormat format, size_t bufferSize) {
+  std::string text;
+  char buffer[4 * STATION_RECORD_MAX];
+  StationCursor cursor = {};
+  size_t n;
+  while ((n = formatStations(buffer, bufferSize, format, cursor)) > 0) {
+    TEST_ASSERT_LESS_OR_EQUAL(bufferSize, n);
+    text.append(buffer, n);
+  }
+  return text;
+}
+
+uint32_t readUint32LE(const std::string& data, size_t at) {
+  uint32_t value = 0;
+  for (int i = 3; i >= 0; i--) {
+    value = value << 8 | (uint8_t)data[at + i];
+  }
+  return value;
+}
+
+// Host time of one report of the table to `sink`, in ns
+template <typename Report>
+double reportNS(int stations, Report report) {
+  CountingPrint sink;
+  int reports = BENCH_STATIONS / stations;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < reports; i++) {
+    report(sink);
+  }
+  auto took = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(took).count() / (double)reports;
+}
+
+void setUp() {}
+void tearDown() {}
+
+
+void test_text_and_json_match_printf() {
+  for (int count : STATION_COUNTS) {
+    connectStations(count);
+    const StationFormat formats[] = { STATION_TEXT, STATION_JSON };
+    for (StationFormat format : formats) {
+      StringPrint reference, report;
+      printfReport(reference, format);
+      reportStations(report, format);
+      TEST_ASSERT_EQUAL_STRING(reference.text.c_str(), report.text.c_str());
+    }
+  }
+}
+
+void test_binary_records_decode_to_the_table() {
+  connectStations(32);
+  std::string data = formatted(STATION_BINARY, 4 * STATION_RECORD_MAX);
+  TEST_ASSERT_EQUAL(STATION_BINARY_SIZE, (uint8_t)data[0]);
+  TEST_ASSERT_EQUAL(1 + 32 * STATION_BINARY_SIZE, data.size());
+
+  for (size_t at = 1; at < data.size(); at += STATION_BINARY_SIZE) {
+    StationInfo info;
+    TEST_ASSERT_TRUE(getStation((const uint8_t*)&data[at], info));
+    TEST_ASSERT_EQUAL_HEX32(info.ip, readUint32LE(data, at + 6));
+    TEST_ASSERT_EQUAL(info.rssi, (int8_t)data[at + 10]);
+    TEST_ASSERT_EQUAL((millis() - info.connectedMS) / 1000, readUint32LE(data, at + 11));
+    TEST_ASSERT_EQUAL((millis() - info.lastSeenMS) / 1000, readUint32LE(data, at + 15));
+  }
+}
+
+void test_small_buffers_get_whole_records() {
+  connectStations(32);
+  const StationFormat formats[] = { STATION_TEXT, STATION_JSON, STATION_BINARY };
+  for (StationFormat format : formats) {
+    std::string whole = formatted(format, 4 * STATION_RECORD_MAX);
+    TEST_ASSERT_EQUAL(whole.size(), formatted(format, STATION_RECORD_MAX).size());
+    TEST_ASSERT_TRUE(whole == formatted(format, STATION_RECORD_MAX + 7));
+  }
+}
+
+void test_report_cost_against_printf() {
+  for (int count : STATION_COUNTS) {
+    connectStations(count);
+    hal::resetHeapStats();
+    double encoders = reportNS(count, [](Print& sink) { reportStations(sink, STATION_TEXT); });
+    uint32_t allocations = hal::heap.allocations;
+    double json = reportNS(count, [](Print& sink) { reportStations(sink, STATION_JSON); });
+    double printfLoop = reportNS(count, [](Print& sink) { printfReport(sink, STATION_TEXT); });
+    printf("%2d stations: %8.0f ns text, %8.0f ns JSON, printf loop %8.0f ns (%.1fx)\n",
+           count, encoders, json, printfLoop, printfLoop / encoders);
+    TEST_ASSERT_EQUAL(0, allocations);
+    if (count >= 4) {
+      TEST_ASSERT_LESS_THAN(printfLoop, encoders);
+    }
+  }
+}
+
+
+int main() {
+  setupStationTable();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_text_and_json_match_printf);
+  RUN_TEST(test_binary_records_decode_to_the_table);
+  RUN_TEST(test_small_buffers_get_whole_records);
+  RUN_TEST(test_report_cost_against_printf);
+  return UNITY_END();
+}
@@ -0,0 +1,225 @@
+/****************************************************************************************
+* ESPStationTable.h fed by the HAL's SoftAP join/leave/probe events: a synthetic trace of
+* joins, leaves & re-joins (MACs that share a home slot included) is replayed & after
+* every event the table is checked against a reference set - count, lookups, the list &
+* the open addressing probe runs - with no heap allocation along the way. Also covers the
+* IP & RSSI filled in after the join & a full table turning joins away.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPStationTable.h"
+#include <unity.h>
+#include <map>
+
+const int TRACE_EVENTS = 5000;
+const int MAC_POOL = 40;
+const int AP_STATION_LIMIT = 10;   // ESP32's, the larger of the two
+
+uint8_t macPool[MAC_POOL][6];
+std::map<int, uint8_t> connected;   // reference: pool index -> aid, changed under hal::Quiet
+
+void makeMAC(uint8_t mac[6], int i) {
+  uint8_t base[6] = { 0x5C, 0xCF, 0x7F, 0x00, 0x00, 0x00 };
+  memcpy(mac, base, 6);
+  if (i % 4 == 0) {
+    mac[0] = 0x10 + i;   // same device part as the others of its group, same home slot
+    mac[5] = 0x42;
+  } else {
+    mac[3] = i * 37;
+    mac[4] = i * 11;
+    mac[5] = i * 101;
+  }
+}
+
+// Every occupied slot is reachable from its home slot without crossing a free one
+void checkProbeRuns() {
+  for (int slot = 0; slot < STATION_TABLE_SIZE; slot++) {
+    if (stationTable[slot].aid == 0) {
+      continue;
+    }
+    for (int s = stationHomeSlot(stationTable[slot].mac); s != slot; s = (s + 1) & (STATION_TABLE_SIZE - 1)) {
+      TEST_ASSERT_NOT_EQUAL(0, stationTable[s].aid);
+    }
+  }
+}
+
+void checkAgainstReference() {
+  TEST_ASSERT_EQUAL(connected.size(), stationCount());
+  TEST_ASSERT_EQUAL(connected.size(), statusValues[STATUS_STATIONS]);
+  checkProbeRuns();
+
+  for (int i = 0; i < MAC_POOL; i++) {
+    StationInfo info;
+    auto it = connected.find(i);
+    bool found = getStation(macPool[i], info);
+    TEST_ASSERT_EQUAL(it != connected.end(), found);
+    if (found) {
+      TEST_ASSERT_EQUAL_MEMORY(macPool[i], info.mac, 6);
+      TEST_ASSERT_EQUAL(it->second, info.aid);
+    }
+  }
+
+  StationInfo list[STATION_TABLE_SIZE];
+  int n = listStations(list, STATION_TABLE_SIZE);
+  TEST_ASSERT_EQUAL(connected.size(), n);
+  for (int k = 0; k < n; k++) {
+    StationInfo info;
+    TEST_ASSERT_TRUE(getStation(list[k].mac, info));
+  }
+}
+
+void join(int i, uint8_t aid) {
+  {
+    hal::Quiet quiet;
+    connected[i] = aid;
+  }
+  hal::joinStation(macPool[i], aid, 0xC0A80400 + i);
+}
+
+void leave(int i) {
+  {
+    hal::Quiet quiet;
+    connected.erase(i);
+  }
+  hal::leaveStation(macPool[i]);
+}
+
+void leaveAll() {
+  while (!connected.empty()) {
+    leave(connected.begin()->first);
+  }
+}
+
+void setUp() {}
+
+void tearDown() {
+  leaveAll();
+  TEST_ASSERT_EQUAL(0, stationCount());
+}
+
+
+void test_join_then_ip_and_rssi_come_in() {
+  join(1, 1);
+  StationInfo info;
+  TEST_ASSERT_TRUE(getStation(macPool[1], info));
+  TEST_ASSERT_EQUAL(millis(), info.connectedMS);
+  TEST_ASSERT_EQUAL(0, info.ip);
+  TEST_ASSERT_EQUAL(0, info.rssi);
+
+  delay(1000);
+  updateStationTable();   // ESP8266: the IP from the SDK list
+  hal::probeRequest(macPool[1], -61);
+  TEST_ASSERT_TRUE(getStation(macPool[1], info));
+  TEST_ASSERT_EQUAL_HEX32(0xC0A80401, info.ip);
+  TEST_ASSERT_EQUAL(-61, info.rssi);
+  TEST_ASSERT_EQUAL(millis(), info.lastSeenMS);
+  TEST_ASSERT_EQUAL(millis() - 1000, info.connectedMS);
+
+  hal::probeRequest(macPool[2], -50);   // not connected, ignored
+  TEST_ASSERT_FALSE(getStation(macPool[2], info));
+}
+
+void test_update_only_walks_the_list_for_missing_ips() {
+  join(1, 1);
+  join(2, 2);
+  hal::resetHeapStats();
+  updateStationTable();
+  TEST_ASSERT_GREATER_THAN(0, hal::heap.allocations);   // the SDK's list, freed again
+
+  hal::resetHeapStats();
+  for (int i = 0; i < 10; i++) {
+    updateStationTable();
+  }
+  TEST_ASSERT_EQUAL(0, hal::heap.allocations);   // every IP known, nothing to look up
+}
+
+void test_same_home_slot_survives_removals() {
+  // Pool entries 0, 4, 8... share their device part, so one home slot & one probe run
+  for (int i = 0; i < 8 * 4; i += 4) {
+    join(i, i + 1);
+  }
+  checkAgainstReference();
+  leave(12);   // from the middle of the run
+  checkAgainstReference();
+  leave(0);    // the head
+  checkAgainstReference();
+  join(12, 99);
+  checkAgainstReference();
+}
+
+void test_rejoin_and_unknown_leave() {
+  join(3, 3);
+  join(3, 7);   // joined again without a leave: same slot, new aid
+  checkAgainstReference();
+  TEST_ASSERT_EQUAL(1, stationCount());
+
+  uint32_t version = stationTableVersion;
+  hal::joinStation(macPool[5], 5, 0);
+  uint8_t unknown[6] = { 1, 2, 3, 4, 5, 6 };
+  removeStation(unknown);
+  TEST_ASSERT_EQUAL(version + 1, stationTableVersion);
+  TEST_ASSERT_EQUAL(2, stationCount());
+  {
+    hal::Quiet quiet;
+    connected[5] = 5;
+  }
+}
+
+void test_full_table_turns_joins_away() {
+  for (int i = 0; i < STATION_TABLE_SIZE; i++) {
+    join(i, i + 1);
+  }
+  checkAgainstReference();
+  hal::joinStation(macPool[STATION_TABLE_SIZE], 17, 0);
+  TEST_ASSERT_EQUAL(STATION_TABLE_SIZE, stationCount());
+  StationInfo info;
+  TEST_ASSERT_FALSE(getStation(macPool[STATION_TABLE_SIZE], info));
+  hal::leaveStation(macPool[STATION_TABLE_SIZE]);
+  checkAgainstReference();
+}
+
+void test_replayed_trace_stays_consistent_without_heap() {
+  int joins = 0, leaves = 0, rejoins = 0;
+  hal::resetHeapStats();
+  for (int event = 0; event < TRACE_EVENTS; event++) {
+    int i = random(MAC_POOL);
+    if (connected.count(i)) {
+      if (random(4) == 0) {
+        join(i, random(1, 256));   // roamed back before the leave was seen
+        rejoins++;
+      } else {
+        leave(i);
+        leaves++;
+      }
+    } else if ((int)connected.size() < AP_STATION_LIMIT) {
+      join(i, random(1, 256));
+      joins++;
+    } else {
+      leave(connected.begin()->first);
+      leaves++;
+    }
+    delay(random(1, 500));
+    checkAgainstReference();
+  }
+  printf("trace: %d joins, %d leaves, %d re-joins, %u heap allocations\n",
+         joins, leaves, rejoins, (unsigned)hal::heap.allocations);
+  TEST_ASSERT_EQUAL(0, hal::heap.allocations);
+  TEST_ASSERT_GREATER_THAN(TRACE_EVENTS / 4, leaves);
+}
+
+
+int main() {
+  for (int i = 0; i < MAC_POOL; i++) {
+    makeMAC(macPool[i], i);
+  }
+  setupStationTable();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_join_then_ip_and_rssi_come_in);
+  RUN_TEST(test_update_only_walks_the_list_for_missing_ips);
+  RUN_TEST(test_same_home_slot_survives_removals);
+  RUN_TEST(test_rejoin_and_unknown_leave);
+  RUN_TEST(test_full_table_turns_joins_away);
+  RUN_TEST(test_replayed_trace_stays_consistent_without_heap);
+  return UNITY_END();
+}
@@ -0,0 +1,177 @@
+/****************************************************************************************
+* ESPStatusLED.h against the HAL's simulated Ticker: each pattern's on/off times & period
+* are exact (blinks, error code pulses & pause), the breathing ramp is symmetric & peaks
+* at full level, a minute of blinking does not drift, a loop() held up in delay() does not
+* stretch a blink, posting the playing pattern again keeps its phase, a new one starts at
+* its first step at once, & solid on & off run no timer.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPStatusLED.h"
+#include <unity.h>
+#include <vector>
+
+// LED level (0..STATUS_LED_MAX_LEVEL, active low undone) now
+int ledNow() {
+  int pin = hal::pinLevels[STATUS_LED_PIN & 31];
+  return STATUS_LED_ACTIVE_LOW ? STATUS_LED_MAX_LEVEL - pin : pin;
+}
+
+// LED level at each ms from now for `ms`
+std::vector<int> trace(unsigned long ms) {
+  std::vector<int> levels;
+  for (unsigned long t = 0; t < ms; t++) {
+    levels.push_back(ledNow());
+    delay(1);
+  }
+  return levels;
+}
+
+// Times (ms from the start of the trace) the level changed
+std::vector<unsigned long> edges(const std::vector<int>& levels) {
+  std::vector<unsigned long> at;
+  for (size_t t = 1; t < levels.size(); t++) {
+    if (levels[t] != levels[t - 1]) {
+      at.push_back(t);
+    }
+  }
+  return at;
+}
+
+// A blink pattern's level at `t` ms after it started
+int expectedLevel(const LEDPattern& pattern, unsigned long t) {
+  return ledLevel(pattern, (t / pattern.stepMS) % pattern.steps);
+}
+
+void checkPattern(const LEDPattern& pattern, unsigned long ms) {
+  setLEDPattern(LED_OFF);
+  setLEDPattern(pattern);
+  std::vector<int> levels = trace(ms);
+  for (unsigned long t = 0; t < ms; t++) {
+    TEST_ASSERT_EQUAL(expectedLevel(pattern, t), levels[t]);
+  }
+}
+
+void setUp() {
+  setupStatusLED();
+}
+
+void tearDown() {}
+
+
+void test_blinks_are_exact() {
+  checkPattern(LED_FAST_BLINK, 5000);
+  checkPattern(LED_SLOW_BLINK, 10000);
+  setLEDPattern(LED_OFF);
+  setLEDPattern(LED_FAST_BLINK);
+  std::vector<unsigned long> at = edges(trace(2001));
+  TEST_ASSERT_EQUAL(8, at.size());
+  for (size_t i = 0; i < at.size(); i++) {
+    TEST_ASSERT_EQUAL(250 * (i + 1), at[i]);
+  }
+}
+
+void test_error_codes_pulse_then_pause() {
+  for (uint8_t code = 1; code <= 5; code++) {
+    LEDPattern pattern = ledErrorCode(code);
+    checkPattern(pattern, 2 * (code * 2 + LED_PAUSE_STEPS) * LED_PULSE_MS);
+
+    setLEDPattern(LED_OFF);
+    setLEDPattern(pattern);
+    std::vector<int> levels = trace((code * 2 + LED_PAUSE_STEPS) * LED_PULSE_MS);
+    int pulses = levels[0] ? 1 : 0;
+    for (unsigned long at : edges(levels)) {
+      pulses += levels[at] ? 1 : 0;
+    }
+    TEST_ASSERT_EQUAL(code, pulses);
+    for (size_t t = code * 2 * LED_PULSE_MS; t < levels.size(); t++) {
+      TEST_ASSERT_EQUAL(0, levels[t]);   // the pause
+    }
+  }
+  TEST_ASSERT_TRUE(samePattern(ledErrorCode(1), ledErrorCode(0)));
+  TEST_ASSERT_TRUE(samePattern(ledErrorCode(12), ledErrorCode(200)));
+}
+
+void test_breathing_ramps_up_and_down() {
+  setLEDPattern(LED_BREATHE);
+  unsigned long period = LED_BREATHE.stepMS * LED_BREATHE.steps;
+  std::vector<int> levels = trace(2 * period);
+  TEST_ASSERT_EQUAL(0, levels[0]);
+  TEST_ASSERT_EQUAL(STATUS_LED_MAX_LEVEL, levels[period / 2]);
+  for (unsigned long t = 0; t < period; t++) {
+    TEST_ASSERT_EQUAL(levels[t], levels[t + period]);   // repeats
+    if (t > 0 && t < period / 2) {
+      TEST_ASSERT_GREATER_OR_EQUAL(levels[t - 1], levels[t]);   // up
+      unsigned long mirror = (period - t + LED_BREATHE.stepMS - 1) / LED_BREATHE.stepMS * LED_BREATHE.stepMS;
+      TEST_ASSERT_EQUAL(levels[t / LED_BREATHE.stepMS * LED_BREATHE.stepMS], levels[mirror]);   // & down the same way
+    }
+  }
+  // Squared: halfway up the ramp is under a quarter of the level
+  TEST_ASSERT_LESS_THAN(STATUS_LED_MAX_LEVEL / 4, levels[period / 4]);
+}
+
+void test_no_drift_over_a_minute() {
+  setLEDPattern(LED_FAST_BLINK);
+  unsigned long start = millis();
+  delay(60000);
+  std::vector<int> levels = trace(1000);
+  for (unsigned long t = 0; t < 1000; t++) {
+    TEST_ASSERT_EQUAL(expectedLevel(LED_FAST_BLINK, 60000 + t), levels[t]);
+  }
+  TEST_ASSERT_EQUAL(61000, millis() - start);
+}
+
+void test_blocked_loop_does_not_stretch_the_blink() {
+  setLEDPattern(LED_SLOW_BLINK);
+  std::vector<int> levels;
+  for (int pass = 0; pass < 20; pass++) {
+    // A loop() pass held up 0.7 s (the old setupOTA() delay(500) & more), posting the pattern again
+    setLEDPattern(LED_SLOW_BLINK);
+    for (int t = 0; t < 700; t++) {
+      levels.push_back(ledNow());
+      delay(1);
+    }
+  }
+  for (size_t t = 0; t < levels.size(); t++) {
+    TEST_ASSERT_EQUAL(expectedLevel(LED_SLOW_BLINK, t), levels[t]);   // same phase, no restarts
+  }
+}
+
+void test_new_pattern_starts_at_once() {
+  setLEDPattern(LED_SLOW_BLINK);
+  delay(1500);   // in an off step
+  TEST_ASSERT_EQUAL(0, ledNow());
+  setLEDPattern(LED_FAST_BLINK);
+  TEST_ASSERT_EQUAL(STATUS_LED_MAX_LEVEL, ledNow());   // first step, not at the next tick
+  std::vector<unsigned long> at = edges(trace(600));
+  TEST_ASSERT_EQUAL(250, at[0]);
+}
+
+void test_solid_patterns_run_no_timer() {
+  setLEDPattern(LED_ON);
+  TEST_ASSERT_EQUAL(STATUS_LED_MAX_LEVEL, ledNow());
+  uint32_t writes = hal::pinWrites;
+  delay(10000);
+  TEST_ASSERT_EQUAL(writes, hal::pinWrites);
+  TEST_ASSERT_FALSE(ledTicker.active());
+
+  setLEDPattern(LED_OFF);
+  TEST_ASSERT_EQUAL(0, ledNow());
+  for (int i = 0; i < 1000; i++) {
+    setLEDPattern(LED_OFF);   // what loop() does on every pass
+  }
+  TEST_ASSERT_EQUAL(writes + 1, hal::pinWrites);
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_blinks_are_exact);
+  RUN_TEST(test_error_codes_pulse_then_pause);
+  RUN_TEST(test_breathing_ramps_up_and_down);
+  RUN_TEST(test_no_drift_over_a_minute);
+  RUN_TEST(test_blocked_loop_does_not_stretch_the_blink);
+  RUN_TEST(test_new_pattern_starts_at_once);
+  RUN_TEST(test_solid_patterns_run_no_timer);
+  return UNITY_END();
+}
@@ -0,0 +1,225 @@
+/****************************************************************************************
+* ESPStatusPush.h through ElegantOTAHelper.h's server: a new dashboard gets every field,
+* then one delta per PUSH_PERIOD_MS with the latest values, pushed by the "push" task of
+* scheduleOTA() & not by handleOTA(). A client that takes no data keeps one bit per field
+* & is dropped after PUSH_SLOW_CLIENT_MS, so with N stalled clients the heap stays under
+* a fixed ceiling per client however long they stall.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ElegantOTAHelper.h"
+#include <unity.h>
+
+const size_t TCP_SEND_BUFFER = 2920;   // lwIP's default, 2 MSS
+
+AsyncWebSocketClient* socketClient(uint32_t id) {
+  return hal::wsClient(statusSocket, id);
+}
+
+const std::string& lastMessage(uint32_t id) {
+  return socketClient(id)->_sent.back();
+}
+
+// A client that reads nothing: lwIP's send buffer fills with what was queued
+void fillSendBuffer(uint32_t id) {
+  AsyncWebSocketClient* client = socketClient(id);
+  size_t queued = 0;
+  for (const std::string& message : client->_queue) {
+    queued += message.size() + 2;   // WebSocket frame header
+  }
+  client->client()->sendSpace = queued >= TCP_SEND_BUFFER ? 0 : TCP_SEND_BUFFER - queued;
+}
+
+void runScheduler(unsigned long ms) {
+  for (unsigned long end = millis() + ms; (long)(millis() - end) < 0;) {
+    Scheduler::run();
+  }
+}
+
+void disconnectAll() {
+  while (!statusSocket._clients.empty()) {
+    hal::wsDisconnect(statusSocket, statusSocket._clients.front()->id());
+  }
+}
+
+void setUp() {
+  delay(PUSH_PERIOD_MS);
+}
+
+void tearDown() {
+  disconnectAll();
+  delay(1);   // pending close events
+}
+
+
+void test_new_client_gets_every_field() {
+  setStatus(STATUS_RSSI, -64);
+  uint32_t id = hal::wsConnect(statusSocket);
+  handleStatusPush();
+  TEST_ASSERT_EQUAL(1, socketClient(id)->_sent.size());
+  const std::string& message = lastMessage(id);
+  for (int i = 0; i < STATUS_FIELD_COUNT; i++) {
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, message.find(STATUS_FIELD_NAMES[i]));
+  }
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, message.find("\"rssi\":-64"));
+}
+
+void test_changes_within_a_period_go_out_as_one_delta() {
+  uint32_t id = hal::wsConnect(statusSocket);
+  handleStatusPush();
+  delay(PUSH_PERIOD_MS);
+
+  setStatus(STATUS_RSSI, -60);
+  setStatus(STATUS_CONNECTED, 1);
+  setStatus(STATUS_RSSI, -72);
+  setStatus(STATUS_RSSI, -73, 3);   // within the deadband, not a change
+  handleStatusPush();
+  TEST_ASSERT_EQUAL(2, socketClient(id)->_sent.size());
+  TEST_ASSERT_EQUAL_STRING("{\"connected\":1,\"rssi\":-72}", lastMessage(id).c_str());
+
+  handleStatusPush();   // nothing changed, nothing sent
+  delay(PUSH_PERIOD_MS);
+  handleStatusPush();
+  TEST_ASSERT_EQUAL(2, socketClient(id)->_sent.size());
+}
+
+void test_push_task_sends_and_handleota_does_not() {
+  uint32_t id = hal::wsConnect(statusSocket);
+  handleStatusPush();
+  delay(PUSH_PERIOD_MS);
+
+  setStatus(STATUS_STATIONS, 3);
+  handleOTA();
+  TEST_ASSERT_EQUAL(1, socketClient(id)->_sent.size());
+
+  // A change every 20 ms for 2 s (upload progress): one delta per period from the "push" task
+  for (int i = 0; i < 100; i++) {
+    hal::after(20 * (i + 1), [i, id]() {
+      setStatus(STATUS_OTA_BYTES, i * 1436);
+      hal::wsDeliver(statusSocket, id);
+    });
+  }
+  runScheduler(2000 + PUSH_PERIOD_MS);
+  size_t messages = socketClient(id)->_sent.size() - 1;
+  TEST_ASSERT_UINT32_WITHIN(1, 2000 / PUSH_PERIOD_MS, messages);
+  TEST_ASSERT_EQUAL_STRING("{\"otaBytes\":142164}", lastMessage(id).c_str());
+}
+
+void test_stalled_client_keeps_fields_not_messages() {
+  uint32_t id = hal::wsConnect(statusSocket);
+  handleStatusPush();
+  hal::wsDeliver(statusSocket, id);
+  socketClient(id)->client()->sendSpace = 0;   // stops reading
+
+  for (int i = 0; i < 10; i++) {
+    delay(PUSH_PERIOD_MS);
+    setStatus(STATUS_GATEWAY_RTT, 10 + i);
+    setStatus(STATUS_INTERNET, i % 2);
+    handleStatusPush();
+  }
+  TEST_ASSERT_EQUAL(1, socketClient(id)->_sent.size());   // nothing queued while it is stalled
+
+  socketClient(id)->client()->sendSpace = TCP_SEND_BUFFER;   // reads again
+  delay(PUSH_PERIOD_MS);
+  handleStatusPush();
+  TEST_ASSERT_EQUAL(2, socketClient(id)->_sent.size());
+  TEST_ASSERT_EQUAL_STRING("{\"internet\":1,\"gatewayRTT\":19}", lastMessage(id).c_str());
+}
+
+void test_client_stalled_too_long_is_dropped() {
+  uint32_t id = hal::wsConnect(statusSocket);
+  uint32_t other = hal::wsConnect(statusSocket);
+  handleStatusPush();
+  socketClient(id)->client()->sendSpace = 0;
+  uint32_t dropped = pushDropped;
+
+  for (unsigned long ms = 0; ms < PUSH_SLOW_CLIENT_MS + 2 * PUSH_PERIOD_MS; ms += PUSH_PERIOD_MS) {
+    setStatus(STATUS_RSSI, statusValues[STATUS_RSSI] - 1);
+    delay(PUSH_PERIOD_MS);
+    handleStatusPush();
+    hal::wsDeliver(statusSocket, other);
+  }
+  TEST_ASSERT_EQUAL(dropped + 1, pushDropped);
+  TEST_ASSERT_NULL(socketClient(id));
+  TEST_ASSERT_NOT_NULL(statusSocket.client(other));   // the reading one stays
+
+  uint32_t again = hal::wsConnect(statusSocket);     // its slot is free again
+  TEST_ASSERT_NOT_NULL(statusSocket.client(again));
+}
+
+void test_clients_beyond_the_limit_are_closed() {
+  uint32_t ids[PUSH_MAX_CLIENTS + 1];
+  for (int i = 0; i <= PUSH_MAX_CLIENTS; i++) {
+    ids[i] = hal::wsConnect(statusSocket);
+  }
+  delay(1);
+  TEST_ASSERT_EQUAL(PUSH_MAX_CLIENTS, statusSocket.count());
+  TEST_ASSERT_NULL(socketClient(ids[PUSH_MAX_CLIENTS]));
+}
+
+// Heap taken by the push with `clients` stalled dashboards while fields change every 50 ms
+int64_t stalledClientsPeak(int clients, unsigned long stallMS) {
+  for (int i = 0; i < clients; i++) {
+    hal::wsConnect(statusSocket);
+  }
+  hal::resetHeapStats();
+  int64_t before = hal::heap.liveBytes;
+  for (unsigned long ms = 0; ms < stallMS; ms += 50) {
+    for (int field = 0; field < STATUS_FIELD_COUNT; field++) {
+      setStatus((StatusField)field, ms % 100 ? -1000000001 : -1000000002);   // every field, longest values
+    }
+    delay(50);
+    handleStatusPush();
+    for (AsyncWebSocketClient* client : statusSocket._clients) {
+      fillSendBuffer(client->id());
+    }
+  }
+  int64_t peak = hal::heap.peakBytes - before;
+  disconnectAll();
+  delay(PUSH_PERIOD_MS);
+  return peak;
+}
+
+void test_memory_ceiling_with_n_stalled_clients() {
+  const int64_t perClient = 8 * (PUSH_MESSAGE_MAX + 32);   // WS_MAX_QUEUED_MESSAGES at most, then nothing more
+  for (int clients = 1; clients <= PUSH_MAX_CLIENTS; clients++) {
+    int64_t shortStall = stalledClientsPeak(clients, 1000);
+    int64_t longStall = stalledClientsPeak(clients, PUSH_SLOW_CLIENT_MS - PUSH_PERIOD_MS);
+    TEST_ASSERT_LESS_OR_EQUAL(clients * perClient, longStall);
+    TEST_ASSERT_EQUAL(shortStall, longStall);   // does not grow with time
+  }
+
+  // Once they are dropped, everything they held is back
+  hal::resetHeapStats();
+  int64_t live = hal::heap.liveBytes;
+  for (int i = 0; i < PUSH_MAX_CLIENTS; i++) {
+    hal::wsConnect(statusSocket);
+  }
+  for (unsigned long ms = 0; ms < PUSH_SLOW_CLIENT_MS + 3000; ms += PUSH_PERIOD_MS) {
+    setStatus(STATUS_OTA_BYTES, ms);
+    delay(PUSH_PERIOD_MS);
+    handleStatusPush();
+    for (AsyncWebSocketClient* client : statusSocket._clients) {
+      fillSendBuffer(client->id());
+    }
+  }
+  delay(1);
+  TEST_ASSERT_EQUAL(0, statusSocket._clients.size());
+  TEST_ASSERT_EQUAL(live, hal::heap.liveBytes);
+}
+
+
+int main() {
+  setupOTA();
+  scheduleOTA();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_new_client_gets_every_field);
+  RUN_TEST(test_changes_within_a_period_go_out_as_one_delta);
+  RUN_TEST(test_push_task_sends_and_handleota_does_not);
+  RUN_TEST(test_stalled_client_keeps_fields_not_messages);
+  RUN_TEST(test_client_stalled_too_long_is_dropped);
+  RUN_TEST(test_clients_beyond_the_limit_are_closed);
+  RUN_TEST(test_memory_ceiling_with_n_stalled_clients);
+  return UNITY_END();
+}
@@ -0,0 +1,259 @@
+/****************************************************************************************
+* ESPWiFiConfig.h: a config round-trips through the record, an older (shorter) record
+* loads & keeps the defaults for the fields it lacks, & a cut, corrupted, newer or
+* out of range record is refused with the config left as it was. Then LittleFS: save,
+* load, a broken file & a file system that does not mount (left as it is, not formatted).
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPWiFiHelper.h"
+#include <unity.h>
+
+const WiFiConfig defaults = wifiConfig;
+
+WiFiConfig changedConfig() {
+  WiFiConfig config = {
+    WIFI_MODE_AP_STA,
+    "portal", "portal-password", IPAddress(10, 0, 0, 1), IPAddress(255, 255, 0, 0),
+    "home", "home-password-0123456789", "sensor-7", true, true,
+    IPAddress(10, 1, 2, 3), IPAddress(10, 1, 2, 254), IPAddress(255, 255, 255, 128), IPAddress(9, 9, 9, 9)
+  };
+  return config;
+}
+
+std::vector<uint8_t> record(const WiFiConfig& config) {
+  uint8_t data[WIFI_CONFIG_MAX_SIZE];
+  size_t length = serializeWiFiConfig(config, data, sizeof(data));
+  return std::vector<uint8_t>(data, data + length);
+}
+
+// Cut the body after `bodyEnd` bytes (header included) & write a matching length & CRC,
+// like a firmware that did not have the later fields yet
+std::vector<uint8_t> sealedAt(std::vector<uint8_t> bytes, size_t bodyEnd) {
+  bytes.resize(bodyEnd);
+  size_t length = bodyEnd + 4;
+  bytes[5] = length;
+  bytes[6] = length >> 8;
+  uint32_t crc = fastConnectCRC(bytes.data(), bodyEnd);
+  for (int i = 0; i < 4; i++) {
+    bytes.push_back(crc >> (8 * i));
+  }
+  return bytes;
+}
+
+// Resealed with its own length, after a change to the body
+std::vector<uint8_t> resealed(const std::vector<uint8_t>& bytes) {
+  return sealedAt(bytes, bytes.size() - 4);
+}
+
+bool load(const std::vector<uint8_t>& bytes, WiFiConfig& config) {
+  return deserializeWiFiConfig(bytes.data(), bytes.size(), config);
+}
+
+void assertSameConfig(const WiFiConfig& expected, const WiFiConfig& actual) {
+  TEST_ASSERT_EQUAL(expected.mode, actual.mode);
+  TEST_ASSERT_EQUAL_STRING(expected.apSSID, actual.apSSID);
+  TEST_ASSERT_EQUAL_STRING(expected.apPassword, actual.apPassword);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)expected.apIP, (uint32_t)actual.apIP);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)expected.apSubnet, (uint32_t)actual.apSubnet);
+  TEST_ASSERT_EQUAL_STRING(expected.staSSID, actual.staSSID);
+  TEST_ASSERT_EQUAL_STRING(expected.staPassword, actual.staPassword);
+  TEST_ASSERT_EQUAL_STRING(expected.hostName, actual.hostName);
+  TEST_ASSERT_EQUAL(expected.useStaticIP, actual.useStaticIP);
+  TEST_ASSERT_EQUAL(expected.useFastConnect, actual.useFastConnect);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)expected.staticIP, (uint32_t)actual.staticIP);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)expected.gateway, (uint32_t)actual.gateway);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)expected.subnet, (uint32_t)actual.subnet);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)expected.dns, (uint32_t)actual.dns);
+}
+
+void setUp() {
+  wifiConfig = defaults;
+}
+
+void tearDown() {}
+
+
+void test_round_trip() {
+  WiFiConfig changed = changedConfig();
+  std::vector<uint8_t> bytes = record(changed);
+  TEST_ASSERT_GREATER_THAN(11, bytes.size());
+
+  WiFiConfig loaded = defaults;
+  TEST_ASSERT_TRUE(load(bytes, loaded));
+  assertSameConfig(changed, loaded);
+
+  loaded = changed;   // & back: the defaults round-trip too
+  TEST_ASSERT_TRUE(load(record(defaults), loaded));
+  assertSameConfig(defaults, loaded);
+}
+
+void test_longest_strings_fit() {
+  WiFiConfig config = defaults;
+  memset(config.apPassword, 'p', sizeof(config.apPassword) - 1);
+  memset(config.staPassword, 's', sizeof(config.staPassword) - 1);
+  memset(config.staSSID, 'n', sizeof(config.staSSID) - 1);
+  memset(config.apSSID, 'a', sizeof(config.apSSID) - 1);
+  memset(config.hostName, 'h', sizeof(config.hostName) - 1);
+  std::vector<uint8_t> bytes = record(config);
+  TEST_ASSERT_LESS_OR_EQUAL(WIFI_CONFIG_MAX_SIZE, bytes.size());
+
+  WiFiConfig loaded = defaults;
+  TEST_ASSERT_TRUE(load(bytes, loaded));
+  assertSameConfig(config, loaded);
+}
+
+void test_buffer_too_small() {
+  uint8_t data[40];
+  TEST_ASSERT_EQUAL(0, serializeWiFiConfig(changedConfig(), data, sizeof(data)));
+}
+
+void test_older_record_keeps_the_defaults_it_lacks() {
+  WiFiConfig changed = changedConfig();
+  // header 7, mode & flags 2, then the length-prefixed SoftAP strings & its 2 addresses,
+  // then the STA strings: an older version that ended after the host name
+  size_t afterHostName = 9 + 1 + strlen(changed.apSSID) + 1 + strlen(changed.apPassword) + 8 +
+                         1 + strlen(changed.staSSID) + 1 + strlen(changed.staPassword) + 1 + strlen(changed.hostName);
+
+  WiFiConfig loaded = defaults;
+  TEST_ASSERT_TRUE(load(sealedAt(record(changed), afterHostName), loaded));
+  TEST_ASSERT_EQUAL(WIFI_MODE_AP_STA, loaded.mode);
+  TEST_ASSERT_EQUAL_STRING("home", loaded.staSSID);
+  TEST_ASSERT_EQUAL_STRING("sensor-7", loaded.hostName);
+  TEST_ASSERT_TRUE(loaded.useStaticIP);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)defaults.staticIP, (uint32_t)loaded.staticIP);   // not in that version
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)defaults.dns, (uint32_t)loaded.dns);
+
+  // One that only had the mode & flags
+  loaded = defaults;
+  TEST_ASSERT_TRUE(load(sealedAt(record(changed), 9), loaded));
+  TEST_ASSERT_EQUAL(WIFI_MODE_AP_STA, loaded.mode);
+  TEST_ASSERT_TRUE(loaded.useFastConnect);
+  TEST_ASSERT_EQUAL_STRING(defaults.apSSID, loaded.apSSID);
+  TEST_ASSERT_EQUAL_STRING(defaults.staPassword, loaded.staPassword);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)defaults.apIP, (uint32_t)loaded.apIP);
+}
+
+void test_record_cut_inside_a_field_is_refused() {
+  WiFiConfig changed = changedConfig();
+  size_t inApIP = 9 + 1 + strlen(changed.apSSID) + 1 + strlen(changed.apPassword) + 2;
+  size_t inApSSID = 9 + 3;
+  size_t beforeFlags = 8;
+
+  const size_t cuts[] = { inApIP, inApSSID, beforeFlags };
+  for (size_t cut : cuts) {
+    WiFiConfig loaded = defaults;
+    TEST_ASSERT_FALSE(load(sealedAt(record(changed), cut), loaded));
+    assertSameConfig(defaults, loaded);
+  }
+}
+
+void test_any_corrupted_byte_is_refused() {
+  std::vector<uint8_t> good = record(changedConfig());
+  for (size_t i = 0; i < good.size(); i++) {
+    std::vector<uint8_t> bytes = good;
+    bytes[i] ^= 0x10;
+    WiFiConfig loaded = defaults;
+    TEST_ASSERT_FALSE(load(bytes, loaded));
+    assertSameConfig(defaults, loaded);
+  }
+
+  WiFiConfig loaded = defaults;
+  TEST_ASSERT_FALSE(load(std::vector<uint8_t>(good.begin(), good.end() - 1), loaded));   // cut short
+  good.push_back(0);
+  TEST_ASSERT_FALSE(load(good, loaded));                                                   // trailing byte
+  TEST_ASSERT_FALSE(deserializeWiFiConfig(good.data(), 0, loaded));
+}
+
+void test_well_sealed_but_invalid_records_are_refused() {
+  std::vector<uint8_t> good = record(changedConfig());
+  WiFiConfig loaded = defaults;
+
+  std::vector<uint8_t> bytes = good;
+  bytes[4] = WIFI_CONFIG_VERSION + 1;   // from a newer firmware
+  TEST_ASSERT_FALSE(load(resealed(bytes), loaded));
+
+  bytes = good;
+  bytes[4] = 0;
+  TEST_ASSERT_FALSE(load(resealed(bytes), loaded));
+
+  bytes = good;
+  bytes[0] = 'X';                       // magic
+  TEST_ASSERT_FALSE(load(resealed(bytes), loaded));
+
+  bytes = good;
+  bytes[7] = WIFI_MODE_AP_STA + 1;      // mode
+  TEST_ASSERT_FALSE(load(resealed(bytes), loaded));
+
+  bytes = good;
+  bytes[9] = sizeof(loaded.apSSID);     // string longer than its field
+  TEST_ASSERT_FALSE(load(resealed(bytes), loaded));
+
+  bytes.assign(WIFI_CONFIG_MAX_SIZE + 1, 0);
+  TEST_ASSERT_FALSE(load(bytes, loaded));
+  assertSameConfig(defaults, loaded);
+}
+
+void test_save_and_load_through_littlefs() {
+  LittleFS.begin();
+  LittleFS.remove(WIFI_CONFIG_PATH);
+  WiFiConfig loaded = defaults;
+  TEST_ASSERT_FALSE(loadWiFiConfig(loaded));   // no file
+
+  TEST_ASSERT_TRUE(saveWiFiConfig(changedConfig()));
+  TEST_ASSERT_FALSE(hal::hasFile("/wifi.cfg.tmp"));
+  TEST_ASSERT_TRUE(loadWiFiConfig(loaded));
+  assertSameConfig(changedConfig(), loaded);
+
+  std::string broken = hal::readFile(WIFI_CONFIG_PATH);
+  broken[10] ^= 0xFF;
+  hal::putFile(WIFI_CONFIG_PATH, broken.data(), broken.size());
+  loaded = defaults;
+  TEST_ASSERT_FALSE(loadWiFiConfig(loaded));
+  assertSameConfig(defaults, loaded);
+}
+
+void test_unmountable_filesystem_is_not_formatted() {
+  LittleFS.begin();
+  TEST_ASSERT_TRUE(saveWiFiConfig(changedConfig()));
+  LittleFS.end();
+  hal::fsMountable = false;
+  hal::serialOutput.clear();
+
+  WiFiConfig loaded = defaults;
+  TEST_ASSERT_FALSE(loadWiFiConfig(loaded));
+  assertSameConfig(defaults, loaded);
+  TEST_ASSERT_FALSE(saveWiFiConfig(changedConfig()));
+  flushLog();
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, hal::serialOutput.find("LittleFS mount failed! Using the default Wi-Fi config."));
+  TEST_ASSERT_EQUAL(0, hal::fsFormats);
+  TEST_ASSERT_TRUE(hal::hasFile(WIFI_CONFIG_PATH));   // still there for a later mount
+
+  hal::fsMountable = true;
+  TEST_ASSERT_TRUE(loadWiFiConfig(loaded));
+  assertSameConfig(changedConfig(), loaded);
+}
+
+void test_deserializing_does_not_allocate() {
+  std::vector<uint8_t> bytes = record(changedConfig());
+  WiFiConfig loaded = defaults;
+  hal::resetHeapStats();
+  TEST_ASSERT_TRUE(load(bytes, loaded));
+  TEST_ASSERT_EQUAL(0, hal::heap.allocations);
+}
+
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_longest_strings_fit);
+  RUN_TEST(test_buffer_too_small);
+  RUN_TEST(test_older_record_keeps_the_defaults_it_lacks);
+  RUN_TEST(test_record_cut_inside_a_field_is_refused);
+  RUN_TEST(test_any_corrupted_byte_is_refused);
+  RUN_TEST(test_well_sealed_but_invalid_records_are_refused);
+  RUN_TEST(test_save_and_load_through_littlefs);
+  RUN_TEST(test_unmountable_filesystem_is_not_formatted);
+  RUN_TEST(test_deserializing_does_not_allocate);
+  return UNITY_END();
+}
@@ -0,0 +1,242 @@
+/****************************************************************************************
+* ESPWiFiEvents.h fed by the HAL's Wi-Fi events & by a scripted flapping-link trace:
+* events arrive typed & in order (reason code, BSSID, IP, station MAC & aid), a plain
+* subscriber gets every one, a coalescing one the last per channel & batch with the count
+* folded into it, masks filter, a full ring drops & counts, the subscriber table is fixed.
+* Also prints the host cost of dispatching an event, which allocates nothing.
+****************************************************************************************/
+
+#include <Arduino.h>
+#include "ESPWiFiEvents.h"
+#include <unity.h>
+#include <chrono>
+#include <vector>
+
+const int FLAPS = 3;                  // link down & up again within one dispatch window, 5 events each
+const int TRACE_MS = 60000;           // flapping-link trace, dispatched by the scheduler
+const unsigned long FLAP_EVERY_MS = 35;
+const int BENCH_BATCHES = 20000;
+
+const uint8_t PHONE[6] = { 0x3C, 0x22, 0xFB, 0x01, 0x02, 0x03 };
+const uint8_t LAPTOP[6] = { 0x8C, 0x85, 0x90, 0x0A, 0x0B, 0x0C };
+
+std::vector<WiFiBusEvent> plainGot;
+std::vector<WiFiBusEvent> coalescedGot;
+std::vector<WiFiBusEvent> ipOnlyGot;
+
+void onPlain(const WiFiBusEvent& event) {
+  hal::Quiet quiet;
+  plainGot.push_back(event);
+}
+
+void onCoalesced(const WiFiBusEvent& event) {
+  hal::Quiet quiet;
+  coalescedGot.push_back(event);
+}
+
+void onIPOnly(const WiFiBusEvent& event) {
+  hal::Quiet quiet;
+  ipOnlyGot.push_back(event);
+}
+
+volatile uint32_t benchSink = 0;
+void onBench(const WiFiBusEvent& event) {
+  benchSink += event.type;
+}
+
+int plainId = -1, coalescedId = -1, ipOnlyId = -1;
+
+// The platform callbacks of a link going down & coming back, as the Wi-Fi task posts them
+void flap(uint8_t reason) {
+  const uint8_t bssid[6] = { 0x02, 0, 0, 0, 0, 1 };
+  postWiFiEvent(WIFI_EVENT_BUS_DISCONNECTED, reason, bssid);
+  postWiFiEvent(WIFI_EVENT_BUS_INTERNET, 0);
+  postWiFiEvent(WIFI_EVENT_BUS_GOT_IP, 0, nullptr, IPAddress(192, 168, 1, 77));
+}
+
+void clearGot() {
+  hal::Quiet quiet;
+  plainGot.clear();
+  coalescedGot.clear();
+  ipOnlyGot.clear();
+}
+
+void setUp() {
+  handleWiFiEvents();   // nothing left over
+  clearGot();
+}
+
+void tearDown() {}
+
+
+void test_platform_events_arrive_typed_and_in_order() {
+  WiFi.mode(WIFI_AP_STA);
+  WiFi.begin("YOUR_SSID_NAME", "YOUR_SSID_PW");
+  delay(2000);
+  hal::dropLink(WIFI_DISCONNECT_REASON_BEACON_TIMEOUT);
+  hal::joinStation(PHONE, 1, IPAddress(192, 168, 4, 2));
+  hal::leaveStation(PHONE);
+  handleWiFiEvents();
+
+  TEST_ASSERT_EQUAL(4, plainGot.size());
+  TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_GOT_IP, plainGot[0].type);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)hal::dhcpIP, plainGot[0].ip);
+  TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_DISCONNECTED, plainGot[1].type);
+  TEST_ASSERT_EQUAL(WIFI_DISCONNECT_REASON_BEACON_TIMEOUT, plainGot[1].value);
+  TEST_ASSERT_EQUAL_MEMORY(hal::accessPoints[0].bssid, plainGot[1].mac, 6);
+  TEST_ASSERT_EQUAL(millis(), plainGot[1].atMS);
+  TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_STATION_JOINED, plainGot[2].type);
+  TEST_ASSERT_EQUAL(1, plainGot[2].value);
+  TEST_ASSERT_EQUAL_MEMORY(PHONE, plainGot[2].mac, 6);
+  TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_STATION_LEFT, plainGot[3].type);
+  for (const WiFiBusEvent& event : plainGot) {
+    TEST_ASSERT_EQUAL(1, event.count);
+  }
+
+  TEST_ASSERT_EQUAL(1, ipOnlyGot.size());   // its mask
+  TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_GOT_IP, ipOnlyGot[0].type);
+}
+
+void test_flapping_link_is_coalesced() {
+  for (int i = 0; i < FLAPS; i++) {
+    flap(WIFI_DISCONNECT_REASON_BEACON_TIMEOUT + i);
+    hal::joinStation(LAPTOP, 2, 0);   // a station flapping too
+    hal::leaveStation(LAPTOP);
+  }
+  hal::joinStation(PHONE, 3, 0);
+  TEST_ASSERT_EQUAL(WIFI_EVENTS_QUEUE, wifiEventHead - wifiEventTail);   // a full ring, nothing dropped
+  handleWiFiEvents();
+
+  // Every event, in the order posted
+  TEST_ASSERT_EQUAL(FLAPS * 5 + 1, plainGot.size());
+  for (int i = 0; i < FLAPS; i++) {
+    TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_DISCONNECTED, plainGot[i * 5].type);
+    TEST_ASSERT_EQUAL(WIFI_DISCONNECT_REASON_BEACON_TIMEOUT + i, plainGot[i * 5].value);
+    TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_INTERNET, plainGot[i * 5 + 1].type);
+    TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_GOT_IP, plainGot[i * 5 + 2].type);
+    TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_STATION_JOINED, plainGot[i * 5 + 3].type);
+    TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_STATION_LEFT, plainGot[i * 5 + 4].type);
+  }
+
+  // The last of each channel - internet, the STA link, the laptop, the phone - in the order they came last
+  TEST_ASSERT_EQUAL(4, coalescedGot.size());
+  TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_INTERNET, coalescedGot[0].type);
+  TEST_ASSERT_EQUAL(0, coalescedGot[0].value);   // the state it ended in
+  TEST_ASSERT_EQUAL(FLAPS, coalescedGot[0].count);
+  TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_GOT_IP, coalescedGot[1].type);
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)IPAddress(192, 168, 1, 77), coalescedGot[1].ip);
+  TEST_ASSERT_EQUAL(FLAPS * 2, coalescedGot[1].count);
+  TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_STATION_LEFT, coalescedGot[2].type);
+  TEST_ASSERT_EQUAL_MEMORY(LAPTOP, coalescedGot[2].mac, 6);
+  TEST_ASSERT_EQUAL(FLAPS * 2, coalescedGot[2].count);
+  TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_STATION_JOINED, coalescedGot[3].type);
+  TEST_ASSERT_EQUAL_MEMORY(PHONE, coalescedGot[3].mac, 6);
+  TEST_ASSERT_EQUAL(1, coalescedGot[3].count);
+
+  TEST_ASSERT_EQUAL(FLAPS, ipOnlyGot.size());
+}
+
+void test_scheduled_trace_batches_per_window() {
+  Scheduler::taskCount = 0;
+  scheduleWiFiEvents();
+  uint32_t posted = wifiEventsPosted;
+  uint32_t dropped = wifiEventsDropped;
+  unsigned long start = millis();
+  unsigned long nextFlapMS = start;
+  while (millis() - start < TRACE_MS) {
+    if (millis() >= nextFlapMS) {
+      flap(WIFI_DISCONNECT_REASON_BEACON_TIMEOUT);
+      nextFlapMS += FLAP_EVERY_MS;
+    }
+    Scheduler::sleepWhenIdle = false;
+    Scheduler::run();
+    delay(1);
+  }
+  handleWiFiEvents();
+  uint32_t events = wifiEventsPosted - posted;
+  printf("flapping trace: %u events in %d s, plain subscriber %u calls, coalescing %u calls, %u dropped\n",
+         events, TRACE_MS / 1000, (unsigned)plainGot.size(), (unsigned)coalescedGot.size(), wifiEventsDropped - dropped);
+
+  TEST_ASSERT_EQUAL(dropped, wifiEventsDropped);   // the ring holds a window of flaps
+  TEST_ASSERT_EQUAL(events, plainGot.size());
+  uint32_t folded = 0;
+  for (const WiFiBusEvent& event : coalescedGot) {
+    folded += event.count;
+  }
+  TEST_ASSERT_EQUAL(events, folded);   // nothing lost, only folded
+  // Two channels (link & internet), one call each per 100 ms window
+  TEST_ASSERT_UINT32_WITHIN(4, 2 * TRACE_MS / WIFI_EVENTS_PERIOD_MS, coalescedGot.size());
+  Scheduler::taskCount = 0;
+}
+
+void test_full_ring_drops_and_counts() {
+  uint32_t dropped = wifiEventsDropped;
+  for (int i = 0; i < WIFI_EVENTS_QUEUE; i++) {
+    TEST_ASSERT_TRUE(postWiFiEvent(WIFI_EVENT_BUS_INTERNET, i & 1));
+  }
+  TEST_ASSERT_FALSE(postWiFiEvent(WIFI_EVENT_BUS_GOT_IP));
+  TEST_ASSERT_EQUAL(dropped + 1, wifiEventsDropped);
+  handleWiFiEvents();
+  TEST_ASSERT_EQUAL(WIFI_EVENTS_QUEUE, plainGot.size());
+  TEST_ASSERT_EQUAL(WIFI_EVENT_BUS_INTERNET, plainGot.back().type);   // the newest was the one dropped
+  TEST_ASSERT_TRUE(postWiFiEvent(WIFI_EVENT_BUS_GOT_IP));   // room again
+}
+
+void test_subscriber_table_is_fixed() {
+  int ids[WIFI_EVENTS_MAX_SUBSCRIBERS];
+  int added = 0;
+  while ((ids[added] = subscribeWiFiEvents(onBench)) >= 0) {
+    added++;
+  }
+  TEST_ASSERT_EQUAL(WIFI_EVENTS_MAX_SUBSCRIBERS - 3, added);
+  unsubscribeWiFiEvents(ids[0]);
+  TEST_ASSERT_EQUAL(ids[0], subscribeWiFiEvents(onBench));
+  for (int i = 0; i < added; i++) {
+    unsubscribeWiFiEvents(ids[i]);
+  }
+}
+
+void test_dispatch_cost_per_event() {
+  unsubscribeWiFiEvents(plainId);
+  unsubscribeWiFiEvents(coalescedId);
+  unsubscribeWiFiEvents(ipOnlyId);
+  int plain = subscribeWiFiEvents(onBench);
+  int coalescing = subscribeWiFiEvents(onBench, WIFI_EVENT_BUS_ALL, true);
+
+  hal::resetHeapStats();
+  auto start = std::chrono::steady_clock::now();
+  for (int batch = 0; batch < BENCH_BATCHES; batch++) {
+    for (int i = 0; i < WIFI_EVENTS_QUEUE / 4; i++) {
+      flap(WIFI_DISCONNECT_REASON_BEACON_TIMEOUT);
+      postWiFiEvent(WIFI_EVENT_BUS_STATION_JOINED, 1, PHONE);
+    }
+    handleWiFiEvents();
+  }
+  auto took = std::chrono::steady_clock::now() - start;
+  double perEvent = std::chrono::duration_cast<std::chrono::nanoseconds>(took).count() / ((double)BENCH_BATCHES * WIFI_EVENTS_QUEUE);
+  printf("dispatch: %.1f ns per event (post & a full batch to a plain & a coalescing subscriber)\n", perEvent);
+  TEST_ASSERT_EQUAL(0, hal::heap.allocations);
+  TEST_ASSERT_LESS_THAN(5000.0, perEvent);
+
+  unsubscribeWiFiEvents(plain);
+  unsubscribeWiFiEvents(coalescing);
+}
+
+
+int main() {
+  hal::addAccessPoint("YOUR_SSID_NAME", "YOUR_SSID_PW", 1, 6, -55);
+  setupWiFiEvents();
+  setupWiFiEvents();   // the helpers may each call it, the handlers are registered once
+  plainId = subscribeWiFiEvents(onPlain);
+  coalescedId = subscribeWiFiEvents(onCoalesced, WIFI_EVENT_BUS_ALL, true);
+  ipOnlyId = subscribeWiFiEvents(onIPOnly, WIFI_EVENT_BUS_MASK(WIFI_EVENT_BUS_GOT_IP));
+
+  UNITY_BEGIN();
+  RUN_TEST(test_platform_events_arrive_typed_and_in_order);
+  RUN_TEST(test_flapping_link_is_coalesced);
+  RUN_TEST(test_scheduled_trace_batches_per_window);
+  RUN_TEST(test_full_ring_drops_and_counts);
+  RUN_TEST(test_subscriber_table_is_fixed);
+  RUN_TEST(test_dispatch_cost_per_event);
+  return UNITY_END();
+}